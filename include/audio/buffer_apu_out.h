@@ -0,0 +1,29 @@
+#ifndef SDGBC_BUFFER_APU_OUT_H_
+#define SDGBC_BUFFER_APU_OUT_H_
+
+#include "hw/apu/apu.h"
+#include "types.h"
+#include <vector>
+
+// collects interleaved left/right samples in memory until cleared. used by
+// embedders that pull audio after each frame
+class BufferApuOutput : public IApuOutput {
+public:
+  BufferApuOutput();
+
+  void AudioBufferSamples(i16 leftSample, i16 rightSample) override;
+  bool AudioIsMuted() const override;
+
+  // while disabled, no samples are collected and the APU runs in lazy mode
+  void SetEnabled(bool val);
+  bool IsEnabled() const;
+
+  const std::vector<i16>& GetSamples() const;
+  void ClearSamples();
+
+private:
+  std::vector<i16> samples_;
+  bool enabled_;
+};
+
+#endif // SDGBC_BUFFER_APU_OUT_H_
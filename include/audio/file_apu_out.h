@@ -0,0 +1,92 @@
+#ifndef SDGBC_FILE_APU_OUT_H_
+#define SDGBC_FILE_APU_OUT_H_
+
+#include "hw/apu/apu.h"
+#include "spsc_queue.h"
+#include "types.h"
+#include <array>
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// amount of sample frames that can be queued for the writer thread. at our
+// output sample rate, this is a bit under 3 seconds worth of audio
+constexpr std::size_t kFileApuQueueSize = 1 << 17;
+
+// size in bytes that each output file buffers in memory before writing
+constexpr std::size_t kFileApuWriteBufferSize = 1 << 16;
+
+enum class FileApuOutputFormat {
+  Wav,   // 16-bit signed PCM WAV
+  RawPcm // headerless 16-bit signed little-endian PCM
+};
+
+// streams the APU output to a file. samples are passed to a writer thread
+// through a lock-free queue so that the emulation thread never blocks on file
+// IO; if the writer can't keep up, samples are dropped and counted instead.
+// per-channel stems can optionally be recorded into separate mono files, which
+// are named after the main file with ".ch1" to ".ch4" inserted before the
+// extension
+class FileApuOutput : public IApuOutput {
+public:
+  FileApuOutput();
+  ~FileApuOutput();
+
+  bool Open(const std::string& filePath,
+            FileApuOutputFormat format = FileApuOutputFormat::Wav,
+            bool recordStems = false);
+  // flushes all queued samples and finalizes the files
+  void Close();
+
+  bool IsOpen() const;
+  // returns the amount of sample frames dropped since Open()
+  u64 GetDroppedSamples() const;
+
+  void AudioBufferSamples(i16 leftSample, i16 rightSample) override;
+  bool AudioIsMuted() const override;
+
+  bool AudioWantsChannelVolumes() const override;
+  void AudioBufferChannelVolumes(const ApuChannelVolumes& volumes) override;
+
+  // the same as GetDroppedSamples()
+  u64 AudioGetNumOverruns() const override;
+
+private:
+  struct SampleFrame {
+    i16 left, right;
+    ApuChannelVolumes volumes;
+  };
+
+  struct OutputFile {
+    std::ofstream stream;
+    std::vector<char> writeBuffer;
+    u64 dataSize;
+    unsigned int numChannels;
+
+    bool Open(const std::string& filePath, FileApuOutputFormat format,
+              unsigned int channels);
+    void Close(FileApuOutputFormat format);
+
+    void PutSample(i16 sample);
+    void Flush();
+  };
+
+  SpscQueue<SampleFrame> queue_;
+  ApuChannelVolumes pendingVolumes_;
+
+  FileApuOutputFormat format_;
+  std::atomic<bool> recordStems_;
+  OutputFile mainFile_;
+  std::array<OutputFile, 4> stemFiles_;
+
+  std::thread writerThread_;
+  std::atomic<bool> isOpen_;
+  std::atomic<u64> droppedSamples_;
+
+  void WriterThreadMain();
+  void WriteFrames(const SampleFrame* frames, std::size_t count);
+};
+
+#endif // SDGBC_FILE_APU_OUT_H_
@@ -40,6 +40,9 @@ public:
   void AudioBufferSamples(i16 leftSample, i16 rightSample) override;
   bool AudioIsMuted() const override;
 
+  u64 AudioGetNumUnderruns() const override;
+  u64 AudioGetNumOverruns() const override;
+
   bool IsStreaming() const;
 
 private:
@@ -60,6 +63,10 @@ private:
   std::condition_variable streamWaitCondition_;
   std::atomic<bool> isStreaming_;
 
+  // times onGetData() had to wait for samples, and samples dropped because the
+  // back buffer was full
+  std::atomic<u64> numUnderruns_, numOverruns_;
+
   bool onGetData(Chunk& data) override;
   void onSeek(sf::Time timeOffset) override;
 };
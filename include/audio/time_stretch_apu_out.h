@@ -0,0 +1,58 @@
+#ifndef SDGBC_TIME_STRETCH_APU_OUT_H_
+#define SDGBC_TIME_STRETCH_APU_OUT_H_
+
+#include "hw/apu/apu.h"
+#include "types.h"
+#include <vector>
+
+// sample frames in each half of the windows that get overlapped. output is
+// produced in blocks of this size
+constexpr std::size_t kTimeStretchHopFrames = 512;
+
+// how far (in sample frames) either side of its ideal position each window may
+// be moved to line up with the previous one
+constexpr std::size_t kTimeStretchSearchFrames = 256;
+
+// passes samples on to another output at 1/speed of the rate that they are
+// produced, without changing their pitch. uses WSOLA: windows of the input
+// spaced speed times further apart than the output are cross-faded together,
+// each shifted slightly to wherever it best lines up with the end of the last
+// so that the joins don't smear the waveform
+class TimeStretchApuOutput : public IApuOutput {
+public:
+  explicit TimeStretchApuOutput(IApuOutput* out = nullptr);
+
+  void AudioBufferSamples(i16 leftSample, i16 rightSample) override;
+  bool AudioIsMuted() const override;
+
+  void SetOutput(IApuOutput* out);
+  IApuOutput* GetOutput() const;
+
+  // at speeds of 1 or less, samples are passed straight through
+  void SetSpeed(double speed);
+  double GetSpeed() const;
+
+  // drops any input that hasn't been stretched yet
+  void Reset();
+
+private:
+  IApuOutput* out_;
+  double speed_;
+
+  // interleaved left/right samples, starting from input frame inputBase_
+  std::vector<float> input_;
+  u64 inputBase_;
+
+  // ideal start of the next window and the actual start of the last one, as
+  // input frame numbers
+  double nextPos_;
+  u64 lastPos_;
+  bool hasLast_;
+
+  void ProcessWindows();
+  u64 FindBestWindowPos(u64 idealPos) const;
+  double GetWindowSimilarity(u64 pos, std::size_t step) const;
+  void OutputFrame(float left, float right);
+};
+
+#endif // SDGBC_TIME_STRETCH_APU_OUT_H_
@@ -0,0 +1,115 @@
+#ifndef SDGBC_BENCH_RUNNER_H_
+#define SDGBC_BENCH_RUNNER_H_
+
+#include "bench/bench_scenes.h"
+#include "bench/micro_bench.h"
+#include "hw/gbc.h"
+#include "perf_counters.h"
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// the hardware components that time is split between, as reported by
+// Gbc::UpdateFrameInSteps(). Other is everything else spent updating (the
+// serial port and the update loop itself)
+enum BenchComponent : unsigned int {
+  kBenchCpu = kGbcUpdateCpu,
+  kBenchPpu = kGbcUpdatePpu,
+  kBenchApu = kGbcUpdateApu,
+  kBenchTimer = kGbcUpdateTimer,
+  kBenchDma = kGbcUpdateDma,
+  kBenchOther = kGbcUpdateOther,
+  kBenchNumComponents = kGbcNumUpdateSteps
+};
+
+struct BenchRomScene {
+  std::string romFilePath;
+  std::string stateFilePath; // loaded before running (if not empty)
+};
+
+struct BenchOptions {
+  // frames measured for each scene, after a few to warm up
+  u64 numFrames;
+
+  // run these ROMs (with optional save states) as scenes. if empty, the
+  // built-in scenes are run instead
+  std::vector<BenchRomScene> romScenes;
+  // only run the built-in scenes with these names (all if empty)
+  std::vector<std::string> sceneNames;
+  bool listScenes;
+
+  // run the component and opcode microbenchmarks instead of any scenes
+  bool micro;
+
+  // also count host hardware events per frame with PerfCounters, split
+  // between the components if the counters have fast reads
+  bool perfCounters;
+
+  // also write the results to this file as JSON (if not empty)
+  std::string jsonFilePath;
+
+  // compare with the results that an earlier run wrote as JSON (if not
+  // empty). scenes that got slower per frame (or microbenchmarks that got
+  // slower per op) by more than tolerancePercent count as regressions
+  std::string baselineFilePath;
+  double tolerancePercent;
+
+  BenchOptions();
+};
+
+enum BenchExitCode : int {
+  kBenchExitOk = 0,
+  kBenchExitRegression = 1,
+  kBenchExitError = 2
+};
+
+struct BenchResult {
+  std::string name;
+  u64 numFrames;
+  double hostSeconds;
+  double framesPerSecond;
+  double instructionsPerSecond;
+  double nanosPerFrame;
+  std::array<double, kBenchNumComponents> componentNanosPerFrame;
+
+  bool hasPerfCounts, hasComponentPerfCounts;
+  PerfCounts perfCountsPerFrame;
+  std::array<PerfCounts, kBenchNumComponents> componentPerfCountsPerFrame;
+};
+
+// runs each scene headless and as fast as the host allows, reporting how fast
+// it emulated and how that time was split between the hardware components
+class BenchRunner {
+public:
+  explicit BenchRunner(const BenchOptions& options,
+                       std::ostream& os = std::cout);
+
+  int Run();
+
+private:
+  const BenchOptions options_;
+  std::ostream& os_;
+
+  std::vector<BenchResult> results_;
+  std::vector<MicroBenchResult> microResults_;
+  PerfCounters perfCounters_;
+
+  bool RunScenes();
+  bool RunScene(const std::string& name, Gbc& gbc);
+  u64 RunFrames(Gbc& gbc, u64 numFrames);
+  std::array<double, kBenchNumComponents> RunTimedFrames(Gbc& gbc,
+                                                         u64 numFrames);
+  std::array<PerfCounts, kBenchNumComponents> RunCountedFrames(Gbc& gbc,
+                                                               u64 numFrames);
+  void RunMicro();
+  void PrintCpuOpResults(const std::array<double, 256>& nanos,
+                         bool cbOps) const;
+
+  void PrintResult(const BenchResult& result) const;
+  void WritePerfCountsJson(std::ostream& os, const PerfCounts& counts) const;
+  bool WriteJson() const;
+  int CompareWithBaseline() const;
+};
+
+#endif // SDGBC_BENCH_RUNNER_H_
@@ -0,0 +1,20 @@
+#ifndef SDGBC_BENCH_SCENES_H_
+#define SDGBC_BENCH_SCENES_H_
+
+#include "types.h"
+#include <string>
+#include <vector>
+
+// a workload for the benchmark, as a small ROM that stresses one part of the
+// hardware and runs forever
+struct BenchScene {
+  std::string name;
+  std::string description;
+  std::vector<u8> romData;
+};
+
+// the scenes built into sdgbc-bench. their ROMs are assembled here rather
+// than loaded from files, so the benchmark needs nothing besides the binary
+std::vector<BenchScene> BuildBenchScenes();
+
+#endif // SDGBC_BENCH_SCENES_H_
@@ -0,0 +1,14 @@
+#ifndef SDGBC_DISCARD_APU_OUT_H_
+#define SDGBC_DISCARD_APU_OUT_H_
+
+#include "hw/apu/apu.h"
+
+// takes the samples so that the APU does its full work (as it would when
+// playing) rather than running in lazy mode, then throws them away
+class DiscardApuOutput : public IApuOutput {
+public:
+  void AudioBufferSamples(i16, i16) override {}
+  bool AudioIsMuted() const override { return false; }
+};
+
+#endif // SDGBC_DISCARD_APU_OUT_H_
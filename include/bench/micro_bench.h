@@ -0,0 +1,27 @@
+#ifndef SDGBC_MICRO_BENCH_H_
+#define SDGBC_MICRO_BENCH_H_
+
+#include "types.h"
+#include <array>
+#include <string>
+#include <vector>
+
+// the time given for opcodes that aren't benchmarked
+constexpr double kMicroBenchSkipped = -1.0;
+
+struct MicroBenchResult {
+  std::string name;
+  double nanosPerOp;
+};
+
+// drives the APU, PPU, MMU and DMA on their own with synthetic workloads,
+// without the rest of the hardware being updated alongside them
+std::vector<MicroBenchResult> RunComponentMicroBenches();
+
+// the time that Cpu::Update() takes to execute each opcode (or each
+// CB-prefixed opcode if cbOps), including fetching it. the undefined opcodes,
+// which hang the CPU, are kMicroBenchSkipped. RST opcodes include the RET at
+// the vector that they call
+std::array<double, 256> RunCpuOpMicroBenches(bool cbOps);
+
+#endif // SDGBC_MICRO_BENCH_H_
@@ -0,0 +1,37 @@
+#ifndef SDGBC_ROM_WRITER_H_
+#define SDGBC_ROM_WRITER_H_
+
+#include "types.h"
+#include <initializer_list>
+#include <vector>
+
+// code is emitted from here, just after the cartridge header
+constexpr u16 kRomWriterCodeStart = 0x150;
+
+// assembles a 32 KiB ROM-only cartridge for the benchmarks. code is emitted
+// from kRomWriterCodeStart, and the entry point jumps to wherever Finish() is
+// told
+class RomWriter {
+public:
+  explicit RomWriter(bool cgbSupported);
+
+  u16 Here() const;
+
+  void Emit(std::initializer_list<u8> bytes);
+  void Emit16(u8 op, u16 val);
+  // op is a relative jump (e.g 0x20 for jr nz) back to target
+  void EmitJr(u8 op, u16 target);
+  // busy-waits until LY is (or, if whileEqual, is no longer) ly
+  void EmitWaitLy(u8 ly, bool whileEqual);
+
+  void Place(u16 loc, const std::vector<u8>& data);
+  void Place(u16 loc, std::initializer_list<u8> bytes);
+
+  std::vector<u8> Finish(u16 entry);
+
+private:
+  std::vector<u8> rom_;
+  u16 pc_;
+};
+
+#endif // SDGBC_ROM_WRITER_H_
@@ -1,6 +1,7 @@
 #ifndef SDGBC_CPU_CMD_MODE_H_
 #define SDGBC_CPU_CMD_MODE_H_
 
+#include "debug/guest_profiler.h"
 #include "debug/serial_stdout.h"
 #include "hw/gbc.h"
 
@@ -8,11 +9,14 @@ class CpuCmdMode {
 public:
   CpuCmdMode();
 
-  int Run(const std::string& romFilePath = {});
+  int Run(const std::string& romFilePath = {},
+          const std::string& symFilePath = {});
 
 private:
   Gbc gbc_;
   SerialStdout serialStdout_;
+  GuestProfiler profiler_;
+  GuestSymbols symbols_;
 
   unsigned long long totalCpuSteps_, totalCpuCycles_;
   bool autoResume_, updateGbcOnStep_;
@@ -23,6 +27,9 @@ private:
   bool ExecuteUserCommand(const std::string& cmd);
   RomLoadResult ExecuteLoadRomCommand(std::string romFilePath = {});
   void ExecuteViewMemoryAreaCommand();
+  void ExecuteLoadSymbolsCommand(std::string symFilePath = {});
+  void ExecuteProfileReportCommand();
+  void ToggleProfiling();
 
   void ExecuteStepCpuCommand();
   void StepCpu(unsigned int steps = 1);
@@ -0,0 +1,138 @@
+#ifndef SDGBC_GUEST_PROFILER_H_
+#define SDGBC_GUEST_PROFILER_H_
+
+#include "hw/gbc.h"
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// a location in the guest's address space. as in RGBDS .sym files, bank is
+// the ROM bank for $0000-$7fff, the WRAM bank for $d000-$dfff and 0 elsewhere
+struct GuestLocation {
+  u16 bank, loc;
+};
+
+enum class SymFileLoadResult {
+  Ok,
+  ReadError,
+  InvalidFormat
+};
+
+std::string GetSymFileLoadResultAsMessage(SymFileLoadResult result);
+
+// symbols loaded from a .sym file written by rgblink (-n), used to name the
+// locations in a guest profile
+class GuestSymbols {
+public:
+  // replaces any symbols already loaded. on failure, none are kept
+  SymFileLoadResult LoadSymFile(const std::string& filePath);
+  void Clear();
+
+  std::size_t GetNumSymbols() const;
+
+  // the name of the closest symbol at or before location in the same bank and
+  // memory area plus an offset (e.g "Main.loop+$3"), or the location itself
+  // (e.g "01:4abc") if there is none
+  std::string GetLocationName(GuestLocation location) const;
+  // likewise, but only the name of the closest global symbol (skipping local
+  // labels, which contain a '.') with no offset
+  std::string GetFunctionName(GuestLocation location) const;
+
+private:
+  struct Symbol {
+    u32 key; // bank << 16 | loc
+    std::string name;
+    bool isLocal;
+  };
+
+  std::vector<Symbol> symbols_; // sorted by key
+
+  const Symbol* FindSymbol(GuestLocation location, bool globalOnly) const;
+};
+
+// the max amount of nodes in the call tree. calls that would need more are
+// counted towards their caller
+constexpr std::size_t kGuestProfilerMaxCallNodes = 1 << 16;
+
+enum class GuestProfileFormat {
+  Flat,  // self cycles by function and by instruction
+  Tree,  // the call tree, with inclusive and self cycles
+  Folded // folded stacks, for flamegraph.pl and similar tools
+};
+
+// what GuestProfiler::BeginStep() saw before the hardware was updated
+struct GuestProfilerStep {
+  u64* cycleCount; // nullptr if the location has no count
+  u16 pc, sp;
+  u16 interruptVector; // of the interrupt about to be serviced, or 0 if none
+  bool isIdle; // the CPU won't run (halted, stopped or hung)
+};
+
+// accumulates the CPU cycles spent at each guest instruction, keyed by its ROM
+// bank (or WRAM bank) and PC, in flat arrays. calls are followed with a shadow
+// call stack to build a call tree: a CALL or RST is recognised by the return
+// address it pushes, an interrupt by the CPU's interrupt state, and a return by
+// popping back to one of them. jumps through "push hl; ret" and other stack
+// tricks are treated as plain jumps.
+//
+// attach it with Gbc::SetGuestProfiler(); a Gbc without one only pays for a
+// branch per update
+class GuestProfiler {
+public:
+  GuestProfiler();
+
+  // discards the profile, sizing it for the ROM loaded into gbc
+  void Clear(const Gbc& gbc);
+  // forgets the shadow call stack, e.g after a reset or loading a state
+  void ResetCallStack();
+
+  // called around each update of the hardware, with the amount of CPU cycles
+  // that the update took
+  GuestProfilerStep BeginStep(const GbcHardware& hw);
+  void EndStep(const GbcHardware& hw, const GuestProfilerStep& step,
+               unsigned int cycles);
+
+  u64 GetTotalCycles() const;
+  u64 GetIdleCycles() const; // spent not running
+
+  void WriteReport(std::ostream& os, GuestProfileFormat format,
+                   const GuestSymbols& symbols) const;
+  bool WriteReportFile(const std::string& filePath, GuestProfileFormat format,
+                       const GuestSymbols& symbols) const;
+
+private:
+  struct CallNode {
+    GuestLocation entry;
+    u32 parent, firstChild, nextSibling;
+    u64 selfCycles, idleCycles;
+  };
+
+  struct CallFrame {
+    u32 node;
+    u16 returnLoc, sp; // sp just after the return address was pushed
+  };
+
+  std::vector<u64> romCycles_; // indexed by ROM offset
+  std::vector<u64> ramCycles_; // $8000-$ffff, then WRAM banks 2-7
+  u64 totalCycles_, idleCycles_;
+
+  std::vector<CallNode> nodes_; // the first is the root
+  std::vector<CallFrame> callStack_;
+  u32 currentNode_;
+
+  GuestLocation GetLocation(const GbcHardware& hw, u16 loc) const;
+  u64* GetCycleCount(const GbcHardware& hw, u16 loc);
+
+  void EnterCall(const GbcHardware& hw, u16 targetLoc, u16 returnLoc, u16 sp);
+  void ReturnFromCall(u16 returnLoc, u16 sp);
+  void PopDeadFrames(u16 sp);
+
+  std::vector<u64> GetInclusiveCycles() const; // by node
+
+  void WriteFlatReport(std::ostream& os, const GuestSymbols& symbols) const;
+  void WriteTreeReport(std::ostream& os, const GuestSymbols& symbols) const;
+  void WriteFoldedStacks(std::ostream& os, const GuestSymbols& symbols) const;
+};
+
+#endif // SDGBC_GUEST_PROFILER_H_
@@ -0,0 +1,26 @@
+#ifndef SDGBC_SERIAL_BUFFER_H_
+#define SDGBC_SERIAL_BUFFER_H_
+
+#include "hw/serial.h"
+#include <string>
+
+// captures every byte sent over serial. test ROMs commonly report their
+// results this way
+class SerialBuffer : public ISerialOutput {
+public:
+  SerialBuffer();
+
+  void SerialReset() override;
+
+  void SerialWriteBit(bool bitSet) override;
+  void SerialOnByteWritten() override;
+
+  const std::string& GetData() const;
+  void ClearData();
+
+private:
+  u8 outByte_;
+  std::string data_;
+};
+
+#endif // SDGBC_SERIAL_BUFFER_H_
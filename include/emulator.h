@@ -1,7 +1,14 @@
 #ifndef SDGBC_EMULATOR_H_
 #define SDGBC_EMULATOR_H_
 
+#include "audio/time_stretch_apu_out.h"
 #include "hw/gbc.h"
+#include "movie.h"
+#include "netplay.h"
+#include "perf_counters.h"
+#include "rewind_buffer.h"
+#include "seqlock.h"
+#include "spsc_queue.h"
 #include <atomic>
 #include <chrono>
 #include <condition_variable>
@@ -13,13 +20,76 @@ using FrameDurationMillis = std::chrono::duration<int_least64_t,
                                                   std::ratio<10000, 597275>>;
 constexpr FrameDurationMillis kFrameTime(1);
 
-// VBlank takes 70224 clock cycles in normal speed mode.
-// 4.194304 MHz div 59.7275 = approx 70224 clock cycles
-constexpr auto kNormalSpeedCyclesPerFrame = 70224u;
-
-// system is clocked at 4.194304 MHz in normal speed mode
-constexpr auto kNormalSpeedClockRateHz = 4194304u;
+// max amount of setter calls that can be waiting for the emulation thread to
+// apply them before the caller has to apply them itself
+constexpr std::size_t kEmulatorCommandQueueSize = 256;
+
+// amount of frames that each set of published frame time stats covers
+constexpr auto kEmulatorStatsWindowFrames = 60u;
+
+// unless stated otherwise, stats cover the last kEmulatorStatsWindowFrames
+// frames. they are published together by the emulation thread at the end of
+// each window, so reading them never blocks it
+struct EmulatorStats {
+  u64 numFrames; // emulated since emulation was started
+
+  // emulated frames per second, and that as a percentage of the normal rate.
+  // instructions (like idlePercent) exclude frames emulated only to be rolled
+  // back, such as those ran ahead, replayed by netplay or drawn while rewinding
+  double framesPerSecond;
+  double speedPercent;
+  double instructionsPerSecond;
+
+  // host time spent emulating each frame, and how that splits between the
+  // hardware (as measured by Gbc::UpdateFrameTimed() on one frame per window).
+  // the split is only available if the window had a frame that was neither
+  // emulated by netplay nor rewound; otherwise, other is the whole frame
+  double emulateMicros;
+  bool hasUpdateTimes;
+  double cpuMicros, ppuMicros, apuMicros, otherMicros;
+
+  // frames run back-to-back to catch up after falling behind, since emulation
+  // was started
+  u64 numFramesSkipped;
+
+  // as reported by the audio output set by Emulator::SetApuOutput()
+  u64 numAudioUnderruns, numAudioOverruns;
+
+  // time that the emulation thread spent waiting to lock the emulation mutex
+  // (held by other threads while they access the hardware), per frame
+  double lockWaitMicros;
+
+  // share of the emulated time that the CPU spent halted or stopped
+  double idlePercent;
+
+  // host hardware events counted per frame on the emulation thread, if
+  // enabled by Emulator::SetPerfCountersEnabled() and the counters could be
+  // opened. counters that the host lacks read as 0
+  bool hasPerfCounts;
+  PerfCounts perfCountsPerFrame;
+  // how they split between the hardware on one frame per window, as measured
+  // by Gbc::UpdateFrameCounted(). only available if the counters have fast
+  // reads. unlike otherMicros, other only covers the hardware update
+  bool hasPerfUpdateCounts;
+  GbcUpdateCounts perfUpdateCounts;
+
+  // host time between the starts of consecutive frames, over the last
+  // kEmulatorStatsWindowFrames frames (excluding time spent paused)
+  double frameTimeMeanMicros;
+  double frameTimeVarianceMicros2;
+  double frameTimeMaxMicros;
+
+  // how late the host has recently been waking us from sleep, and how long
+  // before each frame's deadline we stop sleeping to spin instead
+  double sleepOvershootMicros;
+  double spinMarginMicros;
+};
 
+// NOTE: the setters for joypad, APU channel mute, video layer and run-ahead
+// settings don't wait for the emulation thread; they queue their change for it
+// to apply before its next frame, and their getters return the latest value
+// set. as the queue only supports a single producer, these setters must not be
+// called from more than one thread at the same time
 class Emulator {
 public:
   Emulator();
@@ -36,8 +106,69 @@ public:
   bool ExportCartridgeBatteryExtRam(const std::string& filePath) const;
   bool ImportCartridgeBatteryExtRam(const std::string& filePath);
 
+  // returns false if there is no ROM loaded to save the state of
+  bool SaveState(std::vector<u8>& outData) const;
+  StateLoadResult LoadState(const std::vector<u8>& data);
+
+  bool SaveStateFile(const std::string& filePath) const;
+  StateLoadResult LoadStateFile(const std::string& filePath);
+
   void Reset(bool forceDmgMode = false);
 
+  // a frameInterval of 0 disables rewind (and frees its history). otherwise, a
+  // state is recorded every frameInterval frames, keeping at most
+  // historySeconds worth of them within maxMemoryBytes (0 for no limit)
+  void SetRewindConfig(unsigned int historySeconds, std::size_t maxMemoryBytes,
+                       unsigned int frameInterval = 1);
+  bool IsRewindEnabled() const;
+
+  // while rewinding, each frame steps back to the previous recorded state
+  // rather than emulating forward
+  void SetRewinding(bool val);
+  bool IsRewinding() const;
+
+  std::size_t GetRewindMemoryUsage() const;
+  float GetRewindHistorySeconds() const;
+
+  // each frame, emulates numFrames further frames ahead with the current input
+  // and shows the last of those before going back, hiding that many frames of
+  // the program's own input latency. 0 disables run-ahead
+  void SetRunAheadFrames(unsigned int numFrames);
+  unsigned int GetRunAheadFrames() const;
+
+  // average extra host time spent per frame on running ahead
+  double GetRunAheadCostMicros() const;
+
+  EmulatorStats GetStats() const;
+
+  // counts hardware events (such as cache misses) on the emulation thread for
+  // the stats, through perf_event_open() on Linux. GetPerfCountersOpenResult()
+  // is the result of the emulation thread's latest attempt at opening them
+  void SetPerfCountersEnabled(bool val);
+  bool IsPerfCountersEnabled() const;
+  PerfCountersOpenResult GetPerfCountersOpenResult() const;
+
+  // records the input of every frame from the current state onwards. rewinding
+  // is ignored while recording, and resets or state loads stop the recording.
+  // returns false if there is no ROM loaded
+  bool StartMovieRecording(
+      unsigned int hashInterval = kMovieDefaultHashInterval);
+  void StopMovieRecording();
+  bool IsRecordingMovie() const;
+  // saves the movie recorded most recently (which may still be recording)
+  bool SaveMovieFile(const std::string& filePath) const;
+
+  // resets the machine and begins playing with a peer over transport (which
+  // must outlive the session) using a RollbackSession. both peers must have
+  // the same ROM loaded. the local player's keys are whatever is set with
+  // SetJoypadKeyState(). rewinding, run-ahead and movie recording are ignored
+  // while playing, and resets or state loads stop the session. returns false
+  // if there is no ROM loaded
+  bool StartNetplay(INetplayTransport& transport, unsigned int localPlayer);
+  void StopNetplay();
+  bool IsNetplayActive() const;
+  NetplayStats GetNetplayStats() const;
+
   void SetVideoLcd(ILcd* lcd);
   void SetApuOutput(IApuOutput* audioOut);
 
@@ -49,9 +180,20 @@ public:
   void SetPaused(bool val);
   bool IsPaused() const;
 
+  // with the framerate unlimited, emulation runs as fast as it can. either way
+  // when running faster than normal, only as many frames are drawn as can be
+  // shown and the audio is time-stretched to keep its pitch
   void SetLimitFramerate(bool val);
   bool IsLimitingFramerate() const;
 
+  // while fast-forwarding, frames are scheduled at speed times the normal rate
+  // (a speed of 0 doesn't limit the framerate at all)
+  void SetFastForwarding(bool val);
+  bool IsFastForwarding() const;
+
+  void SetFastForwardSpeed(unsigned int speed);
+  unsigned int GetFastForwardSpeed() const;
+
   bool IsStarted() const;
 
   void SetApuMuteCh1(bool val);
@@ -86,10 +228,92 @@ public:
   bool IsInCgbMode() const;
 
 private:
+  enum class CommandType : u8 {
+    JoypadKeyState,
+    JoypadImpossibleInputsAllowed,
+    ApuMuteChannel,
+    VideoScanlineSpritesLimiterEnabled,
+    VideoBgRenderEnabled,
+    VideoBgWindowRenderEnabled,
+    VideoSpritesRenderEnabled,
+    RunAheadFrames
+  };
+
+  struct Command {
+    CommandType type;
+    u8 target; // joypad key or APU channel number, if relevant
+    unsigned int value;
+  };
+
   Gbc gbc_;
 
-  std::atomic<bool> isPaused_, isStarted_, limitFramerate_;
-  unsigned int normalSpeedFrameCycles_;
+  // only consumed while holding emulationMutex_
+  SpscQueue<Command> commandQueue_;
+
+  // the values most recently set through the command queue, plus state that is
+  // published by the emulation thread so that it can be read without locking
+  std::atomic<bool> joypadImpossibleInputsAllowed_;
+  std::atomic<bool> apuChMuted_[4];
+  std::atomic<bool> videoScanlineSpritesLimiterEnabled_, videoBgRenderEnabled_;
+  std::atomic<bool> videoBgWindowRenderEnabled_, videoSpritesRenderEnabled_;
+  std::atomic<unsigned int> runAheadFramesSetting_;
+  std::atomic<bool> isInCgbMode_, isRewindEnabled_;
+  std::atomic<std::size_t> rewindMemoryUsage_;
+  std::atomic<float> rewindHistorySeconds_;
+
+  std::atomic<bool> isPaused_, isStarted_, limitFramerate_, isRewinding_;
+  std::atomic<bool> isFastForwarding_;
+  std::atomic<unsigned int> fastForwardSpeed_;
+  std::atomic<bool> perfCountersEnabled_;
+  std::atomic<PerfCountersOpenResult> perfCountersOpenResult_;
+
+  // sits between the APU and the audio output set by SetApuOutput()
+  TimeStretchApuOutput timeStretchOut_;
+
+  // only touched by the emulation thread
+  std::chrono::steady_clock::time_point nextPresentTime_, speedMeasureTime_;
+  unsigned int lastSpeed_, speedMeasureFrames_;
+
+  // frame pacing and its stats; also only touched by the emulation thread
+  double sleepOvershootMicros_, spinMarginMicros_;
+  std::chrono::steady_clock::time_point lastFrameStartTime_;
+  bool hasLastFrameStartTime_;
+  u64 numFrames_, numFramesSkipped_;
+  unsigned int statsWindowFrames_;
+  double statsWindowMean_, statsWindowM2_, statsWindowMax_;
+  Seqlock<EmulatorStats> stats_;
+
+  // runtime stats gathered over the current window; again only touched by the
+  // emulation thread. the CPU's totals are taken at the start of the window
+  u64 statsWindowStartFrame_, statsWindowStartInstructions_;
+  u64 statsWindowStartCycles_, statsWindowStartIdleCycles_;
+  unsigned int statsWindowEmulateFrames_;
+  double statsWindowEmulateSeconds_, statsWindowLockWaitSeconds_;
+  bool timeNextUpdateFrame_;
+  GbcUpdateTimes statsWindowUpdateTimes_;
+
+  // opened by the emulation thread, for itself, while perfCountersEnabled_.
+  // the window's second frame is counted by UpdateFrameCounted() if they have
+  // fast reads
+  PerfCounters perfCounters_;
+  PerfCounts statsWindowPerfCounts_;
+  unsigned int statsWindowPerfFrames_;
+  bool countNextUpdateFrame_, hasStatsWindowUpdateCounts_;
+  GbcUpdateCounts statsWindowUpdateCounts_;
+
+  RewindBuffer rewindBuffer_;
+  unsigned int rewindFrameInterval_, framesSinceRewindPush_;
+  std::vector<u8> frameState_;
+
+  unsigned int runAheadFrames_;
+  std::atomic<double> runAheadCostMicros_;
+
+  Movie movie_;
+  std::atomic<bool> isRecordingMovie_;
+
+  RollbackSession netplay_;
+  std::atomic<bool> isNetplayActive_;
+  Seqlock<NetplayStats> netplayStats_;
 
   std::thread emulationThread_;
   // NOTE: access of some emulated hw properties (such as cartridge ROM info)
@@ -104,8 +328,27 @@ private:
   bool StartEmulation();
   void StopEmulation();
 
+  void PushCommand(CommandType type, u8 target, unsigned int value);
+  void DrainCommands();
+  void ApplyCommand(const Command& command);
+  void PublishCgbMode();
+  void PublishRewindStats();
+
+  unsigned int GetTargetSpeed() const;
   void EmulationLoop();
-  void EmulateFrame();
+  std::unique_lock<std::mutex> LockEmulation();
+  void WaitUntil(std::chrono::steady_clock::time_point deadline);
+  void RunFrame(unsigned int speed);
+  void RecordFrameStart(std::chrono::steady_clock::time_point startTime);
+  void PublishStats();
+  void StartStatsWindow();
+  void SyncPerfCounters();
+  void EmulateFrame(bool present);
+  void RewindFrame(bool present);
+  void RunAhead();
+  void ClearRewindHistory();
+  void FinishMovieRecording();
+  void FinishNetplay();
   void PauseUntilNotify();
 };
 
@@ -0,0 +1,106 @@
+#ifndef SDGBC_EMULATOR_POOL_H_
+#define SDGBC_EMULATOR_POOL_H_
+
+#include "hw/gbc.h"
+#include "types.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using PoolInstanceId = std::size_t;
+
+// called on a worker thread after an instance finishes a frame. returning
+// false stops that instance from being stepped for the rest of the run
+using PoolFrameCallback = std::function<bool(PoolInstanceId id, Gbc& gbc)>;
+
+// steps many independent Gbc instances in parallel on a fixed set of worker
+// threads, one frame per task. each worker has its own queue of instances and
+// steals from the others once its own runs dry, so instances that stop early
+// don't leave workers idle. only instances waiting behind another in their
+// queue are stolen, and a stolen instance stays with the thief, so instances
+// move between (pinned) workers only to even out the queues. workers with
+// nothing to steal sleep until there is
+class EmulatorPool {
+public:
+  // numWorkers of 0 uses one worker per core that the process may run on. if
+  // pinWorkers is set, each worker is pinned to one of those cores where the
+  // platform supports it
+  explicit EmulatorPool(unsigned int numWorkers = 0, bool pinWorkers = true);
+  explicit EmulatorPool(const EmulatorPool& other) = delete;
+  explicit EmulatorPool(EmulatorPool&& other) = delete;
+  ~EmulatorPool();
+
+  EmulatorPool& operator=(const EmulatorPool& other) = delete;
+  EmulatorPool& operator=(EmulatorPool&& other) = delete;
+
+  // instances may only be added or accessed while Run() is not in progress
+  PoolInstanceId AddInstance(PoolFrameCallback frameCallback = {});
+  Gbc& GetInstance(PoolInstanceId id);
+  const Gbc& GetInstance(PoolInstanceId id) const;
+
+  // steps every instance for up to maxFrames frames, or until its frame
+  // callback returns false. blocks until all instances are done, then returns
+  // the total amount of frames that were run
+  u64 Run(u64 maxFrames);
+
+  // amount of frames the instance ran during the last call to Run()
+  u64 GetInstanceFrames(PoolInstanceId id) const;
+  // amount of tasks taken from another worker's queue during the last run
+  u64 GetNumSteals() const;
+
+  std::size_t GetNumInstances() const;
+  unsigned int GetNumWorkers() const;
+
+private:
+  struct Instance {
+    Gbc gbc;
+    PoolFrameCallback frameCallback;
+    PoolInstanceId id;
+    u64 frames;
+  };
+
+  struct Worker {
+    std::thread thread;
+    std::mutex queueMutex;
+    std::deque<Instance*> queue;
+  };
+
+  std::vector<std::unique_ptr<Instance>> instances_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  std::mutex runMutex_;
+  std::condition_variable runStartCondition_, runDoneCondition_;
+  u64 runGeneration_, runMaxFrames_;
+  unsigned int numRunningWorkers_;
+  bool isShuttingDown_;
+
+  std::atomic<std::size_t> numActiveInstances_;
+  std::atomic<u64> numSteals_;
+
+  // bumped whenever a task becomes stealable, for workers waiting on one
+  std::mutex idleMutex_;
+  std::condition_variable idleCondition_;
+  u64 stealGeneration_;
+  unsigned int numIdleWorkers_;
+
+  void WorkerLoop(unsigned int workerIdx);
+  void RunTask(unsigned int workerIdx, Instance& inst);
+
+  void PushTask(unsigned int workerIdx, Instance& inst);
+  Instance* TryPopTask(unsigned int workerIdx);
+  Instance* TryStealTask(unsigned int workerIdx);
+
+  u64 GetStealGeneration();
+  void WaitForStealableTask(u64 seenGeneration);
+  void NotifyIdleWorkers(bool wakeAll);
+
+  static std::vector<unsigned int> GetAllowedCores();
+  static void PinThreadToCore(std::thread& thread, unsigned int core);
+};
+
+#endif // SDGBC_EMULATOR_POOL_H_
@@ -0,0 +1,160 @@
+#ifndef SDGBC_HEADLESS_RUNNER_H_
+#define SDGBC_HEADLESS_RUNNER_H_
+
+#include "audio/file_apu_out.h"
+#include "debug/guest_profiler.h"
+#include "debug/serial_buffer.h"
+#include "emulator_pool.h"
+#include "hw/gbc.h"
+#include "link_cable.h"
+#include "perf_counters.h"
+#include "rewind_buffer.h"
+#include "video/buffer_lcd.h"
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+struct HeadlessOptions {
+  std::string romFilePath;
+  bool forceDmgMode;
+
+  u64 maxFrames;
+  // print the frame buffer hash every hashInterval frames (0 for final only)
+  u64 hashInterval;
+  // print runtime stats every statsInterval frames (0 to disable), including
+  // host hardware events counted per frame if perfCounters
+  u64 statsInterval;
+  bool perfCounters;
+
+  // stop early once the serial output contains untilSerial (if not empty)
+  std::string untilSerial;
+
+  // stop early once the byte at untilMemLoc equals untilMemVal
+  bool hasUntilMem;
+  u16 untilMemLoc;
+  u8 untilMemVal;
+
+  bool printSerial;
+
+  // record audio to this file (if not empty)
+  std::string audioFilePath;
+  FileApuOutputFormat audioFormat;
+  bool audioStems;
+
+  // load a save state before running, and/or save one afterwards (if not
+  // empty)
+  std::string loadStatePath, saveStatePath;
+
+  // record a rewind state every frame, keeping up to rewindSeconds of history,
+  // then rewind through all of it and report its cost (0 to disable)
+  unsigned int rewindSeconds;
+
+  // run this many frames ahead each frame, reporting the extra cost. the frame
+  // buffer then shows the last frame ran ahead (0 to disable)
+  unsigned int runAheadFrames;
+
+  // record the run to a movie file (if not empty), hashing the state every
+  // movieHashInterval frames
+  std::string recordMoviePath;
+  unsigned int movieHashInterval;
+
+  // instead of running normally, replay these movies in parallel and check
+  // their state hashes. each movie is replayed on whichever of romFilePath and
+  // extraRomFilePaths it was recorded with
+  std::vector<std::string> verifyMoviePaths;
+  std::vector<std::string> extraRomFilePaths;
+
+  // run this many copies of the ROM in parallel on an EmulatorPool with
+  // numWorkers worker threads (0 for one per hardware thread)
+  unsigned int numInstances;
+  unsigned int numWorkers;
+
+  // instead of running normally, run two netplay peers of the ROM against
+  // each other with netplayLatencyMillis of simulated network latency, feeding
+  // each scripted input, then check that their states match
+  bool netplayTest;
+  unsigned int netplayLatencyMillis;
+
+  // run the ROM linked by a LinkCable to a second copy of itself (or to the
+  // first of extraRomFilePaths, if given)
+  bool linkCable;
+
+  // link the ROM to another process's over a unix domain socket at
+  // linkLocalPath, sending to the other's socket at linkRemotePath (if not
+  // empty)
+  std::string linkLocalPath, linkRemotePath;
+
+  // record trace zones throughout the run, then write them to this file as
+  // Chrome trace JSON (if not empty)
+  std::string traceFilePath;
+
+  // profile the guest's code throughout the run, then write a report in
+  // profileFormat to this file ("-" for the output stream) if not empty,
+  // naming its locations with the symbols in symFilePath (if not empty)
+  std::string profileFilePath;
+  GuestProfileFormat profileFormat;
+  std::string symFilePath;
+
+  HeadlessOptions();
+};
+
+enum HeadlessExitCode : int {
+  kHeadlessExitOk = 0,           // condition met (or frames ran, if none)
+  kHeadlessExitConditionNotMet = 1,
+  kHeadlessExitError = 2
+};
+
+// runs a ROM without a GUI and as fast as the host allows, then reports frame
+// buffer hashes, serial output and timing stats
+class HeadlessRunner {
+public:
+  explicit HeadlessRunner(const HeadlessOptions& options,
+                          std::ostream& os = std::cout);
+
+  int Run();
+
+private:
+  const HeadlessOptions options_;
+  std::ostream& os_;
+
+  Gbc gbc_;
+  BufferLcd lcd_;
+  SerialBuffer serial_;
+  FileApuOutput audioOut_;
+  PerfCounters perfCounters_;
+  GuestProfiler profiler_;
+  GuestSymbols symbols_;
+
+  int RunMode();
+  int RunPool();
+  int RunVerify();
+  int RunNetplayTest();
+  int RunLinkCable();
+  int RunRemoteLinkCable();
+
+  bool HasStopCondition() const;
+  bool IsStopConditionMet(const Gbc& gbc, const SerialBuffer& serial) const;
+
+  void PrintFrameHash(u64 frame) const;
+  void PrintSerialOutput(const SerialBuffer& serial) const;
+  void PrintStats(u64 frames, double hostSeconds) const;
+
+  // where each window of runtime stats started from
+  struct StatsWindow {
+    std::chrono::steady_clock::time_point startTime;
+    u64 startFrame, startInstructions, startCycles, startIdleCycles;
+    GbcUpdateTimes updateTimes; // of the window's first frame
+    PerfCounts startPerfCounts;
+  };
+
+  void StartStatsWindow(StatsWindow& window, u64 frame) const;
+  void PrintRuntimeStats(const StatsWindow& window, u64 frame) const;
+  bool RewindAndPrintStats(RewindBuffer& rewind, u64 frames,
+                           double pushSeconds);
+
+  bool StartProfiling();
+  bool WriteProfile() const;
+};
+
+#endif // SDGBC_HEADLESS_RUNNER_H_
@@ -5,6 +5,7 @@
 #include "hw/apu/apu_chan_square.h"
 #include "hw/apu/apu_chan_wave.h"
 #include "types.h"
+#include <array>
 #include <utility>
 
 enum class ApuCh1Register {
@@ -40,15 +41,34 @@ enum class ApuCh4Register {
 // CD-quality sound output rate
 constexpr auto kApuOutputSampleRateHz = 44100u;
 
+// DAC output volumes of each sound channel (ch1-4) before they are mixed
+using ApuChannelVolumes = std::array<u8, 4>;
+
 class IApuOutput {
 public:
   virtual ~IApuOutput() = default;
 
   virtual void AudioBufferSamples(i16 leftSample, i16 rightSample) = 0;
   virtual bool AudioIsMuted() const = 0;
+
+  // outputs that want the unmixed volumes of each channel (e.g for recording
+  // per-channel stems) should override these. if AudioWantsChannelVolumes()
+  // returns true, AudioBufferChannelVolumes() is called just before every call
+  // to AudioBufferSamples(). channel mutes are not applied to these volumes
+  virtual bool AudioWantsChannelVolumes() const { return false; }
+  virtual void AudioBufferChannelVolumes(const ApuChannelVolumes&) {}
+
+  // outputs that feed a consumer running at its own pace (such as an audio
+  // device) can report how many times it ran short of samples (underruns) and
+  // how many samples were dropped for lack of room (overruns) so far. these
+  // may be called from a different thread to the one buffering samples
+  virtual u64 AudioGetNumUnderruns() const { return 0; }
+  virtual u64 AudioGetNumOverruns() const { return 0; }
 };
 
 class Cpu;
+class StateReader;
+class StateWriter;
 
 class Apu {
 public:
@@ -56,9 +76,23 @@ public:
 
   void Reset();
 
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
+
   void Update(unsigned int cycles);
 
+  // lazy mode is used automatically while there is no output attached (or the
+  // output is muted). only state that is visible through the registers is
+  // updated while in this mode
   void SetApuOutput(IApuOutput* audioOut);
+  IApuOutput* GetApuOutput() const;
+  bool IsInLazyMode() const;
+
+  // lazy mode leaves the channels' internal waveform state behind, so the full
+  // state then differs from one emulated with an output attached. disallowing
+  // it keeps the state independent of the output (e.g. for movies)
+  void SetLazyModeAllowed(bool val);
+  bool IsLazyModeAllowed() const;
 
   void WriteWaveRam8(u8 loc, u8 val);
   u8 ReadWaveRam8(u8 loc) const;
@@ -108,6 +142,7 @@ private:
   ApuNoiseChannel ch4_;
 
   bool muteCh1_, muteCh2_, muteCh3_, muteCh4_;
+  bool lazyModeAllowed_;
 
   unsigned int frameSeqCycles_, frameSeqStep_;
   unsigned int outSampleCycles_;
@@ -116,12 +151,16 @@ private:
   u8 channelCtrl_, outCtrl_;
   bool soundOn_;
 
+  void UpdateFrameSequencer(unsigned int cycles);
   void UpdateFrameSequencerCycle();
+  void StepFrameSequencer();
 
   void ZeroWriteAllRegisters();
 
+  ApuChannelVolumes CalculateChannelVolumes() const;
+
   // returns the samples for both the left and right channels
-  std::pair<i16, i16> MixChannels() const;
+  std::pair<i16, i16> MixChannels(const ApuChannelVolumes& volumes) const;
 };
 
 #endif // SDGBC_APU_H_
@@ -2,17 +2,31 @@
 #define SDGBC_APU_CHAN_BASE_H_
 
 #include "hw/memory.h"
+#include "hw/state.h"
 #include "types.h"
 
 constexpr u8 kApuChannelMaxOutputVolume = 15;
 constexpr u16 kApuChannelMaxFreqLoad = 0x07ff;
 
+// the sound channels use static polymorphism (CRTP) rather than virtual
+// functions, as the frequency timer is updated every clock cycle for each
+// channel. C must provide:
+//
+//   void Restart();
+//   void UpdateFrequency();
+//   u16 GetFrequencyTimerPeriod() const;
+//   u16 GetMaxLength() const;
+//   u8 CalculateOutputVolume() const;
+//
+// these may be private, as long as C befriends ApuSoundChannelBase<C>
+template <typename C>
 class ApuSoundChannelBase {
 public:
-  virtual ~ApuSoundChannelBase() = default;
+  void Reset();
+  void Restart();
 
-  virtual void Reset();
-  virtual void Restart();
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
 
   void UpdateFrequencyTimer();
   void UpdateLengthCounter();
@@ -35,24 +49,22 @@ protected:
   void SetDacEnabled(bool val);
   bool IsDacEnabled() const;
 
-  virtual void UpdateFrequency() = 0;
-
-  virtual u16 GetFrequencyTimerPeriod() const = 0;
-  virtual u16 GetMaxLength() const = 0;
-
-  virtual u8 CalculateOutputVolume() const = 0;
-
 private:
   bool dacEnabled_;
   u16 freqTimer_;
+
+  C& AsC();
+  const C& AsC() const;
 };
 
-class ApuEnvelopeChannelBase : public ApuSoundChannelBase {
+template <typename C>
+class ApuEnvelopeChannelBase : public ApuSoundChannelBase<C> {
 public:
-  virtual ~ApuEnvelopeChannelBase() = default;
+  void Reset();
+  void Restart();
 
-  virtual void Reset() override;
-  virtual void Restart() override;
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
 
   void UpdateEnvelope();
 
@@ -66,7 +78,9 @@ protected:
   u8 ResetEnvelopeTimer(); // returns the new envelope period
   void ResetEnvelopeVolume();
 
-  u16 GetMaxLength() const override;
+  u16 GetMaxLength() const;
 };
 
+#include "hw/apu/apu_chan_base_inl.h"
+
 #endif // SDGBC_APU_CHAN_BASE_H_
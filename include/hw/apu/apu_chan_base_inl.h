@@ -0,0 +1,208 @@
+#ifndef SDGBC_APU_CHAN_BASE_INL_H_
+#define SDGBC_APU_CHAN_BASE_INL_H_
+
+#include <cassert>
+
+// if (envelopeCtrl & mask) is not 0, DAC is enabled.
+// NOTE: the wave channel does not have an envelope ctrl register. DAC is
+// instead turned on/off via the channel's on ctrl register (NR30)
+constexpr u8 kEnvelopeCtrlDacEnabledMask = 0xf8;
+
+template <typename C>
+void ApuSoundChannelBase<C>::Reset() {
+  enabled_ = dacEnabled_ = false;
+
+  lengthEnabled_ = false;
+  freqTimer_ = lengthCounter_ = 0;
+}
+
+template <typename C>
+void ApuSoundChannelBase<C>::Restart() {
+  enabled_ = dacEnabled_;
+
+  if (lengthCounter_ <= 0) {
+    ResetLengthCounter();
+  }
+
+  freqTimer_ = AsC().GetFrequencyTimerPeriod();
+}
+
+template <typename C>
+void ApuSoundChannelBase<C>::SaveState(StateWriter& writer) const {
+  writer.WriteBool(enabled_);
+  writer.WriteBool(dacEnabled_);
+
+  writer.WriteBool(lengthEnabled_);
+  writer.Write16(lengthCounter_);
+  writer.Write16(freqTimer_);
+}
+
+template <typename C>
+void ApuSoundChannelBase<C>::LoadState(StateReader& reader) {
+  enabled_ = reader.ReadBool();
+  dacEnabled_ = reader.ReadBool();
+
+  lengthEnabled_ = reader.ReadBool();
+  lengthCounter_ = reader.Read16InRange(0, AsC().GetMaxLength());
+  freqTimer_ = reader.Read16();
+}
+
+template <typename C>
+void ApuSoundChannelBase<C>::UpdateFrequencyTimer() {
+  // NOTE: if the timer is already 0, it will overflow and not trigger this
+  // condition - audio seems to sound better (especially with the noise channel)
+  // than when handling that case!
+  if (--freqTimer_ <= 0) {
+    freqTimer_ = AsC().GetFrequencyTimerPeriod();
+    AsC().UpdateFrequency();
+  }
+}
+
+template <typename C>
+void ApuSoundChannelBase<C>::UpdateLengthCounter() {
+  if (lengthEnabled_ && lengthCounter_ > 0 && --lengthCounter_ <= 0) {
+    enabled_ = false;
+  }
+}
+
+template <typename C>
+u8 ApuSoundChannelBase<C>::CalculateDacOutputVolume() const {
+  const u8 vol = (enabled_ && IsDacEnabled() ? AsC().CalculateOutputVolume()
+                                             : 0);
+  assert(vol <= kApuChannelMaxOutputVolume);
+
+  return vol;
+}
+
+template <typename C>
+void ApuSoundChannelBase<C>::SetLengthCtrl(u8 val) {
+  lengthEnabled_ = (val & 0x40) != 0;
+
+  // restart if bit 7 is set
+  if (val & 0x80) {
+    AsC().Restart();
+  }
+}
+
+template <typename C>
+u8 ApuSoundChannelBase<C>::GetLengthCtrl() const {
+  return lengthEnabled_ ? 0xff : 0xbf; // only bit 6 readable
+}
+
+template <typename C>
+bool ApuSoundChannelBase<C>::IsEnabled() const {
+  return enabled_;
+}
+
+template <typename C>
+void ApuSoundChannelBase<C>::ResetLengthCounter(u8 lengthSubtract) {
+  lengthCounter_ = AsC().GetMaxLength() - lengthSubtract;
+}
+
+template <typename C>
+void ApuSoundChannelBase<C>::SetDacEnabled(bool val) {
+  dacEnabled_ = val;
+
+  // NOTE: enabling DAC again won't re-enable the channel
+  if (!dacEnabled_) {
+    enabled_ = false;
+  }
+}
+
+template <typename C>
+bool ApuSoundChannelBase<C>::IsDacEnabled() const {
+  return dacEnabled_;
+}
+
+template <typename C>
+C& ApuSoundChannelBase<C>::AsC() {
+  return static_cast<C&>(*this);
+}
+
+template <typename C>
+const C& ApuSoundChannelBase<C>::AsC() const {
+  return static_cast<const C&>(*this);
+}
+
+template <typename C>
+void ApuEnvelopeChannelBase<C>::Reset() {
+  ApuSoundChannelBase<C>::Reset();
+
+  envTimer_ = envVolume_ = 0;
+  envCtrl_ = 0x00;
+}
+
+template <typename C>
+void ApuEnvelopeChannelBase<C>::Restart() {
+  ApuSoundChannelBase<C>::Restart();
+
+  ResetEnvelopeTimer();
+  ResetEnvelopeVolume();
+}
+
+template <typename C>
+void ApuEnvelopeChannelBase<C>::SaveState(StateWriter& writer) const {
+  ApuSoundChannelBase<C>::SaveState(writer);
+
+  writer.Write8(envTimer_);
+  writer.Write8(envVolume_);
+  writer.Write8(envCtrl_);
+}
+
+template <typename C>
+void ApuEnvelopeChannelBase<C>::LoadState(StateReader& reader) {
+  ApuSoundChannelBase<C>::LoadState(reader);
+
+  envTimer_ = reader.Read8();
+  envVolume_ = reader.Read8InRange(0, 15);
+  envCtrl_ = reader.Read8();
+}
+
+template <typename C>
+void ApuEnvelopeChannelBase<C>::UpdateEnvelope() {
+  if (--envTimer_ <= 0 && ResetEnvelopeTimer() > 0) {
+    // update current envelope volume depending on the add mode (bit 3).
+    // the new volume cannot be greater than 15 or below 0
+    if (envCtrl_ & 8) {
+      if (envVolume_ < 15) {
+        ++envVolume_;
+      }
+    } else {
+      if (envVolume_ > 0) {
+        --envVolume_;
+      }
+    }
+  }
+}
+
+template <typename C>
+u8 ApuEnvelopeChannelBase<C>::ResetEnvelopeTimer() {
+  // reload the period from bits 7-4 of the ctrl reg.
+  // due to weird APU behaviour, a new period of 0 is treated as 8 instead
+  const u8 newPeriod = envCtrl_ & 7;
+  envTimer_ = newPeriod == 0 ? 8 : newPeriod;
+  return newPeriod;
+}
+
+template <typename C>
+void ApuEnvelopeChannelBase<C>::SetEnvelopeCtrl(u8 val) {
+  envCtrl_ = val;
+  this->SetDacEnabled((envCtrl_ & kEnvelopeCtrlDacEnabledMask) != 0);
+}
+
+template <typename C>
+u8 ApuEnvelopeChannelBase<C>::GetEnvelopeCtrl() const {
+  return envCtrl_;
+}
+
+template <typename C>
+void ApuEnvelopeChannelBase<C>::ResetEnvelopeVolume() {
+  envVolume_ = (envCtrl_ & 0xf0) >> 4;
+}
+
+template <typename C>
+u16 ApuEnvelopeChannelBase<C>::GetMaxLength() const {
+  return 64;
+}
+
+#endif // SDGBC_APU_CHAN_BASE_INL_H_
@@ -3,10 +3,15 @@
 
 #include "hw/apu/apu_chan_base.h"
 
-class ApuNoiseChannel : public ApuEnvelopeChannelBase {
+class ApuNoiseChannel final : public ApuEnvelopeChannelBase<ApuNoiseChannel> {
+  friend class ApuSoundChannelBase<ApuNoiseChannel>;
+
 public:
-  void Reset() override;
-  void Restart() override;
+  void Reset();
+  void Restart();
+
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
 
   void SetLengthLoad(u8 val);
 
@@ -17,10 +22,10 @@ private:
   u8 polyCtrl_;
   u16 linearShift_;
 
-  void UpdateFrequency() override;
-  u8 CalculateOutputVolume() const override;
+  void UpdateFrequency();
+  u8 CalculateOutputVolume() const;
 
-  u16 GetFrequencyTimerPeriod() const override;
+  u16 GetFrequencyTimerPeriod() const;
 };
 
 #endif // SDGBC_APU_CHAN_NOISE_H_
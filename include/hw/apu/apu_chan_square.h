@@ -3,11 +3,13 @@
 
 #include "hw/apu/apu_chan_base.h"
 
-class ApuSquareChannel : public ApuEnvelopeChannelBase {
+template <typename C>
+class ApuSquareChannelBase : public ApuEnvelopeChannelBase<C> {
 public:
-  virtual ~ApuSquareChannel() = default;
+  void Reset();
 
-  virtual void Reset() override;
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
 
   void ResetDutyCounter();
 
@@ -23,16 +25,26 @@ protected:
 
   u16 freqLoad_;
 
-  void UpdateFrequency() override;
-  u8 CalculateOutputVolume() const override;
+  void UpdateFrequency();
+  u8 CalculateOutputVolume() const;
 
-  u16 GetFrequencyTimerPeriod() const override;
+  u16 GetFrequencyTimerPeriod() const;
 };
 
-class ApuSquareSweepChannel : public ApuSquareChannel {
+class ApuSquareChannel final : public ApuSquareChannelBase<ApuSquareChannel> {
+  friend class ApuSoundChannelBase<ApuSquareChannel>;
+};
+
+class ApuSquareSweepChannel final
+    : public ApuSquareChannelBase<ApuSquareSweepChannel> {
+  friend class ApuSoundChannelBase<ApuSquareSweepChannel>;
+
 public:
-  void Reset() override;
-  void Restart() override;
+  void Reset();
+  void Restart();
+
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
 
   void UpdateSweep();
 
@@ -52,4 +64,6 @@ private:
   u8 GetSweepShift() const;
 };
 
+#include "hw/apu/apu_chan_square_inl.h"
+
 #endif // SDGBC_APU_CHAN_SQUARE_H_
@@ -0,0 +1,85 @@
+#ifndef SDGBC_APU_CHAN_SQUARE_INL_H_
+#define SDGBC_APU_CHAN_SQUARE_INL_H_
+
+#include "util.h"
+#include <array>
+
+constexpr std::array<u8, 4> kSquareDutyWaveforms {
+  0b00000001,
+  0b10000001,
+  0b10000111,
+  0b01111110
+};
+
+template <typename C>
+void ApuSquareChannelBase<C>::Reset() {
+  ApuEnvelopeChannelBase<C>::Reset();
+
+  freqLoad_ = 0x0000;
+  dutyNum_ = dutyBitIdxCounter_ = 0;
+}
+
+template <typename C>
+void ApuSquareChannelBase<C>::SaveState(StateWriter& writer) const {
+  ApuEnvelopeChannelBase<C>::SaveState(writer);
+
+  writer.Write8(dutyNum_);
+  writer.Write8(dutyBitIdxCounter_);
+  writer.Write16(freqLoad_);
+}
+
+template <typename C>
+void ApuSquareChannelBase<C>::LoadState(StateReader& reader) {
+  ApuEnvelopeChannelBase<C>::LoadState(reader);
+
+  dutyNum_ = reader.Read8InRange(0, kSquareDutyWaveforms.size() - 1);
+  dutyBitIdxCounter_ = reader.Read8InRange(0, 7);
+  freqLoad_ = reader.Read16();
+}
+
+template <typename C>
+void ApuSquareChannelBase<C>::ResetDutyCounter() {
+  dutyBitIdxCounter_ = 0;
+}
+
+template <typename C>
+void ApuSquareChannelBase<C>::UpdateFrequency() {
+  // increment the duty bit pos
+  dutyBitIdxCounter_ = (dutyBitIdxCounter_ + 1) % 8;
+}
+
+template <typename C>
+u8 ApuSquareChannelBase<C>::CalculateOutputVolume() const {
+  // output envelope volume if the selected bit of the duty waveform is set
+  const u8 duty = kSquareDutyWaveforms[dutyNum_];
+  return (1 << dutyBitIdxCounter_) & duty ? this->envVolume_ : 0;
+}
+
+template <typename C>
+u16 ApuSquareChannelBase<C>::GetFrequencyTimerPeriod() const {
+  return ((kApuChannelMaxFreqLoad + 1) - freqLoad_) * 4;
+}
+
+template <typename C>
+void ApuSquareChannelBase<C>::SetLengthLoadDutyCtrl(u8 val) {
+  dutyNum_ = (val >> 6) & 3; // duty number is bits 6-7
+  this->ResetLengthCounter(val & 0x3f); // load value is bits 0-5
+}
+
+template <typename C>
+u8 ApuSquareChannelBase<C>::GetLengthLoadDutyCtrl() const {
+  return (dutyNum_ << 6) | 0x3f; // only duty number readable (bits 6-7)
+}
+
+template <typename C>
+void ApuSquareChannelBase<C>::SetFreqLoadLo(u8 val) {
+  freqLoad_ = util::SetLo8(freqLoad_, val);
+}
+
+template <typename C>
+void ApuSquareChannelBase<C>::SetLengthCtrlFreqLoadHi(u8 val) {
+  freqLoad_ = util::SetHi8(freqLoad_, val & 7); // bits 0-2 freq MSB
+  this->SetLengthCtrl(val);
+}
+
+#endif // SDGBC_APU_CHAN_SQUARE_INL_H_
@@ -3,10 +3,15 @@
 
 #include "hw/apu/apu_chan_base.h"
 
-class ApuWaveChannel : public ApuSoundChannelBase {
+class ApuWaveChannel final : public ApuSoundChannelBase<ApuWaveChannel> {
+  friend class ApuSoundChannelBase<ApuWaveChannel>;
+
 public:
-  void Reset() override;
-  void Restart() override;
+  void Reset();
+  void Restart();
+
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
 
   void ClearWaveRam();
 
@@ -33,11 +38,11 @@ private:
   u8 waveRamLastWrittenVal_;
   u8 sampleIdxCounter_;
 
-  void UpdateFrequency() override;
-  u8 CalculateOutputVolume() const override;
+  void UpdateFrequency();
+  u8 CalculateOutputVolume() const;
 
-  u16 GetFrequencyTimerPeriod() const override;
-  u16 GetMaxLength() const override;
+  u16 GetFrequencyTimerPeriod() const;
+  u16 GetMaxLength() const;
 };
 
 #endif // SDGBC_APU_CHAN_WAVE_H_
@@ -17,6 +17,8 @@ enum class RomLoadResult {
 };
 
 class ICartridgeExtension;
+class StateReader;
+class StateWriter;
 
 class Cartridge {
 public:
@@ -33,8 +35,15 @@ public:
   void Clear(); // clears cartridge ROM and resets
   void Reset(); // only clears cartridge RAM/other volatile memory
 
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
+
   RomLoadResult LoadRomFile(const std::string& filePath,
                             const std::string& fileName = {});
+  // loads a ROM image from memory. as there is no file path, battery-backed
+  // RAM is not automatically loaded or saved for these
+  RomLoadResult LoadRomData(std::vector<u8> romData,
+                            const std::string& romName = {});
 
   // SaveBatteryExtRam() and LoadBatteryExtRam() return true if the operation
   // was successful OR if the cartridge doesn't need to save RAM (no battery, no
@@ -51,11 +60,19 @@ public:
   void RamWrite8(u16 loc, u8 val);
   u8 RamRead8(u16 loc) const;
 
+  // return pointers to the currently mapped banks for bulk reads, or nullptr
+  // if they can't be read directly. see ICartridgeExtension
+  const u8* GetRomBank0Data() const;
+  const u8* GetRomBankXData() const;
+  const u8* GetRamData() const;
+
   std::string GetRomFilePath() const;
   std::string GetRomFileName() const;
 
   bool IsRomLoaded() const;
   const std::vector<u8>& GetRomData() const;
+  // 64-bit FNV-1a hash of the ROM data, used to match save states to ROMs
+  u64 GetRomHash() const;
 
   u16 GetNumRomBanks() const;
   u16 GetNum2KBExtRamBanks() const;
@@ -70,12 +87,17 @@ private:
   bool isRomLoaded_;
 
   std::vector<u8> romData_;
+  u64 romHash_;
   u16 numRomBanks_, num2KBExtRamBanks_;
   bool cgbMode_;
 
   std::unique_ptr<ICartridgeExtension> extension_;
   u8 extensionId_;
 
+  RomLoadResult LoadRom(std::vector<u8>&& romData,
+                        const std::string& filePath,
+                        const std::string& fileName);
+
   RomLoadResult ParseRomHeader(Cartridge& newCart);
   RomLoadResult ParseExtensions(Cartridge& newCart);
 };
@@ -6,6 +6,8 @@
 #include <vector>
 
 class Cartridge;
+class StateReader;
+class StateWriter;
 
 class ICartridgeExtension {
 public:
@@ -25,8 +27,20 @@ public:
   virtual void ExtRamWrite8(u16 loc, u8 val) = 0;
   virtual u8 ExtRamRead8(u16 loc) const = 0;
 
+  // return a pointer to the start of the currently mapped ROM bank 0, ROM bank
+  // X or RAM bank, so that they can be read in bulk. returns nullptr if the
+  // whole bank can't be read directly from contiguous memory (e.g if RAM is
+  // disabled or an RTC register is mapped instead)
+  virtual const u8* ExtGetRomBank0Data() const = 0;
+  virtual const u8* ExtGetRomBankXData() const = 0;
+  virtual const u8* ExtGetRamData() const = 0;
+
   virtual bool ExtSaveRam(std::ostream& os) = 0;
   virtual bool ExtLoadRam(std::istream& is) = 0;
+
+  // save the mapper registers and RAM (but not ROM) for save states
+  virtual void ExtSaveState(StateWriter& writer) const = 0;
+  virtual void ExtLoadState(StateReader& reader) = 0;
 };
 
 class CartridgeExtensionBase : public ICartridgeExtension {
@@ -42,6 +56,9 @@ public:
   virtual void ExtRomBankXWrite8(u16 loc, u8 val) override;
   virtual u8 ExtRomBankXRead8(u16 loc) const override;
 
+  virtual const u8* ExtGetRomBank0Data() const override;
+  virtual const u8* ExtGetRomBankXData() const override;
+
 protected:
   const Cartridge* cart_;
 };
@@ -56,9 +73,14 @@ public:
   virtual void ExtRamWrite8(u16 loc, u8 val) override;
   virtual u8 ExtRamRead8(u16 loc) const override;
 
+  virtual const u8* ExtGetRamData() const override;
+
   bool ExtSaveRam(std::ostream& os) override;
   bool ExtLoadRam(std::istream& is) override;
 
+  virtual void ExtSaveState(StateWriter& writer) const override;
+  virtual void ExtLoadState(StateReader& reader) override;
+
 protected:
   std::vector<u8> ramData_;
   u16 ramBankNum_;
@@ -66,6 +88,7 @@ protected:
 
   void RamBankXWrite8(u16 loc, u8 val, u16 bankNum);
   u8 RamBankXRead8(u16 loc, u16 bankNum) const;
+  const u8* GetRamBankXData(u16 bankNum) const;
 };
 
 class MbcBase : public RamExtensionBase {
@@ -77,10 +100,17 @@ public:
   virtual u8 ExtRomBank0Read8(u16 loc) const override;
   virtual u8 ExtRomBankXRead8(u16 loc) const override;
 
+  virtual const u8* ExtGetRomBank0Data() const override;
+  virtual const u8* ExtGetRomBankXData() const override;
+
+  virtual void ExtSaveState(StateWriter& writer) const override;
+  virtual void ExtLoadState(StateReader& reader) override;
+
 protected:
   u16 romBankNum_;
 
   u8 RomBankXRead8(u16 loc, u16 bankNum) const;
+  const u8* GetRomBankXData(u16 bankNum) const;
 };
 
 #endif // SDGBC_CART_EXT_BASE_H_
@@ -16,6 +16,12 @@ public:
   void ExtRamWrite8(u16 loc, u8 val) override;
   u8 ExtRamRead8(u16 loc) const override;
 
+  const u8* ExtGetRomBankXData() const override;
+  const u8* ExtGetRamData() const override;
+
+  void ExtSaveState(StateWriter& writer) const override;
+  void ExtLoadState(StateReader& reader) override;
+
 private:
   bool ramBankingMode_;
 };
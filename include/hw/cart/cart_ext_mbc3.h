@@ -16,6 +16,11 @@ public:
   void ExtRamWrite8(u16 loc, u8 val) override;
   u8 ExtRamRead8(u16 loc) const override;
 
+  const u8* ExtGetRamData() const override;
+
+  void ExtSaveState(StateWriter& writer) const override;
+  void ExtLoadState(StateReader& reader) override;
+
 private:
   enum class RtcRegister : u8 {
     S  = 0x8,
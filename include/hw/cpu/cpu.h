@@ -18,15 +18,25 @@ enum CpuInterruptMask : u8 {
   kCpuInterrupt0x60 = 0x10
 };
 
+// see Cpu::GetTotals()
+struct CpuTotals {
+  u64 numInstructions, numCycles, numIdleCycles;
+};
+
 class Mmu;
 class Dma;
 class Joypad;
+class StateReader;
+class StateWriter;
 
 class Cpu {
 public:
   explicit Cpu(Mmu& mmu, const Dma& dma, const Joypad& joypad);
 
   void Reset(bool cgbMode);
+
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
   bool Resume(); // resumes the CPU if it was halted
 
   unsigned int Update(); // returns the amount of CPU clock cycles spent
@@ -51,6 +61,18 @@ public:
   bool IsInDoubleSpeedMode() const;
   bool IsSpeedSwitchInProgress() const;
 
+  // totals since construction, kept for the host's runtime stats. they aren't
+  // part of the emulated state, so resets and save states leave them alone.
+  // cycles are in CPU clock cycles, idle ones being spent halted or stopped
+  u64 GetNumInstructions() const;
+  u64 GetNumCycles() const;
+  u64 GetNumIdleCycles() const;
+
+  // for emulation that is rolled back (such as running ahead), so that it
+  // isn't counted: take the totals beforehand and put them back afterwards
+  CpuTotals GetTotals() const;
+  void RestoreTotals(const CpuTotals& totals);
+
 private:
   Mmu& mmu_;
   const Dma& dma_;
@@ -68,6 +90,8 @@ private:
   bool intme_;
   u8 intf_, inte_;
 
+  u64 numInstructions_, numCycles_, numIdleCycles_;
+
   void HandleStoppedUpdate();
 
   bool HandleInterrupts(); // returns whether or not an int was serviced
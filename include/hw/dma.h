@@ -6,6 +6,8 @@
 class Mmu;
 class Cpu;
 class Ppu;
+class StateReader;
+class StateWriter;
 
 enum class NdmaStatus {
   Inactive,
@@ -25,6 +27,9 @@ public:
   explicit Dma(const Mmu& mmu, const Cpu& cpu, Ppu& ppu);
 
   void Reset(bool cgbMode);
+
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
   void Update(unsigned int cycles);
 
   void StartOamDmaTransfer(u8 sourceLocHi);
@@ -9,7 +9,42 @@
 #include "hw/mmu.h"
 #include "hw/ppu.h"
 #include "hw/serial.h"
+#include "hw/state.h"
 #include "hw/timer.h"
+#include "perf_counters.h"
+
+// VBlank takes 70224 clock cycles in normal speed mode.
+// 4.194304 MHz div 59.7275 = approx 70224 clock cycles
+constexpr auto kNormalSpeedCyclesPerFrame = 70224u;
+
+// system is clocked at 4.194304 MHz in normal speed mode
+constexpr auto kNormalSpeedClockRateHz = 4194304u;
+
+// host time spent updating each part of the hardware, as measured by
+// Gbc::UpdateFrameTimed(). Other is the DMA, timer, serial port and the update
+// loop itself
+struct GbcUpdateTimes {
+  double cpuSeconds, ppuSeconds, apuSeconds, otherSeconds;
+};
+
+// the same split, in hardware events counted by Gbc::UpdateFrameCounted()
+struct GbcUpdateCounts {
+  PerfCounts cpu, ppu, apu, other;
+};
+
+// the parts of the hardware reported by Gbc::UpdateFrameInSteps(). Other is the
+// serial port and the update loop itself
+enum GbcUpdateStep : unsigned int {
+  kGbcUpdateCpu,
+  kGbcUpdatePpu,
+  kGbcUpdateApu,
+  kGbcUpdateTimer,
+  kGbcUpdateDma,
+  kGbcUpdateOther,
+  kGbcNumUpdateSteps
+};
+
+class GuestProfiler;
 
 struct GbcHardware {
   Cpu cpu;
@@ -35,9 +70,54 @@ public:
 
   void Reset(bool forceDmgMode = false);
   unsigned int Update(); // returns the amount of CPU cycles spent
+  // updates for a frame's worth of normal speed clock cycles. cycles that
+  // overshoot the end of the frame are carried over to the next one
+  void UpdateFrame();
+  // as UpdateFrame(), but also measures how long each part of the hardware
+  // took. reading the clock so often slows the frame down, so this is meant for
+  // sampling the odd frame
+  void UpdateFrameTimed(GbcUpdateTimes& outTimes);
+  // likewise, but with the counters (opened on the calling thread). this is
+  // only worth doing if they have fast reads; the cost of each read is
+  // measured and taken away
+  void UpdateFrameCounted(const PerfCounters& counters,
+                          GbcUpdateCounts& outCounts);
+  // as UpdateFrame(), but calls endStep(GbcUpdateStep) right after updating
+  // each part of the hardware, for measuring them. returns the amount of
+  // updates
+  template <typename EndStep>
+  unsigned int UpdateFrameInSteps(EndStep endStep);
+
+  // attaches a profiler of the guest's code (nullptr to detach), fed by every
+  // update of the CPU other than those of frames that are ran ahead and rolled
+  // back
+  void SetGuestProfiler(GuestProfiler* profiler);
+  GuestProfiler* GetGuestProfiler() const;
 
   RomLoadResult LoadCartridgeRomFile(const std::string& filePath,
                                      const std::string& fileName = {});
+  RomLoadResult LoadCartridgeRomData(std::vector<u8> romData,
+                                     const std::string& romName = {});
+
+  // save states hold the complete state of the emulated hardware (but not the
+  // cartridge ROM itself) in a pointer-free little-endian binary layout.
+  // SaveState() replaces the contents of outData; reusing the same vector for
+  // each save avoids reallocating it. if LoadState() fails, the current state
+  // is left untouched
+  void SaveState(std::vector<u8>& outData) const;
+  StateLoadResult LoadState(const u8* data, std::size_t size);
+  StateLoadResult LoadState(const std::vector<u8>& data);
+
+  // snapshots are save states without the header, for states that never leave
+  // the process. restoring one skips the validation and backup that
+  // LoadState() does, so it must have been taken by this Gbc with the same ROM
+  void SaveSnapshot(std::vector<u8>& outData) const;
+  void LoadSnapshot(const std::vector<u8>& data);
+
+  // emulates numFrames frames ahead of the current state and then rolls back
+  // to it using a snapshot. only the last of those frames is rendered, no
+  // audio or serial output is produced, and any link cable is unplugged
+  void RunAhead(unsigned int numFrames);
 
   GbcHardware& GetHardware();
   const GbcHardware& GetHardware() const;
@@ -47,6 +127,24 @@ public:
 private:
   GbcHardware hw_;
   bool cgbMode_;
+
+  unsigned int normalSpeedFrameCycles_;
+
+  // scratch copy of the state taken before loading a save state, so that we
+  // can roll back if it turns out to be corrupt
+  std::vector<u8> loadStateBackup_;
+
+  std::vector<u8> runAheadState_;
+
+  GuestProfiler* profiler_;
+
+  unsigned int UpdateHardware();
+  unsigned int UpdateCpu(); // feeds the guest profiler, if any
+
+  void SaveHardwareState(StateWriter& writer) const;
+  void LoadHardwareState(StateReader& reader);
 };
 
+#include "hw/gbc_inl.h"
+
 #endif // SDGBC_GBC_H_
@@ -0,0 +1,33 @@
+#ifndef SDGBC_GBC_INL_H_
+#define SDGBC_GBC_INL_H_
+
+#include "util.h"
+
+template <typename EndStep>
+unsigned int Gbc::UpdateFrameInSteps(EndStep endStep) {
+  unsigned int numUpdates = 0;
+
+  // mirrors UpdateHardware() and UpdateFrame()
+  while (normalSpeedFrameCycles_ < kNormalSpeedCyclesPerFrame) {
+    const auto cycles = UpdateCpu();
+    endStep(kGbcUpdateCpu);
+    hw_.dma.Update(cycles);
+    endStep(kGbcUpdateDma);
+    hw_.apu.Update(cycles);
+    endStep(kGbcUpdateApu);
+    hw_.ppu.Update(cycles);
+    endStep(kGbcUpdatePpu);
+    hw_.timer.Update(cycles);
+    endStep(kGbcUpdateTimer);
+    hw_.serial.Update(cycles);
+
+    normalSpeedFrameCycles_ += util::RescaleCycles(hw_.cpu, cycles);
+    ++numUpdates;
+    endStep(kGbcUpdateOther);
+  }
+
+  normalSpeedFrameCycles_ -= kNormalSpeedCyclesPerFrame;
+  return numUpdates;
+}
+
+#endif // SDGBC_GBC_INL_H_
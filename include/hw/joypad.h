@@ -15,6 +15,8 @@ enum class JoypadKey : u8 {
 };
 
 class Cpu;
+class StateReader;
+class StateWriter;
 
 class Joypad {
 public:
@@ -22,9 +24,20 @@ public:
 
   void Reset();
 
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
+
   void CommitKeyStates();
   void SetKeyState(JoypadKey key, bool pressed);
 
+  // sets all of the keys to be committed next at once (one JoypadKey bit per
+  // key), bypassing the impossible inputs check. used for replaying input
+  void SetKeyStates(u8 keys);
+  // keys as of the last commit
+  u8 GetKeyStates() const;
+  // keys that will be committed next
+  u8 GetNextKeyStates() const;
+
   void SetJoyp(u8 val);
   u8 GetJoyp() const;
 
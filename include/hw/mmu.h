@@ -70,6 +70,8 @@ enum IoRegisterId : u8 {
 };
 
 struct GbcHardware;
+class StateReader;
+class StateWriter;
 
 class Mmu {
 public:
@@ -77,12 +79,23 @@ public:
 
   void Reset(bool cgbMode);
 
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
+
   void Write8(u16 loc, u8 val);
   u8 Read8(u16 loc) const;
 
+  // returns a pointer that can be used to read size bytes starting at loc
+  // directly, or nullptr if the range isn't backed by contiguous memory (it
+  // crosses a region boundary, or maps to VRAM, IO registers etc.)
+  const u8* GetDirectReadPtr(u16 loc, u16 size) const;
+
   void WriteIoRegister(u8 regId, u8 val);
   u8 ReadIoRegister(u8 regId) const;
 
+  // the WRAM bank mapped to $d000-$dfff (1-7)
+  u8 GetWramBankIndex() const;
+
   bool IsInCgbMode() const;
 
 private:
@@ -91,8 +104,6 @@ private:
 
   // WRAM bank switch register
   u8 svbk_;
-
-  u8 GetWramBankIndex() const;
 };
 
 #endif // SDGBC_MMU_H_
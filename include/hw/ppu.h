@@ -2,7 +2,6 @@
 #define SDGBC_PPU_H_
 
 #include "hw/memory.h"
-#include "wxui/wx.h"
 #include <vector>
 
 constexpr auto kLcdWidthPixels  = 160u,
@@ -43,16 +42,26 @@ enum class PpuScreenMode : u8 {
 
 class Cpu;
 class Dma;
+class StateReader;
+class StateWriter;
 
 class Ppu {
 public:
   explicit Ppu(Cpu& cpu, const Dma& dma);
 
   void Reset(bool cgbMode);
+
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
   void Update(unsigned int cycles);
 
   void SetLcd(ILcd* lcd);
 
+  // skips rendering scanlines and refreshing or powering the LCD without
+  // affecting emulation; used for frames whose picture will never be shown
+  void SetRenderSuppressed(bool val);
+  bool IsRenderSuppressed() const;
+
   void SetScanlineSpritesLimiterEnabled(bool val);
   bool IsScanlineSpritesLimiterEnabled() const;
 
@@ -71,6 +80,11 @@ public:
   void OamWrite8(u16 loc, u8 val, bool oamDmaWrite = false);
   u8 OamRead8(u16 loc) const;
 
+  // bulk writes used by DMA transfers. VRAM accessibility is checked once for
+  // the whole block rather than for each byte
+  void VramWriteBlock(u16 loc, const u8* data, u16 size);
+  void OamDmaWriteAll(const u8* data); // data must contain a full OAM's worth
+
   bool IsLcdOn() const;
   PpuScreenMode GetScreenMode() const;
 
@@ -173,7 +187,8 @@ private:
   unsigned int screenModeCycles_;
   bool cgbMode_;
 
-  bool limitScanlineSprites_;
+  bool limitScanlineSprites_, renderSuppressed_;
+  bool lcdPowerOutOfSync_; // a power change was hidden from the LCD
   bool enableBg_, enableBgWindow_, enableSprites_;
 
   // LCD control & status registers
@@ -191,6 +206,7 @@ private:
   // LCD VRAM bank register
   u8 vbk_;
 
+  void UpdateLcdPower();
   void UpdateScreenMode(unsigned int cycles);
 
   void ChangeScreenMode(PpuScreenMode mode);
@@ -12,16 +12,46 @@ public:
   virtual void SerialOnByteWritten() = 0;
 };
 
+// the other end of a link cable, as seen by a Serial that is clocking a
+// transfer itself (SC bit 0 set)
+class ISerialLink {
+public:
+  virtual ~ISerialLink() = default;
+
+  // called as each bit is shifted out, returning the bit shifted in from the
+  // other end
+  virtual bool SerialExchangeBit(bool bitSet) = 0;
+};
+
 class Cpu;
+class StateReader;
+class StateWriter;
 
 class Serial {
 public:
   explicit Serial(Cpu& cpu);
 
   void Reset(bool cgbMode);
+
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
   void Update(unsigned int cycles);
 
   void SetSerialOutput(ISerialOutput* dataOut);
+  ISerialOutput* GetSerialOutput() const;
+
+  // without a link, transfers that we clock receive 1s, as if nothing were
+  // plugged in
+  void SetSerialLink(ISerialLink* link);
+  ISerialLink* GetSerialLink() const;
+
+  // true while a transfer is waiting to be (or being) clocked by either end
+  // of the link (SC bit 7 set)
+  bool IsTransferPending() const;
+  // shifts a bit in from (and a bit out to) the other end of the link when
+  // it clocks a transfer. returns false, leaving outBit alone, if we aren't
+  // waiting on an externally clocked transfer (SC bit 7 set, bit 0 unset)
+  bool ClockExternalBit(bool inBit, bool& outBit);
 
   void SetSb(u8 val);
   u8 GetSb() const;
@@ -35,12 +65,15 @@ private:
   Cpu& cpu_;
 
   ISerialOutput* dataOut_;
+  ISerialLink* link_;
 
   u8 sb_, sc_;
   unsigned int nextBitTransferCycles_;
   u8 transferNextBitIdx_;
 
   bool cgbMode_;
+
+  bool ShiftBit(bool inBit);
 };
 
 #endif // SDGBC_SERIAL_H_
@@ -0,0 +1,87 @@
+#ifndef SDGBC_STATE_H_
+#define SDGBC_STATE_H_
+
+#include "types.h"
+#include <array>
+#include <string>
+#include <vector>
+
+// save states start with this magic number ("SDGS" in ASCII)
+constexpr u32 kStateMagic = 0x53474453;
+
+// bumped whenever the save state layout changes. states from other versions
+// are rejected rather than converted
+constexpr u16 kStateVersion = 1;
+
+enum class StateLoadResult {
+  Ok,
+  ReadError,
+  InvalidFormat,
+  UnsupportedVersion,
+  RomMismatch,
+  NoRom
+};
+
+// appends little-endian values to a byte buffer. the buffer's capacity is
+// left alone, so reusing the same buffer for each save avoids reallocating
+class StateWriter {
+public:
+  explicit StateWriter(std::vector<u8>& data);
+
+  void Write8(u8 val);
+  void Write16(u16 val);
+  void Write32(u32 val);
+  void Write64(u64 val);
+  void WriteBool(bool val);
+
+  void WriteBytes(const u8* data, std::size_t size);
+  template <std::size_t N>
+  void WriteBytes(const std::array<u8, N>& data);
+
+private:
+  std::vector<u8>& data_;
+};
+
+// reads values written by StateWriter. reading past the end of the data
+// yields zeroes and sets the error flag instead of failing immediately, so
+// that callers only need to check for errors once they're done
+class StateReader {
+public:
+  StateReader(const u8* data, std::size_t size);
+
+  u8 Read8();
+  u16 Read16();
+  u32 Read32();
+  u64 Read64();
+  bool ReadBool();
+
+  // for values that must be within [min, max], such as indices into tables and
+  // enum values. values out of range yield min and set the error flag
+  u8 Read8InRange(u8 min, u8 max);
+  u16 Read16InRange(u16 min, u16 max);
+  u32 Read32InRange(u32 min, u32 max);
+  u64 Read64InRange(u64 min, u64 max);
+
+  // for rejecting values that are only invalid in combination with others
+  void SetError();
+
+  void ReadBytes(u8* outData, std::size_t size);
+  template <std::size_t N>
+  void ReadBytes(std::array<u8, N>& outData);
+
+  bool HasError() const;
+  std::size_t GetBytesLeft() const;
+
+private:
+  const u8* data_;
+  std::size_t size_, pos_;
+  bool hasError_;
+
+  u64 CheckRange(u64 val, u64 min, u64 max);
+};
+
+std::string GetStateLoadResultAsMessage(StateLoadResult result);
+
+#include "hw/state_inl.h"
+
+#endif // SDGBC_STATE_H_
@@ -0,0 +1,14 @@
+#ifndef SDGBC_STATE_INL_H_
+#define SDGBC_STATE_INL_H_
+
+template <std::size_t N>
+void StateWriter::WriteBytes(const std::array<u8, N>& data) {
+  WriteBytes(data.data(), N);
+}
+
+template <std::size_t N>
+void StateReader::ReadBytes(std::array<u8, N>& outData) {
+  ReadBytes(outData.data(), N);
+}
+
+#endif // SDGBC_STATE_INL_H_
@@ -4,7 +4,13 @@
 #include "types.h"
 
 class Cpu;
+class StateReader;
+class StateWriter;
 
+// the timer is evaluated lazily: rather than stepping DIV and TIMA every
+// update, we only count elapsed clock cycles and remember the cycle at which
+// each register was last set. their values are then calculated on demand when
+// read, and the next TIMA overflow is scheduled as a single event
 class Timer {
 public:
   explicit Timer(Cpu& cpu);
@@ -12,6 +18,9 @@ public:
   void Reset();
   void Update(unsigned int cycles);
 
+  void SaveState(StateWriter& writer) const;
+  void LoadState(StateReader& reader);
+
   void ResetDiv();
   u8 GetDiv() const;
 
@@ -27,10 +36,30 @@ public:
 private:
   Cpu& cpu_;
 
-  // timer & divider registers & clock counters
-  unsigned int divCycles_, timaCycles_;
-  u8 div_, tima_, tma_, tac_;
+  // clock cycles elapsed since reset
+  u64 cycles_;
+
+  // cycle at which the internal 16-bit divider counter was last 0.
+  // DIV is the upper 8 bits of this counter
+  u64 divBaseCycle_;
+
+  // value of TIMA at timaBaseCycle_. while the timer is stopped, this is
+  // simply the current value of TIMA
+  u8 timaBase_;
+  u64 timaBaseCycle_;
+
+  // cycle at which TIMA will next overflow, or kTimerNoEvent if stopped
+  u64 timaOverflowCycle_;
+
+  u8 tma_, tac_;
+
+  void HandleTimaOverflow();
+  // moves the TIMA base to the current cycle, keeping the cycles that have
+  // elapsed towards the next increment
+  void RebaseTima();
+  void ScheduleTimaOverflow();
 
+  bool IsTimaRunning() const;
   unsigned int GetTimaFreqInCycles() const;
 };
 
@@ -0,0 +1,72 @@
+#ifndef SDGBC_LINK_CABLE_H_
+#define SDGBC_LINK_CABLE_H_
+
+#include "hw/gbc.h"
+#include "types.h"
+#include <array>
+
+// how far (in normal speed clock cycles) each side runs on its own at a time
+// while no transfer is pending
+constexpr auto kLinkCableBatchCycles = kNormalSpeedCyclesPerFrame / 8;
+
+// how far one side may get ahead of the other while a transfer is pending.
+// this is finer than a bit at the fastest CGB transfer speed
+constexpr auto kLinkCableSyncCycles = 8u;
+
+struct LinkCableStats {
+  u64 batchedCycles; // ran in independent batches
+  u64 syncedCycles;  // ran in lockstep with the other side
+  u64 numBitsExchanged; // clocked while the other side was listening
+};
+
+// connects the serial ports of two Gbc instances in the same process. both
+// sides run in large independent batches until either has a transfer pending
+// (SC bit 7 set), at which point the other catches up and they run in
+// lockstep until no transfer is pending. this way, a side that is ahead has
+// never had a transfer pending since the time that the other side is at, so
+// the other can't clock a transfer that it should have seen.
+//
+// each bit is exchanged with the other side's Serial as the clocking side
+// shifts it out (first letting the other side catch up, if it's behind). if
+// the other side isn't listening for one (SC bit 7 set, bit 0 unset), a 1 is
+// received instead
+class LinkCable {
+public:
+  LinkCable();
+  explicit LinkCable(const LinkCable& other) = delete;
+  ~LinkCable();
+
+  LinkCable& operator=(const LinkCable& other) = delete;
+
+  // plugs the cable into both (unplugging it from anything else first). while
+  // connected, they must only be run by UpdateFrame()
+  void Connect(Gbc& a, Gbc& b);
+  void Disconnect();
+  bool IsConnected() const;
+
+  // updates both sides for a frame's worth of normal speed clock cycles.
+  // cycles that overshoot the end of the frame are carried over to the next
+  void UpdateFrame();
+
+  const LinkCableStats& GetStats() const;
+
+private:
+  class End : public ISerialLink {
+  public:
+    End();
+
+    bool SerialExchangeBit(bool bitSet) override;
+
+    LinkCable* cable;
+    Gbc* gbc;
+    End* other;
+    unsigned int frameCycles; // normal speed cycles ran this frame
+  };
+
+  std::array<End, 2> ends_;
+  LinkCableStats stats_;
+
+  void RunEnd(End& end, unsigned int untilCycles, bool isSynced);
+};
+
+#endif // SDGBC_LINK_CABLE_H_
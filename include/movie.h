@@ -0,0 +1,112 @@
+#ifndef SDGBC_MOVIE_H_
+#define SDGBC_MOVIE_H_
+
+#include "hw/gbc.h"
+#include <string>
+#include <vector>
+
+// movie files start with this magic number ("SDGM" in ASCII)
+constexpr u32 kMovieMagic = 0x4d474453;
+
+// bumped whenever the movie file layout changes
+constexpr u16 kMovieVersion = 1;
+
+// a state hash is recorded every this many frames by default
+constexpr auto kMovieDefaultHashInterval = 60u;
+
+enum class MovieLoadResult {
+  Ok,
+  ReadError,
+  InvalidFormat,
+  UnsupportedVersion
+};
+
+// recording of the joypad input of every frame from a starting save state,
+// along with a hash of the full emulated state every few frames. replaying the
+// input from the start state must reproduce the same hashes bit-exactly; any
+// difference means that emulation has changed (or was never deterministic).
+//
+// in files, the input is stored as runs of identical key states, as the keys
+// held rarely change from one frame to the next
+class Movie {
+public:
+  Movie();
+
+  // begins a new movie starting from the current state of gbc, which must have
+  // a ROM loaded. the APU's lazy mode must be disallowed while recording, or
+  // the state hashes will depend on whether audio was being played
+  void Start(const Gbc& gbc,
+             unsigned int hashInterval = kMovieDefaultHashInterval);
+  // records the keys committed for the frame that gbc just emulated, and its
+  // state hash if one is due
+  void RecordFrame(const Gbc& gbc);
+
+  void Save(std::vector<u8>& outData) const;
+  MovieLoadResult Load(const u8* data, std::size_t size);
+
+  bool SaveFile(const std::string& filePath) const;
+  MovieLoadResult LoadFile(const std::string& filePath);
+
+  u64 GetRomHash() const;
+  const std::vector<u8>& GetStartState() const;
+
+  u32 GetNumFrames() const;
+  u8 GetFrameKeys(u32 frame) const;
+
+  unsigned int GetHashInterval() const;
+  // hashes are recorded after every hashInterval-th frame (counting from 1)
+  bool HasFrameHash(u32 frame) const;
+  u64 GetFrameHash(u32 frame) const;
+
+  // hashes the full emulated state of gbc. stateBuffer is used as scratch
+  // space, so that reusing it avoids reallocating
+  static u64 CalculateStateHash(const Gbc& gbc, std::vector<u8>& stateBuffer);
+
+  static std::string GetMovieLoadResultAsMessage(MovieLoadResult result);
+
+private:
+  u64 romHash_;
+  std::vector<u8> startState_;
+
+  std::vector<u8> frameKeys_;
+
+  unsigned int hashInterval_;
+  std::vector<u64> frameHashes_;
+
+  std::vector<u8> hashStateBuffer_;
+};
+
+// replays a movie on a Gbc, checking the recorded state hashes as it goes
+class MoviePlayer {
+public:
+  explicit MoviePlayer(const Movie& movie);
+
+  // loads the movie's start state into gbc (which must have the movie's ROM
+  // loaded), disallows the APU's lazy mode and commits the keys of the first
+  // frame
+  StateLoadResult Start(Gbc& gbc);
+
+  // call after gbc has emulated a frame. checks the frame's state hash if one
+  // was recorded, then commits the keys of the next frame. returns false once
+  // the movie has ended or the replay has desynced
+  bool OnFrameEnd(Gbc& gbc);
+
+  bool IsFinished() const;
+  bool HasDesynced() const;
+
+  // frames replayed so far
+  u32 GetFrame() const;
+  // the first frame whose state hash didn't match the recording
+  u32 GetDesyncFrame() const;
+
+private:
+  const Movie& movie_;
+  std::vector<u8> stateBuffer_;
+
+  u32 frame_, desyncFrame_;
+  bool hasDesynced_;
+
+  void CommitFrameKeys(Gbc& gbc) const;
+};
+
+#endif // SDGBC_MOVIE_H_
@@ -0,0 +1,159 @@
+#ifndef SDGBC_NETPLAY_H_
+#define SDGBC_NETPLAY_H_
+
+#include "hw/gbc.h"
+#include <array>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+// netplay packets start with this magic number ("SDGN" in ASCII)
+constexpr u32 kNetplayPacketMagic = 0x4e474453;
+
+// how many frames a peer may run ahead of the last frame that it has the
+// other peer's input for. this is also the deepest that a rollback can be
+constexpr auto kNetplayMaxRollbackFrames = 8u;
+
+// frames worth of input and snapshots kept by each peer. must be a power of 2
+// comfortably larger than the frames that can be in flight either way
+constexpr auto kNetplayHistoryFrames = 64u;
+static_assert(kNetplayHistoryFrames > 2 * kNetplayMaxRollbackFrames + 1,
+              "kNetplayHistoryFrames is too small");
+static_assert((kNetplayHistoryFrames & (kNetplayHistoryFrames - 1)) == 0,
+              "kNetplayHistoryFrames must be a power of 2");
+
+// sends and receives whole packets without blocking. packets may be lost, but
+// must arrive intact if they arrive at all
+class INetplayTransport {
+public:
+  virtual ~INetplayTransport() = default;
+
+  // returns false if the packet couldn't be sent (e.g the peer isn't up yet)
+  virtual bool NetplaySend(const std::vector<u8>& packet) = 0;
+  // returns false if no packet has arrived
+  virtual bool NetplayReceive(std::vector<u8>& outPacket) = 0;
+};
+
+// exchanges packets over a unix domain datagram socket. this is either one end
+// of a connected pair (for peers in the same process) or a socket bound to a
+// path that sends to the peer's path (for peers in separate processes).
+// NOTE: only supported on POSIX hosts; elsewhere, opening always fails
+class SocketNetplayTransport : public INetplayTransport {
+public:
+  SocketNetplayTransport();
+  explicit SocketNetplayTransport(const SocketNetplayTransport& other) = delete;
+  ~SocketNetplayTransport();
+
+  SocketNetplayTransport& operator=(const SocketNetplayTransport& other)
+      = delete;
+
+  static bool OpenPair(SocketNetplayTransport& a, SocketNetplayTransport& b);
+  // replaces any stale socket file at localPath. the peer doesn't need to have
+  // opened its end yet
+  bool Open(const std::string& localPath, const std::string& remotePath);
+  void Close();
+  bool IsOpen() const;
+
+  bool NetplaySend(const std::vector<u8>& packet) override;
+  bool NetplayReceive(std::vector<u8>& outPacket) override;
+
+private:
+  int fd_;
+  std::string localPath_, remotePath_; // empty if opened as a pair
+};
+
+// holds back the packets received from another transport until latency has
+// passed since they arrived. used for trying out netplay without a real
+// network between the peers
+class LatencyNetplayTransport : public INetplayTransport {
+public:
+  LatencyNetplayTransport(INetplayTransport& transport,
+                          std::chrono::microseconds latency);
+
+  bool NetplaySend(const std::vector<u8>& packet) override;
+  bool NetplayReceive(std::vector<u8>& outPacket) override;
+
+private:
+  INetplayTransport& transport_;
+  const std::chrono::microseconds latency_;
+
+  std::deque<std::pair<std::chrono::steady_clock::time_point,
+                       std::vector<u8>>> pending_;
+};
+
+struct NetplayStats {
+  u32 numFrames;        // advanced so far
+  u32 numStalls;        // advances refused while waiting for the peer
+  u32 numRollbacks;
+  u32 lastRollbackFrames, maxRollbackFrames;
+  double rollbackCostMicros;  // average host time to restore and re-emulate
+  double snapshotCostMicros;  // average host time to snapshot each frame
+  u32 remoteFrame;            // frames of the peer's input that we have
+};
+
+// keeps two peers' copies of the same machine in step, with each peer feeding
+// in its own player's input every frame. rather than waiting for the other
+// player's input to arrive, it is predicted to be the same as the last input
+// received. if that turns out to be wrong, the snapshot from before the
+// mispredicted frame is restored and the frames since are re-emulated with the
+// real input, without rendering or sound.
+//
+// the emulated hardware only has one joypad, so the keys held by both players
+// are combined
+class RollbackSession {
+public:
+  RollbackSession();
+
+  // begins a session from the current state of gbc, which must be the same as
+  // the peer's state when it begins its session (e.g both reset with the same
+  // ROM). disallows the APU's lazy mode, as otherwise emulation would depend
+  // on whether audio is playing. localPlayer is 0 for one peer and 1 for the
+  // other
+  void Start(Gbc& gbc, INetplayTransport& transport, unsigned int localPlayer);
+  void Stop();
+  bool IsStarted() const;
+
+  // emulates the next frame with localKeys held by the local player. returns
+  // false without emulating if we are too far ahead of the peer, in which case
+  // the same frame's keys should be given again later
+  bool AdvanceFrame(Gbc& gbc, u8 localKeys);
+  // handles packets from the peer (rolling back if needed) without advancing
+  void Poll(Gbc& gbc);
+
+  // true if the peer's input for every frame advanced so far has arrived,
+  // meaning that no more rollbacks can happen for them
+  bool IsSynchronized() const;
+
+  const NetplayStats& GetStats() const;
+
+private:
+  INetplayTransport* transport_;
+  unsigned int localPlayer_;
+
+  u32 frame_; // next frame to emulate
+  u32 remoteFrame_; // frames before this have the peer's real input
+  u32 remoteAckFrame_; // frames before this have had our input received
+  u32 rollbackFrame_; // earliest mispredicted frame, or frame_ if none
+
+  std::array<u8, kNetplayHistoryFrames> localKeys_, remoteKeys_;
+  // the peer's keys that each frame was last emulated with
+  std::array<u8, kNetplayHistoryFrames> usedRemoteKeys_;
+  std::array<u32, kNetplayHistoryFrames> remoteKeysFrame_;
+  // snapshot taken just before emulating each frame
+  std::array<std::vector<u8>, kNetplayHistoryFrames> snapshots_;
+
+  std::vector<u8> packet_;
+  NetplayStats stats_;
+
+  void ReceivePackets();
+  void HandlePacket(const std::vector<u8>& packet);
+  void SendInput();
+
+  void Rollback(Gbc& gbc);
+  void EmulateFrame(Gbc& gbc, u32 frame, bool takeSnapshot);
+  u8 GetRemoteKeys(u32 frame) const;
+};
+
+#endif // SDGBC_NETPLAY_H_
@@ -0,0 +1,72 @@
+#ifndef SDGBC_PERF_COUNTERS_H_
+#define SDGBC_PERF_COUNTERS_H_
+
+#include "types.h"
+#include <array>
+#include <cstddef>
+#include <string>
+
+enum PerfCounter : std::size_t {
+  kPerfCounterCycles,
+  kPerfCounterInstructions,
+  kPerfCounterBranchMisses,
+  kPerfCounterL1dMisses, // L1 data cache read misses
+  kNumPerfCounters
+};
+
+// one count per PerfCounter
+using PerfCounts = std::array<u64, kNumPerfCounters>;
+
+enum class PerfCountersOpenResult {
+  Ok,
+  Unsupported,  // not on Linux
+  NotPermitted, // see /proc/sys/kernel/perf_event_paranoid
+  NoCounters    // the host (or VM) has no hardware counters to open
+};
+
+std::string GetPerfCountersOpenResultAsMessage(PerfCountersOpenResult result);
+const char* GetPerfCounterName(PerfCounter counter);
+
+PerfCounts operator-(const PerfCounts& lhs, const PerfCounts& rhs);
+PerfCounts& operator+=(PerfCounts& lhs, const PerfCounts& rhs);
+
+// hardware event counters (through Linux's perf_event_open()) for the thread
+// that opens them, counting only while it runs user-space code. counters that
+// the host lacks are left out, so long as at least one of them can be opened
+class PerfCounters {
+public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  PerfCountersOpenResult Open();
+  void Close();
+
+  bool IsOpen() const;
+  bool IsCounting(PerfCounter counter) const;
+
+  // true if the counters can be read from user-space (with rdpmc) rather than
+  // with a system call, making reads cheap enough to take around small scopes
+  // of code
+  bool HasFastReads() const;
+
+  // the totals so far. counters that aren't counting read as 0.
+  // NOTE: only call from the thread that opened the counters
+  PerfCounts Read() const;
+
+private:
+  std::array<int, kNumPerfCounters> fds_;
+  std::array<void*, kNumPerfCounters> mmapPages_;
+  // the first counter opened leads the group, which is read all at once
+  int groupFd_;
+  std::array<std::size_t, kNumPerfCounters> groupIdxs_;
+  std::size_t numOpen_;
+  bool hasFastReads_;
+
+  PerfCounts ReadGroup() const;
+  PerfCounts ReadMmapPages() const;
+};
+
+#endif // SDGBC_PERF_COUNTERS_H_
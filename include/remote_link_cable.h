@@ -0,0 +1,173 @@
+#ifndef SDGBC_REMOTE_LINK_CABLE_H_
+#define SDGBC_REMOTE_LINK_CABLE_H_
+
+#include "hw/gbc.h"
+#include "netplay.h"
+#include "types.h"
+#include <array>
+#include <vector>
+
+// remote link cable packets start with this magic number ("SDGL" in ASCII)
+constexpr u32 kRemoteLinkPacketMagic = 0x4c474453;
+
+// how far (in normal speed clock cycles) we may run ahead of the last point
+// that the peer has told us about. this is also the deepest that a rollback
+// normally needs to be
+constexpr auto kRemoteLinkMaxSpeculationCycles = kNormalSpeedCyclesPerFrame / 4;
+
+// how often packets are exchanged with the peer, and how often a snapshot is
+// taken to roll back to
+constexpr auto kRemoteLinkServiceCycles = 4096u;
+constexpr auto kRemoteLinkSnapshotCycles = 2 * kRemoteLinkServiceCycles;
+
+// snapshots kept. must cover a few times kRemoteLinkMaxSpeculationCycles, as
+// a rollback on one side can cause a slightly deeper one on the other
+constexpr auto kRemoteLinkSnapshots = 32u;
+static_assert(kRemoteLinkSnapshots * kRemoteLinkSnapshotCycles
+                  >= 4 * kRemoteLinkMaxSpeculationCycles,
+              "kRemoteLinkSnapshots is too small");
+
+struct RemoteLinkCableStats {
+  u64 numTransfers;       // bytes that we clocked
+  u64 numStalls;          // updates cut short while waiting for the peer
+  u64 numRollbacks;
+  u64 lastRollbackCycles, maxRollbackCycles;
+  u64 numFailedRollbacks; // too deep for the snapshots kept; may desync
+  double rollbackCostMicros; // average host time to restore a snapshot
+  double snapshotCostMicros; // average host time to take a snapshot
+};
+
+// links the serial port of a Gbc to a peer's in another process, exchanging
+// packets over a transport (such as a SocketNetplayTransport). rather than
+// waiting on the peer for every bit, each side runs ahead on its own and
+// sends the peer a timeline of what happens to its serial port: when it
+// starts or stops listening for a transfer (SC bit 7 set, bit 0 unset) and
+// with which byte in SB, and each byte that it clocks out itself (SC bits 7
+// and 0 set).
+//
+// clocking a transfer receives whatever byte the peer was listening with at
+// the time, as far as we know. bytes clocked by the peer are shifted in once
+// we reach the time that they were clocked at. if the peer's timeline turns
+// out to differ from what we assumed for any time that we already ran, we
+// restore a snapshot from before then and run again without audio, serial
+// output or rendering until we're back where we were. both sides count time
+// in normal speed clock cycles since connecting, so both must connect from
+// the start of their sessions
+class RemoteLinkCable : public ISerialLink {
+public:
+  RemoteLinkCable();
+  explicit RemoteLinkCable(const RemoteLinkCable& other) = delete;
+  ~RemoteLinkCable();
+
+  RemoteLinkCable& operator=(const RemoteLinkCable& other) = delete;
+
+  // plugs the cable into gbc. the transport must outlive the connection.
+  // disallows the APU's lazy mode, as otherwise rollbacks would depend on
+  // whether audio is playing
+  void Connect(Gbc& gbc, INetplayTransport& transport);
+  void Disconnect();
+  bool IsConnected() const;
+
+  // updates for a frame's worth of normal speed clock cycles. returns false
+  // if we had to stop early as we're too far ahead of the peer, in which case
+  // the same frame continues on the next call
+  bool UpdateFrame();
+  // exchanges packets (rolling back if needed) without advancing
+  void Poll();
+
+  // true if the peer has told us about everything up to the end of the last
+  // frame updated (and has heard about ours), so that no more rollbacks can
+  // happen for the frames already ran
+  bool IsSynchronized() const;
+
+  const RemoteLinkCableStats& GetStats() const;
+
+  bool SerialExchangeBit(bool bitSet) override;
+
+private:
+  enum class EventType : u8 {
+    // the port is listening with value & 0xff in SB if value & 0x100 is set,
+    // otherwise it isn't listening
+    PortState,
+    Transfer // value is the byte clocked out
+  };
+
+  struct Event {
+    u64 time;
+    EventType type;
+    u16 value;
+  };
+
+  // everything that a snapshot must restore besides the emulated state
+  struct LinkState {
+    u64 time;
+    u64 appliedTime;    // the peer's transfers before this have been applied
+    u64 lastLookupTime; // latest time that the peer's port state was used
+    u16 portState;
+    u8 exchangeBitIdx, exchangeInByte, exchangeOutByte;
+  };
+
+  struct Snapshot {
+    LinkState state;
+    std::vector<u8> data;
+    bool isValid;
+  };
+
+  Gbc* gbc_;
+  INetplayTransport* transport_;
+
+  LinkState state_;
+  u64 frameEndTime_;
+  u64 nextServiceTime_, nextSnapshotTime_;
+
+  // after a rollback, we run without output until we're back here
+  u64 replayEndTime_;
+  bool isReplaying_;
+  IApuOutput* replayApuOut_;
+  ISerialOutput* replaySerialOut_;
+  bool replayRenderSuppressed_;
+  CpuTotals replayCpuTotals_;
+
+  // our events not yet acknowledged by the peer, and the earliest time from
+  // which the peer needs them again. rollbacks bump our epoch, which the
+  // peer acknowledges so that we can tell stale acknowledgements apart
+  std::vector<Event> events_;
+  u64 resendTime_;
+  u32 epoch_;
+
+  // the peer's events before remoteTime_, which were all sent from the
+  // peer's epoch remoteEpoch_. events before remotePrunedTime_ are dropped, so
+  // remoteBasePortState_ is the peer's port state as of then
+  std::vector<Event> remoteEvents_;
+  u64 remoteTime_, remotePrunedTime_;
+  u32 remoteEpoch_;
+  u16 remoteBasePortState_;
+
+  std::array<Snapshot, kRemoteLinkSnapshots> snapshots_;
+  std::size_t nextSnapshotIdx_;
+
+  std::vector<u8> packet_;
+  std::vector<Event> packetEvents_;
+  RemoteLinkCableStats stats_;
+
+  bool RunUntil(u64 endTime);
+  void SetReplaying(bool isReplaying);
+
+  void Service();
+  void ReceivePackets();
+  void HandlePacket(const std::vector<u8>& packet);
+  void SendEvents();
+
+  void TakeSnapshot();
+  void Rollback(u64 changeTime);
+  void ApplyRemoteTransfers();
+  void PruneEvents();
+
+  // orders events for searching by time
+  static bool IsEventBefore(const Event& event, u64 time);
+
+  u16 GetPortState() const;
+  u16 GetRemotePortState(u64 time) const;
+};
+
+#endif // SDGBC_REMOTE_LINK_CABLE_H_
@@ -0,0 +1,70 @@
+#ifndef SDGBC_REWIND_BUFFER_H_
+#define SDGBC_REWIND_BUFFER_H_
+
+#include "types.h"
+#include <deque>
+#include <vector>
+
+// a keyframe is stored every this many pushes by default
+constexpr unsigned int kRewindDefaultKeyframeInterval = 60;
+
+// history of save states that can be popped back off in reverse order.
+//
+// every state is stored XORed against the most recent keyframe (keyframes are
+// stored as-is) and then run-length encoded. as consecutive states differ in
+// very few bytes, the XORed data is almost entirely made up of long runs of
+// zeroes that compress down to a few bytes each. only the keyframe of the
+// newest group of entries is kept decoded in memory.
+//
+// once either the entry or memory limit is exceeded, the oldest keyframe and
+// the entries that depend on it are dropped together. the buffers of dropped
+// entries are recycled, so memory use stays flat once the limit is reached
+class RewindBuffer {
+public:
+  RewindBuffer();
+
+  // a maxMemoryBytes of 0 means no limit on memory
+  void SetLimits(std::size_t maxEntries, std::size_t maxMemoryBytes);
+  void SetKeyframeInterval(unsigned int interval);
+
+  void Clear();
+
+  // all states pushed must be the same size; pushing a state of a different
+  // size clears the buffer first
+  void Push(const std::vector<u8>& state);
+  // returns false if there is nothing left to pop
+  bool Pop(std::vector<u8>& outState);
+
+  std::size_t GetNumEntries() const;
+  // bytes used by the encoded entries, spare buffers and the decoded keyframe
+  std::size_t GetMemoryUsage() const;
+
+private:
+  struct Entry {
+    std::vector<u8> data;
+    bool isKeyframe;
+  };
+
+  std::deque<Entry> entries_;
+  std::vector<std::vector<u8>> freeBuffers_;
+
+  std::size_t maxEntries_, maxMemoryBytes_;
+  unsigned int keyframeInterval_;
+
+  std::size_t stateSize_, entriesMemoryUsage_, freeMemoryUsage_;
+  std::size_t numKeyframes_;
+
+  // decoded copy of the keyframe that the newest entries were encoded against.
+  // invalidated when that keyframe is popped
+  std::vector<u8> keyframe_;
+  bool isKeyframeValid_;
+  unsigned int entriesSinceKeyframe_;
+
+  bool SyncKeyframe();
+  void EvictOldest();
+
+  std::vector<u8> TakeFreeBuffer();
+  void RecycleEntry(Entry&& entry);
+};
+
+#endif // SDGBC_REWIND_BUFFER_H_
@@ -0,0 +1,131 @@
+#ifndef SDGBC_SDGBC_H_
+#define SDGBC_SDGBC_H_
+
+/*
+ * C interface to the emulator core, for embedding sdgbc into other programs
+ * and for use from other languages through an FFI. everything here is plain C
+ * so that this header can be included from both C and C++.
+ *
+ * an instance is not thread-safe; calls on the same instance must not
+ * overlap. separate instances are fully independent of each other.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(SDGBC_SHARED)
+#  ifdef SDGBC_BUILDING
+#    define SDGBC_API __declspec(dllexport)
+#  else
+#    define SDGBC_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define SDGBC_API __attribute__((visibility("default")))
+#else
+#  define SDGBC_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bumped whenever the interface changes incompatibly */
+#define SDGBC_API_VERSION 2
+
+#define SDGBC_LCD_WIDTH 160
+#define SDGBC_LCD_HEIGHT 144
+#define SDGBC_AUDIO_SAMPLE_RATE 44100
+
+typedef struct sdgbc_instance sdgbc_instance;
+
+typedef enum sdgbc_result {
+  SDGBC_OK = 0,
+  SDGBC_ERROR_INVALID_ARGUMENT,
+  SDGBC_ERROR_ROM_INVALID_SIZE,
+  SDGBC_ERROR_ROM_UNSUPPORTED,
+  SDGBC_ERROR_NO_ROM,
+  SDGBC_ERROR_INVALID_STATE,
+  SDGBC_ERROR_UNSUPPORTED,
+  SDGBC_ERROR_OUT_OF_MEMORY
+} sdgbc_result;
+
+/* values match the bits of the JOYP key state */
+typedef enum sdgbc_key {
+  SDGBC_KEY_A      = 0x01,
+  SDGBC_KEY_B      = 0x02,
+  SDGBC_KEY_SELECT = 0x04,
+  SDGBC_KEY_START  = 0x08,
+  SDGBC_KEY_RIGHT  = 0x10,
+  SDGBC_KEY_LEFT   = 0x20,
+  SDGBC_KEY_UP     = 0x40,
+  SDGBC_KEY_DOWN   = 0x80
+} sdgbc_key;
+
+/* returns SDGBC_API_VERSION of the library actually loaded */
+SDGBC_API int sdgbc_get_api_version(void);
+SDGBC_API const char* sdgbc_get_result_message(sdgbc_result result);
+
+/* returns NULL if the instance could not be allocated */
+SDGBC_API sdgbc_instance* sdgbc_create(void);
+SDGBC_API void sdgbc_destroy(sdgbc_instance* inst);
+
+/* the ROM image is copied, so data may be freed after this returns. on
+ * success, the system is reset; on failure, any ROM loaded before is kept. a
+ * non-zero force_dmg runs CGB-enhanced games in DMG mode */
+SDGBC_API sdgbc_result sdgbc_load_rom(sdgbc_instance* inst, const void* data,
+                                      size_t size, int force_dmg);
+SDGBC_API sdgbc_result sdgbc_reset(sdgbc_instance* inst, int force_dmg);
+
+/* runs for a single frame's worth of normal speed clock cycles (about
+ * 1/59.73 seconds of emulated time). key states set beforehand take effect at
+ * the start of the frame */
+SDGBC_API sdgbc_result sdgbc_run_frame(sdgbc_instance* inst);
+
+/* with run-ahead, each sdgbc_run_frame also emulates num_frames further frames
+ * with the current keys and then rolls back, so that the framebuffer shows the
+ * last of those. this hides that many frames of the game's own input latency.
+ * audio and serial output still come from the real frame. 0 (the default)
+ * disables it */
+SDGBC_API void sdgbc_set_run_ahead(sdgbc_instance* inst,
+                                   unsigned int num_frames);
+
+SDGBC_API void sdgbc_set_key(sdgbc_instance* inst, sdgbc_key key,
+                             int pressed);
+
+/* the last completed frame as SDGBC_LCD_WIDTH * SDGBC_LCD_HEIGHT pixels in
+ * row-major order, each stored as 0x00RRGGBB. valid until the next call to
+ * sdgbc_run_frame or sdgbc_destroy */
+SDGBC_API const uint32_t* sdgbc_get_framebuffer(const sdgbc_instance* inst);
+/* 64-bit FNV-1a hash of the last completed frame's RGB values */
+SDGBC_API uint64_t sdgbc_get_frame_hash(const sdgbc_instance* inst);
+
+/* audio is disabled by default, which lets the core skip sample generation */
+SDGBC_API void sdgbc_set_audio_enabled(sdgbc_instance* inst, int enabled);
+/* interleaved stereo samples (left, right) generated during the last call to
+ * sdgbc_run_frame at SDGBC_AUDIO_SAMPLE_RATE. num_frames receives the number
+ * of stereo sample pairs. valid until the next call to sdgbc_run_frame */
+SDGBC_API const int16_t* sdgbc_get_audio_samples(const sdgbc_instance* inst,
+                                                 size_t* num_frames);
+
+/* NUL-terminated string of every byte sent over the serial port since the
+ * last reset. valid until the next call to sdgbc_run_frame */
+SDGBC_API const char* sdgbc_get_serial_output(const sdgbc_instance* inst);
+
+/* reads a byte through the memory bus, as the CPU would see it */
+SDGBC_API uint8_t sdgbc_read8(const sdgbc_instance* inst, uint16_t loc);
+
+/* save states. the size of a state only depends on the loaded ROM.
+ * sdgbc_get_state_size returns 0 if no ROM is loaded. sdgbc_save_state sets
+ * out_size (if not NULL) to the size of the state, even if buf is too small.
+ * if sdgbc_load_state fails, the current state is left untouched */
+SDGBC_API size_t sdgbc_get_state_size(const sdgbc_instance* inst);
+SDGBC_API sdgbc_result sdgbc_save_state(sdgbc_instance* inst, void* buf,
+                                        size_t size, size_t* out_size);
+SDGBC_API sdgbc_result sdgbc_load_state(sdgbc_instance* inst, const void* buf,
+                                        size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SDGBC_SDGBC_H_ */
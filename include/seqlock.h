@@ -0,0 +1,37 @@
+#ifndef SDGBC_SEQLOCK_H_
+#define SDGBC_SEQLOCK_H_
+
+#include "types.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// holds a value of a trivially copyable type that one writer thread can update
+// while any number of reader threads read it, without either side locking.
+// readers retry if the value was being written while they read it, so this is
+// best suited to small values that are written rarely compared to how long a
+// copy takes
+template <typename T>
+class Seqlock {
+public:
+  Seqlock();
+  explicit Seqlock(const T& val);
+
+  // NOTE: only safe to call from one thread at a time
+  void Store(const T& val);
+  T Load() const;
+
+private:
+  static constexpr std::size_t kNumWords = (sizeof(T) + sizeof(u64) - 1)
+                                           / sizeof(u64);
+
+  // odd while a write is in progress
+  std::atomic<u32> sequence_;
+  // the value is copied in and out as whole words so that a reader racing
+  // with the writer never touches memory non-atomically
+  std::array<std::atomic<u64>, kNumWords> words_;
+};
+
+#include "seqlock_inl.h"
+
+#endif // SDGBC_SEQLOCK_H_
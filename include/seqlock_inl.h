@@ -0,0 +1,65 @@
+#ifndef SDGBC_SEQLOCK_INL_H_
+#define SDGBC_SEQLOCK_INL_H_
+
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+template <typename T>
+Seqlock<T>::Seqlock() : Seqlock(T()) {}
+
+template <typename T>
+Seqlock<T>::Seqlock(const T& val) : sequence_(0) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "Seqlock values must be trivially copyable");
+
+  for (auto& w : words_) {
+    w.store(0, std::memory_order_relaxed);
+  }
+
+  Store(val);
+}
+
+template <typename T>
+void Seqlock<T>::Store(const T& val) {
+  std::array<u64, kNumWords> buffer{};
+  std::memcpy(buffer.data(), &val, sizeof(T));
+
+  const auto sequence = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  for (std::size_t i = 0; i < kNumWords; ++i) {
+    words_[i].store(buffer[i], std::memory_order_relaxed);
+  }
+
+  sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+template <typename T>
+T Seqlock<T>::Load() const {
+  std::array<u64, kNumWords> buffer;
+
+  while (true) {
+    const auto sequence = sequence_.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      std::this_thread::yield(); // writer is in the middle of storing
+      continue;
+    }
+
+    for (std::size_t i = 0; i < kNumWords; ++i) {
+      buffer[i] = words_[i].load(std::memory_order_relaxed);
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) == sequence) {
+      break;
+    }
+  }
+
+  T val;
+  std::memcpy(&val, buffer.data(), sizeof(T));
+  return val;
+}
+
+#endif // SDGBC_SEQLOCK_INL_H_
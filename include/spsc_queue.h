@@ -0,0 +1,45 @@
+#ifndef SDGBC_SPSC_QUEUE_H_
+#define SDGBC_SPSC_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// size of a cache line on most targets. used to keep the producer and consumer
+// indices apart so that the two threads don't fight over the same line
+constexpr std::size_t kSpscCacheLineSize = 64;
+
+// bounded lock-free queue that is safe to use from exactly one producer thread
+// and exactly one consumer thread at the same time.
+// the capacity is rounded up to a power of 2 so that indices can be wrapped
+// with a mask
+template <typename T>
+class SpscQueue {
+public:
+  explicit SpscQueue(std::size_t capacity);
+
+  // producer side. returns false (without blocking) if the queue is full
+  bool TryPush(const T& val);
+
+  // consumer side. returns false (without blocking) if the queue is empty
+  bool TryPop(T& outVal);
+  // pops at most maxCount elements into out. returns the amount popped
+  std::size_t TryPopMany(T* out, std::size_t maxCount);
+
+  // NOTE: only safe to call while neither thread is using the queue
+  void Clear();
+
+  std::size_t GetSize() const;
+  std::size_t GetCapacity() const;
+
+private:
+  std::vector<T> buffer_;
+  const std::size_t mask_;
+
+  alignas(kSpscCacheLineSize) std::atomic<std::size_t> head_; // consumer
+  alignas(kSpscCacheLineSize) std::atomic<std::size_t> tail_; // producer
+};
+
+#include "spsc_queue_inl.h"
+
+#endif // SDGBC_SPSC_QUEUE_H_
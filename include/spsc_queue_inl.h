@@ -0,0 +1,69 @@
+#ifndef SDGBC_SPSC_QUEUE_INL_H_
+#define SDGBC_SPSC_QUEUE_INL_H_
+
+#include <algorithm>
+
+namespace detail {
+  inline std::size_t RoundUpPow2(std::size_t val) {
+    std::size_t pow2 = 1;
+    while (pow2 < val) {
+      pow2 <<= 1;
+    }
+
+    return pow2;
+  }
+}
+
+template <typename T>
+SpscQueue<T>::SpscQueue(std::size_t capacity)
+    : buffer_(detail::RoundUpPow2(std::max<std::size_t>(capacity, 2))),
+      mask_(buffer_.size() - 1), head_(0), tail_(0) {}
+
+template <typename T>
+bool SpscQueue<T>::TryPush(const T& val) {
+  const auto tail = tail_.load(std::memory_order_relaxed);
+  if (tail - head_.load(std::memory_order_acquire) >= buffer_.size()) {
+    return false; // full
+  }
+
+  buffer_[tail & mask_] = val;
+  tail_.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool SpscQueue<T>::TryPop(T& outVal) {
+  return TryPopMany(&outVal, 1) == 1;
+}
+
+template <typename T>
+std::size_t SpscQueue<T>::TryPopMany(T* out, std::size_t maxCount) {
+  const auto head = head_.load(std::memory_order_relaxed);
+  const auto count = std::min(tail_.load(std::memory_order_acquire) - head,
+                              maxCount);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    out[i] = buffer_[(head + i) & mask_];
+  }
+
+  head_.store(head + count, std::memory_order_release);
+  return count;
+}
+
+template <typename T>
+void SpscQueue<T>::Clear() {
+  head_ = tail_ = 0;
+}
+
+template <typename T>
+std::size_t SpscQueue<T>::GetSize() const {
+  return tail_.load(std::memory_order_acquire)
+         - head_.load(std::memory_order_acquire);
+}
+
+template <typename T>
+std::size_t SpscQueue<T>::GetCapacity() const {
+  return buffer_.size();
+}
+
+#endif // SDGBC_SPSC_QUEUE_INL_H_
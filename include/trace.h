@@ -0,0 +1,96 @@
+#ifndef SDGBC_TRACE_H_
+#define SDGBC_TRACE_H_
+
+#include "types.h"
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+// scoped trace zones, for seeing how the emulation, audio & UI threads line up
+// with each other (frame pacing stalls, lock contention, etc.).
+// each thread records its zones into its own buffer without locking, and a
+// recording can be written out as Chrome trace event JSON, which can be viewed
+// in chrome://tracing or ui.perfetto.dev.
+//
+// the zones are compiled out entirely unless SDGBC_ENABLE_TRACING is defined
+// (see the cmake option of the same name). otherwise, a zone only costs an
+// atomic load while nothing is being recorded
+
+#ifdef SDGBC_ENABLE_TRACING
+constexpr bool kTraceZonesEnabled = true;
+#else
+constexpr bool kTraceZonesEnabled = false;
+#endif
+
+// the max amount of zones that each thread records in a recording. any later
+// zones are dropped
+constexpr std::size_t kTraceMaxEventsPerThread = 1 << 18;
+
+namespace trace {
+  namespace detail {
+    extern std::atomic<bool> isRecording;
+  }
+
+  // starting a recording discards the previous one
+  void StartRecording();
+  void StopRecording();
+
+  inline bool IsRecording() {
+    return detail::isRecording.load(std::memory_order_relaxed);
+  }
+
+  // names the calling thread in the written trace. name must stay valid for
+  // as long as the recording is kept (e.g a string literal)
+  void SetThreadName(const char* name);
+
+  // nanoseconds since the program started
+  u64 GetNanos();
+  void RecordZone(const char* name, u64 startNanos, u64 endNanos);
+
+  // the amount of zones dropped from the current (or last) recording due to
+  // a thread running out of room
+  u64 GetNumDroppedEvents();
+
+  // NOTE: should only be called after stopping the recording; zones that are
+  // still being recorded by other threads may otherwise be missed
+  bool WriteChromeJson(std::ostream& os);
+  bool WriteChromeJsonFile(const std::string& filePath);
+}
+
+// records the time between its construction and destruction as a zone, if a
+// recording was in progress when it was constructed
+class TraceZone {
+public:
+  explicit TraceZone(const char* name)
+      : name_(name),
+        startNanos_(trace::IsRecording() ? trace::GetNanos() : kNotRecording) {}
+
+  ~TraceZone() {
+    if (startNanos_ != kNotRecording) {
+      trace::RecordZone(name_, startNanos_, trace::GetNanos());
+    }
+  }
+
+  TraceZone(const TraceZone&) = delete;
+  TraceZone& operator=(const TraceZone&) = delete;
+
+private:
+  static constexpr u64 kNotRecording = ~0ull;
+
+  const char* name_;
+  u64 startNanos_;
+};
+
+// traces the rest of the enclosing scope as a zone named name (which must be
+// a string literal)
+#ifdef SDGBC_ENABLE_TRACING
+#  define SDGBC_TRACE_CONCAT_(a, b) a##b
+#  define SDGBC_TRACE_CONCAT(a, b) SDGBC_TRACE_CONCAT_(a, b)
+#  define SDGBC_TRACE_ZONE(name) \
+     TraceZone SDGBC_TRACE_CONCAT(traceZone, __LINE__)(name)
+#else
+#  define SDGBC_TRACE_ZONE(name) static_cast<void>(0)
+#endif
+
+#endif // SDGBC_TRACE_H_
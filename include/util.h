@@ -7,6 +7,8 @@
 
 class Cpu;
 
+constexpr u64 kFnv1a64OffsetBasis = 0xcbf29ce484222325;
+
 namespace util {
   u16 To16(u8 hi, u8 lo);
 
@@ -26,6 +28,15 @@ namespace util {
   bool ReadBinaryStream(std::istream& is, std::vector<u8>& data,
                         bool resizeToFitData = true);
   bool WriteBinaryStream(std::ostream& os, const std::vector<u8>& data);
+
+  // 64-bit FNV-1a. pass the result of a previous call as hash to continue
+  // hashing over multiple blocks of data
+  u64 HashFnv1a64(const u8* data, std::size_t size,
+                  u64 hash = kFnv1a64OffsetBasis);
+
+  // folds a new timing sample into a running average, smoothing out the
+  // reported cost over the last several samples
+  double SmoothCost(double avgMicros, double sampleMicros);
 }
 
 #endif // SDGBC_UTIL_H_
@@ -0,0 +1,38 @@
+#ifndef SDGBC_BUFFER_LCD_H_
+#define SDGBC_BUFFER_LCD_H_
+
+#include "hw/ppu.h"
+#include "types.h"
+#include <array>
+
+// each pixel is stored as 0x00RRGGBB
+using LcdFrameBuffer = std::array<u32, kLcdWidthPixels * kLcdHeightPixels>;
+
+// LCD that renders into an in-memory frame buffer. used where there's no
+// window to draw to, such as for headless runs
+class BufferLcd : public ILcd {
+public:
+  BufferLcd();
+
+  void LcdPower(bool powerOn) override;
+  void LcdRefresh() override;
+  void LcdPutPixel(unsigned int x, unsigned int y,
+                   const RgbColor& color) override;
+
+  // the last completed frame
+  const LcdFrameBuffer& GetFrameBuffer() const;
+  // 64-bit FNV-1a hash of the last completed frame
+  u64 CalculateFrameHash() const;
+
+  u64 GetNumRefreshes() const;
+  bool IsLcdOn() const;
+
+private:
+  LcdFrameBuffer frontBuffer_, backBuffer_;
+  u64 numRefreshes_;
+  bool isLcdOn_;
+
+  void ClearToWhite();
+};
+
+#endif // SDGBC_BUFFER_LCD_H_
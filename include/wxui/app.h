@@ -22,7 +22,7 @@ public:
 
 private:
   bool cpuCmdMode_;
-  std::string startupRomFilePath_;
+  std::string startupRomFilePath_, startupSymFilePath_;
 };
 
 #endif // SDGBC_APP_H_
@@ -5,7 +5,6 @@
 #include "wxui/sfml_canvas.h"
 #include <array>
 #include <atomic>
-#include <mutex>
 
 class LcdCanvas : public SfmlCanvas, public ILcd {
 public:
@@ -28,15 +27,16 @@ private:
   bool maintainAspectRatio_;
   bool isLcdOn_;
 
-  std::array<sf::Image, 2> lcdFrameBuffers_;
-  sf::Image* lcdFrontBuffer_;
-  sf::Image* lcdBackBuffer_;
-  // NOTE: no need to ever lock for back buffer accesses, as these are only
-  // done by the emulation thread. only the front buffer is accessed by both
-  // the emulation and main thread
-  mutable std::mutex lcdFrontBufferMutex_;
+  // triple buffered so that neither thread ever waits on the other: the
+  // emulation thread draws into the back buffer, the main thread uploads the
+  // front buffer, and finished frames are handed over by swapping indices with
+  // the ready buffer. the ready index also holds kLcdFreshFrameBit if its
+  // buffer has a frame that the main thread hasn't taken yet
+  std::array<sf::Image, 3> lcdFrameBuffers_;
+  unsigned int lcdBackIndex_;  // only used by the emulation thread
+  unsigned int lcdFrontIndex_; // only used by the main thread
+  std::atomic<unsigned int> lcdReadyIndex_;
 
-  std::atomic<bool> lcdTextureNeedsRefresh_;
   sf::Texture lcdTexture_;
 
   void CanvasRender() override;
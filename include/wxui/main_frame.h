@@ -23,13 +23,20 @@ private:
   SfmlApuSoundStream audioOut_;
   Emulator emulator_;
 
+  // periodically refreshes the title while it is showing live stats
+  wxTimer titleTimer_;
+  // likewise for the runtime stats in the status bar, while it is shown
+  wxTimer statsTimer_;
+
   void RecursivelyConnectKeyEvents(wxWindow* childComponent);
 
   void UpdateUIState();
   void UpdateTitle();
   void UpdateMenu();
+  void UpdateStatsBar();
 
   bool HandleJoypadKeyEvent(wxKeyEvent& event);
+  bool HandleRewindKeyEvent(wxKeyEvent& event);
 
   void OnClose(wxCloseEvent& event);
   void OnSize(wxSizeEvent& event);
@@ -41,11 +48,22 @@ private:
   void OnOpenRomFile(wxCommandEvent& event);
   void OnImportBattery(wxCommandEvent& event);
   void OnExportBattery(wxCommandEvent& event);
+  void OnStartMovie(wxCommandEvent& event);
+  void OnStopMovie(wxCommandEvent& event);
 
   void OnReset(wxCommandEvent& event);
   void OnResetInDmgMode(wxCommandEvent& event);
   void OnPause(wxCommandEvent& event);
   void OnLimitFramerate(wxCommandEvent& event);
+  void OnFastForward(wxCommandEvent& event);
+  void OnFastForwardSpeed(wxCommandEvent& event);
+  void OnEnableRewind(wxCommandEvent& event);
+  void OnRunAhead(wxCommandEvent& event);
+  void OnShowStats(wxCommandEvent& event);
+  void OnCountHwEvents(wxCommandEvent& event);
+  void OnRecordTrace(wxCommandEvent& event);
+  void OnTitleTimer(wxTimerEvent& event);
+  void OnStatsTimer(wxTimerEvent& event);
 
   void OnEnableBg(wxCommandEvent& event);
   void OnEnableBgWindow(wxCommandEvent& event);
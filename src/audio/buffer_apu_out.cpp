@@ -0,0 +1,32 @@
+#include "audio/buffer_apu_out.h"
+
+BufferApuOutput::BufferApuOutput() : enabled_(false) {}
+
+void BufferApuOutput::AudioBufferSamples(i16 leftSample, i16 rightSample) {
+  samples_.push_back(leftSample);
+  samples_.push_back(rightSample);
+}
+
+bool BufferApuOutput::AudioIsMuted() const {
+  return !enabled_;
+}
+
+void BufferApuOutput::SetEnabled(bool val) {
+  enabled_ = val;
+
+  if (!enabled_) {
+    ClearSamples();
+  }
+}
+
+bool BufferApuOutput::IsEnabled() const {
+  return enabled_;
+}
+
+const std::vector<i16>& BufferApuOutput::GetSamples() const {
+  return samples_;
+}
+
+void BufferApuOutput::ClearSamples() {
+  samples_.clear();
+}
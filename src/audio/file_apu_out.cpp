@@ -0,0 +1,250 @@
+#include "audio/file_apu_out.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+// amount of sample frames popped from the queue by the writer at a time
+constexpr std::size_t kWriterBatchSize = 4096;
+
+// how long the writer sleeps for when the queue is empty. the queue holds a few
+// seconds worth of audio, so this can be pretty coarse
+constexpr auto kWriterIdleSleepTime = std::chrono::milliseconds(10);
+
+constexpr auto kWavHeaderSize = 44u;
+
+namespace {
+  void PutLe16(char* out, u16 val) {
+    out[0] = static_cast<char>(val & 0xff);
+    out[1] = static_cast<char>(val >> 8);
+  }
+
+  void PutLe32(char* out, u32 val) {
+    PutLe16(out, static_cast<u16>(val & 0xffff));
+    PutLe16(out + 2, static_cast<u16>(val >> 16));
+  }
+
+  // inserts suffix into filePath just before its extension (if any)
+  std::string GetStemFilePath(const std::string& filePath,
+                              const std::string& suffix) {
+    const auto sepIdx = filePath.find_last_of("/\\");
+    const auto extIdx = filePath.find_last_of('.');
+
+    if (extIdx == std::string::npos
+        || (sepIdx != std::string::npos && extIdx < sepIdx)) {
+      return filePath + suffix;
+    }
+
+    return filePath.substr(0, extIdx) + suffix + filePath.substr(extIdx);
+  }
+}
+
+FileApuOutput::FileApuOutput()
+    : queue_(kFileApuQueueSize), pendingVolumes_(),
+      format_(FileApuOutputFormat::Wav), recordStems_(false),
+      isOpen_(false), droppedSamples_(0) {}
+
+FileApuOutput::~FileApuOutput() {
+  Close();
+}
+
+bool FileApuOutput::Open(const std::string& filePath,
+                         FileApuOutputFormat format, bool recordStems) {
+  Close();
+
+  format_ = format;
+  recordStems_ = recordStems;
+
+  if (!mainFile_.Open(filePath, format, 2)) {
+    return false;
+  }
+
+  if (recordStems) {
+    for (std::size_t i = 0; i < stemFiles_.size(); ++i) {
+      const auto stemPath = GetStemFilePath(filePath,
+                                            ".ch" + std::to_string(i + 1));
+
+      if (!stemFiles_[i].Open(stemPath, format, 1)) {
+        // close the ones we've opened so far
+        mainFile_.Close(format);
+        for (std::size_t j = 0; j < i; ++j) {
+          stemFiles_[j].Close(format);
+        }
+
+        return false;
+      }
+    }
+  }
+
+  queue_.Clear();
+  droppedSamples_ = 0;
+  isOpen_ = true;
+  writerThread_ = std::thread(&FileApuOutput::WriterThreadMain, this);
+  return true;
+}
+
+void FileApuOutput::Close() {
+  if (!isOpen_) {
+    return;
+  }
+
+  // the writer thread drains whatever is left in the queue before exiting
+  isOpen_ = false;
+  if (writerThread_.joinable()) {
+    writerThread_.join();
+  }
+
+  mainFile_.Close(format_);
+  if (recordStems_) {
+    for (auto& stemFile : stemFiles_) {
+      stemFile.Close(format_);
+    }
+  }
+}
+
+bool FileApuOutput::IsOpen() const {
+  return isOpen_;
+}
+
+u64 FileApuOutput::GetDroppedSamples() const {
+  return droppedSamples_;
+}
+
+void FileApuOutput::AudioBufferSamples(i16 leftSample, i16 rightSample) {
+  if (!isOpen_) {
+    return;
+  }
+
+  if (!queue_.TryPush({leftSample, rightSample, pendingVolumes_})) {
+    // writer can't keep up; never block the emulation thread
+    droppedSamples_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+bool FileApuOutput::AudioIsMuted() const {
+  return !isOpen_;
+}
+
+u64 FileApuOutput::AudioGetNumOverruns() const {
+  return GetDroppedSamples();
+}
+
+bool FileApuOutput::AudioWantsChannelVolumes() const {
+  return recordStems_;
+}
+
+void FileApuOutput::AudioBufferChannelVolumes(
+    const ApuChannelVolumes& volumes) {
+  pendingVolumes_ = volumes;
+}
+
+void FileApuOutput::WriterThreadMain() {
+  std::vector<SampleFrame> frames(kWriterBatchSize);
+
+  while (true) {
+    const auto count = queue_.TryPopMany(frames.data(), frames.size());
+    if (count > 0) {
+      WriteFrames(frames.data(), count);
+      continue;
+    }
+
+    // queue is empty. only exit now if we were closed so nothing gets lost
+    if (!isOpen_) {
+      break;
+    }
+
+    std::this_thread::sleep_for(kWriterIdleSleepTime);
+  }
+}
+
+void FileApuOutput::WriteFrames(const SampleFrame* frames, std::size_t count) {
+  // the unmixed channel volumes are unipolar (0 to max), so center them
+  // around zero as they're scaled to the 16-bit signed sample range; a stem
+  // would otherwise carry a large DC offset
+  const auto stemScale = std::numeric_limits<i16>::max()
+                         / kApuChannelMaxOutputVolume;
+
+  for (std::size_t i = 0; i < count; ++i) {
+    mainFile_.PutSample(frames[i].left);
+    mainFile_.PutSample(frames[i].right);
+
+    if (recordStems_) {
+      for (std::size_t ch = 0; ch < stemFiles_.size(); ++ch) {
+        stemFiles_[ch].PutSample(static_cast<i16>(
+          (2 * frames[i].volumes[ch] - kApuChannelMaxOutputVolume)
+          * stemScale));
+      }
+    }
+  }
+}
+
+bool FileApuOutput::OutputFile::Open(const std::string& filePath,
+                                     FileApuOutputFormat format,
+                                     unsigned int channels) {
+  stream.open(filePath, std::ios::binary | std::ios::trunc);
+  if (!stream) {
+    return false;
+  }
+
+  numChannels = channels;
+  dataSize = 0;
+  writeBuffer.clear();
+  writeBuffer.reserve(kFileApuWriteBufferSize);
+
+  if (format == FileApuOutputFormat::Wav) {
+    // reserve space for the header; it's filled in once we know the data size
+    writeBuffer.resize(kWavHeaderSize);
+  }
+
+  return true;
+}
+
+void FileApuOutput::OutputFile::Close(FileApuOutputFormat format) {
+  if (!stream.is_open()) {
+    return;
+  }
+
+  Flush();
+
+  if (format == FileApuOutputFormat::Wav) {
+    const auto bytesPerFrame = numChannels * 2u;
+    // WAV sizes are 32-bit; clamp so very long recordings are still readable
+    const auto maxDataSize = std::numeric_limits<u32>::max() - kWavHeaderSize;
+    const auto wavDataSize = static_cast<u32>(
+      std::min<u64>(dataSize, maxDataSize - maxDataSize % bytesPerFrame));
+
+    char header[kWavHeaderSize];
+    std::copy_n("RIFF", 4, header);
+    PutLe32(header + 4, wavDataSize + kWavHeaderSize - 8);
+    std::copy_n("WAVEfmt ", 8, header + 8);
+    PutLe32(header + 16, 16); // fmt chunk size
+    PutLe16(header + 20, 1);  // PCM
+    PutLe16(header + 22, static_cast<u16>(numChannels));
+    PutLe32(header + 24, kApuOutputSampleRateHz);
+    PutLe32(header + 28, kApuOutputSampleRateHz * bytesPerFrame);
+    PutLe16(header + 32, static_cast<u16>(bytesPerFrame));
+    PutLe16(header + 34, 16); // bits per sample
+    std::copy_n("data", 4, header + 36);
+    PutLe32(header + 40, wavDataSize);
+
+    stream.seekp(0);
+    stream.write(header, kWavHeaderSize);
+  }
+
+  stream.close();
+}
+
+void FileApuOutput::OutputFile::PutSample(i16 sample) {
+  char bytes[2];
+  PutLe16(bytes, static_cast<u16>(sample));
+  writeBuffer.insert(writeBuffer.end(), bytes, bytes + 2);
+  dataSize += 2;
+
+  if (writeBuffer.size() >= kFileApuWriteBufferSize) {
+    Flush();
+  }
+}
+
+void FileApuOutput::OutputFile::Flush() {
+  stream.write(writeBuffer.data(), writeBuffer.size());
+  writeBuffer.clear();
+}
@@ -1,7 +1,8 @@
 #include "audio/sfml_apu_out.h"
+#include "trace.h"
 
 SfmlApuSoundStream::SfmlApuSoundStream()
-    : isStreaming_(false),
+    : isStreaming_(false), numUnderruns_(0), numOverruns_(0),
       sampleFrontBuffer_(&sampleBuffers_[0]),
       sampleBackBuffer_(&sampleBuffers_[1]) {
   // 2 channels for left and right speakers @ our APU's downsampled sample rate
@@ -35,15 +36,30 @@ bool SfmlApuSoundStream::AudioIsMuted() const {
   return !isStreaming_;
 }
 
+u64 SfmlApuSoundStream::AudioGetNumUnderruns() const {
+  return numUnderruns_;
+}
+
+u64 SfmlApuSoundStream::AudioGetNumOverruns() const {
+  return numOverruns_;
+}
+
 void SfmlApuSoundStream::AudioBufferSamples(i16 leftSample, i16 rightSample) {
   if (samplesNextIdx_ < sampleBackBuffer_->size()) {
     // locking here has the potential that samplesNextIdx_ is set to 0 by the
     // onGetData() thread, but this shouldn't cause any issues (it'll mean that
     // these samples will get queued for the next audio driver copy instead)
-    std::unique_lock<std::mutex> lock(sampleBackBufferMutex_);
+    std::unique_lock<std::mutex> lock(sampleBackBufferMutex_, std::try_to_lock);
+    if (!lock.owns_lock()) {
+      // this runs for every sample, so only waits for the lock are traced
+      SDGBC_TRACE_ZONE("SfmlApuSoundStream::AudioBufferSamples (lock wait)");
+      lock.lock();
+    }
 
     (*sampleBackBuffer_)[samplesNextIdx_++] = leftSample;
     (*sampleBackBuffer_)[samplesNextIdx_++] = rightSample;
+  } else {
+    ++numOverruns_;
   }
 
   // wake up onGetData() if it is waiting for more samples if we've now
@@ -54,7 +70,14 @@ void SfmlApuSoundStream::AudioBufferSamples(i16 leftSample, i16 rightSample) {
 }
 
 bool SfmlApuSoundStream::onGetData(Chunk& data) {
+  trace::SetThreadName("audio");
+  SDGBC_TRACE_ZONE("SfmlApuSoundStream::onGetData");
+
   // wait until we have enough samples first (at least kMinStreamedSamples)
+  if (samplesNextIdx_ < kMinStreamedSamples && isStreaming_) {
+    ++numUnderruns_;
+  }
+
   {
     std::unique_lock<std::mutex> waitLock(streamWaitMutex_);
 
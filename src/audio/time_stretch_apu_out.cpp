@@ -0,0 +1,195 @@
+#include "audio/time_stretch_apu_out.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// the window search first tries every kCoarseSearchStep-th position comparing
+// every kCoarseCompareStep-th frame, then every position around the best one
+// comparing every kFineCompareStep-th frame
+constexpr std::size_t kCoarseSearchStep = 4;
+constexpr std::size_t kCoarseCompareStep = 4;
+constexpr std::size_t kFineCompareStep = 2;
+
+// input that is no longer needed is only erased once there's at least this
+// many frames of it, so the buffer isn't shifted after every window
+constexpr std::size_t kInputCompactFrames = 4096;
+
+TimeStretchApuOutput::TimeStretchApuOutput(IApuOutput* out)
+    : out_(out), speed_(1.0) {
+  Reset();
+}
+
+void TimeStretchApuOutput::AudioBufferSamples(i16 leftSample,
+                                              i16 rightSample) {
+  if (!out_) {
+    return;
+  }
+
+  if (speed_ <= 1.0) {
+    out_->AudioBufferSamples(leftSample, rightSample);
+    return;
+  }
+
+  input_.push_back(leftSample);
+  input_.push_back(rightSample);
+  ProcessWindows();
+}
+
+void TimeStretchApuOutput::ProcessWindows() {
+  const u64 inputEnd = inputBase_ + input_.size() / 2;
+
+  while (true) {
+    // wait until every position that the search may pick has a full half
+    // window of input after it
+    const auto idealPos = static_cast<u64>(nextPos_);
+    if (idealPos + kTimeStretchSearchFrames + kTimeStretchHopFrames
+            > inputEnd
+        || (hasLast_ && lastPos_ + 2 * kTimeStretchHopFrames > inputEnd)) {
+      break;
+    }
+
+    const u64 pos = hasLast_ ? FindBestWindowPos(idealPos) : idealPos;
+    const float* in = &input_[2 * (pos - inputBase_)];
+
+    if (hasLast_) {
+      // cross-fade from the second half of the last window into the first
+      // half of this one
+      const float* last = &input_[2 * (lastPos_ + kTimeStretchHopFrames
+                                       - inputBase_)];
+
+      for (std::size_t i = 0; i < kTimeStretchHopFrames; ++i) {
+        const float fadeIn = (i + 0.5f) / kTimeStretchHopFrames;
+        OutputFrame(last[2 * i] + (in[2 * i] - last[2 * i]) * fadeIn,
+                    last[2 * i + 1]
+                    + (in[2 * i + 1] - last[2 * i + 1]) * fadeIn);
+      }
+    } else {
+      for (std::size_t i = 0; i < kTimeStretchHopFrames; ++i) {
+        OutputFrame(in[2 * i], in[2 * i + 1]);
+      }
+    }
+
+    lastPos_ = pos;
+    hasLast_ = true;
+    nextPos_ += kTimeStretchHopFrames * speed_;
+
+    // keep the second half of this window and everything that the next search
+    // may look at; at high speeds, the input in between is skipped entirely
+    const auto nextIdealPos = static_cast<u64>(nextPos_);
+    const u64 keepPos = std::min(
+        lastPos_ + kTimeStretchHopFrames,
+        nextIdealPos - std::min<u64>(nextIdealPos, kTimeStretchSearchFrames));
+
+    if (keepPos >= inputBase_ + kInputCompactFrames) {
+      const auto numErased = static_cast<std::ptrdiff_t>(
+          std::min<u64>(keepPos, inputEnd) - inputBase_);
+      input_.erase(input_.begin(), input_.begin() + 2 * numErased);
+      inputBase_ += numErased;
+    }
+  }
+}
+
+u64 TimeStretchApuOutput::FindBestWindowPos(u64 idealPos) const {
+  const u64 firstPos = std::max<u64>(
+      inputBase_,
+      idealPos - std::min<u64>(idealPos, kTimeStretchSearchFrames));
+  const u64 lastPos = idealPos + kTimeStretchSearchFrames;
+
+  // prefer the ideal position if nothing lines up better
+  u64 coarseBestPos = idealPos;
+  double bestSimilarity = GetWindowSimilarity(idealPos, kCoarseCompareStep);
+
+  for (u64 pos = firstPos; pos <= lastPos; pos += kCoarseSearchStep) {
+    const double similarity = GetWindowSimilarity(pos, kCoarseCompareStep);
+    if (similarity > bestSimilarity) {
+      bestSimilarity = similarity;
+      coarseBestPos = pos;
+    }
+  }
+
+  u64 bestPos = coarseBestPos;
+  bestSimilarity = GetWindowSimilarity(coarseBestPos, kFineCompareStep);
+
+  const u64 fineFirstPos = std::max(
+      firstPos, coarseBestPos - std::min<u64>(coarseBestPos,
+                                              kCoarseSearchStep - 1));
+  const u64 fineLastPos = std::min(lastPos,
+                                   coarseBestPos + kCoarseSearchStep - 1);
+
+  for (u64 pos = fineFirstPos; pos <= fineLastPos; ++pos) {
+    const double similarity = GetWindowSimilarity(pos, kFineCompareStep);
+    if (similarity > bestSimilarity) {
+      bestSimilarity = similarity;
+      bestPos = pos;
+    }
+  }
+
+  return bestPos;
+}
+
+double TimeStretchApuOutput::GetWindowSimilarity(u64 pos,
+                                                 std::size_t step) const {
+  // compares (the mono mix of) the half window starting at pos with the second
+  // half of the last window, which is what it will be cross-faded with
+  const float* in = &input_[2 * (pos - inputBase_)];
+  const float* last = &input_[2 * (lastPos_ + kTimeStretchHopFrames
+                                   - inputBase_)];
+
+  double correlation = 0.0, energy = 0.0;
+  for (std::size_t i = 0; i < kTimeStretchHopFrames; i += step) {
+    const double inSample = in[2 * i] + in[2 * i + 1];
+    const double lastSample = last[2 * i] + last[2 * i + 1];
+
+    correlation += inSample * lastSample;
+    energy += inSample * inSample;
+  }
+
+  // normalized so that louder positions aren't favoured, keeping the sign so
+  // that positions out of phase are rejected
+  return energy > 0.0 ? correlation * std::fabs(correlation) / energy : 0.0;
+}
+
+void TimeStretchApuOutput::OutputFrame(float left, float right) {
+  const auto toSample = [] (float val) {
+    return static_cast<i16>(std::lround(std::min<float>(
+        std::max<float>(val, std::numeric_limits<i16>::min()),
+        std::numeric_limits<i16>::max())));
+  };
+
+  out_->AudioBufferSamples(toSample(left), toSample(right));
+}
+
+bool TimeStretchApuOutput::AudioIsMuted() const {
+  return !out_ || out_->AudioIsMuted();
+}
+
+void TimeStretchApuOutput::SetOutput(IApuOutput* out) {
+  out_ = out;
+  Reset();
+}
+
+IApuOutput* TimeStretchApuOutput::GetOutput() const {
+  return out_;
+}
+
+void TimeStretchApuOutput::SetSpeed(double speed) {
+  // the buffered input belongs to the old mode when switching to or from
+  // passing samples straight through
+  if ((speed > 1.0) != (speed_ > 1.0)) {
+    Reset();
+  }
+
+  speed_ = speed;
+}
+
+double TimeStretchApuOutput::GetSpeed() const {
+  return speed_;
+}
+
+void TimeStretchApuOutput::Reset() {
+  input_.clear();
+  inputBase_ = 0;
+  nextPos_ = 0.0;
+  lastPos_ = 0;
+  hasLast_ = false;
+}
@@ -0,0 +1,650 @@
+#include "bench/bench_runner.h"
+#include "bench/discard_apu_out.h"
+#include "util.h"
+#include "video/buffer_lcd.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+
+// frames emulated before measuring each scene, so that it's past its setup
+// and the host's caches are warm
+constexpr u64 kBenchWarmupFrames = 60;
+
+// times that each scene is measured, keeping the fastest
+constexpr unsigned int kBenchRuns = 3;
+
+namespace {
+  const char* const kComponentNames[kBenchNumComponents] = {
+    "cpu", "ppu", "apu", "timer", "dma", "other"
+  };
+
+  // Gbc::UpdateFrameInSteps() for numFrames frames. returns the amount of
+  // updates
+  template <typename EndStep>
+  u64 UpdateInSteps(Gbc& gbc, u64 numFrames, EndStep endStep) {
+    u64 numUpdates = 0;
+    for (u64 i = 0; i < numFrames; ++i) {
+      numUpdates += gbc.UpdateFrameInSteps(endStep);
+    }
+
+    return numUpdates;
+  }
+
+  std::string EscapeJsonString(const std::string& str) {
+    std::ostringstream os;
+
+    for (const char c : str) {
+      if (c == '"' || c == '\\') {
+        os << '\\' << c;
+      } else if (static_cast<unsigned char>(c) < 0x20) {
+        os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+           << static_cast<int>(c) << std::dec;
+      } else {
+        os << c;
+      }
+    }
+
+    return os.str();
+  }
+
+  // reads the name and ns per frame (or per op) of each scene and
+  // microbenchmark in results written by BenchRunner::WriteJson(). this isn't
+  // a general JSON parser; it only understands the layout that we write
+  bool ReadBaseline(const std::string& filePath,
+                    std::vector<std::pair<std::string, double>>& outScenes) {
+    std::ifstream file(filePath);
+    if (!file) {
+      return false;
+    }
+
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    const auto json = contents.str();
+
+    const std::string nameKey = "\"name\": \"";
+    const std::string nanosKey = "\"ns_per_";
+
+    outScenes.clear();
+    for (auto idx = json.find(nameKey); idx != std::string::npos;
+         idx = json.find(nameKey, idx)) {
+      idx += nameKey.size();
+
+      std::string name;
+      while (idx < json.size() && json[idx] != '"') {
+        if (json[idx] == '\\' && idx + 1 < json.size()) {
+          ++idx;
+        }
+        name += json[idx++];
+      }
+
+      idx = json.find(nanosKey, idx);
+      if (idx == std::string::npos) {
+        return false;
+      }
+      idx = json.find(": ", idx);
+      if (idx == std::string::npos) {
+        return false;
+      }
+      idx += 2;
+
+      char* endPtr;
+      const double nanos = std::strtod(json.c_str() + idx, &endPtr);
+      if (endPtr == json.c_str() + idx) {
+        return false;
+      }
+
+      outScenes.emplace_back(name, nanos);
+    }
+
+    return !outScenes.empty();
+  }
+}
+
+BenchOptions::BenchOptions()
+    : numFrames(600), listScenes(false), micro(false), perfCounters(false),
+      tolerancePercent(10.0) {}
+
+BenchRunner::BenchRunner(const BenchOptions& options, std::ostream& os)
+    : options_(options), os_(os) {}
+
+int BenchRunner::Run() {
+  if (options_.listScenes) {
+    for (const auto& scene : BuildBenchScenes()) {
+      os_ << scene.name << ": " << scene.description << '\n';
+    }
+
+    return kBenchExitOk;
+  }
+
+  results_.clear();
+  microResults_.clear();
+
+  if (options_.perfCounters) {
+    const auto openResult = perfCounters_.Open();
+    if (openResult != PerfCountersOpenResult::Ok) {
+      // carry on without them
+      os_ << "not counting hardware events: "
+          << GetPerfCountersOpenResultAsMessage(openResult) << '\n';
+    }
+  }
+
+  if (options_.micro) {
+    RunMicro();
+  } else if (!RunScenes()) {
+    return kBenchExitError;
+  }
+
+  if (!options_.jsonFilePath.empty() && !WriteJson()) {
+    os_ << "failed to write results to \"" << options_.jsonFilePath
+        << "\"\n";
+    return kBenchExitError;
+  }
+
+  return options_.baselineFilePath.empty() ? kBenchExitOk
+                                           : CompareWithBaseline();
+}
+
+bool BenchRunner::RunScenes() {
+  if (options_.romScenes.empty()) {
+    const auto scenes = BuildBenchScenes();
+
+    for (const auto& sceneName : options_.sceneNames) {
+      if (std::none_of(scenes.begin(), scenes.end(),
+                       [&sceneName](const BenchScene& scene) {
+                         return scene.name == sceneName;
+                       })) {
+        os_ << "unknown scene \"" << sceneName << "\"\n";
+        return false;
+      }
+    }
+
+    for (const auto& scene : scenes) {
+      if (!options_.sceneNames.empty()
+          && std::find(options_.sceneNames.begin(),
+                       options_.sceneNames.end(), scene.name)
+                 == options_.sceneNames.end()) {
+        continue;
+      }
+
+      Gbc gbc;
+      if (gbc.LoadCartridgeRomData(scene.romData, scene.name)
+          != RomLoadResult::Ok) {
+        os_ << "failed to load the " << scene.name << " scene's ROM\n";
+        return false;
+      }
+
+      if (!RunScene(scene.name, gbc)) {
+        return false;
+      }
+    }
+  } else {
+    for (const auto& romScene : options_.romScenes) {
+      Gbc gbc;
+      const auto loadResult = gbc.LoadCartridgeRomFile(romScene.romFilePath);
+      if (loadResult != RomLoadResult::Ok) {
+        os_ << "failed to load ROM \"" << romScene.romFilePath << "\" - \""
+            << Cartridge::GetRomLoadResultAsMessage(loadResult) << "\"\n";
+        return false;
+      }
+
+      std::string name = romScene.romFilePath;
+      if (!romScene.stateFilePath.empty()) {
+        std::vector<u8> state;
+        std::ifstream file(romScene.stateFilePath, std::ios::binary);
+
+        const auto stateResult = util::ReadBinaryStream(file, state)
+                                     ? gbc.LoadState(state)
+                                     : StateLoadResult::ReadError;
+        if (stateResult != StateLoadResult::Ok) {
+          os_ << "failed to load save state \"" << romScene.stateFilePath
+              << "\" - \"" << GetStateLoadResultAsMessage(stateResult)
+              << "\"\n";
+          return false;
+        }
+
+        name += '=' + romScene.stateFilePath;
+      }
+
+      if (!RunScene(name, gbc)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+bool BenchRunner::RunScene(const std::string& name, Gbc& gbc) {
+  using namespace std::chrono;
+
+  BufferLcd lcd;
+  DiscardApuOutput apuOut;
+
+  auto& hw = gbc.GetHardware();
+  hw.ppu.SetLcd(&lcd);
+  hw.apu.SetApuOutput(&apuOut);
+
+  RunFrames(gbc, kBenchWarmupFrames);
+
+  // timing each component has a cost of its own, so the time per frame is
+  // measured by runs without it. every run starts from the same point, so
+  // that they all do the same work
+  std::vector<u8> snapshot;
+  gbc.SaveSnapshot(snapshot);
+
+  // the fastest run is the one least disturbed by the rest of the host
+  u64 numInstructions = 0;
+  double hostSeconds = 0.0;
+  PerfCounts perfCounts{};
+
+  for (unsigned int i = 0; i < kBenchRuns; ++i) {
+    const auto startCounts = perfCounters_.Read();
+    const auto startTime = steady_clock::now();
+    numInstructions = RunFrames(gbc, options_.numFrames);
+    const double runSeconds = duration<double>(steady_clock::now()
+                                               - startTime).count();
+    const auto runCounts = perfCounters_.Read() - startCounts;
+
+    if (i == 0 || runSeconds < hostSeconds) {
+      hostSeconds = runSeconds;
+      perfCounts = runCounts;
+    }
+    gbc.LoadSnapshot(snapshot);
+  }
+
+  const auto componentSeconds = RunTimedFrames(gbc, options_.numFrames);
+
+  // reading the counters between every component is only cheap enough with
+  // fast reads
+  std::array<PerfCounts, kBenchNumComponents> componentCounts{};
+  if (perfCounters_.HasFastReads()) {
+    gbc.LoadSnapshot(snapshot);
+    componentCounts = RunCountedFrames(gbc, options_.numFrames);
+  }
+
+  hw.ppu.SetLcd(nullptr);
+  hw.apu.SetApuOutput(nullptr);
+
+  if (hostSeconds <= 0.0 || options_.numFrames == 0) {
+    os_ << "scene " << name << " ran too quickly to measure\n";
+    return false;
+  }
+
+  BenchResult result;
+  result.name = name;
+  result.numFrames = options_.numFrames;
+  result.hostSeconds = hostSeconds;
+  result.framesPerSecond = options_.numFrames / hostSeconds;
+  result.instructionsPerSecond = numInstructions / hostSeconds;
+  result.nanosPerFrame = hostSeconds * 1e9 / options_.numFrames;
+
+  // the timed run is slower, so its times are only used for the proportions
+  // to split the measured run's time in
+  double timedSeconds = 0.0;
+  for (const auto seconds : componentSeconds) {
+    timedSeconds += seconds;
+  }
+
+  for (unsigned int i = 0; i < kBenchNumComponents; ++i) {
+    result.componentNanosPerFrame[i] =
+        timedSeconds > 0.0
+            ? result.nanosPerFrame * componentSeconds[i] / timedSeconds
+            : 0.0;
+  }
+
+  result.hasPerfCounts = perfCounters_.IsOpen();
+  result.hasComponentPerfCounts = perfCounters_.HasFastReads();
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    result.perfCountsPerFrame[i] = perfCounts[i] / options_.numFrames;
+
+    for (unsigned int j = 0; j < kBenchNumComponents; ++j) {
+      result.componentPerfCountsPerFrame[j][i] = componentCounts[j][i]
+                                                 / options_.numFrames;
+    }
+  }
+
+  PrintResult(result);
+  results_.push_back(std::move(result));
+  return true;
+}
+
+u64 BenchRunner::RunFrames(Gbc& gbc, u64 numFrames) {
+  const auto& hw = gbc.GetHardware();
+  const u64 endCycles = numFrames * kNormalSpeedCyclesPerFrame;
+
+  u64 cycles = 0, numInstructions = 0;
+  while (cycles < endCycles) {
+    // updates while halted or stalled by a DMA don't execute anything
+    if (hw.cpu.GetStatus() == CpuStatus::Running
+        && !hw.dma.IsNdmaInProgress()) {
+      ++numInstructions;
+    }
+
+    // don't scale the amount of cycles with CPU double speed mode
+    cycles += util::RescaleCycles(hw.cpu, gbc.Update());
+  }
+
+  return numInstructions;
+}
+
+std::array<double, kBenchNumComponents> BenchRunner::RunTimedFrames(
+    Gbc& gbc, u64 numFrames) {
+  using namespace std::chrono;
+
+  // each time measured includes the cost of reading the clock once, which
+  // would otherwise swamp the cheaper components
+  constexpr unsigned int kNumCalibrationReads = 100000;
+  const auto calibrationStartTime = steady_clock::now();
+  for (unsigned int i = 0; i < kNumCalibrationReads; ++i) {
+    steady_clock::now();
+  }
+  const double clockReadSeconds =
+      duration<double>(steady_clock::now() - calibrationStartTime).count()
+      / kNumCalibrationReads;
+
+  std::array<steady_clock::duration, kBenchNumComponents> durations{};
+  auto time = steady_clock::now();
+
+  const auto numUpdates = UpdateInSteps(gbc, numFrames,
+                                        [&](GbcUpdateStep component) {
+    const auto endTime = steady_clock::now();
+    durations[component] += endTime - time;
+    time = endTime;
+  });
+
+  std::array<double, kBenchNumComponents> seconds;
+  for (unsigned int i = 0; i < kBenchNumComponents; ++i) {
+    seconds[i] = std::max(0.0, duration<double>(durations[i]).count()
+                                   - numUpdates * clockReadSeconds);
+  }
+
+  return seconds;
+}
+
+std::array<PerfCounts, kBenchNumComponents> BenchRunner::RunCountedFrames(
+    Gbc& gbc, u64 numFrames) {
+  // as with the clock in RunTimedFrames()
+  constexpr unsigned int kNumCalibrationReads = 100000;
+  const auto calibrationStartCounts = perfCounters_.Read();
+  for (unsigned int i = 0; i < kNumCalibrationReads; ++i) {
+    perfCounters_.Read();
+  }
+  const auto readCounts = perfCounters_.Read() - calibrationStartCounts;
+
+  std::array<PerfCounts, kBenchNumComponents> componentCounts{};
+  auto counts = perfCounters_.Read();
+
+  const auto numUpdates = UpdateInSteps(gbc, numFrames,
+                                        [&](GbcUpdateStep component) {
+    const auto endCounts = perfCounters_.Read();
+    componentCounts[component] += endCounts - counts;
+    counts = endCounts;
+  });
+
+  for (auto& componentCount : componentCounts) {
+    for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+      const u64 readCount = numUpdates * readCounts[i]
+                            / (kNumCalibrationReads + 1);
+      componentCount[i] = componentCount[i] > readCount
+                              ? componentCount[i] - readCount : 0;
+    }
+  }
+
+  return componentCounts;
+}
+
+void BenchRunner::RunMicro() {
+  const auto flags = os_.flags();
+  os_ << std::fixed << std::setprecision(2);
+
+  for (auto& result : RunComponentMicroBenches()) {
+    os_ << result.name << ": " << result.nanosPerOp << " ns/op\n";
+    microResults_.push_back(std::move(result));
+  }
+
+  os_.flags(flags);
+
+  for (const bool cbOps : {false, true}) {
+    const auto nanos = RunCpuOpMicroBenches(cbOps);
+    PrintCpuOpResults(nanos, cbOps);
+
+    for (unsigned int op = 0; op < nanos.size(); ++op) {
+      if (nanos[op] == kMicroBenchSkipped) {
+        continue;
+      }
+
+      std::ostringstream name;
+      name << "cpu op " << (cbOps ? "cb " : "") << "0x" << std::hex
+           << std::setw(2) << std::setfill('0') << op;
+      microResults_.push_back({name.str(), nanos[op]});
+    }
+  }
+}
+
+void BenchRunner::PrintCpuOpResults(const std::array<double, 256>& nanos,
+                                    bool cbOps) const {
+  const auto flags = os_.flags();
+  os_ << (cbOps ? "cpu cb opcodes" : "cpu opcodes") << " (ns/op):\n   "
+      << std::hex << std::uppercase;
+
+  for (unsigned int col = 0; col < 16; ++col) {
+    os_ << std::setw(6) << col;
+  }
+
+  os_ << std::fixed << std::setprecision(1);
+  for (unsigned int row = 0; row < 16; ++row) {
+    os_ << '\n' << row << "x ";
+
+    for (unsigned int col = 0; col < 16; ++col) {
+      const double opNanos = nanos[row * 16 + col];
+      if (opNanos == kMicroBenchSkipped) {
+        os_ << std::setw(6) << '-';
+      } else {
+        os_ << std::setw(6) << opNanos;
+      }
+    }
+  }
+
+  os_ << '\n';
+  os_.flags(flags);
+}
+
+void BenchRunner::PrintResult(const BenchResult& result) const {
+  const auto flags = os_.flags();
+  os_ << std::fixed << std::setprecision(1)
+      << "scene " << result.name << ": " << result.numFrames << " frames"
+      << "  fps: " << result.framesPerSecond
+      << "  instructions/s: " << std::setprecision(0)
+      << result.instructionsPerSecond
+      << "  ns/frame: " << result.nanosPerFrame << "\n ";
+
+  for (unsigned int i = 0; i < kBenchNumComponents; ++i) {
+    os_ << ' ' << kComponentNames[i] << ": "
+        << result.componentNanosPerFrame[i];
+  }
+
+  os_ << " ns/frame\n";
+
+  for (std::size_t i = 0; result.hasPerfCounts && i < kNumPerfCounters; ++i) {
+    const auto counter = static_cast<PerfCounter>(i);
+    if (!perfCounters_.IsCounting(counter)) {
+      continue;
+    }
+
+    os_ << "  " << GetPerfCounterName(counter) << "/frame: "
+        << result.perfCountsPerFrame[i];
+
+    for (unsigned int j = 0;
+         result.hasComponentPerfCounts && j < kBenchNumComponents; ++j) {
+      os_ << (j == 0 ? "  (" : ", ") << kComponentNames[j] << ": "
+          << result.componentPerfCountsPerFrame[j][i]
+          << (j + 1 == kBenchNumComponents ? ")" : "");
+    }
+
+    os_ << '\n';
+  }
+
+  const auto& counts = result.perfCountsPerFrame;
+  if (result.hasPerfCounts && counts[kPerfCounterCycles] > 0
+      && counts[kPerfCounterInstructions] > 0) {
+    os_ << std::setprecision(2) << "  instructions/cycle: "
+        << static_cast<double>(counts[kPerfCounterInstructions])
+           / counts[kPerfCounterCycles] << '\n';
+  }
+
+  os_.flags(flags);
+}
+
+void BenchRunner::WritePerfCountsJson(std::ostream& os,
+                                      const PerfCounts& counts) const {
+  os << '{';
+
+  auto isFirst = true;
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    const auto counter = static_cast<PerfCounter>(i);
+    if (perfCounters_.IsCounting(counter)) {
+      os << (isFirst ? "\"" : ", \"") << GetPerfCounterName(counter)
+         << "\": " << counts[i];
+      isFirst = false;
+    }
+  }
+
+  os << '}';
+}
+
+bool BenchRunner::WriteJson() const {
+  std::ofstream file(options_.jsonFilePath);
+  file << std::fixed << std::setprecision(1) << "{\n  \"scenes\": [";
+
+  for (std::size_t i = 0; i < results_.size(); ++i) {
+    const auto& result = results_[i];
+
+    file << (i > 0 ? ",\n" : "\n")
+         << "    {\n"
+         << "      \"name\": \"" << EscapeJsonString(result.name) << "\",\n"
+         << "      \"frames\": " << result.numFrames << ",\n"
+         << "      \"host_seconds\": " << std::setprecision(6)
+         << result.hostSeconds << std::setprecision(1) << ",\n"
+         << "      \"fps\": " << result.framesPerSecond << ",\n"
+         << "      \"instructions_per_second\": "
+         << result.instructionsPerSecond << ",\n"
+         << "      \"ns_per_frame\": " << result.nanosPerFrame << ",\n"
+         << "      \"component_ns_per_frame\": {";
+
+    for (unsigned int j = 0; j < kBenchNumComponents; ++j) {
+      file << (j > 0 ? ", \"" : "\"") << kComponentNames[j]
+           << "\": " << result.componentNanosPerFrame[j];
+    }
+
+    file << '}';
+
+    if (result.hasPerfCounts) {
+      file << ",\n      \"perf_per_frame\": ";
+      WritePerfCountsJson(file, result.perfCountsPerFrame);
+    }
+
+    if (result.hasComponentPerfCounts) {
+      file << ",\n      \"component_perf_per_frame\": {";
+
+      for (unsigned int j = 0; j < kBenchNumComponents; ++j) {
+        file << (j > 0 ? ", \"" : "\"") << kComponentNames[j] << "\": ";
+        WritePerfCountsJson(file, result.componentPerfCountsPerFrame[j]);
+      }
+
+      file << '}';
+    }
+
+    file << "\n    }";
+  }
+
+  file << "\n  ]";
+
+  if (!microResults_.empty()) {
+    file << ",\n  \"micro\": [" << std::setprecision(2);
+
+    for (std::size_t i = 0; i < microResults_.size(); ++i) {
+      file << (i > 0 ? ",\n" : "\n") << "    {\"name\": \""
+           << EscapeJsonString(microResults_[i].name) << "\", \"ns_per_op\": "
+           << microResults_[i].nanosPerOp << '}';
+    }
+
+    file << "\n  ]";
+  }
+
+  file << "\n}\n";
+  return static_cast<bool>(file);
+}
+
+int BenchRunner::CompareWithBaseline() const {
+  std::vector<std::pair<std::string, double>> baseline;
+  if (!ReadBaseline(options_.baselineFilePath, baseline)) {
+    os_ << "failed to read baseline results from \""
+        << options_.baselineFilePath << "\"\n";
+    return kBenchExitError;
+  }
+
+  const auto flags = os_.flags();
+  os_ << std::fixed << std::setprecision(1);
+
+  bool hasRegression = false;
+  for (const auto& result : results_) {
+    const auto it = std::find_if(
+        baseline.begin(), baseline.end(),
+        [&result](const std::pair<std::string, double>& scene) {
+          return scene.first == result.name;
+        });
+
+    os_ << "baseline " << result.name << ": ";
+    if (it == baseline.end() || it->second <= 0.0) {
+      os_ << "not in baseline\n";
+      continue;
+    }
+
+    const double changePercent = (result.nanosPerFrame - it->second)
+                                 / it->second * 100.0;
+    const bool isRegression = changePercent > options_.tolerancePercent;
+    hasRegression = hasRegression || isRegression;
+
+    os_ << it->second << " -> " << result.nanosPerFrame << " ns/frame ("
+        << std::showpos << changePercent << std::noshowpos << "%)"
+        << (isRegression ? "  REGRESSION\n" : "\n");
+  }
+
+  // there are hundreds of microbenchmarks, so only the regressions are listed
+  if (!microResults_.empty()) {
+    unsigned int numCompared = 0, numRegressions = 0;
+
+    for (const auto& result : microResults_) {
+      const auto it = std::find_if(
+          baseline.begin(), baseline.end(),
+          [&result](const std::pair<std::string, double>& micro) {
+            return micro.first == result.name;
+          });
+      if (it == baseline.end() || it->second <= 0.0) {
+        continue;
+      }
+
+      ++numCompared;
+      const double changePercent = (result.nanosPerOp - it->second)
+                                   / it->second * 100.0;
+      if (changePercent > options_.tolerancePercent) {
+        ++numRegressions;
+        os_ << "baseline " << result.name << ": " << it->second << " -> "
+            << result.nanosPerOp << " ns/op (" << std::showpos
+            << changePercent << std::noshowpos << "%)  REGRESSION\n";
+      }
+    }
+
+    os_ << "baseline micro: " << numRegressions << " of " << numCompared
+        << " regressed (" << microResults_.size() - numCompared
+        << " not in baseline)\n";
+    hasRegression = hasRegression || numRegressions > 0;
+  }
+
+  os_.flags(flags);
+  return hasRegression ? kBenchExitRegression : kBenchExitOk;
+}
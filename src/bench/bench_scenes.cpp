@@ -0,0 +1,224 @@
+#include "bench/bench_scenes.h"
+#include "bench/rom_writer.h"
+
+namespace {
+  // arithmetic, WRAM accesses and calls in a tight loop
+  std::vector<u8> BuildCpuRom() {
+    RomWriter rom(false);
+
+    const auto sub = rom.Here();
+    rom.Emit({0xc5,        // push bc
+              0xcb, 0x37,  // swap a
+              0x8a,        // adc a, d
+              0x57,        // ld d, a
+              0xc1,        // pop bc
+              0xc9});      // ret
+
+    const auto entry = rom.Here();
+    rom.Emit({0xf3});                // di
+    rom.Emit16(0x31, 0xdffe);        // ld sp, $dffe
+
+    const auto loop = rom.Here();
+    rom.Emit16(0x21, 0xc000);        // ld hl, $c000
+    rom.Emit({0x06, 0x00});          // ld b, 0
+
+    const auto inner = rom.Here();
+    rom.Emit({0x7e,                  // ld a, (hl)
+              0x80,                  // add a, b
+              0x07,                  // rlca
+              0xa9,                  // xor c
+              0x22,                  // ld (hl+), a
+              0x4f});                // ld c, a
+    rom.Emit16(0xcd, sub);           // call sub
+    rom.Emit({0x05});                // dec b
+    rom.EmitJr(0x20, inner);         // jr nz, inner
+    rom.EmitJr(0x18, loop);          // jr loop
+
+    return rom.Finish(entry);
+  }
+
+  // back-to-back HBlank DMAs of 2 KiB into VRAM, each followed by a general
+  // purpose DMA of the same size. needs a CGB
+  std::vector<u8> BuildHdmaRom() {
+    RomWriter rom(true);
+
+    const auto entry = rom.Here();
+    rom.Emit({0xf3});                // di
+    rom.Emit16(0x31, 0xfffe);        // ld sp, $fffe
+
+    const auto loop = rom.Here();
+    rom.Emit({0x3e, 0x40,            // ld a, $40
+              0xe0, 0x51,            // ldh (HDMA1), a
+              0xaf,                  // xor a
+              0xe0, 0x52,            // ldh (HDMA2), a
+              0xe0, 0x53,            // ldh (HDMA3), a
+              0xe0, 0x54,            // ldh (HDMA4), a
+              0x3e, 0xff,            // ld a, $ff
+              0xe0, 0x55});          // ldh (HDMA5), a
+
+    const auto wait = rom.Here();
+    rom.Emit({0xf0, 0x55,            // ldh a, (HDMA5)
+              0xfe, 0xff});          // cp $ff
+    rom.EmitJr(0x20, wait);          // jr nz, wait
+
+    rom.Emit({0x3e, 0x7f,            // ld a, $7f
+              0xe0, 0x55});          // ldh (HDMA5), a
+    rom.EmitJr(0x18, loop);          // jr loop
+
+    // something other than zeroes to copy
+    std::vector<u8> data(0x800);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+      data[i] = static_cast<u8>(i * 7);
+    }
+    rom.Place(0x4000, data);
+
+    return rom.Finish(entry);
+  }
+
+  // 40 8x16 sprites in four bands of ten, so that 64 lines have the most
+  // sprites that the PPU draws per line, over half background and half
+  // window. the sprites and background move every frame
+  std::vector<u8> BuildSpritesRom() {
+    RomWriter rom(false);
+
+    constexpr u16 kOamTableLoc = 0x1000;
+    std::vector<u8> oam;
+    for (int band = 0; band < 4; ++band) {
+      for (int i = 0; i < 10; ++i) {
+        oam.push_back(static_cast<u8>(16 + band * 36));     // y
+        oam.push_back(static_cast<u8>(8 + i * 16 + band));  // x
+        oam.push_back(static_cast<u8>(i * 2));              // tile
+        oam.push_back(static_cast<u8>((i & 3) << 5));       // flips
+      }
+    }
+    rom.Place(kOamTableLoc, oam);
+
+    const auto entry = rom.Here();
+    rom.Emit({0xf3});                // di
+    rom.Emit16(0x31, 0xfffe);        // ld sp, $fffe
+
+    // the LCD can only be turned off during VBlank
+    rom.EmitWaitLy(144, false);
+    rom.Emit({0xaf,                  // xor a
+              0xe0, 0x40});          // ldh (LCDC), a
+
+    // fill the tile data with a pattern, so that no pixel is transparent
+    rom.Emit16(0x21, 0x8000);        // ld hl, $8000
+    const auto fillTiles = rom.Here();
+    rom.Emit({0x7d,                  // ld a, l
+              0x2f,                  // cpl
+              0x22,                  // ld (hl+), a
+              0x7c,                  // ld a, h
+              0xfe, 0x90});          // cp $90
+    rom.EmitJr(0x20, fillTiles);     // jr nz, fillTiles
+
+    rom.Emit16(0x21, kOamTableLoc);  // ld hl, kOamTableLoc
+    rom.Emit16(0x11, 0xfe00);        // ld de, $fe00
+    rom.Emit({0x06, 0xa0});          // ld b, 160
+    const auto copyOam = rom.Here();
+    rom.Emit({0x2a,                  // ld a, (hl+)
+              0x12,                  // ld (de), a
+              0x13,                  // inc de
+              0x05});                // dec b
+    rom.EmitJr(0x20, copyOam);       // jr nz, copyOam
+
+    rom.Emit({0xaf,                  // xor a
+              0xe0, 0x4a,            // ldh (WY), a
+              0x3e, 0x57,            // ld a, 87
+              0xe0, 0x4b,            // ldh (WX), a
+              0x3e, 0xe4,            // ld a, $e4
+              0xe0, 0x47,            // ldh (BGP), a
+              0xe0, 0x48,            // ldh (OBP0), a
+              0xe0, 0x49,            // ldh (OBP1), a
+              0x3e, 0xf7,            // ld a, $f7
+              0xe0, 0x40});          // ldh (LCDC), a
+
+    const auto frame = rom.Here();
+    rom.EmitWaitLy(144, false);
+    rom.Emit16(0x21, 0xfe01);        // ld hl, $fe01
+    rom.Emit({0x06, 40});            // ld b, 40
+    const auto moveSprites = rom.Here();
+    rom.Emit({0x34,                  // inc (hl)
+              0x2c,                  // inc l
+              0x2c,                  // inc l
+              0x2c,                  // inc l
+              0x2c,                  // inc l
+              0x05});                // dec b
+    rom.EmitJr(0x20, moveSprites);   // jr nz, moveSprites
+    rom.Emit({0xf0, 0x43,            // ldh a, (SCX)
+              0x3c,                  // inc a
+              0xe0, 0x43});          // ldh (SCX), a
+    rom.EmitWaitLy(144, true);
+    rom.EmitJr(0x18, frame);         // jr frame
+
+    return rom.Finish(entry);
+  }
+
+  // all four sound channels playing at once, retriggered every frame with
+  // new frequencies
+  std::vector<u8> BuildAudioRom() {
+    RomWriter rom(false);
+
+    const auto entry = rom.Here();
+    rom.Emit({0xf3});                // di
+    rom.Emit16(0x31, 0xfffe);        // ld sp, $fffe
+
+    rom.Emit({0x3e, 0x80,            // ld a, $80
+              0xe0, 0x26,            // ldh (NR52), a
+              0x3e, 0xff,            // ld a, $ff
+              0xe0, 0x25,            // ldh (NR51), a
+              0x3e, 0x77,            // ld a, $77
+              0xe0, 0x24});          // ldh (NR50), a
+
+    rom.Emit({0x0e, 0x30,            // ld c, $30
+              0x06, 16});            // ld b, 16
+    const auto fillWave = rom.Here();
+    rom.Emit({0x79,                  // ld a, c
+              0x07,                  // rlca
+              0xe2,                  // ldh (c), a
+              0x0c,                  // inc c
+              0x05});                // dec b
+    rom.EmitJr(0x20, fillWave);      // jr nz, fillWave
+
+    rom.Emit({0x3e, 0x17, 0xe0, 0x10,  // NR10: sweep up every step
+              0x3e, 0x80, 0xe0, 0x11,  // NR11: 50% duty
+              0x3e, 0xf3, 0xe0, 0x12,  // NR12: full volume, fading
+              0x3e, 0x40, 0xe0, 0x16,  // NR21: 25% duty
+              0x3e, 0xf3, 0xe0, 0x17,  // NR22: full volume, fading
+              0x3e, 0x80, 0xe0, 0x1a,  // NR30: wave DAC on
+              0x3e, 0x20, 0xe0, 0x1c,  // NR32: full volume
+              0x3e, 0xf3, 0xe0, 0x21}); // NR42: full volume, fading
+
+    const auto frame = rom.Here();
+    rom.EmitWaitLy(144, false);
+    rom.Emit({0x1c,                  // inc e
+              0x7b,                  // ld a, e
+              0xe0, 0x13,            // ldh (NR13), a
+              0xe0, 0x18,            // ldh (NR23), a
+              0xe0, 0x1d,            // ldh (NR33), a
+              0xe6, 0x7f,            // and $7f
+              0xe0, 0x22,            // ldh (NR43), a
+              0x3e, 0x87,            // ld a, $87
+              0xe0, 0x14,            // ldh (NR14), a
+              0xe0, 0x19,            // ldh (NR24), a
+              0xe0, 0x1e,            // ldh (NR34), a
+              0xe0, 0x23});          // ldh (NR44), a
+    rom.EmitWaitLy(144, true);
+    rom.EmitJr(0x18, frame);         // jr frame
+
+    return rom.Finish(entry);
+  }
+}
+
+std::vector<BenchScene> BuildBenchScenes() {
+  return {
+    {"cpu", "ALU ops, WRAM accesses and calls in a tight loop",
+     BuildCpuRom()},
+    {"hdma", "back-to-back HBlank and general purpose DMAs into VRAM (CGB)",
+     BuildHdmaRom()},
+    {"sprites", "10 sprites on each of 64 lines over background and window",
+     BuildSpritesRom()},
+    {"audio", "all four sound channels retriggered every frame",
+     BuildAudioRom()}
+  };
+}
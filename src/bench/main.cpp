@@ -0,0 +1,118 @@
+#include "bench/bench_runner.h"
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+  void PrintUsage(const char* programName) {
+    std::cerr
+      << "usage: " << programName << " [options] [ROM_PATH[=STATE_PATH]...]\n"
+      << "\n"
+      << "runs the built-in scenes, or the ROMs given (each from a save state\n"
+      << "at STATE_PATH, if given), reporting emulated frames per second,\n"
+      << "instructions per second and how the time per frame was split\n"
+      << "between the CPU, PPU, APU, timer and DMA\n"
+      << "\n"
+      << "options:\n"
+      << "  --frames N          frames measured per scene (default 600)\n"
+      << "  --scene NAME        only run the built-in scene NAME (repeatable)\n"
+      << "  --list              list the built-in scenes\n"
+      << "  --micro             run microbenchmarks of each component and\n"
+      << "                      opcode instead of any scenes\n"
+      << "  --perf              also count host hardware events per frame\n"
+      << "                      (Linux only)\n"
+      << "  --json FILE         also write the results to FILE as JSON\n"
+      << "  --baseline FILE     compare with results written by --json\n"
+      << "  --tolerance PCT     slow down per frame from the baseline allowed\n"
+      << "                      before it counts as a regression (default 10)\n"
+      << "\n"
+      << "exits with 0 on success, 1 if a scene (or microbenchmark) regressed\n"
+      << "from the baseline, or 2 on error\n";
+  }
+
+  bool ParseUnsigned(const std::string& str, u64& outVal) {
+    try {
+      std::size_t endIdx;
+      outVal = std::stoull(str, &endIdx);
+      return endIdx == str.size();
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  bool ParseDouble(const std::string& str, double& outVal) {
+    try {
+      std::size_t endIdx;
+      outVal = std::stod(str, &endIdx);
+      return endIdx == str.size();
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  bool ParseArgs(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+
+      if (arg == "--frames" && hasValue) {
+        if (!ParseUnsigned(argv[++i], options.numFrames)
+            || options.numFrames == 0) {
+          return false;
+        }
+      } else if (arg == "--scene" && hasValue) {
+        options.sceneNames.emplace_back(argv[++i]);
+      } else if (arg == "--list") {
+        options.listScenes = true;
+      } else if (arg == "--micro") {
+        options.micro = true;
+      } else if (arg == "--perf") {
+        options.perfCounters = true;
+      } else if (arg == "--json" && hasValue) {
+        options.jsonFilePath = argv[++i];
+      } else if (arg == "--baseline" && hasValue) {
+        options.baselineFilePath = argv[++i];
+      } else if (arg == "--tolerance" && hasValue) {
+        if (!ParseDouble(argv[++i], options.tolerancePercent)
+            || options.tolerancePercent < 0.0) {
+          return false;
+        }
+      } else if (arg.compare(0, 2, "--") != 0) {
+        BenchRomScene romScene;
+        const auto sepIdx = arg.find('=');
+        romScene.romFilePath = arg.substr(0, sepIdx);
+        if (sepIdx != std::string::npos) {
+          romScene.stateFilePath = arg.substr(sepIdx + 1);
+        }
+
+        if (romScene.romFilePath.empty()
+            || (sepIdx != std::string::npos
+                && romScene.stateFilePath.empty())) {
+          return false;
+        }
+
+        options.romScenes.push_back(std::move(romScene));
+      } else {
+        return false;
+      }
+    }
+
+    // built-in scenes can't be picked when running ROMs or microbenchmarks
+    // instead, and the microbenchmarks don't count hardware events
+    return (options.romScenes.empty() || options.sceneNames.empty())
+           && (!options.micro
+               || (options.romScenes.empty() && options.sceneNames.empty()
+                   && !options.perfCounters));
+  }
+}
+
+int main(int argc, char* argv[]) {
+  BenchOptions options;
+
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage(argv[0]);
+    return kBenchExitError;
+  }
+
+  return BenchRunner(options).Run();
+}
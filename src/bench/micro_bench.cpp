@@ -0,0 +1,410 @@
+#include "bench/micro_bench.h"
+#include "bench/discard_apu_out.h"
+#include "bench/rom_writer.h"
+#include "hw/gbc.h"
+#include "video/buffer_lcd.h"
+#include <algorithm>
+#include <chrono>
+
+// each measurement runs batches of ops that take at least this long, keeping
+// the fastest of kMicroBenchRuns batches
+constexpr double kMicroBenchMinBatchSeconds = 0.002;
+constexpr unsigned int kMicroBenchRuns = 3;
+
+// copies of the opcode benchmarked in each pass through the loop
+constexpr unsigned int kOpCopies = 64;
+
+// where RET-like opcodes pop their return addresses from
+constexpr u16 kOpReturnTableLoc = 0x4000;
+
+namespace {
+  // results of Mmu::Read8() end up here, so that the reads aren't optimized
+  // away
+  volatile u8 readSink;
+
+  template <typename F>
+  double MeasureNanosPerOp(F runOps) {
+    using namespace std::chrono;
+
+    const auto timeOps = [&runOps](u64 numOps) {
+      const auto startTime = steady_clock::now();
+      runOps(numOps);
+      return duration<double>(steady_clock::now() - startTime).count();
+    };
+
+    u64 numOps = 1024;
+    double seconds;
+    while ((seconds = timeOps(numOps)) < kMicroBenchMinBatchSeconds
+           && numOps < (u64(1) << 32)) {
+      numOps *= 2;
+    }
+
+    for (unsigned int i = 1; i < kMicroBenchRuns; ++i) {
+      seconds = std::min(seconds, timeOps(numOps));
+    }
+
+    return seconds * 1e9 / numOps;
+  }
+
+  // a ROM that spins in place, for when the CPU doesn't matter
+  std::vector<u8> BuildIdleRom(bool cgbSupported) {
+    RomWriter rom(cgbSupported);
+
+    const auto entry = rom.Here();
+    rom.EmitJr(0x18, entry); // jr entry
+
+    return rom.Finish(entry);
+  }
+
+  MicroBenchResult RunApuMicroBench() {
+    Gbc gbc;
+    gbc.LoadCartridgeRomData(BuildIdleRom(false));
+
+    DiscardApuOutput apuOut;
+    auto& hw = gbc.GetHardware();
+    hw.apu.SetApuOutput(&apuOut);
+
+    hw.mmu.Write8(0xff26, 0x80); // NR52: on
+    hw.mmu.Write8(0xff25, 0xff); // NR51: every channel to both sides
+    hw.mmu.Write8(0xff24, 0x77); // NR50: full volume
+
+    for (u16 loc = 0xff30; loc < 0xff40; ++loc) {
+      hw.mmu.Write8(loc, static_cast<u8>(loc * 0x37));
+    }
+
+    // every channel plays at full volume without stopping
+    const std::pair<u16, u8> writes[] = {
+      {0xff10, 0x00}, {0xff11, 0x80}, {0xff12, 0xf0}, {0xff13, 0x00},
+      {0xff14, 0x87}, {0xff16, 0x40}, {0xff17, 0xf0}, {0xff18, 0x80},
+      {0xff19, 0x86}, {0xff1a, 0x80}, {0xff1c, 0x20}, {0xff1d, 0x40},
+      {0xff1e, 0x87}, {0xff21, 0xf0}, {0xff22, 0x22}, {0xff23, 0x80}
+    };
+    for (const auto& write : writes) {
+      hw.mmu.Write8(write.first, write.second);
+    }
+
+    const double nanos = MeasureNanosPerOp([&hw](u64 numOps) {
+      for (u64 i = 0; i < numOps; ++i) {
+        hw.apu.Update(4);
+      }
+    });
+
+    hw.apu.SetApuOutput(nullptr);
+    return {"apu update (4 cycles, 4 channels)", nanos};
+  }
+
+  MicroBenchResult RunPpuMicroBench() {
+    Gbc gbc;
+    gbc.LoadCartridgeRomData(BuildIdleRom(false));
+
+    auto& hw = gbc.GetHardware();
+    hw.mmu.Write8(0xff40, 0x00); // LCDC: off, so that VRAM can be written
+
+    // tile data with no transparent pixels, and maps using all of it
+    for (u16 loc = 0x8000; loc < 0x9000; ++loc) {
+      hw.mmu.Write8(loc, static_cast<u8>(~loc));
+    }
+    for (u16 loc = 0x9800; loc < 0xa000; ++loc) {
+      hw.mmu.Write8(loc, static_cast<u8>(loc * 3));
+    }
+
+    for (u8 i = 0; i < 40; ++i) {
+      hw.mmu.Write8(0xfe00 + i * 4 + 1, static_cast<u8>(8 + (i % 10) * 16));
+      hw.mmu.Write8(0xfe00 + i * 4 + 2, static_cast<u8>(i * 2));
+      hw.mmu.Write8(0xfe00 + i * 4 + 3, static_cast<u8>((i & 3) << 5));
+    }
+
+    hw.mmu.Write8(0xff47, 0xe4); // BGP
+    hw.mmu.Write8(0xff48, 0xe4); // OBP0
+    hw.mmu.Write8(0xff49, 0xe4); // OBP1
+    hw.mmu.Write8(0xff4a, 0);    // WY
+    hw.mmu.Write8(0xff4b, 7);    // WX: the window covers the whole screen
+    hw.mmu.Write8(0xff40, 0xf7); // LCDC: on, with window and 8x16 sprites
+
+    BufferLcd lcd;
+    hw.ppu.SetLcd(&lcd);
+
+    // the 40 sprites cover 64 lines with 10 sprites each, so they're moved
+    // down every 64 lines to keep 10 sprites on every visible line
+    const auto runFrame = [&hw]() {
+      for (unsigned int band = 0; band < 3; ++band) {
+        for (u8 i = 0; i < 40; ++i) {
+          hw.ppu.OamWrite8(i * 4, static_cast<u8>(16 + band * 64
+                                                   + (i / 10) * 16),
+                           true);
+        }
+
+        const u8 endLy = band < 2 ? static_cast<u8>((band + 1) * 64) : 0;
+        do {
+          hw.ppu.Update(4);
+        } while (hw.ppu.GetLy() != endLy);
+      }
+    };
+
+    while (hw.ppu.GetLy() != 0) {
+      hw.ppu.Update(4);
+    }
+
+    constexpr unsigned int kLinesPerFrame = 154;
+    const double nanos = MeasureNanosPerOp([&runFrame](u64 numOps) {
+      for (u64 i = 0; i < numOps; i += kLinesPerFrame) {
+        runFrame();
+      }
+    });
+
+    hw.ppu.SetLcd(nullptr);
+    return {"ppu scanline (window, 10 sprites)", nanos};
+  }
+
+  std::vector<MicroBenchResult> RunMmuMicroBenches() {
+    struct Region {
+      const char* name;
+      u16 startLoc, endLoc;
+    };
+
+    const Region regions[] = {
+      {"rom bank 0", 0x0000, 0x4000}, {"rom bank n", 0x4000, 0x8000},
+      {"vram", 0x8000, 0xa000},       {"cart ram", 0xa000, 0xc000},
+      {"wram bank 0", 0xc000, 0xd000}, {"wram bank n", 0xd000, 0xe000},
+      {"echo ram", 0xe000, 0xfe00},   {"oam", 0xfe00, 0xfea0},
+      {"unusable", 0xfea0, 0xff00},   {"io", 0xff00, 0xff80},
+      {"hram", 0xff80, 0xffff},       {"ie", 0xffff, 0x0000}
+    };
+
+    Gbc gbc;
+    gbc.LoadCartridgeRomData(BuildIdleRom(true));
+    const auto& mmu = gbc.GetHardware().mmu;
+
+    std::vector<MicroBenchResult> results;
+    for (const auto& region : regions) {
+      const double nanos = MeasureNanosPerOp([&mmu, &region](u64 numOps) {
+        u8 sum = 0;
+        u16 loc = region.startLoc;
+
+        for (u64 i = 0; i < numOps; ++i) {
+          sum ^= mmu.Read8(loc);
+          if (++loc == region.endLoc) {
+            loc = region.startLoc;
+          }
+        }
+
+        readSink = sum;
+      });
+
+      results.push_back({std::string("mmu read8 ") + region.name, nanos});
+    }
+
+    return results;
+  }
+
+  std::vector<MicroBenchResult> RunDmaMicroBenches() {
+    Gbc gbc;
+    gbc.LoadCartridgeRomData(BuildIdleRom(true));
+
+    auto& hw = gbc.GetHardware();
+    hw.mmu.Write8(0xff40, 0x00); // LCDC: off, so that VRAM can be written
+
+    // a general purpose DMA of all 128 blocks that it can copy is done in one
+    // go once its time is up
+    constexpr unsigned int kBlocksPerGdma = 128;
+    const auto runGdmas = [&hw](u8 sourceLocHi, u64 numBlocks) {
+      for (u64 i = 0; i < numBlocks; i += kBlocksPerGdma) {
+        hw.dma.SetNdmaSourceLocHi(sourceLocHi);
+        hw.dma.SetNdmaSourceLocLo(0x00);
+        hw.dma.SetNdmaDestLocHi(0x00);
+        hw.dma.SetNdmaDestLocLo(0x00);
+        hw.dma.SetNdma5(kBlocksPerGdma - 1);
+        hw.dma.Update(0xffff);
+      }
+    };
+
+    std::vector<MicroBenchResult> results;
+
+    // ROM is read directly, but the cartridge RAM (which this cartridge lacks)
+    // is read a byte at a time through the MMU
+    results.push_back(
+        {"dma gdma block (from rom)",
+         MeasureNanosPerOp([&runGdmas](u64 numOps) {
+           runGdmas(0x40, numOps);
+         })});
+    results.push_back(
+        {"dma gdma block (from cart ram)",
+         MeasureNanosPerOp([&runGdmas](u64 numOps) {
+           runGdmas(0xa0, numOps);
+         })});
+
+    results.push_back(
+        {"dma oam transfer", MeasureNanosPerOp([&hw](u64 numOps) {
+           for (u64 i = 0; i < numOps; ++i) {
+             hw.dma.StartOamDmaTransfer(0xc0);
+             while (hw.dma.IsOamDmaInProgress()) {
+               hw.dma.Update(4);
+             }
+           }
+         })});
+
+    return results;
+  }
+
+  unsigned int GetOpLength(u8 op) {
+    switch (op) {
+      case 0x06: case 0x0e: case 0x16: case 0x1e: // ld r, n
+      case 0x26: case 0x2e: case 0x36: case 0x3e:
+      case 0x10: // stop
+      case 0x18: case 0x20: case 0x28: case 0x30: case 0x38: // jr
+      case 0xc6: case 0xce: case 0xd6: case 0xde: // alu a, n
+      case 0xe6: case 0xee: case 0xf6: case 0xfe:
+      case 0xe0: case 0xf0: // ldh
+      case 0xe8: case 0xf8: // add sp, e & ld hl, sp+e
+      case 0xcb:
+        return 2;
+
+      case 0x01: case 0x11: case 0x21: case 0x31: // ld rr, nn
+      case 0x08: case 0xea: case 0xfa: // ld (nn), sp & ld (nn), a etc.
+      case 0xc2: case 0xc3: case 0xca: case 0xd2: case 0xda: // jp
+      case 0xc4: case 0xcc: case 0xcd: case 0xd4: case 0xdc: // call
+        return 3;
+
+      default:
+        return 1;
+    }
+  }
+
+  bool IsUndefinedOp(u8 op) {
+    switch (op) {
+      case 0xd3: case 0xdb: case 0xdd: case 0xe3: case 0xe4: case 0xeb:
+      case 0xec: case 0xed: case 0xf4: case 0xfc: case 0xfd:
+        return true;
+
+      default:
+        return false;
+    }
+  }
+
+  bool IsReturnOp(u8 op) {
+    return op == 0xc0 || op == 0xc8 || op == 0xc9 || op == 0xd0
+           || op == 0xd8 || op == 0xd9;
+  }
+
+  bool IsRestartOp(u8 op) {
+    return (op & 0xc7) == 0xc7;
+  }
+
+  // HALT and STOP leave the CPU idle, and JP (HL) jumps back to itself, so
+  // every update after the first few runs the same thing
+  bool IsSelfRepeatingOp(u8 op) {
+    return op == 0x76 || op == 0x10 || op == 0xe9;
+  }
+
+  // a loop that sets up BC, DE, HL & SP, then runs numCopies copies of op
+  // (unless it's 0x100, for an empty loop). memory operands point at WRAM, and
+  // jumps and calls go to the next copy. RET-like ops return to the next copy
+  // using a table of addresses in ROM, and the RST vectors all return
+  std::vector<u8> BuildOpRom(unsigned int op, bool isCbOp) {
+    RomWriter rom(false);
+
+    for (u16 loc = 0; loc < 0x40; loc += 8) {
+      rom.Place(loc, {0xc9}); // ret
+    }
+
+    const u8 baseOp = isCbOp ? 0xcb : static_cast<u8>(op);
+    const auto opLength = op > 0xff ? 0 : GetOpLength(baseOp);
+    const u16 copiesLoc = kRomWriterCodeStart + 12;
+
+    const auto entry = rom.Here();
+    rom.Emit16(0x01, 0xc000);                            // ld bc, $c000
+    rom.Emit16(0x11, 0xc000);                            // ld de, $c000
+    rom.Emit16(0x21, baseOp == 0xe9 ? copiesLoc : 0xc000); // ld hl, ...
+    rom.Emit16(0x31, IsReturnOp(baseOp) ? kOpReturnTableLoc
+                                        : 0xdff0);      // ld sp, ...
+
+    const auto numCopies = op > 0xff ? 0 : kOpCopies;
+    std::vector<u8> returnTable;
+
+    for (unsigned int i = 0; i < numCopies; ++i) {
+      const u16 nextLoc = rom.Here() + opLength;
+      returnTable.push_back(static_cast<u8>(nextLoc));
+      returnTable.push_back(static_cast<u8>(nextLoc >> 8));
+
+      if (isCbOp) {
+        rom.Emit({0xcb, static_cast<u8>(op)});
+      } else if (opLength == 3) {
+        // every 3 byte op from 0xc0 is a jump or call, other than the loads
+        const bool isJump = baseOp >= 0xc0 && baseOp != 0xea
+                            && baseOp != 0xfa;
+        rom.Emit16(baseOp, isJump ? nextLoc
+                                  : baseOp == 0x31 ? 0xdff0 : 0xc000);
+      } else if (opLength == 2) {
+        const bool isHighRamOp = baseOp == 0xe0 || baseOp == 0xf0;
+        rom.Emit({baseOp, static_cast<u8>(isHighRamOp ? 0x80 : 0x00)});
+      } else {
+        rom.Emit({baseOp});
+      }
+    }
+
+    rom.Emit16(0xc3, entry); // jp entry
+    rom.Place(kOpReturnTableLoc, returnTable);
+
+    return rom.Finish(entry);
+  }
+
+  double MeasureNanosPerUpdate(Gbc& gbc, std::vector<u8> romData) {
+    gbc.LoadCartridgeRomData(std::move(romData));
+    auto& cpu = gbc.GetHardware().cpu;
+
+    return MeasureNanosPerOp([&cpu](u64 numOps) {
+      for (u64 i = 0; i < numOps; ++i) {
+        cpu.Update();
+      }
+    });
+  }
+}
+
+std::vector<MicroBenchResult> RunComponentMicroBenches() {
+  std::vector<MicroBenchResult> results;
+
+  results.push_back(RunApuMicroBench());
+  results.push_back(RunPpuMicroBench());
+
+  for (auto& result : RunMmuMicroBenches()) {
+    results.push_back(std::move(result));
+  }
+  for (auto& result : RunDmaMicroBenches()) {
+    results.push_back(std::move(result));
+  }
+
+  return results;
+}
+
+std::array<double, 256> RunCpuOpMicroBenches(bool cbOps) {
+  Gbc gbc;
+
+  // the loop around the copies costs this much per update
+  constexpr unsigned int kLoopUpdates = 5; // 4 loads and a jump
+  const double loopNanos = MeasureNanosPerUpdate(gbc,
+                                                 BuildOpRom(0x100, false));
+
+  std::array<double, 256> nanos;
+  for (unsigned int op = 0; op < 256; ++op) {
+    const auto baseOp = static_cast<u8>(cbOps ? 0xcb : op);
+    if (IsUndefinedOp(baseOp)) {
+      nanos[op] = kMicroBenchSkipped;
+      continue;
+    }
+
+    const double updateNanos = MeasureNanosPerUpdate(gbc,
+                                                     BuildOpRom(op, cbOps));
+    if (!cbOps && IsSelfRepeatingOp(baseOp)) {
+      nanos[op] = updateNanos;
+      continue;
+    }
+
+    // take away the loop's share of the updates
+    const unsigned int copyUpdates = !cbOps && IsRestartOp(baseOp) ? 2 : 1;
+    const double numUpdates = kOpCopies * copyUpdates + kLoopUpdates;
+    nanos[op] = std::max(0.0, (numUpdates * updateNanos
+                               - kLoopUpdates * loopNanos) / kOpCopies);
+  }
+
+  return nanos;
+}
@@ -0,0 +1,62 @@
+#include "bench/rom_writer.h"
+#include <algorithm>
+
+constexpr std::size_t kRomSize = 0x8000;
+
+RomWriter::RomWriter(bool cgbSupported)
+    : rom_(kRomSize), pc_(kRomWriterCodeStart) {
+  const char title[] = "SDGBC BENCH";
+  for (std::size_t i = 0; i + 1 < sizeof(title); ++i) {
+    rom_[0x134 + i] = static_cast<u8>(title[i]);
+  }
+
+  rom_[0x143] = cgbSupported ? 0x80 : 0x00;
+}
+
+u16 RomWriter::Here() const {
+  return pc_;
+}
+
+void RomWriter::Emit(std::initializer_list<u8> bytes) {
+  for (const auto byte : bytes) {
+    rom_[pc_++] = byte;
+  }
+}
+
+void RomWriter::Emit16(u8 op, u16 val) {
+  Emit({op, static_cast<u8>(val), static_cast<u8>(val >> 8)});
+}
+
+void RomWriter::EmitJr(u8 op, u16 target) {
+  Emit({op, static_cast<u8>(target - (pc_ + 2))});
+}
+
+void RomWriter::EmitWaitLy(u8 ly, bool whileEqual) {
+  const auto loop = Here();
+  Emit({0xf0, 0x44,   // ldh a, (LY)
+        0xfe, ly});   // cp ly
+  EmitJr(whileEqual ? 0x28 : 0x20, loop); // jr z/nz, loop
+}
+
+void RomWriter::Place(u16 loc, const std::vector<u8>& data) {
+  std::copy(data.begin(), data.end(), rom_.begin() + loc);
+}
+
+void RomWriter::Place(u16 loc, std::initializer_list<u8> bytes) {
+  std::copy(bytes.begin(), bytes.end(), rom_.begin() + loc);
+}
+
+std::vector<u8> RomWriter::Finish(u16 entry) {
+  rom_[0x100] = 0x00; // nop
+  rom_[0x101] = 0xc3; // jp entry
+  rom_[0x102] = static_cast<u8>(entry);
+  rom_[0x103] = static_cast<u8>(entry >> 8);
+
+  u8 checksum = 0;
+  for (std::size_t i = 0x134; i < 0x14d; ++i) {
+    checksum = static_cast<u8>(checksum - rom_[i] - 1);
+  }
+  rom_[0x14d] = checksum;
+
+  return rom_;
+}
@@ -0,0 +1,252 @@
+#include "sdgbc.h"
+#include "audio/buffer_apu_out.h"
+#include "debug/serial_buffer.h"
+#include "hw/gbc.h"
+#include "video/buffer_lcd.h"
+#include <cstring>
+#include <new>
+#include <vector>
+
+static_assert(SDGBC_LCD_WIDTH == kLcdWidthPixels &&
+              SDGBC_LCD_HEIGHT == kLcdHeightPixels,
+              "C API LCD size does not match the PPU");
+static_assert(SDGBC_AUDIO_SAMPLE_RATE == kApuOutputSampleRateHz,
+              "C API sample rate does not match the APU");
+
+struct sdgbc_instance {
+  Gbc gbc;
+  BufferLcd lcd;
+  BufferApuOutput audioOut;
+  SerialBuffer serialOut;
+  bool romLoaded;
+  unsigned int runAheadFrames;
+
+  // the last saved state, kept around so that its buffer can be reused
+  std::vector<u8> state;
+
+  sdgbc_instance() : romLoaded(false), runAheadFrames(0) {
+    auto& hw = gbc.GetHardware();
+    hw.ppu.SetLcd(&lcd);
+    hw.apu.SetApuOutput(&audioOut);
+    hw.serial.SetSerialOutput(&serialOut);
+  }
+};
+
+namespace {
+  sdgbc_result RomLoadResultToResult(RomLoadResult result) {
+    switch (result) {
+      case RomLoadResult::Ok: return SDGBC_OK;
+      case RomLoadResult::ReadError:
+      case RomLoadResult::InvalidSize: return SDGBC_ERROR_ROM_INVALID_SIZE;
+      case RomLoadResult::InvalidExtension:
+      case RomLoadResult::Unsupported:
+      default: return SDGBC_ERROR_ROM_UNSUPPORTED;
+    }
+  }
+}
+
+int sdgbc_get_api_version(void) {
+  return SDGBC_API_VERSION;
+}
+
+const char* sdgbc_get_result_message(sdgbc_result result) {
+  switch (result) {
+    case SDGBC_OK: return "Success.";
+    case SDGBC_ERROR_INVALID_ARGUMENT: return "An argument was invalid.";
+    case SDGBC_ERROR_ROM_INVALID_SIZE:
+      return "The ROM image has an invalid or unexpected size.";
+    case SDGBC_ERROR_ROM_UNSUPPORTED:
+      return "The ROM requires emulation of features that are not supported.";
+    case SDGBC_ERROR_NO_ROM: return "No ROM image is loaded.";
+    case SDGBC_ERROR_INVALID_STATE: return "The save state is invalid.";
+    case SDGBC_ERROR_UNSUPPORTED: return "The operation is not supported.";
+    case SDGBC_ERROR_OUT_OF_MEMORY: return "Out of memory.";
+    default: return "Unknown result.";
+  }
+}
+
+sdgbc_instance* sdgbc_create(void) {
+  // exceptions must not escape through the C interface
+  return new (std::nothrow) sdgbc_instance();
+}
+
+void sdgbc_destroy(sdgbc_instance* inst) {
+  delete inst;
+}
+
+sdgbc_result sdgbc_load_rom(sdgbc_instance* inst, const void* data,
+                            size_t size, int force_dmg) {
+  if (!inst || (!data && size > 0)) {
+    return SDGBC_ERROR_INVALID_ARGUMENT;
+  }
+
+  try {
+    const auto bytes = static_cast<const u8*>(data);
+    const auto result = RomLoadResultToResult(
+        inst->gbc.LoadCartridgeRomData(std::vector<u8>(bytes, bytes + size)));
+
+    // a failed load leaves the cartridge's previous ROM in place
+    if (result == SDGBC_OK) {
+      inst->romLoaded = true;
+      inst->serialOut.ClearData();
+      if (force_dmg) {
+        inst->gbc.Reset(true);
+      }
+    }
+
+    return result;
+  } catch (const std::bad_alloc&) {
+    return SDGBC_ERROR_OUT_OF_MEMORY;
+  }
+}
+
+sdgbc_result sdgbc_reset(sdgbc_instance* inst, int force_dmg) {
+  if (!inst) {
+    return SDGBC_ERROR_INVALID_ARGUMENT;
+  }
+  if (!inst->romLoaded) {
+    return SDGBC_ERROR_NO_ROM;
+  }
+
+  inst->gbc.Reset(force_dmg != 0);
+  inst->serialOut.ClearData();
+  return SDGBC_OK;
+}
+
+sdgbc_result sdgbc_run_frame(sdgbc_instance* inst) {
+  if (!inst) {
+    return SDGBC_ERROR_INVALID_ARGUMENT;
+  }
+  if (!inst->romLoaded) {
+    return SDGBC_ERROR_NO_ROM;
+  }
+
+  try {
+    inst->audioOut.ClearSamples();
+    auto& hw = inst->gbc.GetHardware();
+    hw.joypad.CommitKeyStates();
+
+    hw.ppu.SetRenderSuppressed(inst->runAheadFrames > 0);
+    inst->gbc.UpdateFrame();
+    hw.ppu.SetRenderSuppressed(false);
+
+    inst->gbc.RunAhead(inst->runAheadFrames);
+  } catch (const std::bad_alloc&) {
+    return SDGBC_ERROR_OUT_OF_MEMORY;
+  }
+
+  return SDGBC_OK;
+}
+
+void sdgbc_set_run_ahead(sdgbc_instance* inst, unsigned int num_frames) {
+  if (inst) {
+    inst->runAheadFrames = num_frames;
+  }
+}
+
+void sdgbc_set_key(sdgbc_instance* inst, sdgbc_key key, int pressed) {
+  if (inst) {
+    inst->gbc.GetHardware().joypad.SetKeyState(static_cast<JoypadKey>(key),
+                                               pressed != 0);
+  }
+}
+
+const uint32_t* sdgbc_get_framebuffer(const sdgbc_instance* inst) {
+  return inst ? inst->lcd.GetFrameBuffer().data() : nullptr;
+}
+
+uint64_t sdgbc_get_frame_hash(const sdgbc_instance* inst) {
+  return inst ? inst->lcd.CalculateFrameHash() : 0;
+}
+
+void sdgbc_set_audio_enabled(sdgbc_instance* inst, int enabled) {
+  if (inst) {
+    inst->audioOut.SetEnabled(enabled != 0);
+  }
+}
+
+const int16_t* sdgbc_get_audio_samples(const sdgbc_instance* inst,
+                                       size_t* num_frames) {
+  if (!inst) {
+    if (num_frames) {
+      *num_frames = 0;
+    }
+    return nullptr;
+  }
+
+  const auto& samples = inst->audioOut.GetSamples();
+  if (num_frames) {
+    *num_frames = samples.size() / 2;
+  }
+
+  return samples.data();
+}
+
+const char* sdgbc_get_serial_output(const sdgbc_instance* inst) {
+  return inst ? inst->serialOut.GetData().c_str() : "";
+}
+
+uint8_t sdgbc_read8(const sdgbc_instance* inst, uint16_t loc) {
+  return inst ? inst->gbc.GetHardware().mmu.Read8(loc) : 0xff;
+}
+
+size_t sdgbc_get_state_size(const sdgbc_instance* inst) {
+  if (!inst || !inst->romLoaded) {
+    return 0;
+  }
+
+  // the size only depends on the ROM, so just measure an actual save
+  try {
+    std::vector<u8> state;
+    inst->gbc.SaveState(state);
+    return state.size();
+  } catch (const std::bad_alloc&) {
+    return 0;
+  }
+}
+
+sdgbc_result sdgbc_save_state(sdgbc_instance* inst, void* buf, size_t size,
+                              size_t* out_size) {
+  if (out_size) {
+    *out_size = 0;
+  }
+  if (!inst || !buf) {
+    return SDGBC_ERROR_INVALID_ARGUMENT;
+  }
+  if (!inst->romLoaded) {
+    return SDGBC_ERROR_NO_ROM;
+  }
+
+  try {
+    inst->gbc.SaveState(inst->state);
+  } catch (const std::bad_alloc&) {
+    return SDGBC_ERROR_OUT_OF_MEMORY;
+  }
+
+  if (out_size) {
+    *out_size = inst->state.size();
+  }
+  if (size < inst->state.size()) {
+    return SDGBC_ERROR_INVALID_ARGUMENT;
+  }
+
+  std::memcpy(buf, inst->state.data(), inst->state.size());
+  return SDGBC_OK;
+}
+
+sdgbc_result sdgbc_load_state(sdgbc_instance* inst, const void* buf,
+                              size_t size) {
+  if (!inst || !buf) {
+    return SDGBC_ERROR_INVALID_ARGUMENT;
+  }
+
+  try {
+    switch (inst->gbc.LoadState(static_cast<const u8*>(buf), size)) {
+      case StateLoadResult::Ok: return SDGBC_OK;
+      case StateLoadResult::NoRom: return SDGBC_ERROR_NO_ROM;
+      default: return SDGBC_ERROR_INVALID_STATE;
+    }
+  } catch (const std::bad_alloc&) {
+    return SDGBC_ERROR_OUT_OF_MEMORY;
+  }
+}
@@ -2,6 +2,7 @@
 #include "util.h"
 #include <cassert>
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 CpuCmdMode::CpuCmdMode()
@@ -10,7 +11,8 @@ CpuCmdMode::CpuCmdMode()
   gbc_.GetHardware().serial.SetSerialOutput(&serialStdout_);
 }
 
-int CpuCmdMode::Run(const std::string& romFilePath) {
+int CpuCmdMode::Run(const std::string& romFilePath,
+                    const std::string& symFilePath) {
   std::cout << "       *-*-*-*  sdgbc cpu-cmd mode  *-*-*-*\n";
   std::cout << "basic tool for debugging sdgbc's LR35902 emulation\n";
   std::cout << std::endl;
@@ -23,6 +25,10 @@ int CpuCmdMode::Run(const std::string& romFilePath) {
     } while (ExecuteLoadRomCommand() != RomLoadResult::Ok);
   }
 
+  if (!symFilePath.empty()) {
+    ExecuteLoadSymbolsCommand(symFilePath);
+  }
+
   std::cout << "\ntype \"help\" for a list of commands\n";
   std::cout << "NOTE: commands are case sensitive!\n\n";
 
@@ -47,6 +53,10 @@ RomLoadResult CpuCmdMode::ExecuteLoadRomCommand(std::string romFilePath) {
   switch (result) {
     case RomLoadResult::Ok:
       std::cout << "ROM file loaded!\n";
+      if (gbc_.GetGuestProfiler()) {
+        profiler_.Clear(gbc_); // the old profile was of the old ROM
+        std::cout << "NOTE: the profile has been cleared\n";
+      }
       break;
 
     default:
@@ -150,6 +160,66 @@ void CpuCmdMode::ExecuteViewMemoryAreaCommand() {
   ResetInputStream();
 }
 
+void CpuCmdMode::ExecuteLoadSymbolsCommand(std::string symFilePath) {
+  if (symFilePath.empty()) {
+    std::cout << "input .sym file path > ";
+    std::getline(std::cin, symFilePath);
+  }
+
+  const auto result = symbols_.LoadSymFile(symFilePath);
+  if (result == SymFileLoadResult::Ok) {
+    std::cout << "loaded " << symbols_.GetNumSymbols() << " symbol(s)!\n";
+  } else {
+    std::cout << "failed to load symbols - \""
+              << GetSymFileLoadResultAsMessage(result) << "\"\n";
+  }
+}
+
+void CpuCmdMode::ToggleProfiling() {
+  if (gbc_.GetGuestProfiler()) {
+    gbc_.SetGuestProfiler(nullptr);
+    std::cout << "profiling is now off - " << profiler_.GetTotalCycles()
+              << " cycle(s) profiled\n";
+  } else {
+    profiler_.Clear(gbc_);
+    gbc_.SetGuestProfiler(&profiler_);
+    std::cout << "profiling is now on (profile cleared)\n";
+    if (!updateGbcOnStep_) {
+      std::cout << "NOTE: only steps taken while stepgbc is on are profiled\n";
+    }
+  }
+}
+
+void CpuCmdMode::ExecuteProfileReportCommand() {
+  std::cout << "input report format (flat, tree, folded) > ";
+  std::string formatStr;
+  std::getline(std::cin, formatStr);
+
+  GuestProfileFormat format;
+  if (formatStr == "flat") {
+    format = GuestProfileFormat::Flat;
+  } else if (formatStr == "tree") {
+    format = GuestProfileFormat::Tree;
+  } else if (formatStr == "folded") {
+    format = GuestProfileFormat::Folded;
+  } else {
+    std::cout << "unknown report format!\n";
+    return;
+  }
+
+  std::cout << "input output file path (empty to print) > ";
+  std::string filePath;
+  std::getline(std::cin, filePath);
+
+  if (filePath.empty()) {
+    profiler_.WriteReport(std::cout, format, symbols_);
+  } else if (profiler_.WriteReportFile(filePath, format, symbols_)) {
+    std::cout << "OK - report written!\n";
+  } else {
+    std::cout << "failed to write the report!\n";
+  }
+}
+
 std::string CpuCmdMode::QueryUserCommand() const {
   const auto& hw = gbc_.GetHardware();
 
@@ -206,6 +276,12 @@ bool CpuCmdMode::ExecuteUserCommand(const std::string& cmd) {
     std::cout << "OK - system reset!\n";
   } else if (cmd == "load" || cmd == "l") {
     ExecuteLoadRomCommand();
+  } else if (cmd == "symbols" || cmd == "sym") {
+    ExecuteLoadSymbolsCommand();
+  } else if (cmd == "profile" || cmd == "prof") {
+    ToggleProfiling();
+  } else if (cmd == "report" || cmd == "rep") {
+    ExecuteProfileReportCommand();
   } else if (cmd == "help" || cmd == "h" || cmd == "?") {
     std::cout << "help | h | ?       - print a list of commands\n";
     std::cout << "load | l           - load a new program ROM file and reset\n";
@@ -217,6 +293,9 @@ bool CpuCmdMode::ExecuteUserCommand(const std::string& cmd) {
     std::cout << "stepgbc | g        - toggle steps updating all hardware\n";
     std::cout << "<empty> | next | n - step to the next CPU instruction\n";
     std::cout << "step | s           - step a number of CPU instructions\n";
+    std::cout << "symbols | sym      - load an RGBDS .sym file for reports\n";
+    std::cout << "profile | prof     - toggle profiling (clears the profile)\n";
+    std::cout << "report | rep       - print or write the profile\n";
     std::cout << "quit | q | exit    - quit the application\n";
   } else {
     std::cout << "bad command - type \"help\" for a list of commands\n";
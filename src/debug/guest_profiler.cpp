@@ -0,0 +1,612 @@
+#include "debug/guest_profiler.h"
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <tuple>
+#include <unordered_map>
+
+namespace {
+  constexpr auto kWramBankSize = std::tuple_size<WorkRamBank>::value;
+  constexpr auto kNumWramBanks = std::tuple_size<WorkRamBanks>::value;
+
+  // $8000-$ffff, then the WRAM banks that aren't mapped there by default
+  constexpr std::size_t kRamCyclesSize = 0x8000
+                                         + (kNumWramBanks - 2) * kWramBankSize;
+
+  constexpr u32 kNoCallNode = ~0u;
+
+  // the max amount of rows in each list of the flat report, and the smallest
+  // share of the total cycles that a call is shown with in the tree report
+  constexpr std::size_t kFlatReportMaxRows = 40;
+  constexpr double kTreeReportMinShare = 0.001;
+
+  bool operator==(GuestLocation lhs, GuestLocation rhs) {
+    return lhs.bank == rhs.bank && lhs.loc == rhs.loc;
+  }
+
+  // the start of the memory area (ROM0, ROMX, VRAM, SRAM etc.) containing loc
+  u16 GetAreaStart(u16 loc) {
+    if (loc < 0x4000) {
+      return 0x0000;
+    } else if (loc < 0x8000) {
+      return 0x4000;
+    } else if (loc < 0xa000) {
+      return 0x8000;
+    } else if (loc < 0xc000) {
+      return 0xa000;
+    } else if (loc < 0xd000) {
+      return 0xc000;
+    } else if (loc < 0xe000) {
+      return 0xd000;
+    } else if (loc < 0xfe00) {
+      return 0xe000;
+    } else if (loc < 0xff00) {
+      return 0xfe00;
+    } else if (loc < 0xff80) {
+      return 0xff00;
+    } else {
+      return 0xff80;
+    }
+  }
+
+  std::string FormatLocation(GuestLocation location) {
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%02x:%04x", location.bank, location.loc);
+    return buf;
+  }
+
+  GuestLocation GetRomIndexLocation(std::size_t idx) {
+    const auto bank = static_cast<u16>(idx / kRomBankSize);
+    const auto offset = static_cast<u16>(idx % kRomBankSize);
+    return {bank, static_cast<u16>(bank == 0 ? offset : 0x4000 + offset)};
+  }
+
+  GuestLocation GetRamIndexLocation(std::size_t idx) {
+    if (idx >= 0x8000) {
+      idx -= 0x8000;
+      return {static_cast<u16>(2 + idx / kWramBankSize),
+              static_cast<u16>(0xd000 + idx % kWramBankSize)};
+    }
+
+    const auto loc = static_cast<u16>(0x8000 + idx);
+    return {static_cast<u16>(loc >= 0xd000 && loc < 0xe000 ? 1 : 0), loc};
+  }
+
+  void WriteShare(std::ostream& os, u64 cycles, u64 totalCycles) {
+    os << std::setw(7) << std::fixed << std::setprecision(2)
+       << (totalCycles > 0 ? 100.0 * cycles / totalCycles : 0.0) << '%';
+  }
+}
+
+std::string GetSymFileLoadResultAsMessage(SymFileLoadResult result) {
+  switch (result) {
+    case SymFileLoadResult::Ok:
+      return "Symbol file loaded successfully!";
+
+    case SymFileLoadResult::ReadError:
+      return "Could not read the symbol file.";
+
+    case SymFileLoadResult::InvalidFormat:
+      return "The symbol file is not in the RGBDS .sym format.";
+
+    default: assert(!"unimplemented SymFileLoadResult message!");
+      return {};
+  }
+}
+
+SymFileLoadResult GuestSymbols::LoadSymFile(const std::string& filePath) {
+  Clear();
+
+  std::ifstream file(filePath);
+  if (!file) {
+    return SymFileLoadResult::ReadError;
+  }
+
+  // each line is "BB:AAAA Name", with ';' starting a comment
+  std::vector<Symbol> symbols;
+  std::string line;
+
+  while (std::getline(file, line)) {
+    std::istringstream iss(line.substr(0, line.find(';')));
+    std::string locStr, name;
+
+    if (!(iss >> locStr)) {
+      continue; // blank or comment line
+    }
+    if (!(iss >> name)) {
+      return SymFileLoadResult::InvalidFormat;
+    }
+
+    const auto sepIdx = locStr.find(':');
+    if (sepIdx == 0 || sepIdx == std::string::npos
+        || sepIdx + 1 == locStr.size()) {
+      return SymFileLoadResult::InvalidFormat;
+    }
+
+    char* bankEnd;
+    char* locEnd;
+    const auto bank = std::strtoul(locStr.c_str(), &bankEnd, 16);
+    const auto loc = std::strtoul(locStr.c_str() + sepIdx + 1, &locEnd, 16);
+
+    if (bankEnd != locStr.c_str() + sepIdx || *locEnd != '\0'
+        || bank > 0xffff || loc > 0xffff) {
+      return SymFileLoadResult::InvalidFormat;
+    }
+
+    const bool isLocal = name.find('.') != std::string::npos;
+    symbols.push_back({static_cast<u32>(bank << 16 | loc), std::move(name),
+                       isLocal});
+  }
+
+  if (file.bad()) {
+    return SymFileLoadResult::ReadError;
+  }
+
+  std::stable_sort(symbols.begin(), symbols.end(),
+                   [](const Symbol& lhs, const Symbol& rhs) {
+                     return lhs.key < rhs.key;
+                   });
+  symbols_ = std::move(symbols);
+  return SymFileLoadResult::Ok;
+}
+
+void GuestSymbols::Clear() {
+  symbols_.clear();
+}
+
+std::size_t GuestSymbols::GetNumSymbols() const {
+  return symbols_.size();
+}
+
+std::string GuestSymbols::GetLocationName(GuestLocation location) const {
+  const auto symbol = FindSymbol(location, false);
+  if (!symbol) {
+    return FormatLocation(location);
+  }
+
+  const auto offset = location.loc - (symbol->key & 0xffff);
+  if (offset == 0) {
+    return symbol->name;
+  }
+
+  std::ostringstream oss;
+  oss << symbol->name << "+$" << std::hex << offset;
+  return oss.str();
+}
+
+std::string GuestSymbols::GetFunctionName(GuestLocation location) const {
+  const auto symbol = FindSymbol(location, true);
+  return symbol ? symbol->name : FormatLocation(location);
+}
+
+const GuestSymbols::Symbol* GuestSymbols::FindSymbol(GuestLocation location,
+                                                     bool globalOnly) const {
+  const u32 key = u32{location.bank} << 16 | location.loc;
+  const auto areaStart = GetAreaStart(location.loc);
+
+  auto it = std::upper_bound(symbols_.begin(), symbols_.end(), key,
+                             [](u32 k, const Symbol& symbol) {
+                               return k < symbol.key;
+                             });
+
+  while (it != symbols_.begin()) {
+    --it;
+    if (it->key >> 16 != location.bank || (it->key & 0xffff) < areaStart) {
+      break; // no symbol before location in its area
+    }
+    if (!globalOnly || !it->isLocal) {
+      return &*it;
+    }
+  }
+
+  return nullptr;
+}
+
+GuestProfiler::GuestProfiler()
+    : ramCycles_(kRamCyclesSize), totalCycles_(0), idleCycles_(0),
+      currentNode_(0) {
+  nodes_.push_back({{0, 0}, kNoCallNode, kNoCallNode, kNoCallNode, 0, 0});
+}
+
+void GuestProfiler::Clear(const Gbc& gbc) {
+  const auto& hw = gbc.GetHardware();
+  const bool isRomLoaded = hw.cartridge.IsRomLoaded();
+
+  romCycles_.assign(isRomLoaded ? hw.cartridge.GetRomData().size() : 0, 0);
+  ramCycles_.assign(kRamCyclesSize, 0);
+  totalCycles_ = idleCycles_ = 0;
+
+  // the root is named after wherever the CPU was when profiling started
+  const auto pc = hw.cpu.GetRegisters().pc.Get();
+  nodes_.clear();
+  nodes_.push_back({isRomLoaded ? GetLocation(hw, pc) : GuestLocation{0, pc},
+                    kNoCallNode, kNoCallNode, kNoCallNode, 0, 0});
+  ResetCallStack();
+}
+
+void GuestProfiler::ResetCallStack() {
+  callStack_.clear();
+  currentNode_ = 0;
+}
+
+GuestProfilerStep GuestProfiler::BeginStep(const GbcHardware& hw) {
+  const auto& cpu = hw.cpu;
+  const auto& reg = cpu.GetRegisters();
+  GuestProfilerStep step{nullptr, reg.pc.Get(), reg.sp.Get(), 0, false};
+
+  // as in Cpu::Update(), a requested interrupt wakes a halted CPU, and is
+  // serviced if the master enable is on
+  const auto status = cpu.GetStatus();
+  const bool canWake = status == CpuStatus::Halted
+                       && !hw.dma.IsNdmaInProgress();
+  const u8 requestedInts = status == CpuStatus::Running || canWake
+                           ? cpu.GetIntf() & cpu.GetInte() : 0;
+
+  step.isIdle = status != CpuStatus::Running && requestedInts == 0;
+  if (step.isIdle) {
+    return step;
+  }
+
+  if (cpu.GetIntme() && (requestedInts & 0x1f) && !hw.dma.IsNdmaInProgress()) {
+    step.interruptVector = 0x40;
+    for (auto ints = requestedInts & 0x1f; !(ints & 1); ints >>= 1) {
+      step.interruptVector += 8;
+    }
+  }
+
+  // count towards the instruction about to be executed (or the interrupt's
+  // handler), in the banks mapped now; it may switch them
+  step.cycleCount = GetCycleCount(hw, step.interruptVector != 0
+                                      ? step.interruptVector : step.pc);
+  return step;
+}
+
+void GuestProfiler::EndStep(const GbcHardware& hw,
+                            const GuestProfilerStep& step,
+                            unsigned int cycles) {
+  totalCycles_ += cycles;
+
+  if (step.isIdle) {
+    idleCycles_ += cycles;
+    nodes_[currentNode_].idleCycles += cycles;
+    return;
+  }
+
+  // servicing an interrupt pushes the PC, and the update may then go on to
+  // execute the handler's first instruction
+  auto opPc = step.pc, opSp = step.sp;
+  if (step.interruptVector != 0) {
+    opPc = step.interruptVector;
+    opSp = static_cast<u16>(step.sp - 2);
+    EnterCall(hw, opPc, step.pc, opSp);
+  }
+
+  nodes_[currentNode_].selfCycles += cycles;
+  if (step.cycleCount) {
+    *step.cycleCount += cycles;
+  }
+
+  // PUSH and POP leave PC at the next instruction, unlike calls and returns
+  const auto& reg = hw.cpu.GetRegisters();
+  const u16 pc = reg.pc.Get(), sp = reg.sp.Get();
+  if (pc == static_cast<u16>(opPc + 1)) {
+    return;
+  }
+
+  if (sp == static_cast<u16>(opSp - 2)) {
+    const u16 pushed = hw.mmu.Read8(sp) | hw.mmu.Read8(sp + 1) << 8;
+
+    const bool isCall = pushed == static_cast<u16>(opPc + 3);
+    const bool isRestart = pushed == static_cast<u16>(opPc + 1)
+                           && (pc & ~0x38) == 0;
+    if (isCall || isRestart) {
+      EnterCall(hw, pc, pushed, sp);
+    }
+  } else if (sp == static_cast<u16>(opSp + 2)) {
+    ReturnFromCall(pc, sp);
+  }
+}
+
+u64* GuestProfiler::GetCycleCount(const GbcHardware& hw, u16 loc) {
+  if (loc < 0x8000) {
+    const auto& cart = hw.cartridge;
+    const u8* bankData = loc < kRomBankSize ? cart.GetRomBank0Data()
+                                            : cart.GetRomBankXData();
+    if (!bankData) {
+      return nullptr;
+    }
+
+    const auto idx = static_cast<std::size_t>(bankData
+                                              - cart.GetRomData().data())
+                     + (loc & (kRomBankSize - 1));
+    return idx < romCycles_.size() ? &romCycles_[idx] : nullptr;
+  } else if (loc >= 0xd000 && loc < 0xe000 && hw.mmu.GetWramBankIndex() > 1) {
+    return &ramCycles_[0x8000 + (hw.mmu.GetWramBankIndex() - 2) * kWramBankSize
+                       + (loc & (kWramBankSize - 1))];
+  } else {
+    return &ramCycles_[loc - 0x8000];
+  }
+}
+
+u64 GuestProfiler::GetTotalCycles() const {
+  return totalCycles_;
+}
+
+u64 GuestProfiler::GetIdleCycles() const {
+  return idleCycles_;
+}
+
+GuestLocation GuestProfiler::GetLocation(const GbcHardware& hw,
+                                         u16 loc) const {
+  if (loc < 0x8000) {
+    const auto& cart = hw.cartridge;
+    const u8* bankData = loc < kRomBankSize ? cart.GetRomBank0Data()
+                                            : cart.GetRomBankXData();
+    const auto offset = bankData ? bankData - cart.GetRomData().data() : 0;
+    return {static_cast<u16>(offset / kRomBankSize), loc};
+  } else if (loc >= 0xd000 && loc < 0xe000) {
+    return {hw.mmu.GetWramBankIndex(), loc};
+  } else {
+    return {0, loc};
+  }
+}
+
+void GuestProfiler::EnterCall(const GbcHardware& hw, u16 targetLoc,
+                              u16 returnLoc, u16 sp) {
+  PopDeadFrames(sp);
+
+  const auto entry = GetLocation(hw, targetLoc);
+  auto child = nodes_[currentNode_].firstChild;
+  while (child != kNoCallNode && !(nodes_[child].entry == entry)) {
+    child = nodes_[child].nextSibling;
+  }
+
+  if (child == kNoCallNode) {
+    if (nodes_.size() < kGuestProfilerMaxCallNodes) {
+      child = static_cast<u32>(nodes_.size());
+      nodes_.push_back({entry, currentNode_, kNoCallNode,
+                        nodes_[currentNode_].firstChild, 0, 0});
+      nodes_[currentNode_].firstChild = child;
+    } else {
+      child = currentNode_; // out of room; count it towards the caller
+    }
+  }
+
+  callStack_.push_back({child, returnLoc, sp});
+  currentNode_ = child;
+}
+
+void GuestProfiler::ReturnFromCall(u16 returnLoc, u16 sp) {
+  // the return address was popped from just below sp
+  const auto frameSp = static_cast<u16>(sp - 2);
+  PopDeadFrames(static_cast<u16>(frameSp - 1));
+
+  if (!callStack_.empty() && callStack_.back().sp == frameSp
+      && callStack_.back().returnLoc == returnLoc) {
+    callStack_.pop_back();
+    currentNode_ = callStack_.empty() ? 0 : callStack_.back().node;
+  }
+}
+
+void GuestProfiler::PopDeadFrames(u16 sp) {
+  // the stack grows down, so frames at or below sp have been overwritten or
+  // abandoned (e.g by loading SP)
+  while (!callStack_.empty() && callStack_.back().sp <= sp) {
+    callStack_.pop_back();
+  }
+
+  currentNode_ = callStack_.empty() ? 0 : callStack_.back().node;
+}
+
+std::vector<u64> GuestProfiler::GetInclusiveCycles() const {
+  std::vector<u64> inclusive(nodes_.size());
+
+  // children are always created after their parents
+  for (auto i = nodes_.size(); i-- > 0;) {
+    inclusive[i] += nodes_[i].selfCycles + nodes_[i].idleCycles;
+    if (nodes_[i].parent != kNoCallNode) {
+      inclusive[nodes_[i].parent] += inclusive[i];
+    }
+  }
+
+  return inclusive;
+}
+
+void GuestProfiler::WriteReport(std::ostream& os, GuestProfileFormat format,
+                                const GuestSymbols& symbols) const {
+  const auto flags = os.flags();
+  const auto precision = os.precision();
+  const auto fill = os.fill(' ');
+
+  switch (format) {
+    case GuestProfileFormat::Flat:
+      WriteFlatReport(os, symbols);
+      break;
+
+    case GuestProfileFormat::Tree:
+      WriteTreeReport(os, symbols);
+      break;
+
+    case GuestProfileFormat::Folded:
+      WriteFoldedStacks(os, symbols);
+      break;
+
+    default: assert(!"unimplemented GuestProfileFormat!");
+  }
+
+  os.flags(flags);
+  os.precision(precision);
+  os.fill(fill);
+}
+
+bool GuestProfiler::WriteReportFile(const std::string& filePath,
+                                    GuestProfileFormat format,
+                                    const GuestSymbols& symbols) const {
+  std::ofstream file(filePath);
+  if (!file) {
+    return false;
+  }
+
+  WriteReport(file, format, symbols);
+  return static_cast<bool>(file);
+}
+
+void GuestProfiler::WriteFlatReport(std::ostream& os,
+                                    const GuestSymbols& symbols) const {
+  struct Entry {
+    GuestLocation location;
+    u64 cycles;
+  };
+
+  std::vector<Entry> entries;
+  for (std::size_t i = 0; i < romCycles_.size(); ++i) {
+    if (romCycles_[i] > 0) {
+      entries.push_back({GetRomIndexLocation(i), romCycles_[i]});
+    }
+  }
+  for (std::size_t i = 0; i < ramCycles_.size(); ++i) {
+    if (ramCycles_[i] > 0) {
+      entries.push_back({GetRamIndexLocation(i), ramCycles_[i]});
+    }
+  }
+
+  os << "total: " << totalCycles_ << " cycles, ";
+  WriteShare(os, idleCycles_, totalCycles_);
+  os << " halted or stopped\n";
+
+  if (symbols.GetNumSymbols() > 0) {
+    std::unordered_map<std::string, u64> functionCycles;
+    for (const auto& entry : entries) {
+      functionCycles[symbols.GetFunctionName(entry.location)] += entry.cycles;
+    }
+
+    std::vector<std::pair<std::string, u64>> functions(functionCycles.begin(),
+                                                       functionCycles.end());
+    std::sort(functions.begin(), functions.end(),
+              [](const std::pair<std::string, u64>& lhs,
+                 const std::pair<std::string, u64>& rhs) {
+                return lhs.second > rhs.second;
+              });
+
+    os << "\nself cycles by function:\n"
+       << "          cycles    share  function\n";
+    for (std::size_t i = 0;
+         i < std::min(functions.size(), kFlatReportMaxRows); ++i) {
+      os << std::setw(16) << functions[i].second << ' ';
+      WriteShare(os, functions[i].second, totalCycles_);
+      os << "  " << functions[i].first << '\n';
+    }
+  }
+
+  const auto numRows = std::min(entries.size(), kFlatReportMaxRows);
+  std::partial_sort(entries.begin(), entries.begin() + numRows, entries.end(),
+                    [](const Entry& lhs, const Entry& rhs) {
+                      return lhs.cycles > rhs.cycles;
+                    });
+
+  os << "\nself cycles by instruction:\n"
+     << "          cycles    share  location\n";
+  for (std::size_t i = 0; i < numRows; ++i) {
+    os << std::setw(16) << entries[i].cycles << ' ';
+    WriteShare(os, entries[i].cycles, totalCycles_);
+    os << "  " << FormatLocation(entries[i].location);
+    if (symbols.GetNumSymbols() > 0) {
+      os << "  " << symbols.GetLocationName(entries[i].location);
+    }
+    os << '\n';
+  }
+}
+
+void GuestProfiler::WriteTreeReport(std::ostream& os,
+                                    const GuestSymbols& symbols) const {
+  const auto inclusive = GetInclusiveCycles();
+  const auto minCycles = static_cast<u64>(totalCycles_
+                                          * kTreeReportMinShare);
+
+  os << "call tree of " << totalCycles_ << " cycles (hiding calls under "
+     << kTreeReportMinShare * 100 << "%):\n"
+     << "          cycles    total     self  function\n";
+
+  // depth-first, with the most expensive calls first. kept off the host's
+  // call stack, as a recursive guest can nest calls thousands deep
+  std::vector<std::pair<u32, unsigned int>> pending{{0, 0}};
+  std::vector<u32> children;
+
+  while (!pending.empty()) {
+    const auto nodeIdx = pending.back().first;
+    const auto depth = pending.back().second;
+    const auto& node = nodes_[nodeIdx];
+    pending.pop_back();
+
+    os << std::setw(16) << inclusive[nodeIdx] << ' ';
+    WriteShare(os, inclusive[nodeIdx], totalCycles_);
+    os << ' ';
+    WriteShare(os, node.selfCycles, totalCycles_);
+    os << "  " << std::string(depth * 2, ' ')
+       << symbols.GetLocationName(node.entry) << '\n';
+
+    if (node.idleCycles > 0 && node.idleCycles >= minCycles) {
+      os << std::setw(16) << node.idleCycles << ' ';
+      WriteShare(os, node.idleCycles, totalCycles_);
+      os << ' ';
+      WriteShare(os, node.idleCycles, totalCycles_);
+      os << "  " << std::string(depth * 2 + 2, ' ') << "(halted)\n";
+    }
+
+    children.clear();
+    for (auto child = node.firstChild; child != kNoCallNode;
+         child = nodes_[child].nextSibling) {
+      if (inclusive[child] > 0 && inclusive[child] >= minCycles) {
+        children.push_back(child);
+      }
+    }
+
+    // pushed cheapest first, so that the most expensive is written next
+    std::sort(children.begin(), children.end(), [&](u32 lhs, u32 rhs) {
+      return inclusive[lhs] < inclusive[rhs];
+    });
+    for (const auto child : children) {
+      pending.emplace_back(child, depth + 1);
+    }
+  }
+}
+
+void GuestProfiler::WriteFoldedStacks(std::ostream& os,
+                                      const GuestSymbols& symbols) const {
+  // one "root;caller;callee cycles" line for each node's own cycles
+  std::vector<std::string> names;
+  names.reserve(nodes_.size());
+  for (const auto& node : nodes_) {
+    names.push_back(symbols.GetLocationName(node.entry));
+  }
+
+  std::vector<u32> path;
+  for (std::size_t i = 0; i < nodes_.size(); ++i) {
+    const auto& node = nodes_[i];
+    if (node.selfCycles == 0 && node.idleCycles == 0) {
+      continue;
+    }
+
+    path.clear();
+    for (auto n = static_cast<u32>(i); n != kNoCallNode;
+         n = nodes_[n].parent) {
+      path.push_back(n);
+    }
+
+    std::string stack;
+    for (auto it = path.rbegin(); it != path.rend(); ++it) {
+      stack += (it == path.rbegin() ? "" : ";") + names[*it];
+    }
+
+    if (node.selfCycles > 0) {
+      os << stack << ' ' << node.selfCycles << '\n';
+    }
+    if (node.idleCycles > 0) {
+      os << stack << ";(halted) " << node.idleCycles << '\n';
+    }
+  }
+}
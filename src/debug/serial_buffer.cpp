@@ -0,0 +1,23 @@
+#include "debug/serial_buffer.h"
+
+SerialBuffer::SerialBuffer() : outByte_(0) {}
+
+void SerialBuffer::SerialReset() {
+  outByte_ = 0;
+}
+
+void SerialBuffer::SerialWriteBit(bool bitSet) {
+  outByte_ = ((outByte_ << 1) | (bitSet ? 1 : 0)) & 0xff;
+}
+
+void SerialBuffer::SerialOnByteWritten() {
+  data_ += static_cast<char>(outByte_);
+}
+
+const std::string& SerialBuffer::GetData() const {
+  return data_;
+}
+
+void SerialBuffer::ClearData() {
+  data_.clear();
+}
@@ -1,9 +1,22 @@
 #include "emulator.h"
-
-// the minimum amount of time that the emulation thread sleeps for.
-// allows the main thread to do work while waiting on the emu thread
+#include "trace.h"
+#include "util.h"
+#include <algorithm>
+#include <fstream>
+
+// the minimum amount of time that the emulation thread sleeps for between
+// frames when the framerate is unlimited. allows the main thread to do work
+// while waiting on the emu thread
 constexpr std::chrono::microseconds kMinFrameSleepTime(50);
 
+// frames are waited for by sleeping until a margin before their deadline and
+// spinning for the rest. the margin adapts to how late the host has recently
+// been waking us up (which decays by kSleepOvershootDecay every frame), within
+// these limits
+constexpr auto kMinSpinMarginMicros = 50.0;
+constexpr auto kMaxSpinMarginMicros = 4000.0;
+constexpr auto kSleepOvershootDecay = 1.0 / 64.0;
+
 // the max amount of frames that can be processed at one time without
 // sleeping the emulation thread to catch-up with the target framerate
 constexpr auto kMaxFrameSkip = 3u;
@@ -14,8 +27,48 @@ static_assert(kMaxFrameSkip > 0, "kMaxFrameSkip must be at least 1");
 // rescheduled for the current time
 constexpr std::chrono::seconds kMaxFrameTimeLateness(1);
 
+// while running faster than normal, the actual speed is measured over this long
+// to know how much to time-stretch the audio by
+constexpr std::chrono::milliseconds kSpeedMeasureTime(100);
+
+constexpr auto kDefaultFastForwardSpeed = 4u;
+
 Emulator::Emulator()
-    : isPaused_(false), isStarted_(false), limitFramerate_(true) {}
+    : commandQueue_(kEmulatorCommandQueueSize), isInCgbMode_(false),
+      isRewindEnabled_(false), rewindMemoryUsage_(0),
+      rewindHistorySeconds_(0.0f), isPaused_(false), isStarted_(false),
+      limitFramerate_(true), isRewinding_(false), isFastForwarding_(false),
+      fastForwardSpeed_(kDefaultFastForwardSpeed),
+      perfCountersEnabled_(false),
+      perfCountersOpenResult_(PerfCountersOpenResult::Ok), lastSpeed_(1),
+      speedMeasureFrames_(0), sleepOvershootMicros_(0.0),
+      spinMarginMicros_(kMinSpinMarginMicros), hasLastFrameStartTime_(false),
+      numFrames_(0), numFramesSkipped_(0), statsWindowFrames_(0),
+      statsWindowMean_(0.0), statsWindowM2_(0.0), statsWindowMax_(0.0),
+      statsWindowStartFrame_(0), statsWindowStartInstructions_(0),
+      statsWindowStartCycles_(0), statsWindowStartIdleCycles_(0),
+      statsWindowEmulateFrames_(0), statsWindowEmulateSeconds_(0.0),
+      statsWindowLockWaitSeconds_(0.0), timeNextUpdateFrame_(false),
+      statsWindowUpdateTimes_(), statsWindowPerfCounts_(),
+      statsWindowPerfFrames_(0), countNextUpdateFrame_(false),
+      hasStatsWindowUpdateCounts_(false), statsWindowUpdateCounts_(),
+      rewindFrameInterval_(0),
+      framesSinceRewindPush_(0), runAheadFrames_(0), runAheadCostMicros_(0.0),
+      isRecordingMovie_(false), isNetplayActive_(false) {
+  const auto& hw = gbc_.GetHardware();
+
+  joypadImpossibleInputsAllowed_ = hw.joypad.AreImpossibleInputsAllowed();
+  apuChMuted_[0] = hw.apu.IsCh1Muted();
+  apuChMuted_[1] = hw.apu.IsCh2Muted();
+  apuChMuted_[2] = hw.apu.IsCh3Muted();
+  apuChMuted_[3] = hw.apu.IsCh4Muted();
+  videoScanlineSpritesLimiterEnabled_ =
+      hw.ppu.IsScanlineSpritesLimiterEnabled();
+  videoBgRenderEnabled_ = hw.ppu.IsBgRenderEnabled();
+  videoBgWindowRenderEnabled_ = hw.ppu.IsBgWindowRenderEnabled();
+  videoSpritesRenderEnabled_ = hw.ppu.IsSpritesRenderEnabled();
+  runAheadFramesSetting_ = runAheadFrames_;
+}
 
 Emulator::~Emulator() {
   StopEmulation();
@@ -23,10 +76,14 @@ Emulator::~Emulator() {
 
 void Emulator::EmulationLoop() {
   using namespace std::chrono;
+  trace::SetThreadName("emulation");
 
   // schedule the next frame to happen immediately
   auto nextFrameTime_ = steady_clock::now();
 
+  numFrames_ = numFramesSkipped_ = 0;
+  hasLastFrameStartTime_ = false;
+
   while (isStarted_) {
     if (isPaused_) {
       // pause and adjust the next frame time to account for the pause
@@ -34,21 +91,28 @@ void Emulator::EmulationLoop() {
       PauseUntilNotify();
 
       nextFrameTime_ += steady_clock::now() - pauseStartTime;
+      hasLastFrameStartTime_ = false; // don't count the pause as a frame time
     } else {
-      // update joypad key states for the frame(s) that we are about to process
-      gbc_.GetHardware().joypad.CommitKeyStates();
+      const auto speed = GetTargetSpeed();
+
+      if (speed > 0) {
+        const auto frameTime = duration_cast<steady_clock::duration>(kFrameTime)
+                               / speed;
 
-      if (limitFramerate_) {
         // frame skip until we process enough frames to catch up to our expected
         // frame rate (or until we hit kMaxFrameSkip)
         {
-          std::unique_lock<std::mutex> lock(emulationMutex_);
+          const auto lock = LockEmulation();
 
           for (auto i = 0u;
                i < kMaxFrameSkip && steady_clock::now() >= nextFrameTime_;
                ++i) {
-            EmulateFrame();
-            nextFrameTime_ += duration_cast<steady_clock::duration>(kFrameTime);
+            if (i > 0) {
+              ++numFramesSkipped_;
+            }
+
+            RunFrame(speed);
+            nextFrameTime_ += frameTime;
           }
         }
 
@@ -59,21 +123,16 @@ void Emulator::EmulationLoop() {
           nextFrameTime_ = nowTime;
         }
 
-        // sleep for the remaining frame time or kMinFrameSleepTime if too small
-        const auto frameTimeLeft = duration_cast<steady_clock::duration>(
-            nextFrameTime_ - nowTime);
-
-        const auto frameSleepDur = std::max(frameTimeLeft,
-            duration_cast<steady_clock::duration>(kMinFrameSleepTime));
-
-        std::this_thread::sleep_for(frameSleepDur);
+        // the deadline is absolute, so time spent emulating or oversleeping
+        // is never added on top of the frame time
+        WaitUntil(nextFrameTime_);
       } else {
         // emulation frame rate unlimited - just render the next frame here and
         // ignore the time that was scheduled for processing the next frame.
         // we wont bother handling frame skip here
         {
-          std::unique_lock<std::mutex> lock(emulationMutex_);
-          EmulateFrame();
+          const auto lock = LockEmulation();
+          RunFrame(speed);
         }
 
         // sleep for the minimum required time
@@ -85,17 +144,443 @@ void Emulator::EmulationLoop() {
       }
     }
   }
+
+  // the counters belong to this thread, which is about to exit
+  perfCounters_.Close();
+}
+
+std::unique_lock<std::mutex> Emulator::LockEmulation() {
+  using namespace std::chrono;
+
+  SDGBC_TRACE_ZONE("Emulator::LockEmulation");
+  const auto startTime = steady_clock::now();
+  std::unique_lock<std::mutex> lock(emulationMutex_);
+  statsWindowLockWaitSeconds_ += duration<double>(steady_clock::now()
+                                                  - startTime).count();
+
+  return lock;
+}
+
+unsigned int Emulator::GetTargetSpeed() const {
+  if (!limitFramerate_) {
+    return 0;
+  }
+
+  return isFastForwarding_ ? fastForwardSpeed_.load() : 1;
+}
+
+void Emulator::WaitUntil(std::chrono::steady_clock::time_point deadline) {
+  using namespace std::chrono;
+
+  const auto sleepDeadline = deadline
+      - duration_cast<steady_clock::duration>(
+          duration<double, std::micro>(spinMarginMicros_));
+
+  if (steady_clock::now() < sleepDeadline) {
+    std::this_thread::sleep_until(sleepDeadline);
+
+    // track the recent worst case of how late we woke up, letting it decay so
+    // that the margin shrinks again after a one-off spike
+    const double overshootMicros = duration<double, std::micro>(
+        steady_clock::now() - sleepDeadline).count();
+    sleepOvershootMicros_ = std::max(
+        overshootMicros,
+        sleepOvershootMicros_ * (1.0 - kSleepOvershootDecay));
+
+    spinMarginMicros_ = std::min(kMaxSpinMarginMicros,
+                                 kMinSpinMarginMicros
+                                 + sleepOvershootMicros_ * 1.25);
+  }
+
+  while (steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+}
+
+void Emulator::RecordFrameStart(
+    std::chrono::steady_clock::time_point startTime) {
+  using namespace std::chrono;
+
+  if (++numFrames_ == 1) {
+    StartStatsWindow();
+  }
+
+  if (hasLastFrameStartTime_) {
+    // welford's algorithm, restarted for each window
+    const double frameTimeMicros = duration<double, std::micro>(
+        startTime - lastFrameStartTime_).count();
+    const double delta = frameTimeMicros - statsWindowMean_;
+
+    ++statsWindowFrames_;
+    statsWindowMean_ += delta / statsWindowFrames_;
+    statsWindowM2_ += delta * (frameTimeMicros - statsWindowMean_);
+    statsWindowMax_ = std::max(statsWindowMax_, frameTimeMicros);
+  }
+
+  lastFrameStartTime_ = startTime;
+  hasLastFrameStartTime_ = true;
+
+  if (statsWindowFrames_ >= kEmulatorStatsWindowFrames) {
+    PublishStats();
+    StartStatsWindow();
+  }
+}
+
+void Emulator::PublishStats() {
+  using namespace std::chrono;
+
+  EmulatorStats stats;
+  stats.numFrames = numFrames_;
+  stats.frameTimeMeanMicros = statsWindowMean_;
+  stats.frameTimeVarianceMicros2 = statsWindowM2_ / statsWindowFrames_;
+  stats.frameTimeMaxMicros = statsWindowMax_;
+  stats.sleepOvershootMicros = sleepOvershootMicros_;
+  stats.spinMarginMicros = spinMarginMicros_;
+
+  // the window's frames were emulated between its start and this frame
+  const auto& cpu = gbc_.GetHardware().cpu;
+  const double numWindowFrames = static_cast<double>(
+      numFrames_ - statsWindowStartFrame_);
+
+  stats.framesPerSecond = statsWindowMean_ > 0.0 ? 1e6 / statsWindowMean_
+                                                 : 0.0;
+  stats.speedPercent = stats.framesPerSecond
+                       * duration<double>(kFrameTime).count() * 100.0;
+  stats.instructionsPerSecond = stats.framesPerSecond
+      * (cpu.GetNumInstructions() - statsWindowStartInstructions_)
+      / numWindowFrames;
+
+  // the hardware's share comes from the frame timed by UpdateFrameTimed(),
+  // leaving everything else (such as run-ahead and rewind) in other. netplay
+  // and rewinding don't go through it, so a window spent doing only those
+  // has no frame timed
+  const auto& times = statsWindowUpdateTimes_;
+  stats.emulateMicros = statsWindowEmulateFrames_ > 0
+      ? statsWindowEmulateSeconds_ * 1e6 / statsWindowEmulateFrames_ : 0.0;
+  stats.hasUpdateTimes = !timeNextUpdateFrame_;
+  stats.cpuMicros = times.cpuSeconds * 1e6;
+  stats.ppuMicros = times.ppuSeconds * 1e6;
+  stats.apuMicros = times.apuSeconds * 1e6;
+  stats.otherMicros = std::max(0.0, stats.emulateMicros - stats.cpuMicros
+                                        - stats.ppuMicros - stats.apuMicros);
+
+  stats.numFramesSkipped = numFramesSkipped_;
+
+  const auto audioOut = timeStretchOut_.GetOutput();
+  stats.numAudioUnderruns = audioOut ? audioOut->AudioGetNumUnderruns() : 0;
+  stats.numAudioOverruns = audioOut ? audioOut->AudioGetNumOverruns() : 0;
+
+  stats.lockWaitMicros = statsWindowLockWaitSeconds_ * 1e6 / numWindowFrames;
+
+  const auto numCycles = cpu.GetNumCycles() - statsWindowStartCycles_;
+  stats.idlePercent = numCycles > 0
+      ? 100.0 * (cpu.GetNumIdleCycles() - statsWindowStartIdleCycles_)
+            / numCycles
+      : 0.0;
+
+  stats.hasPerfCounts = statsWindowPerfFrames_ > 0;
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    stats.perfCountsPerFrame[i] = stats.hasPerfCounts
+        ? statsWindowPerfCounts_[i] / statsWindowPerfFrames_ : 0;
+  }
+
+  stats.hasPerfUpdateCounts = hasStatsWindowUpdateCounts_;
+  stats.perfUpdateCounts = statsWindowUpdateCounts_;
+
+  stats_.Store(stats);
+}
+
+void Emulator::StartStatsWindow() {
+  const auto& cpu = gbc_.GetHardware().cpu;
+
+  statsWindowFrames_ = 0;
+  statsWindowMean_ = statsWindowM2_ = statsWindowMax_ = 0.0;
+
+  statsWindowStartFrame_ = numFrames_;
+  statsWindowStartInstructions_ = cpu.GetNumInstructions();
+  statsWindowStartCycles_ = cpu.GetNumCycles();
+  statsWindowStartIdleCycles_ = cpu.GetNumIdleCycles();
+
+  statsWindowEmulateFrames_ = 0;
+  statsWindowEmulateSeconds_ = statsWindowLockWaitSeconds_ = 0.0;
+
+  // sample how the hardware splits the time on the window's first frame
+  statsWindowUpdateTimes_ = {};
+  timeNextUpdateFrame_ = true;
+
+  statsWindowPerfCounts_ = {};
+  statsWindowPerfFrames_ = 0;
+  countNextUpdateFrame_ = hasStatsWindowUpdateCounts_ = false;
+  statsWindowUpdateCounts_ = {};
+}
+
+void Emulator::SyncPerfCounters() {
+  const bool enabled = perfCountersEnabled_;
+  if (enabled == perfCounters_.IsOpen()
+      || (enabled && perfCountersOpenResult_ != PerfCountersOpenResult::Ok)) {
+    return; // nothing changed (or we already failed to open them)
+  }
+
+  if (enabled) {
+    perfCountersOpenResult_ = perfCounters_.Open();
+  } else {
+    perfCounters_.Close();
+  }
+}
+
+void Emulator::RunFrame(unsigned int speed) {
+  using namespace std::chrono;
+  const auto nowTime = steady_clock::now();
+
+  RecordFrameStart(nowTime);
+  DrainCommands();
+  SyncPerfCounters();
+
+  if (speed != lastSpeed_) {
+    lastSpeed_ = speed;
+    nextPresentTime_ = speedMeasureTime_ = nowTime;
+    speedMeasureFrames_ = 0;
+
+    // until the actual speed has been measured, assume we're keeping up
+    timeStretchOut_.SetSpeed(speed);
+  }
+
+  // only draw frames as often as they would be drawn at normal speed; the rest
+  // would never be shown anyway
+  const bool present = speed == 1 || nowTime >= nextPresentTime_;
+  if (speed != 1 && present) {
+    nextPresentTime_ += duration_cast<steady_clock::duration>(kFrameTime);
+
+    if (nextPresentTime_ < nowTime) {
+      nextPresentTime_ = nowTime
+                         + duration_cast<steady_clock::duration>(kFrameTime);
+    }
+  }
+
+  const bool timeFrame = timeNextUpdateFrame_;
+  const bool countFrame = countNextUpdateFrame_;
+  const auto startPerfCounts = perfCounters_.Read();
+  EmulateFrame(present);
+
+  // the frames sampled by UpdateFrameTimed() and UpdateFrameCounted() were
+  // slowed down by it, so they're left out of the means
+  if ((!timeFrame || timeNextUpdateFrame_)
+      && (!countFrame || countNextUpdateFrame_)) {
+    statsWindowEmulateSeconds_ += duration<double>(steady_clock::now()
+                                                   - nowTime).count();
+    ++statsWindowEmulateFrames_;
+
+    if (perfCounters_.IsOpen()) {
+      statsWindowPerfCounts_ += perfCounters_.Read() - startPerfCounts;
+      ++statsWindowPerfFrames_;
+    }
+  }
+
+  if (speed == 1) {
+    return;
+  }
+
+  ++speedMeasureFrames_;
+  const auto measureDur = nowTime - speedMeasureTime_;
+
+  if (measureDur >= kSpeedMeasureTime) {
+    const double measuredSpeed = speedMeasureFrames_
+        * duration<double>(kFrameTime).count()
+        / duration<double>(measureDur).count();
+    timeStretchOut_.SetSpeed(std::max(1.0, measuredSpeed));
+
+    speedMeasureTime_ = nowTime;
+    speedMeasureFrames_ = 0;
+  }
+}
+
+void Emulator::EmulateFrame(bool present) {
+  SDGBC_TRACE_ZONE("Emulator::EmulateFrame");
+  auto& ppu = gbc_.GetHardware().ppu;
+
+  if (isNetplayActive_) {
+    // the session commits both players' keys itself. if the peer has fallen
+    // too far behind, the frame is skipped to let it catch up
+    ppu.SetRenderSuppressed(!present);
+    netplay_.AdvanceFrame(gbc_, gbc_.GetHardware().joypad.GetNextKeyStates());
+    ppu.SetRenderSuppressed(false);
+
+    netplayStats_.Store(netplay_.GetStats());
+    return;
+  }
+
+  if (isRewinding_ && rewindFrameInterval_ > 0 && !isRecordingMovie_) {
+    RewindFrame(present);
+    return;
+  }
+
+  // update joypad key states for the frame that we are about to process. this
+  // happens once per frame so that recorded movies can replay it exactly
+  gbc_.GetHardware().joypad.CommitKeyStates();
+
+  // when running ahead, the picture comes from the frames emulated ahead
+  ppu.SetRenderSuppressed(!present || runAheadFrames_ > 0);
+  if (timeNextUpdateFrame_) {
+    gbc_.UpdateFrameTimed(statsWindowUpdateTimes_);
+    timeNextUpdateFrame_ = false;
+    countNextUpdateFrame_ = perfCounters_.HasFastReads();
+  } else if (countNextUpdateFrame_) {
+    gbc_.UpdateFrameCounted(perfCounters_, statsWindowUpdateCounts_);
+    countNextUpdateFrame_ = false;
+    hasStatsWindowUpdateCounts_ = true;
+  } else {
+    gbc_.UpdateFrame();
+  }
+  ppu.SetRenderSuppressed(false);
+
+  if (isRecordingMovie_) {
+    movie_.RecordFrame(gbc_);
+  }
+
+  if (rewindFrameInterval_ > 0
+      && ++framesSinceRewindPush_ >= rewindFrameInterval_) {
+    framesSinceRewindPush_ = 0;
+
+    gbc_.SaveState(frameState_);
+    rewindBuffer_.Push(frameState_);
+    PublishRewindStats();
+  }
+
+  if (present && runAheadFrames_ > 0) {
+    RunAhead();
+  }
+}
+
+void Emulator::RunAhead() {
+  using namespace std::chrono;
+  const auto startTime = steady_clock::now();
+
+  // only the last frame ahead is drawn, and none are heard; the audio of the
+  // real frames is played instead
+  gbc_.RunAhead(runAheadFrames_);
+
+  runAheadCostMicros_ = util::SmoothCost(
+      runAheadCostMicros_,
+      duration<double, std::micro>(steady_clock::now() - startTime).count());
+}
+
+void Emulator::RewindFrame(bool present) {
+  if (!rewindBuffer_.Pop(frameState_)
+      || gbc_.LoadState(frameState_) != StateLoadResult::Ok) {
+    return; // ran out of history; stay on the oldest state
+  }
+
+  framesSinceRewindPush_ = 0;
+  PublishRewindStats();
+  if (!present) {
+    return;
+  }
+
+  // emulate a frame from the popped state so that its picture gets drawn, then
+  // go back to it so that resuming continues from exactly that point.
+  // audio isn't played as it would just be the frame played forwards, nor is
+  // the frame counted towards the stats
+  auto& hw = gbc_.GetHardware();
+  const auto audioOut = hw.apu.GetApuOutput();
+  const auto cpuTotals = hw.cpu.GetTotals();
+
+  hw.apu.SetApuOutput(nullptr);
+  gbc_.UpdateFrame();
+  hw.apu.SetApuOutput(audioOut);
+  hw.cpu.RestoreTotals(cpuTotals);
+
+  gbc_.LoadState(frameState_);
+}
+
+void Emulator::ClearRewindHistory() {
+  rewindBuffer_.Clear();
+  framesSinceRewindPush_ = 0;
+  PublishRewindStats();
+}
+
+void Emulator::PublishRewindStats() {
+  rewindMemoryUsage_ = rewindBuffer_.GetMemoryUsage();
+  rewindHistorySeconds_ = static_cast<float>(rewindBuffer_.GetNumEntries())
+                          * rewindFrameInterval_ * kNormalSpeedCyclesPerFrame
+                          / kNormalSpeedClockRateHz;
+}
+
+void Emulator::PublishCgbMode() {
+  isInCgbMode_ = gbc_.IsInCgbMode();
+}
+
+void Emulator::PushCommand(CommandType type, u8 target, unsigned int value) {
+  const Command command{type, target, value};
+
+  if (!commandQueue_.TryPush(command)) {
+    // the emulation thread has fallen far behind; apply everything ourselves
+    std::unique_lock<std::mutex> lock(emulationMutex_);
+    DrainCommands();
+    ApplyCommand(command);
+    return;
+  }
+
+  // the emulation thread doesn't drain the queue while it isn't running frames
+  if (!isStarted_ || isPaused_) {
+    std::unique_lock<std::mutex> lock(emulationMutex_);
+    DrainCommands();
+  }
 }
 
-void Emulator::EmulateFrame() {
-  while (normalSpeedFrameCycles_ < kNormalSpeedCyclesPerFrame) {
-    // don't scale the amount of cycles left with CPU double speed mode
-    const auto cycles = util::RescaleCycles(gbc_.GetHardware().cpu,
-                                            gbc_.Update());
-    normalSpeedFrameCycles_ += cycles;
+void Emulator::DrainCommands() {
+  Command command;
+  while (commandQueue_.TryPop(command)) {
+    ApplyCommand(command);
   }
+}
 
-  normalSpeedFrameCycles_ -= kNormalSpeedCyclesPerFrame;
+void Emulator::ApplyCommand(const Command& command) {
+  auto& hw = gbc_.GetHardware();
+  const bool val = command.value != 0;
+
+  switch (command.type) {
+    case CommandType::JoypadKeyState:
+      hw.joypad.SetKeyState(static_cast<JoypadKey>(command.target), val);
+      break;
+    case CommandType::JoypadImpossibleInputsAllowed:
+      hw.joypad.SetImpossibleInputsAllowed(val);
+      break;
+
+    case CommandType::ApuMuteChannel:
+      switch (command.target) {
+        case 1:
+          hw.apu.SetMuteCh1(val);
+          break;
+        case 2:
+          hw.apu.SetMuteCh2(val);
+          break;
+        case 3:
+          hw.apu.SetMuteCh3(val);
+          break;
+        case 4:
+          hw.apu.SetMuteCh4(val);
+          break;
+      }
+      break;
+
+    case CommandType::VideoScanlineSpritesLimiterEnabled:
+      hw.ppu.SetScanlineSpritesLimiterEnabled(val);
+      break;
+    case CommandType::VideoBgRenderEnabled:
+      hw.ppu.SetBgRenderEnabled(val);
+      break;
+    case CommandType::VideoBgWindowRenderEnabled:
+      hw.ppu.SetBgWindowRenderEnabled(val);
+      break;
+    case CommandType::VideoSpritesRenderEnabled:
+      hw.ppu.SetSpritesRenderEnabled(val);
+      break;
+
+    case CommandType::RunAheadFrames:
+      runAheadFrames_ = command.value;
+      runAheadCostMicros_ = 0.0;
+      break;
+  }
 }
 
 void Emulator::PauseUntilNotify() {
@@ -161,6 +646,51 @@ bool Emulator::ImportCartridgeBatteryExtRam(const std::string& filePath) {
   return success;
 }
 
+bool Emulator::SaveState(std::vector<u8>& outData) const {
+  if (!gbc_.GetHardware().cartridge.IsRomLoaded()) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(emulationMutex_);
+  gbc_.SaveState(outData);
+  return true;
+}
+
+StateLoadResult Emulator::LoadState(const std::vector<u8>& data) {
+  std::unique_lock<std::mutex> lock(emulationMutex_);
+
+  const auto result = gbc_.LoadState(data);
+  if (result == StateLoadResult::Ok) {
+    PublishCgbMode();
+    ClearRewindHistory();
+    FinishMovieRecording();
+    FinishNetplay();
+  }
+
+  return result;
+}
+
+bool Emulator::SaveStateFile(const std::string& filePath) const {
+  std::vector<u8> data;
+  if (!SaveState(data)) {
+    return false;
+  }
+
+  std::ofstream file(filePath, std::ios::binary);
+  return util::WriteBinaryStream(file, data);
+}
+
+StateLoadResult Emulator::LoadStateFile(const std::string& filePath) {
+  std::vector<u8> data;
+
+  std::ifstream file(filePath, std::ios::binary);
+  if (!util::ReadBinaryStream(file, data)) {
+    return StateLoadResult::ReadError;
+  }
+
+  return LoadState(data);
+}
+
 bool Emulator::IsCartridgeRomLoaded() const {
   return gbc_.GetHardware().cartridge.IsRomLoaded();
 }
@@ -172,12 +702,164 @@ const CartridgeExtMeta& Emulator::GetCartridgeExtMeta() const {
 void Emulator::Reset(bool forceDmgMode) {
   if (gbc_.GetHardware().cartridge.IsRomLoaded()) {
     std::unique_lock<std::mutex> lock(emulationMutex_);
-
-    normalSpeedFrameCycles_ = 0;
     gbc_.Reset(forceDmgMode);
+    PublishCgbMode();
+    ClearRewindHistory();
+    FinishMovieRecording();
+    FinishNetplay();
   }
 }
 
+void Emulator::SetRewindConfig(unsigned int historySeconds,
+                               std::size_t maxMemoryBytes,
+                               unsigned int frameInterval) {
+  std::unique_lock<std::mutex> lock(emulationMutex_);
+
+  rewindFrameInterval_ = frameInterval;
+  if (rewindFrameInterval_ == 0) {
+    ClearRewindHistory();
+  }
+
+  const auto maxEntries = frameInterval > 0
+      ? static_cast<std::size_t>(u64(historySeconds) * kNormalSpeedClockRateHz
+                                 / (u64(kNormalSpeedCyclesPerFrame)
+                                    * frameInterval))
+      : 0;
+
+  rewindBuffer_.SetLimits(maxEntries, maxMemoryBytes);
+  isRewindEnabled_ = rewindFrameInterval_ > 0;
+  PublishRewindStats();
+}
+
+bool Emulator::IsRewindEnabled() const {
+  return isRewindEnabled_;
+}
+
+void Emulator::SetRewinding(bool val) {
+  isRewinding_ = val;
+}
+
+bool Emulator::IsRewinding() const {
+  return isRewinding_;
+}
+
+void Emulator::SetRunAheadFrames(unsigned int numFrames) {
+  runAheadFramesSetting_ = numFrames;
+  PushCommand(CommandType::RunAheadFrames, 0, numFrames);
+}
+
+unsigned int Emulator::GetRunAheadFrames() const {
+  return runAheadFramesSetting_;
+}
+
+double Emulator::GetRunAheadCostMicros() const {
+  return runAheadCostMicros_;
+}
+
+EmulatorStats Emulator::GetStats() const {
+  return stats_.Load();
+}
+
+void Emulator::SetPerfCountersEnabled(bool val) {
+  // applied by the emulation thread, as the counters only count the thread
+  // that opens them
+  perfCountersOpenResult_ = PerfCountersOpenResult::Ok;
+  perfCountersEnabled_ = val;
+}
+
+bool Emulator::IsPerfCountersEnabled() const {
+  return perfCountersEnabled_;
+}
+
+PerfCountersOpenResult Emulator::GetPerfCountersOpenResult() const {
+  return perfCountersOpenResult_;
+}
+
+bool Emulator::StartMovieRecording(unsigned int hashInterval) {
+  if (!gbc_.GetHardware().cartridge.IsRomLoaded()) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(emulationMutex_);
+  if (isNetplayActive_) {
+    return false;
+  }
+
+  // the recorded state hashes must not depend on whether audio is playing
+  gbc_.GetHardware().apu.SetLazyModeAllowed(false);
+  movie_.Start(gbc_, hashInterval);
+  isRecordingMovie_ = true;
+  return true;
+}
+
+void Emulator::StopMovieRecording() {
+  std::unique_lock<std::mutex> lock(emulationMutex_);
+  FinishMovieRecording();
+}
+
+void Emulator::FinishMovieRecording() {
+  isRecordingMovie_ = false;
+  gbc_.GetHardware().apu.SetLazyModeAllowed(true);
+}
+
+bool Emulator::IsRecordingMovie() const {
+  return isRecordingMovie_;
+}
+
+bool Emulator::StartNetplay(INetplayTransport& transport,
+                            unsigned int localPlayer) {
+  if (!gbc_.GetHardware().cartridge.IsRomLoaded()) {
+    return false;
+  }
+
+  std::unique_lock<std::mutex> lock(emulationMutex_);
+  FinishMovieRecording();
+
+  // both peers start from a fresh reset so that their states match
+  gbc_.Reset();
+  PublishCgbMode();
+  ClearRewindHistory();
+
+  netplay_.Start(gbc_, transport, localPlayer);
+  netplayStats_.Store(netplay_.GetStats());
+  isNetplayActive_ = true;
+  return true;
+}
+
+void Emulator::StopNetplay() {
+  std::unique_lock<std::mutex> lock(emulationMutex_);
+  FinishNetplay();
+}
+
+void Emulator::FinishNetplay() {
+  if (isNetplayActive_) {
+    isNetplayActive_ = false;
+    netplay_.Stop();
+    gbc_.GetHardware().apu.SetLazyModeAllowed(true);
+  }
+}
+
+bool Emulator::IsNetplayActive() const {
+  return isNetplayActive_;
+}
+
+NetplayStats Emulator::GetNetplayStats() const {
+  return netplayStats_.Load();
+}
+
+bool Emulator::SaveMovieFile(const std::string& filePath) const {
+  std::unique_lock<std::mutex> lock(emulationMutex_);
+  return movie_.SaveFile(filePath);
+}
+
+std::size_t Emulator::GetRewindMemoryUsage() const {
+  return rewindMemoryUsage_;
+}
+
+float Emulator::GetRewindHistorySeconds() const {
+  return rewindHistorySeconds_;
+}
+
 std::string Emulator::GetCartridgeRomFileName() const {
   return gbc_.GetHardware().cartridge.GetRomFileName();
 }
@@ -187,53 +869,52 @@ std::string Emulator::GetCartridgeRomFilePath() const {
 }
 
 void Emulator::SetVideoScanlineSpritesLimiterEnabled(bool val) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().ppu.SetScanlineSpritesLimiterEnabled(val);
+  videoScanlineSpritesLimiterEnabled_ = val;
+  PushCommand(CommandType::VideoScanlineSpritesLimiterEnabled, 0, val);
 }
 
 bool Emulator::IsVideoScanlineSpritesLimiterEnabled() const {
-  return gbc_.GetHardware().ppu.IsScanlineSpritesLimiterEnabled();
+  return videoScanlineSpritesLimiterEnabled_;
 }
 
 void Emulator::SetVideoBgRenderEnabled(bool val) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().ppu.SetBgRenderEnabled(val);
+  videoBgRenderEnabled_ = val;
+  PushCommand(CommandType::VideoBgRenderEnabled, 0, val);
 }
 
 bool Emulator::IsVideoBgRenderEnabled() const {
-  return gbc_.GetHardware().ppu.IsBgRenderEnabled();
+  return videoBgRenderEnabled_;
 }
 
 void Emulator::SetVideoBgWindowRenderEnabled(bool val) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().ppu.SetBgWindowRenderEnabled(val);
+  videoBgWindowRenderEnabled_ = val;
+  PushCommand(CommandType::VideoBgWindowRenderEnabled, 0, val);
 }
 
 bool Emulator::IsVideoBgWindowRenderEnabled() const {
-  return gbc_.GetHardware().ppu.IsBgWindowRenderEnabled();
+  return videoBgWindowRenderEnabled_;
 }
 
 void Emulator::SetVideoSpritesRenderEnabled(bool val) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().ppu.SetSpritesRenderEnabled(val);
+  videoSpritesRenderEnabled_ = val;
+  PushCommand(CommandType::VideoSpritesRenderEnabled, 0, val);
 }
 
 bool Emulator::IsVideoSpritesRenderEnabled() const {
-  return gbc_.GetHardware().ppu.IsSpritesRenderEnabled();
+  return videoSpritesRenderEnabled_;
 }
 
 void Emulator::SetJoypadKeyState(JoypadKey key, bool pressed) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().joypad.SetKeyState(key, pressed);
+  PushCommand(CommandType::JoypadKeyState, static_cast<u8>(key), pressed);
 }
 
 void Emulator::SetJoypadImpossibleInputsAllowed(bool val) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().joypad.SetImpossibleInputsAllowed(val);
+  joypadImpossibleInputsAllowed_ = val;
+  PushCommand(CommandType::JoypadImpossibleInputsAllowed, 0, val);
 }
 
 bool Emulator::AreJoypadImpossibleInputsAllowed() const {
-  return gbc_.GetHardware().joypad.AreImpossibleInputsAllowed();
+  return joypadImpossibleInputsAllowed_;
 }
 
 void Emulator::SetVideoLcd(ILcd* lcd) {
@@ -243,7 +924,10 @@ void Emulator::SetVideoLcd(ILcd* lcd) {
 
 void Emulator::SetApuOutput(IApuOutput* audioOut) {
   std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().apu.SetApuOutput(audioOut);
+
+  // without an output, the APU is left with none so that it can run lazily
+  timeStretchOut_.SetOutput(audioOut);
+  gbc_.GetHardware().apu.SetApuOutput(audioOut ? &timeStretchOut_ : nullptr);
 }
 
 void Emulator::SetPaused(bool val) {
@@ -268,40 +952,56 @@ bool Emulator::IsLimitingFramerate() const {
   return limitFramerate_;
 }
 
+void Emulator::SetFastForwarding(bool val) {
+  isFastForwarding_ = val;
+}
+
+bool Emulator::IsFastForwarding() const {
+  return isFastForwarding_;
+}
+
+void Emulator::SetFastForwardSpeed(unsigned int speed) {
+  fastForwardSpeed_ = speed;
+}
+
+unsigned int Emulator::GetFastForwardSpeed() const {
+  return fastForwardSpeed_;
+}
+
 void Emulator::SetApuMuteCh1(bool val) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().apu.SetMuteCh1(val);
+  apuChMuted_[0] = val;
+  PushCommand(CommandType::ApuMuteChannel, 1, val);
 }
 
 bool Emulator::IsApuCh1Muted() const {
-  return gbc_.GetHardware().apu.IsCh1Muted();
+  return apuChMuted_[0];
 }
 
 void Emulator::SetApuMuteCh2(bool val) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().apu.SetMuteCh2(val);
+  apuChMuted_[1] = val;
+  PushCommand(CommandType::ApuMuteChannel, 2, val);
 }
 
 bool Emulator::IsApuCh2Muted() const {
-  return gbc_.GetHardware().apu.IsCh2Muted();
+  return apuChMuted_[1];
 }
 
 void Emulator::SetApuMuteCh3(bool val) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().apu.SetMuteCh3(val);
+  apuChMuted_[2] = val;
+  PushCommand(CommandType::ApuMuteChannel, 3, val);
 }
 
 bool Emulator::IsApuCh3Muted() const {
-  return gbc_.GetHardware().apu.IsCh3Muted();
+  return apuChMuted_[2];
 }
 
 void Emulator::SetApuMuteCh4(bool val) {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  gbc_.GetHardware().apu.SetMuteCh4(val);
+  apuChMuted_[3] = val;
+  PushCommand(CommandType::ApuMuteChannel, 4, val);
 }
 
 bool Emulator::IsApuCh4Muted() const {
-  return gbc_.GetHardware().apu.IsCh4Muted();
+  return apuChMuted_[3];
 }
 
 bool Emulator::IsStarted() const {
@@ -309,6 +1009,5 @@ bool Emulator::IsStarted() const {
 }
 
 bool Emulator::IsInCgbMode() const {
-  std::unique_lock<std::mutex> lock(emulationMutex_);
-  return gbc_.IsInCgbMode();
+  return isInCgbMode_;
 }
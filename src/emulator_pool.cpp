@@ -0,0 +1,297 @@
+#include "emulator_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <cassert>
+
+#ifdef __linux__
+# include <pthread.h>
+# include <sched.h>
+#endif
+
+EmulatorPool::EmulatorPool(unsigned int numWorkers, bool pinWorkers)
+    : runGeneration_(0), runMaxFrames_(0), numRunningWorkers_(0),
+      isShuttingDown_(false), numActiveInstances_(0), numSteals_(0),
+      stealGeneration_(0), numIdleWorkers_(0) {
+  const auto cores = GetAllowedCores();
+  if (numWorkers == 0) {
+    numWorkers = static_cast<unsigned int>(cores.size());
+  }
+
+  // all workers must exist before any of them start looking for work to steal
+  for (unsigned int i = 0; i < numWorkers; ++i) {
+    workers_.emplace_back(new Worker);
+  }
+
+  for (unsigned int i = 0; i < numWorkers; ++i) {
+    workers_[i]->thread = std::thread(&EmulatorPool::WorkerLoop, this, i);
+
+    if (pinWorkers) {
+      PinThreadToCore(workers_[i]->thread, cores[i % cores.size()]);
+    }
+  }
+}
+
+EmulatorPool::~EmulatorPool() {
+  {
+    std::lock_guard<std::mutex> lock(runMutex_);
+    isShuttingDown_ = true;
+  }
+  runStartCondition_.notify_all();
+
+  for (auto& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+PoolInstanceId EmulatorPool::AddInstance(PoolFrameCallback frameCallback) {
+  const auto id = instances_.size();
+
+  instances_.emplace_back(new Instance);
+  auto& inst = *instances_.back();
+  inst.frameCallback = std::move(frameCallback);
+  inst.id = id;
+  inst.frames = 0;
+
+  return id;
+}
+
+Gbc& EmulatorPool::GetInstance(PoolInstanceId id) {
+  assert(id < instances_.size());
+  return instances_[id]->gbc;
+}
+
+const Gbc& EmulatorPool::GetInstance(PoolInstanceId id) const {
+  assert(id < instances_.size());
+  return instances_[id]->gbc;
+}
+
+u64 EmulatorPool::Run(u64 maxFrames) {
+  if (instances_.empty() || maxFrames == 0) {
+    return 0;
+  }
+
+  // deal the instances out evenly; stealing takes care of any imbalance later
+  for (std::size_t i = 0; i < instances_.size(); ++i) {
+    instances_[i]->frames = 0;
+    PushTask(i % workers_.size(), *instances_[i]);
+  }
+
+  numActiveInstances_ = instances_.size();
+  numSteals_ = 0;
+
+  {
+    std::lock_guard<std::mutex> lock(runMutex_);
+    runMaxFrames_ = maxFrames;
+    numRunningWorkers_ = static_cast<unsigned int>(workers_.size());
+    ++runGeneration_;
+  }
+  runStartCondition_.notify_all();
+
+  {
+    std::unique_lock<std::mutex> lock(runMutex_);
+    runDoneCondition_.wait(lock, [&] { return numRunningWorkers_ == 0; });
+  }
+
+  u64 totalFrames = 0;
+  for (const auto& inst : instances_) {
+    totalFrames += inst->frames;
+  }
+
+  return totalFrames;
+}
+
+u64 EmulatorPool::GetInstanceFrames(PoolInstanceId id) const {
+  assert(id < instances_.size());
+  return instances_[id]->frames;
+}
+
+u64 EmulatorPool::GetNumSteals() const {
+  return numSteals_;
+}
+
+std::size_t EmulatorPool::GetNumInstances() const {
+  return instances_.size();
+}
+
+unsigned int EmulatorPool::GetNumWorkers() const {
+  return static_cast<unsigned int>(workers_.size());
+}
+
+void EmulatorPool::WorkerLoop(unsigned int workerIdx) {
+  trace::SetThreadName("pool worker");
+  u64 seenGeneration = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(runMutex_);
+      runStartCondition_.wait(lock, [&] {
+        return isShuttingDown_ || runGeneration_ != seenGeneration;
+      });
+
+      if (isShuttingDown_) {
+        return;
+      }
+
+      seenGeneration = runGeneration_;
+    }
+
+    // an empty queue doesn't mean that we're done, as an instance that's
+    // currently being stepped by another worker may be requeued afterwards
+    while (numActiveInstances_.load(std::memory_order_acquire) > 0) {
+      auto inst = TryPopTask(workerIdx);
+      if (!inst) {
+        // read before trying to steal, so that a task becoming stealable in
+        // the meantime still wakes us
+        const auto stealGeneration = GetStealGeneration();
+
+        inst = TryStealTask(workerIdx);
+        if (!inst) {
+          WaitForStealableTask(stealGeneration);
+          continue;
+        }
+      }
+
+      RunTask(workerIdx, *inst);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(runMutex_);
+      if (--numRunningWorkers_ == 0) {
+        runDoneCondition_.notify_all();
+      }
+    }
+  }
+}
+
+void EmulatorPool::RunTask(unsigned int workerIdx, Instance& inst) {
+  inst.gbc.UpdateFrame();
+  ++inst.frames;
+
+  const bool keepRunning =
+      (!inst.frameCallback || inst.frameCallback(inst.id, inst.gbc)) &&
+      inst.frames < runMaxFrames_;
+
+  if (keepRunning) {
+    PushTask(workerIdx, inst);
+  } else if (numActiveInstances_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    NotifyIdleWorkers(true); // the run is over
+  }
+}
+
+void EmulatorPool::PushTask(unsigned int workerIdx, Instance& inst) {
+  auto& worker = *workers_[workerIdx];
+  std::size_t queueSize;
+
+  {
+    std::lock_guard<std::mutex> lock(worker.queueMutex);
+    worker.queue.push_back(&inst);
+    queueSize = worker.queue.size();
+  }
+
+  if (queueSize > 1) {
+    NotifyIdleWorkers(false);
+  }
+}
+
+EmulatorPool::Instance* EmulatorPool::TryPopTask(unsigned int workerIdx) {
+  auto& worker = *workers_[workerIdx];
+
+  std::lock_guard<std::mutex> lock(worker.queueMutex);
+  if (worker.queue.empty()) {
+    return nullptr;
+  }
+
+  const auto inst = worker.queue.front();
+  worker.queue.pop_front();
+  return inst;
+}
+
+EmulatorPool::Instance* EmulatorPool::TryStealTask(unsigned int workerIdx) {
+  for (std::size_t i = 1; i < workers_.size(); ++i) {
+    auto& victim = *workers_[(workerIdx + i) % workers_.size()];
+
+    // the victim's next task is left alone, as it will get to that one about
+    // as soon as we could, and stealing it would only move the instance away
+    // from the victim's core
+    std::lock_guard<std::mutex> lock(victim.queueMutex);
+    if (victim.queue.size() < 2) {
+      continue;
+    }
+
+    // take from the back, which the victim would have got to last
+    const auto inst = victim.queue.back();
+    victim.queue.pop_back();
+    numSteals_.fetch_add(1, std::memory_order_relaxed);
+    return inst;
+  }
+
+  return nullptr;
+}
+
+u64 EmulatorPool::GetStealGeneration() {
+  std::lock_guard<std::mutex> lock(idleMutex_);
+  return stealGeneration_;
+}
+
+void EmulatorPool::WaitForStealableTask(u64 seenGeneration) {
+  std::unique_lock<std::mutex> lock(idleMutex_);
+
+  ++numIdleWorkers_;
+  idleCondition_.wait(lock, [&] {
+    return stealGeneration_ != seenGeneration
+           || numActiveInstances_.load(std::memory_order_acquire) == 0;
+  });
+  --numIdleWorkers_;
+}
+
+void EmulatorPool::NotifyIdleWorkers(bool wakeAll) {
+  std::lock_guard<std::mutex> lock(idleMutex_);
+  ++stealGeneration_;
+
+  if (wakeAll) {
+    idleCondition_.notify_all();
+  } else if (numIdleWorkers_ > 0) {
+    idleCondition_.notify_one();
+  }
+}
+
+std::vector<unsigned int> EmulatorPool::GetAllowedCores() {
+  std::vector<unsigned int> cores;
+
+#ifdef __linux__
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+
+  if (sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0) {
+    for (unsigned int core = 0; core < CPU_SETSIZE; ++core) {
+      if (CPU_ISSET(core, &cpuSet)) {
+        cores.push_back(core);
+      }
+    }
+  }
+#endif
+
+  // elsewhere (or if that failed), assume that we may use every core
+  if (cores.empty()) {
+    const auto numCores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int core = 0; core < numCores; ++core) {
+      cores.push_back(core);
+    }
+  }
+
+  return cores;
+}
+
+void EmulatorPool::PinThreadToCore(std::thread& thread, unsigned int core) {
+#ifdef __linux__
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(core, &cpuSet);
+
+  // failure isn't fatal; the worker just runs wherever the OS schedules it
+  pthread_setaffinity_np(thread.native_handle(), sizeof(cpuSet), &cpuSet);
+#else
+  (void)thread;
+  (void)core;
+#endif
+}
@@ -0,0 +1,1061 @@
+#include "headless/headless_runner.h"
+#include "movie.h"
+#include "netplay.h"
+#include "remote_link_cable.h"
+#include "trace.h"
+#include "util.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#include <utility>
+#include <vector>
+
+HeadlessOptions::HeadlessOptions()
+    : forceDmgMode(false), maxFrames(600), hashInterval(0), statsInterval(0),
+      perfCounters(false),
+      hasUntilMem(false), untilMemLoc(0), untilMemVal(0), printSerial(true),
+      audioFormat(FileApuOutputFormat::Wav), audioStems(false),
+      rewindSeconds(0), runAheadFrames(0),
+      movieHashInterval(kMovieDefaultHashInterval), numInstances(1),
+      numWorkers(0), netplayTest(false), netplayLatencyMillis(0),
+      linkCable(false), profileFormat(GuestProfileFormat::Flat) {}
+
+HeadlessRunner::HeadlessRunner(const HeadlessOptions& options,
+                               std::ostream& os)
+    : options_(options), os_(os) {
+  auto& hw = gbc_.GetHardware();
+  hw.ppu.SetLcd(&lcd_);
+  hw.serial.SetSerialOutput(&serial_);
+  // NOTE: with no audio output attached, the APU runs in its cheap lazy mode
+}
+
+int HeadlessRunner::Run() {
+  if (options_.traceFilePath.empty()) {
+    return RunMode();
+  }
+
+  trace::SetThreadName("main");
+  trace::StartRecording();
+  const auto exitCode = RunMode();
+  trace::StopRecording();
+
+  if (!trace::WriteChromeJsonFile(options_.traceFilePath)) {
+    os_ << "failed to write trace file\n";
+    return kHeadlessExitError;
+  }
+
+  const auto numDropped = trace::GetNumDroppedEvents();
+  if (numDropped > 0) {
+    os_ << "trace: " << numDropped << " zones dropped (buffers full)\n";
+  }
+
+  return exitCode;
+}
+
+int HeadlessRunner::RunMode() {
+  using namespace std::chrono;
+
+  if (!options_.verifyMoviePaths.empty()) {
+    return RunVerify();
+  }
+  if (options_.netplayTest) {
+    return RunNetplayTest();
+  }
+  if (options_.linkCable) {
+    return RunLinkCable();
+  }
+  if (!options_.linkLocalPath.empty()) {
+    return RunRemoteLinkCable();
+  }
+  if (options_.numInstances > 1) {
+    return RunPool();
+  }
+
+  const auto loadResult = gbc_.LoadCartridgeRomFile(options_.romFilePath);
+  if (loadResult != RomLoadResult::Ok) {
+    os_ << "failed to load ROM - \""
+        << Cartridge::GetRomLoadResultAsMessage(loadResult) << "\"\n";
+    return kHeadlessExitError;
+  }
+
+  if (options_.forceDmgMode) {
+    gbc_.Reset(true);
+  }
+
+  if (!options_.loadStatePath.empty()) {
+    std::vector<u8> state;
+    std::ifstream file(options_.loadStatePath, std::ios::binary);
+
+    const auto stateResult = util::ReadBinaryStream(file, state)
+                                 ? gbc_.LoadState(state)
+                                 : StateLoadResult::ReadError;
+    if (stateResult != StateLoadResult::Ok) {
+      os_ << "failed to load save state - \""
+          << GetStateLoadResultAsMessage(stateResult) << "\"\n";
+      return kHeadlessExitError;
+    }
+  }
+
+  if (!options_.audioFilePath.empty()) {
+    if (!audioOut_.Open(options_.audioFilePath, options_.audioFormat,
+                        options_.audioStems)) {
+      os_ << "failed to open audio file \"" << options_.audioFilePath
+          << "\"\n";
+      return kHeadlessExitError;
+    }
+
+    gbc_.GetHardware().apu.SetApuOutput(&audioOut_);
+  }
+
+  if (!options_.profileFilePath.empty() && !StartProfiling()) {
+    return kHeadlessExitError;
+  }
+
+  os_ << "rom: " << options_.romFilePath
+      << (gbc_.IsInCgbMode() ? " (CGB mode)\n" : " (DMG mode)\n");
+
+  RewindBuffer rewind;
+  rewind.SetLimits(static_cast<std::size_t>(u64(options_.rewindSeconds)
+                                            * kNormalSpeedClockRateHz
+                                            / kNormalSpeedCyclesPerFrame),
+                   0);
+
+  std::vector<u8> rewindState;
+  duration<double> rewindPushTime(0), runAheadTime(0);
+
+  Movie movie;
+  const bool recordMovie = !options_.recordMoviePath.empty();
+  if (recordMovie) {
+    gbc_.GetHardware().apu.SetLazyModeAllowed(false);
+    movie.Start(gbc_, options_.movieHashInterval);
+  }
+
+  const auto startTime = steady_clock::now();
+
+  u64 frame = 0;
+  bool conditionMet = false;
+
+  auto& ppu = gbc_.GetHardware().ppu;
+
+  if (options_.perfCounters) {
+    const auto openResult = perfCounters_.Open();
+    if (openResult != PerfCountersOpenResult::Ok) {
+      // carry on without them
+      os_ << "not counting hardware events: "
+          << GetPerfCountersOpenResultAsMessage(openResult) << '\n';
+    }
+  }
+
+  StatsWindow statsWindow;
+  StartStatsWindow(statsWindow, frame);
+
+  while (frame < options_.maxFrames) {
+    if (recordMovie) {
+      // replays commit keys before every frame, so do the same here
+      gbc_.GetHardware().joypad.CommitKeyStates();
+    }
+
+    // when running ahead, the picture comes from the frames emulated ahead.
+    // the first frame of each stats window is timed part by part
+    ppu.SetRenderSuppressed(options_.runAheadFrames > 0);
+    if (options_.statsInterval > 0 && frame == statsWindow.startFrame) {
+      gbc_.UpdateFrameTimed(statsWindow.updateTimes);
+    } else {
+      gbc_.UpdateFrame();
+    }
+    ppu.SetRenderSuppressed(false);
+    ++frame;
+
+    if (recordMovie) {
+      movie.RecordFrame(gbc_);
+    }
+
+    if (options_.runAheadFrames > 0) {
+      const auto runAheadStartTime = steady_clock::now();
+      gbc_.RunAhead(options_.runAheadFrames);
+      runAheadTime += steady_clock::now() - runAheadStartTime;
+    }
+
+    if (options_.rewindSeconds > 0) {
+      const auto pushStartTime = steady_clock::now();
+      gbc_.SaveState(rewindState);
+      rewind.Push(rewindState);
+      rewindPushTime += steady_clock::now() - pushStartTime;
+    }
+
+    if (options_.hashInterval > 0 && frame % options_.hashInterval == 0) {
+      PrintFrameHash(frame);
+    }
+
+    if (options_.statsInterval > 0 && frame % options_.statsInterval == 0) {
+      PrintRuntimeStats(statsWindow, frame);
+      StartStatsWindow(statsWindow, frame);
+    }
+
+    if (HasStopCondition() && IsStopConditionMet(gbc_, serial_)) {
+      conditionMet = true;
+      break;
+    }
+  }
+
+  const auto hostSeconds = duration<double>(steady_clock::now()
+                                            - startTime).count();
+
+  gbc_.GetHardware().apu.SetApuOutput(nullptr);
+  audioOut_.Close();
+  gbc_.SetGuestProfiler(nullptr);
+
+  if (!options_.saveStatePath.empty()) {
+    std::vector<u8> state;
+    gbc_.SaveState(state);
+
+    std::ofstream file(options_.saveStatePath, std::ios::binary);
+    if (!util::WriteBinaryStream(file, state)) {
+      os_ << "failed to write save state \"" << options_.saveStatePath
+          << "\"\n";
+      return kHeadlessExitError;
+    }
+  }
+
+  if (recordMovie && !movie.SaveFile(options_.recordMoviePath)) {
+    os_ << "failed to write movie \"" << options_.recordMoviePath << "\"\n";
+    return kHeadlessExitError;
+  }
+
+  if (options_.hashInterval == 0 || frame % options_.hashInterval != 0) {
+    PrintFrameHash(frame);
+  }
+
+  if (options_.printSerial) {
+    PrintSerialOutput(serial_);
+  }
+
+  if (HasStopCondition()) {
+    os_ << (conditionMet ? "result: condition met at frame "
+                         : "result: condition not met after frame ")
+        << frame << '\n';
+  }
+
+  PrintStats(frame, hostSeconds);
+
+  if (!options_.profileFilePath.empty() && !WriteProfile()) {
+    return kHeadlessExitError;
+  }
+
+  if (options_.runAheadFrames > 0 && frame > 0) {
+    const auto flags = os_.flags();
+    os_ << std::fixed << std::setprecision(2)
+        << "run-ahead: " << options_.runAheadFrames << " frames  cost: "
+        << runAheadTime.count() * 1e6 / frame << "us/frame\n";
+    os_.flags(flags);
+  }
+
+  if (options_.rewindSeconds > 0 &&
+      !RewindAndPrintStats(rewind, frame, rewindPushTime.count())) {
+    return kHeadlessExitError;
+  }
+
+  if (!options_.audioFilePath.empty() && audioOut_.GetDroppedSamples() > 0) {
+    os_ << "warning: " << audioOut_.GetDroppedSamples()
+        << " audio samples dropped\n";
+  }
+
+  return !HasStopCondition() || conditionMet ? kHeadlessExitOk
+                                             : kHeadlessExitConditionNotMet;
+}
+
+int HeadlessRunner::RunPool() {
+  using namespace std::chrono;
+
+  // each instance gets its own outputs, written only by whichever worker is
+  // stepping it at the time
+  struct InstanceOutputs {
+    BufferLcd lcd;
+    SerialBuffer serial;
+    bool conditionMet;
+
+    InstanceOutputs() : conditionMet(false) {}
+  };
+
+  EmulatorPool pool(options_.numWorkers);
+  std::vector<std::unique_ptr<InstanceOutputs>> outputs;
+
+  for (unsigned int i = 0; i < options_.numInstances; ++i) {
+    outputs.emplace_back(new InstanceOutputs);
+    auto& out = *outputs.back();
+
+    const auto id = pool.AddInstance([this, &out](PoolInstanceId, Gbc& gbc) {
+      if (HasStopCondition() && IsStopConditionMet(gbc, out.serial)) {
+        out.conditionMet = true;
+        return false;
+      }
+
+      return true;
+    });
+
+    auto& gbc = pool.GetInstance(id);
+    gbc.GetHardware().ppu.SetLcd(&out.lcd);
+    gbc.GetHardware().serial.SetSerialOutput(&out.serial);
+
+    const auto loadResult = gbc.LoadCartridgeRomFile(options_.romFilePath);
+    if (loadResult != RomLoadResult::Ok) {
+      os_ << "failed to load ROM - \""
+          << Cartridge::GetRomLoadResultAsMessage(loadResult) << "\"\n";
+      return kHeadlessExitError;
+    }
+
+    if (options_.forceDmgMode) {
+      gbc.Reset(true);
+    }
+  }
+
+  os_ << "rom: " << options_.romFilePath
+      << (pool.GetInstance(0).IsInCgbMode() ? " (CGB mode)" : " (DMG mode)")
+      << " x" << pool.GetNumInstances() << " instances on "
+      << pool.GetNumWorkers() << " workers\n";
+
+  const auto startTime = steady_clock::now();
+  const auto totalFrames = pool.Run(options_.maxFrames);
+  const auto hostSeconds = duration<double>(steady_clock::now()
+                                            - startTime).count();
+
+  // instances running the same ROM normally end up on the same frame, so only
+  // print each distinct final frame hash once
+  std::vector<std::pair<u64, unsigned int>> hashCounts;
+  for (const auto& out : outputs) {
+    const auto hash = out->lcd.CalculateFrameHash();
+    const auto it = std::find_if(hashCounts.begin(), hashCounts.end(),
+                                 [hash](const std::pair<u64, unsigned int>& p) {
+                                   return p.first == hash;
+                                 });
+
+    if (it != hashCounts.end()) {
+      ++it->second;
+    } else {
+      hashCounts.emplace_back(hash, 1);
+    }
+  }
+
+  const auto flags = os_.flags();
+  for (const auto& hashCount : hashCounts) {
+    os_ << "hash " << std::hex << std::setfill('0') << std::setw(16)
+        << hashCount.first << std::dec << " x" << hashCount.second << '\n';
+  }
+  os_.flags(flags);
+
+  if (options_.printSerial) {
+    PrintSerialOutput(outputs.front()->serial);
+  }
+
+  const auto numConditionMet = std::count_if(
+      outputs.begin(), outputs.end(),
+      [](const std::unique_ptr<InstanceOutputs>& out) {
+        return out->conditionMet;
+      });
+
+  if (HasStopCondition()) {
+    os_ << "result: condition met by " << numConditionMet << " of "
+        << outputs.size() << " instances\n";
+  }
+
+  PrintStats(totalFrames, hostSeconds);
+  os_ << "steals: " << pool.GetNumSteals() << '\n';
+
+  return !HasStopCondition() ||
+         static_cast<std::size_t>(numConditionMet) == outputs.size()
+             ? kHeadlessExitOk : kHeadlessExitConditionNotMet;
+}
+
+int HeadlessRunner::RunVerify() {
+  using namespace std::chrono;
+
+  // load every ROM up front so that each movie can find its own by hash
+  std::vector<std::string> romFilePaths{options_.romFilePath};
+  romFilePaths.insert(romFilePaths.end(), options_.extraRomFilePaths.begin(),
+                      options_.extraRomFilePaths.end());
+
+  std::vector<std::pair<u64, std::vector<u8>>> roms;
+  for (const auto& path : romFilePaths) {
+    std::vector<u8> data;
+    std::ifstream file(path, std::ios::binary);
+
+    if (!util::ReadBinaryStream(file, data)) {
+      os_ << "failed to read ROM \"" << path << "\"\n";
+      return kHeadlessExitError;
+    }
+
+    const auto hash = util::HashFnv1a64(data.data(), data.size());
+    roms.emplace_back(hash, std::move(data));
+  }
+
+  struct MovieReplay {
+    std::string path;
+    Movie movie;
+    std::unique_ptr<MoviePlayer> player;
+    bool failed;
+
+    MovieReplay() : failed(false) {}
+  };
+
+  EmulatorPool pool(options_.numWorkers);
+  std::vector<std::unique_ptr<MovieReplay>> replays;
+  u64 maxFrames = 0;
+  bool hadError = false;
+
+  for (const auto& path : options_.verifyMoviePaths) {
+    replays.emplace_back(new MovieReplay);
+    auto& replay = *replays.back();
+    replay.path = path;
+    replay.failed = true;
+
+    const auto movieResult = replay.movie.LoadFile(path);
+    if (movieResult != MovieLoadResult::Ok) {
+      os_ << "movie " << path << ": failed to load - \""
+          << Movie::GetMovieLoadResultAsMessage(movieResult) << "\"\n";
+      hadError = true;
+      continue;
+    }
+
+    const auto romIt = std::find_if(
+        roms.begin(), roms.end(),
+        [&replay](const std::pair<u64, std::vector<u8>>& rom) {
+          return rom.first == replay.movie.GetRomHash();
+        });
+
+    if (romIt == roms.end()) {
+      os_ << "movie " << path << ": none of the given ROMs match\n";
+      hadError = true;
+      continue;
+    }
+
+    if (replay.movie.GetNumFrames() == 0) {
+      replay.failed = false;
+      continue; // nothing to replay
+    }
+
+    // instances can't be removed from the pool, so one that fails to start
+    // just stops after its first frame
+    replay.player.reset(new MoviePlayer(replay.movie));
+    const auto id = pool.AddInstance([&replay](PoolInstanceId, Gbc& gbc) {
+      return !replay.failed && replay.player->OnFrameEnd(gbc);
+    });
+
+    auto& gbc = pool.GetInstance(id);
+    const auto romResult = gbc.LoadCartridgeRomData(romIt->second);
+    const auto stateResult = romResult == RomLoadResult::Ok
+                                 ? replay.player->Start(gbc)
+                                 : StateLoadResult::NoRom;
+
+    if (stateResult != StateLoadResult::Ok) {
+      os_ << "movie " << path << ": failed to load start state - \""
+          << GetStateLoadResultAsMessage(stateResult) << "\"\n";
+      hadError = true;
+      continue;
+    }
+
+    replay.failed = false;
+    maxFrames = std::max<u64>(maxFrames, replay.movie.GetNumFrames());
+  }
+
+  os_ << "verifying " << pool.GetNumInstances() << " movies on "
+      << pool.GetNumWorkers() << " workers\n";
+
+  const auto startTime = steady_clock::now();
+  const auto totalFrames = pool.Run(maxFrames);
+  const auto hostSeconds = duration<double>(steady_clock::now()
+                                            - startTime).count();
+
+  std::size_t numPassed = 0;
+  bool hadDesync = false;
+
+  for (const auto& replay : replays) {
+    if (replay->failed) {
+      continue;
+    }
+
+    os_ << "movie " << replay->path << ": ";
+
+    if (!replay->player) {
+      os_ << "ok (empty)\n";
+      ++numPassed;
+    } else if (replay->player->HasDesynced()) {
+      os_ << "DESYNC at frame " << replay->player->GetDesyncFrame() << " of "
+          << replay->movie.GetNumFrames() << '\n';
+      hadDesync = true;
+    } else {
+      os_ << "ok (" << replay->player->GetFrame() << " frames)\n";
+      ++numPassed;
+    }
+  }
+
+  os_ << "result: " << numPassed << " of " << replays.size()
+      << " movies verified\n";
+  PrintStats(totalFrames, hostSeconds);
+
+  return hadError ? kHeadlessExitError
+                  : hadDesync ? kHeadlessExitConditionNotMet : kHeadlessExitOk;
+}
+
+int HeadlessRunner::RunNetplayTest() {
+  using namespace std::chrono;
+
+  struct NetplayPeer {
+    Gbc gbc;
+    SocketNetplayTransport socket;
+    std::unique_ptr<LatencyNetplayTransport> transport;
+    RollbackSession session;
+  };
+
+  std::array<std::unique_ptr<NetplayPeer>, 2> peers;
+  for (auto& peer : peers) {
+    peer.reset(new NetplayPeer);
+
+    const auto loadResult = peer->gbc.LoadCartridgeRomFile(
+        options_.romFilePath);
+    if (loadResult != RomLoadResult::Ok) {
+      os_ << "failed to load ROM - \""
+          << Cartridge::GetRomLoadResultAsMessage(loadResult) << "\"\n";
+      return kHeadlessExitError;
+    }
+
+    if (options_.forceDmgMode) {
+      peer->gbc.Reset(true);
+    }
+  }
+
+  if (!SocketNetplayTransport::OpenPair(peers[0]->socket, peers[1]->socket)) {
+    os_ << "failed to open netplay sockets\n";
+    return kHeadlessExitError;
+  }
+
+  const milliseconds latency(options_.netplayLatencyMillis);
+  for (unsigned int i = 0; i < peers.size(); ++i) {
+    auto& peer = *peers[i];
+    peer.transport.reset(new LatencyNetplayTransport(peer.socket, latency));
+    peer.session.Start(peer.gbc, *peer.transport, i);
+  }
+
+  os_ << "rom: " << options_.romFilePath
+      << (peers[0]->gbc.IsInCgbMode() ? " (CGB mode)\n" : " (DMG mode)\n")
+      << "netplay: 2 peers with " << latency.count() << "ms latency\n";
+
+  // each player holds a random set of its own half of the keys, changing every
+  // 16 frames, so that the other peer mispredicts now and again
+  const auto getScriptedKeys = [](unsigned int player, u32 frame) {
+    const u32 seed[] = {player, frame / 16};
+    const auto hash = util::HashFnv1a64(reinterpret_cast<const u8*>(seed),
+                                        sizeof(seed));
+    return static_cast<u8>(hash & (player == 0 ? 0x0f : 0xf0));
+  };
+
+  // the peers must run in real time for the latency to mean anything
+  const duration<double> frameDuration(
+      static_cast<double>(kNormalSpeedCyclesPerFrame)
+      / kNormalSpeedClockRateHz);
+
+  const auto startTime = steady_clock::now();
+  auto nextFrameTime = startTime;
+
+  while (std::min(peers[0]->session.GetStats().numFrames,
+                  peers[1]->session.GetStats().numFrames)
+         < options_.maxFrames) {
+    for (unsigned int i = 0; i < peers.size(); ++i) {
+      auto& peer = *peers[i];
+      if (peer.session.GetStats().numFrames < options_.maxFrames) {
+        peer.session.AdvanceFrame(
+            peer.gbc, getScriptedKeys(i, peer.session.GetStats().numFrames));
+      }
+    }
+
+    nextFrameTime += duration_cast<steady_clock::duration>(frameDuration);
+    std::this_thread::sleep_until(nextFrameTime);
+  }
+
+  // let the last input arrive so that both peers settle on the same state
+  const auto syncDeadline = steady_clock::now() + latency + seconds(1);
+  while (!peers[0]->session.IsSynchronized()
+         || !peers[1]->session.IsSynchronized()) {
+    if (steady_clock::now() > syncDeadline) {
+      break;
+    }
+
+    for (auto& peer : peers) {
+      peer->session.Poll(peer->gbc);
+    }
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+
+  const auto hostSeconds = duration<double>(steady_clock::now()
+                                            - startTime).count();
+
+  std::vector<u8> stateBuffer;
+  std::array<u64, 2> stateHashes;
+  bool isSynchronized = true;
+
+  const auto flags = os_.flags();
+  for (unsigned int i = 0; i < peers.size(); ++i) {
+    auto& peer = *peers[i];
+    const auto& stats = peer.session.GetStats();
+    stateHashes[i] = Movie::CalculateStateHash(peer.gbc, stateBuffer);
+    isSynchronized = isSynchronized && peer.session.IsSynchronized();
+
+    os_ << std::fixed << std::setprecision(1)
+        << "peer " << i << ": rollbacks: " << stats.numRollbacks
+        << "  depth: " << stats.maxRollbackFrames << " max, "
+        << stats.lastRollbackFrames << " last"
+        << "  rollback cost: " << stats.rollbackCostMicros << "us"
+        << "  snapshot cost: " << stats.snapshotCostMicros << "us"
+        << "  stalls: " << stats.numStalls
+        << "  state: " << std::hex << std::setw(16) << std::setfill('0')
+        << stateHashes[i] << std::dec << std::setfill(' ') << '\n';
+  }
+  os_.flags(flags);
+
+  const bool inSync = isSynchronized && stateHashes[0] == stateHashes[1];
+  os_ << "result: " << (inSync ? "peers in sync"
+                               : isSynchronized ? "peers DESYNCED"
+                                                : "peers never synchronized")
+      << '\n';
+  PrintStats(peers[0]->session.GetStats().numFrames, hostSeconds);
+
+  return inSync ? kHeadlessExitOk : kHeadlessExitConditionNotMet;
+}
+
+int HeadlessRunner::RunLinkCable() {
+  using namespace std::chrono;
+
+  Gbc otherGbc;
+  BufferLcd otherLcd;
+  SerialBuffer otherSerial;
+  otherGbc.GetHardware().ppu.SetLcd(&otherLcd);
+  otherGbc.GetHardware().serial.SetSerialOutput(&otherSerial);
+
+  const std::string otherRomFilePath = options_.extraRomFilePaths.empty()
+                                           ? options_.romFilePath
+                                           : options_.extraRomFilePaths[0];
+  const std::array<std::pair<Gbc*, const std::string*>, 2> sides{{
+      {&gbc_, &options_.romFilePath}, {&otherGbc, &otherRomFilePath}}};
+
+  for (const auto& side : sides) {
+    const auto loadResult = side.first->LoadCartridgeRomFile(*side.second);
+    if (loadResult != RomLoadResult::Ok) {
+      os_ << "failed to load ROM \"" << *side.second << "\" - \""
+          << Cartridge::GetRomLoadResultAsMessage(loadResult) << "\"\n";
+      return kHeadlessExitError;
+    }
+
+    if (options_.forceDmgMode) {
+      side.first->Reset(true);
+    }
+
+    os_ << "rom: " << *side.second
+        << (side.first->IsInCgbMode() ? " (CGB mode)\n" : " (DMG mode)\n");
+  }
+
+  LinkCable cable;
+  cable.Connect(gbc_, otherGbc);
+
+  const auto startTime = steady_clock::now();
+
+  u64 frame = 0;
+  bool conditionMet = false;
+
+  while (frame < options_.maxFrames) {
+    cable.UpdateFrame();
+    ++frame;
+
+    if (options_.hashInterval > 0 && frame % options_.hashInterval == 0) {
+      PrintFrameHash(frame);
+    }
+
+    if (HasStopCondition() && IsStopConditionMet(gbc_, serial_)) {
+      conditionMet = true;
+      break;
+    }
+  }
+
+  const auto hostSeconds = duration<double>(steady_clock::now()
+                                            - startTime).count();
+  cable.Disconnect();
+
+  if (options_.hashInterval == 0 || frame % options_.hashInterval != 0) {
+    PrintFrameHash(frame);
+  }
+
+  const auto flags = os_.flags();
+  os_ << "other frame " << frame << " hash " << std::hex << std::setfill('0')
+      << std::setw(16) << otherLcd.CalculateFrameHash() << '\n';
+  os_.flags(flags);
+
+  if (options_.printSerial) {
+    PrintSerialOutput(serial_);
+    PrintSerialOutput(otherSerial);
+  }
+
+  if (HasStopCondition()) {
+    os_ << (conditionMet ? "result: condition met at frame "
+                         : "result: condition not met after frame ")
+        << frame << '\n';
+  }
+
+  PrintStats(frame, hostSeconds);
+
+  const auto& stats = cable.GetStats();
+  const auto totalCycles = stats.batchedCycles + stats.syncedCycles;
+  os_ << std::fixed << std::setprecision(2)
+      << "link: bits exchanged: " << stats.numBitsExchanged
+      << "  cycles in lockstep: "
+      << (totalCycles > 0 ? 100.0 * stats.syncedCycles / totalCycles : 0.0)
+      << "%\n";
+  os_.flags(flags);
+
+  return !HasStopCondition() || conditionMet ? kHeadlessExitOk
+                                             : kHeadlessExitConditionNotMet;
+}
+
+int HeadlessRunner::RunRemoteLinkCable() {
+  using namespace std::chrono;
+
+  const auto loadResult = gbc_.LoadCartridgeRomFile(options_.romFilePath);
+  if (loadResult != RomLoadResult::Ok) {
+    os_ << "failed to load ROM - \""
+        << Cartridge::GetRomLoadResultAsMessage(loadResult) << "\"\n";
+    return kHeadlessExitError;
+  }
+
+  if (options_.forceDmgMode) {
+    gbc_.Reset(true);
+  }
+
+  SocketNetplayTransport transport;
+  if (!transport.Open(options_.linkLocalPath, options_.linkRemotePath)) {
+    os_ << "failed to open link socket \"" << options_.linkLocalPath
+        << "\"\n";
+    return kHeadlessExitError;
+  }
+
+  os_ << "rom: " << options_.romFilePath
+      << (gbc_.IsInCgbMode() ? " (CGB mode)\n" : " (DMG mode)\n");
+
+  RemoteLinkCable cable;
+  cable.Connect(gbc_, transport);
+
+  // give up if the peer goes quiet for this long (it may not have started)
+  constexpr seconds kPeerTimeout(10);
+
+  const auto startTime = steady_clock::now();
+  auto lastProgressTime = startTime;
+
+  u64 frame = 0;
+  bool conditionMet = false;
+
+  while (frame < options_.maxFrames) {
+    if (!cable.UpdateFrame()) {
+      if (steady_clock::now() - lastProgressTime > kPeerTimeout) {
+        os_ << "link peer stopped responding at frame " << frame << '\n';
+        return kHeadlessExitError;
+      }
+
+      std::this_thread::sleep_for(microseconds(100));
+      continue;
+    }
+
+    ++frame;
+    lastProgressTime = steady_clock::now();
+
+    if (options_.hashInterval > 0 && frame % options_.hashInterval == 0) {
+      PrintFrameHash(frame);
+    }
+
+    if (HasStopCondition() && IsStopConditionMet(gbc_, serial_)) {
+      conditionMet = true;
+      break;
+    }
+  }
+
+  // wait for the peer to catch up, rolling back if it changes anything, then
+  // keep answering it for a moment so that it can tell we're done too
+  const auto syncDeadline = steady_clock::now() + kPeerTimeout;
+  while (!cable.IsSynchronized() && steady_clock::now() < syncDeadline) {
+    cable.Poll();
+    std::this_thread::sleep_for(microseconds(100));
+  }
+
+  const bool isSynchronized = cable.IsSynchronized();
+  const auto lingerDeadline = steady_clock::now() + milliseconds(200);
+  while (steady_clock::now() < lingerDeadline) {
+    cable.Poll();
+    std::this_thread::sleep_for(microseconds(100));
+  }
+
+  const auto hostSeconds = duration<double>(steady_clock::now()
+                                            - startTime).count();
+  const auto stats = cable.GetStats();
+  cable.Disconnect();
+
+  if (options_.hashInterval == 0 || frame % options_.hashInterval != 0) {
+    PrintFrameHash(frame);
+  }
+
+  if (options_.printSerial) {
+    PrintSerialOutput(serial_);
+  }
+
+  if (HasStopCondition()) {
+    os_ << (conditionMet ? "result: condition met at frame "
+                         : "result: condition not met after frame ")
+        << frame << '\n';
+  }
+
+  PrintStats(frame, hostSeconds);
+
+  const auto flags = os_.flags();
+  os_ << std::fixed << std::setprecision(1)
+      << "link: transfers: " << stats.numTransfers
+      << "  rollbacks: " << stats.numRollbacks
+      << "  depth: " << stats.maxRollbackCycles << " max, "
+      << stats.lastRollbackCycles << " last cycles"
+      << "  rollback cost: " << stats.rollbackCostMicros << "us"
+      << "  snapshot cost: " << stats.snapshotCostMicros << "us"
+      << "  stalls: " << stats.numStalls << '\n';
+  os_.flags(flags);
+
+  if (!isSynchronized) {
+    os_ << "warning: link peer didn't finish synchronizing\n";
+  }
+  if (stats.numFailedRollbacks > 0) {
+    os_ << "warning: " << stats.numFailedRollbacks
+        << " link rollbacks were too deep\n";
+  }
+
+  return !HasStopCondition() || conditionMet ? kHeadlessExitOk
+                                             : kHeadlessExitConditionNotMet;
+}
+
+bool HeadlessRunner::HasStopCondition() const {
+  return !options_.untilSerial.empty() || options_.hasUntilMem;
+}
+
+bool HeadlessRunner::IsStopConditionMet(const Gbc& gbc,
+                                        const SerialBuffer& serial) const {
+  if (!options_.untilSerial.empty() &&
+      serial.GetData().find(options_.untilSerial) != std::string::npos) {
+    return true;
+  }
+
+  return options_.hasUntilMem &&
+         gbc.GetHardware().mmu.Read8(options_.untilMemLoc)
+         == options_.untilMemVal;
+}
+
+void HeadlessRunner::PrintFrameHash(u64 frame) const {
+  const auto flags = os_.flags();
+  os_ << "frame " << frame << " hash " << std::hex << std::setfill('0')
+      << std::setw(16) << lcd_.CalculateFrameHash() << '\n';
+  os_.flags(flags);
+}
+
+void HeadlessRunner::PrintSerialOutput(const SerialBuffer& serial) const {
+  const auto flags = os_.flags();
+  os_ << "serial: \"";
+
+  // escape anything that isn't printable so the output stays on one line
+  for (const auto c : serial.GetData()) {
+    const auto uc = static_cast<unsigned char>(c);
+
+    if (c == '\n') {
+      os_ << "\\n";
+    } else if (c == '"' || c == '\\') {
+      os_ << '\\' << c;
+    } else if (uc < 0x20 || uc >= 0x7f) {
+      os_ << "\\x" << std::hex << std::setfill('0') << std::setw(2)
+          << static_cast<unsigned int>(uc) << std::dec;
+    } else {
+      os_ << c;
+    }
+  }
+
+  os_ << "\"\n";
+  os_.flags(flags);
+}
+
+bool HeadlessRunner::RewindAndPrintStats(RewindBuffer& rewind, u64 frames,
+                                         double pushSeconds) {
+  using namespace std::chrono;
+
+  const auto numEntries = rewind.GetNumEntries();
+  const auto memoryUsage = rewind.GetMemoryUsage();
+
+  std::vector<u8> rewindState;
+  const auto startTime = steady_clock::now();
+
+  std::size_t numPopped = 0;
+  while (rewind.Pop(rewindState)) {
+    if (gbc_.LoadState(rewindState) != StateLoadResult::Ok) {
+      os_ << "failed to load rewind state " << numPopped << '\n';
+      return false;
+    }
+
+    ++numPopped;
+  }
+
+  const auto popSeconds = duration<double>(steady_clock::now()
+                                           - startTime).count();
+
+  const auto flags = os_.flags();
+  os_ << std::fixed << std::setprecision(1)
+      << "rewind: " << numPopped << " of " << numEntries << " states"
+      << "  memory: " << memoryUsage / 1024.0 << " KiB";
+
+  if (numEntries > 0) {
+    os_ << "  per state: " << static_cast<double>(memoryUsage) / numEntries
+        << " bytes";
+  }
+
+  os_ << std::setprecision(2);
+  if (frames > 0) {
+    os_ << "  push: " << pushSeconds * 1e6 / frames << "us";
+  }
+  if (numPopped > 0) {
+    os_ << "  pop+load: " << popSeconds * 1e6 / numPopped << "us";
+  }
+
+  os_ << '\n';
+  os_.flags(flags);
+
+  return numPopped == numEntries;
+}
+
+bool HeadlessRunner::StartProfiling() {
+  if (!options_.symFilePath.empty()) {
+    const auto symResult = symbols_.LoadSymFile(options_.symFilePath);
+    if (symResult != SymFileLoadResult::Ok) {
+      os_ << "failed to load symbol file - \""
+          << GetSymFileLoadResultAsMessage(symResult) << "\"\n";
+      return false;
+    }
+  }
+
+  profiler_.Clear(gbc_);
+  gbc_.SetGuestProfiler(&profiler_);
+  return true;
+}
+
+bool HeadlessRunner::WriteProfile() const {
+  if (options_.profileFilePath == "-") {
+    os_ << "profile:\n";
+    profiler_.WriteReport(os_, options_.profileFormat, symbols_);
+    return true;
+  }
+
+  if (!profiler_.WriteReportFile(options_.profileFilePath,
+                                 options_.profileFormat, symbols_)) {
+    os_ << "failed to write profile \"" << options_.profileFilePath << "\"\n";
+    return false;
+  }
+
+  return true;
+}
+
+void HeadlessRunner::StartStatsWindow(StatsWindow& window, u64 frame) const {
+  const auto& cpu = gbc_.GetHardware().cpu;
+
+  window.startTime = std::chrono::steady_clock::now();
+  window.startFrame = frame;
+  window.startInstructions = cpu.GetNumInstructions();
+  window.startCycles = cpu.GetNumCycles();
+  window.startIdleCycles = cpu.GetNumIdleCycles();
+  window.updateTimes = {};
+  window.startPerfCounts = perfCounters_.Read();
+}
+
+void HeadlessRunner::PrintRuntimeStats(const StatsWindow& window,
+                                       u64 frame) const {
+  using namespace std::chrono;
+
+  const auto& cpu = gbc_.GetHardware().cpu;
+  const double numFrames = static_cast<double>(frame - window.startFrame);
+  const double hostSeconds = duration<double>(steady_clock::now()
+                                              - window.startTime).count();
+  const double fps = hostSeconds > 0.0 ? numFrames / hostSeconds : 0.0;
+  const auto numCycles = cpu.GetNumCycles() - window.startCycles;
+  const double idlePercent = numCycles > 0
+      ? 100.0 * (cpu.GetNumIdleCycles() - window.startIdleCycles) / numCycles
+      : 0.0;
+
+  // the hardware's share comes from the window's first frame, leaving the
+  // rest of the time per frame (run-ahead, rewind etc.) in other
+  const auto& times = window.updateTimes;
+  const double frameMicros = hostSeconds * 1e6 / numFrames;
+  const double cpuMicros = times.cpuSeconds * 1e6;
+  const double ppuMicros = times.ppuSeconds * 1e6;
+  const double apuMicros = times.apuSeconds * 1e6;
+  const double otherMicros = std::max(0.0, frameMicros - cpuMicros
+                                               - ppuMicros - apuMicros);
+
+  const auto flags = os_.flags();
+  os_ << std::fixed << std::setprecision(1)
+      << "stats: frame " << frame
+      << "  fps: " << fps
+      << "  speed: " << fps * kNormalSpeedCyclesPerFrame
+                        / kNormalSpeedClockRateHz * 100.0 << '%'
+      << "  instructions/s: " << std::setprecision(0)
+      << (cpu.GetNumInstructions() - window.startInstructions) / numFrames * fps
+      << std::setprecision(1) << "  idle: " << idlePercent << '%'
+      << "\n  us/frame: " << frameMicros
+      << "  cpu: " << cpuMicros << "  ppu: " << ppuMicros
+      << "  apu: " << apuMicros << "  other: " << otherMicros;
+
+  if (!options_.audioFilePath.empty()) {
+    os_ << "  audio overruns: " << audioOut_.AudioGetNumOverruns();
+  }
+
+  // these include the window's timed first frame
+  if (perfCounters_.IsOpen()) {
+    const auto counts = perfCounters_.Read() - window.startPerfCounts;
+
+    os_ << "\n  per frame:" << std::setprecision(0);
+    for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+      const auto counter = static_cast<PerfCounter>(i);
+      if (perfCounters_.IsCounting(counter)) {
+        os_ << "  " << GetPerfCounterName(counter) << ": "
+            << counts[i] / numFrames;
+      }
+    }
+
+    if (counts[kPerfCounterCycles] > 0
+        && perfCounters_.IsCounting(kPerfCounterInstructions)) {
+      os_ << std::setprecision(2) << "  instructions/cycle: "
+          << static_cast<double>(counts[kPerfCounterInstructions])
+             / counts[kPerfCounterCycles];
+    }
+  }
+
+  os_ << '\n';
+  os_.flags(flags);
+}
+
+void HeadlessRunner::PrintStats(u64 frames, double hostSeconds) const {
+  const double emulatedSeconds = static_cast<double>(frames)
+                                 * kNormalSpeedCyclesPerFrame
+                                 / kNormalSpeedClockRateHz;
+
+  const auto flags = os_.flags();
+  os_ << std::fixed << std::setprecision(3)
+      << "frames: " << frames
+      << "  emulated: " << emulatedSeconds << "s"
+      << "  host: " << hostSeconds << "s";
+
+  if (hostSeconds > 0.0) {
+    os_ << std::setprecision(1)
+        << "  fps: " << frames / hostSeconds
+        << "  speed: " << emulatedSeconds / hostSeconds * 100.0 << "%";
+  }
+
+  os_ << '\n';
+  os_.flags(flags);
+}
@@ -0,0 +1,280 @@
+#include "headless/headless_runner.h"
+#include "trace.h"
+#include <cstdlib>
+#include <stdexcept>
+#include <iostream>
+#include <string>
+
+namespace {
+  void PrintUsage(const char* programName) {
+    std::cerr
+      << "usage: " << programName << " [options] ROM_PATH\n"
+      << "       " << programName
+      << " --verify MOVIE [--verify MOVIE...] ROM_PATH...\n"
+      << "       " << programName << " --netplay-test MS [options] ROM_PATH\n"
+      << "       " << programName << " --link [options] ROM_PATH [ROM_PATH]\n"
+      << "       " << programName
+      << " --link-socket LOCAL=REMOTE [options] ROM_PATH\n"
+      << "\n"
+      << "options:\n"
+      << "  --frames N          run for at most N frames (default 600)\n"
+      << "  --hash-every N      print the frame buffer hash every N frames\n"
+      << "  --stats-every N     print runtime stats every N frames\n"
+      << "  --perf              include host hardware events counted per\n"
+      << "                      frame in the runtime stats (Linux only)\n"
+      << "  --until-serial STR  stop once the serial output contains STR\n"
+      << "  --until-mem LOC=VAL stop once the byte at LOC equals VAL (hex)\n"
+      << "  --dmg               force DMG mode\n"
+      << "  --no-serial         don't print the serial output\n"
+      << "  --audio-out FILE    record audio to a WAV file\n"
+      << "  --raw-pcm           record raw 16-bit PCM instead of WAV\n"
+      << "  --audio-stems       also record each sound channel separately\n"
+      << "  --load-state FILE   load a save state before running\n"
+      << "  --save-state FILE   write a save state after running\n"
+      << "  --rewind SECONDS    record rewind history every frame, then rewind\n"
+      << "                      through it and report its cost\n"
+      << "  --run-ahead N       run N frames ahead each frame and report the\n"
+      << "                      cost (hashes are of the frame ran ahead)\n"
+      << "  --record-movie FILE record the run's input and state hashes\n"
+      << "  --movie-interval N  hash the state every N frames when recording\n"
+      << "                      a movie (default 60)\n"
+      << "  --verify MOVIE      replay a movie on whichever ROM_PATH it was\n"
+      << "                      recorded with, checking its state hashes. can\n"
+      << "                      be given many times to replay in parallel\n"
+      << "  --instances N       run N copies of the ROM in parallel\n"
+      << "  --threads N         worker threads for --instances and --verify\n"
+      << "                      (default: one per core we may run on)\n"
+      << "  --netplay-test MS   run two rollback netplay peers in real time\n"
+      << "                      with MS of latency between them, then check\n"
+      << "                      that they agree on the state\n"
+      << "  --link              connect a link cable to a second copy of the\n"
+      << "                      ROM (or to the second ROM_PATH, if given)\n"
+      << "  --link-socket LOCAL=REMOTE\n"
+      << "                      connect a link cable to another process over\n"
+      << "                      a unix socket at path LOCAL, sending to its\n"
+      << "                      socket at path REMOTE\n"
+      << "  --trace FILE        record trace zones throughout the run and\n"
+      << "                      write them to FILE as Chrome trace JSON\n"
+      << "  --profile FILE      profile the ROM's code throughout the run and\n"
+      << "                      write a report to FILE (- for stdout)\n"
+      << "  --profile-format F  flat (by function & instruction, default),\n"
+      << "                      tree (call tree) or folded (folded stacks for\n"
+      << "                      flamegraphs)\n"
+      << "  --sym FILE          name profiled locations from an RGBDS .sym\n"
+      << "                      file\n"
+      << "\n"
+      << "exits with 0 if the stop condition was met (or if none was given),\n"
+      << "1 if it wasn't met, or 2 on error\n";
+  }
+
+  bool ParseUnsigned(const std::string& str, u64& outVal, int base = 10) {
+    try {
+      std::size_t endIdx;
+      outVal = std::stoull(str, &endIdx, base);
+      return endIdx == str.size();
+    } catch (const std::exception&) {
+      return false;
+    }
+  }
+
+  bool ParseUntilMem(const std::string& str, HeadlessOptions& options) {
+    const auto sepIdx = str.find('=');
+    if (sepIdx == std::string::npos) {
+      return false;
+    }
+
+    u64 loc, val;
+    if (!ParseUnsigned(str.substr(0, sepIdx), loc, 16) ||
+        !ParseUnsigned(str.substr(sepIdx + 1), val, 16) ||
+        loc > 0xffff || val > 0xff) {
+      return false;
+    }
+
+    options.hasUntilMem = true;
+    options.untilMemLoc = static_cast<u16>(loc);
+    options.untilMemVal = static_cast<u8>(val);
+    return true;
+  }
+
+  bool ParseArgs(int argc, char* argv[], HeadlessOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      u64 val;
+
+      if (arg == "--frames" && hasValue) {
+        if (!ParseUnsigned(argv[++i], options.maxFrames)) {
+          return false;
+        }
+      } else if (arg == "--hash-every" && hasValue) {
+        if (!ParseUnsigned(argv[++i], options.hashInterval)) {
+          return false;
+        }
+      } else if (arg == "--stats-every" && hasValue) {
+        if (!ParseUnsigned(argv[++i], options.statsInterval)) {
+          return false;
+        }
+      } else if (arg == "--trace" && hasValue) {
+        if (!kTraceZonesEnabled) {
+          std::cerr << "trace zones were not compiled in "
+                       "(see SDGBC_ENABLE_TRACING)\n";
+          return false;
+        }
+
+        options.traceFilePath = argv[++i];
+      } else if (arg == "--profile" && hasValue) {
+        options.profileFilePath = argv[++i];
+      } else if (arg == "--profile-format" && hasValue) {
+        const std::string format = argv[++i];
+        if (format == "flat") {
+          options.profileFormat = GuestProfileFormat::Flat;
+        } else if (format == "tree") {
+          options.profileFormat = GuestProfileFormat::Tree;
+        } else if (format == "folded") {
+          options.profileFormat = GuestProfileFormat::Folded;
+        } else {
+          return false;
+        }
+      } else if (arg == "--sym" && hasValue) {
+        options.symFilePath = argv[++i];
+      } else if (arg == "--perf") {
+        options.perfCounters = true;
+      } else if (arg == "--until-serial" && hasValue) {
+        options.untilSerial = argv[++i];
+      } else if (arg == "--until-mem" && hasValue) {
+        if (!ParseUntilMem(argv[++i], options)) {
+          return false;
+        }
+      } else if (arg == "--dmg") {
+        options.forceDmgMode = true;
+      } else if (arg == "--no-serial") {
+        options.printSerial = false;
+      } else if (arg == "--audio-out" && hasValue) {
+        options.audioFilePath = argv[++i];
+      } else if (arg == "--raw-pcm") {
+        options.audioFormat = FileApuOutputFormat::RawPcm;
+      } else if (arg == "--audio-stems") {
+        options.audioStems = true;
+      } else if (arg == "--load-state" && hasValue) {
+        options.loadStatePath = argv[++i];
+      } else if (arg == "--save-state" && hasValue) {
+        options.saveStatePath = argv[++i];
+      } else if (arg == "--rewind" && hasValue) {
+        if (!ParseUnsigned(argv[++i], val) || val == 0 || val > 0xffff) {
+          return false;
+        }
+        options.rewindSeconds = static_cast<unsigned int>(val);
+      } else if (arg == "--run-ahead" && hasValue) {
+        if (!ParseUnsigned(argv[++i], val) || val > 0xff) {
+          return false;
+        }
+        options.runAheadFrames = static_cast<unsigned int>(val);
+      } else if (arg == "--record-movie" && hasValue) {
+        options.recordMoviePath = argv[++i];
+      } else if (arg == "--movie-interval" && hasValue) {
+        if (!ParseUnsigned(argv[++i], val) || val == 0 || val > 0xffffffff) {
+          return false;
+        }
+        options.movieHashInterval = static_cast<unsigned int>(val);
+      } else if (arg == "--verify" && hasValue) {
+        options.verifyMoviePaths.emplace_back(argv[++i]);
+      } else if (arg == "--instances" && hasValue) {
+        if (!ParseUnsigned(argv[++i], val) || val == 0 || val > 0xffff) {
+          return false;
+        }
+        options.numInstances = static_cast<unsigned int>(val);
+      } else if (arg == "--threads" && hasValue) {
+        if (!ParseUnsigned(argv[++i], val) || val > 0xffff) {
+          return false;
+        }
+        options.numWorkers = static_cast<unsigned int>(val);
+      } else if (arg == "--netplay-test" && hasValue) {
+        if (!ParseUnsigned(argv[++i], val) || val > 10000) {
+          return false;
+        }
+        options.netplayTest = true;
+        options.netplayLatencyMillis = static_cast<unsigned int>(val);
+      } else if (arg == "--link") {
+        options.linkCable = true;
+      } else if (arg == "--link-socket" && hasValue) {
+        const std::string paths = argv[++i];
+        const auto sepIdx = paths.find('=');
+        if (sepIdx == std::string::npos || sepIdx == 0 ||
+            sepIdx + 1 == paths.size()) {
+          return false;
+        }
+        options.linkLocalPath = paths.substr(0, sepIdx);
+        options.linkRemotePath = paths.substr(sepIdx + 1);
+      } else if (arg.compare(0, 2, "--") != 0 && options.romFilePath.empty()) {
+        options.romFilePath = arg;
+      } else if (arg.compare(0, 2, "--") != 0) {
+        options.extraRomFilePaths.push_back(arg);
+      } else {
+        return false;
+      }
+    }
+
+    // hardware events are only counted for the runtime stats
+    if (options.perfCounters && options.statsInterval == 0) {
+      return false;
+    }
+
+    // the profiler only follows a single instance running normally
+    if (!options.profileFilePath.empty() &&
+        (options.numInstances > 1 ||
+         !options.verifyMoviePaths.empty() || options.netplayTest ||
+         options.linkCable || !options.linkLocalPath.empty())) {
+      return false;
+    }
+
+    // per-frame hashes and stats, audio recording, save states, rewinding,
+    // run-ahead and movie recording only make sense for a single instance
+    if (options.numInstances > 1 &&
+        (options.hashInterval > 0 || options.statsInterval > 0 ||
+         !options.audioFilePath.empty() ||
+         !options.loadStatePath.empty() || !options.saveStatePath.empty() ||
+         options.rewindSeconds > 0 || options.runAheadFrames > 0 ||
+         !options.recordMoviePath.empty())) {
+      return false;
+    }
+
+    // verifying replays movies with nothing else going on, and only then (or
+    // for the other side of a link cable) can there be more than one ROM
+    if (!options.verifyMoviePaths.empty()
+        ? options.numInstances > 1 || options.hashInterval > 0 ||
+          options.statsInterval > 0 || !options.audioFilePath.empty() || !options.loadStatePath.empty() ||
+          !options.saveStatePath.empty() || options.rewindSeconds > 0 ||
+          options.runAheadFrames > 0 || !options.recordMoviePath.empty()
+        : options.extraRomFilePaths.size() > (options.linkCable ? 1u : 0u)) {
+      return false;
+    }
+
+    // the netplay test and the link cables only support what they report on.
+    // the links' frame hashes are of the first (or local) side
+    const bool hasRemoteLink = !options.linkLocalPath.empty();
+    if ((options.netplayTest || options.linkCable || hasRemoteLink) &&
+        (options.numInstances > 1 || !options.verifyMoviePaths.empty() ||
+         (options.netplayTest && options.hashInterval > 0) ||
+         options.statsInterval > 0 ||
+         !options.audioFilePath.empty() ||
+         !options.loadStatePath.empty() || !options.saveStatePath.empty() ||
+         options.rewindSeconds > 0 || options.runAheadFrames > 0 ||
+         !options.recordMoviePath.empty() ||
+         options.netplayTest + options.linkCable + hasRemoteLink > 1)) {
+      return false;
+    }
+
+    return !options.romFilePath.empty();
+  }
+}
+
+int main(int argc, char* argv[]) {
+  HeadlessOptions options;
+
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage(argv[0]);
+    return kHeadlessExitError;
+  }
+
+  return HeadlessRunner(options).Run();
+}
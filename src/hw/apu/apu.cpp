@@ -1,6 +1,7 @@
 #include "hw/apu/apu.h"
 #include "hw/cpu/cpu.h"
-#include "emulator.h"
+#include "hw/gbc.h"
+#include "hw/state.h"
 #include "util.h"
 #include <cassert>
 #include <limits>
@@ -17,7 +18,8 @@ constexpr auto kCyclesPerBufferedSamples = kNormalSpeedClockRateHz
 
 Apu::Apu(const Cpu& cpu)
     : cpu_(cpu), audioOut_(nullptr),
-      muteCh1_(false), muteCh2_(false), muteCh3_(false), muteCh4_(false) {}
+      muteCh1_(false), muteCh2_(false), muteCh3_(false), muteCh4_(false),
+      lazyModeAllowed_(true) {}
 
 void Apu::Reset() {
   outSampleCycles_ = 0;
@@ -34,6 +36,38 @@ void Apu::Reset() {
   ch4_.Reset();
 }
 
+void Apu::SaveState(StateWriter& writer) const {
+  // NOTE: the channel mute settings belong to the user rather than the
+  // emulated hardware, so they aren't saved
+  writer.Write32(outSampleCycles_);
+  writer.Write32(frameSeqCycles_);
+  writer.Write32(frameSeqStep_);
+
+  writer.Write8(channelCtrl_);
+  writer.Write8(outCtrl_);
+  writer.WriteBool(soundOn_);
+
+  ch1_.SaveState(writer);
+  ch2_.SaveState(writer);
+  ch3_.SaveState(writer);
+  ch4_.SaveState(writer);
+}
+
+void Apu::LoadState(StateReader& reader) {
+  outSampleCycles_ = reader.Read32InRange(0, kCyclesPerBufferedSamples - 1);
+  frameSeqCycles_ = reader.Read32InRange(0, kFrameSeqUpdateTotalCycles - 1);
+  frameSeqStep_ = reader.Read32InRange(0, 7);
+
+  channelCtrl_ = reader.Read8();
+  outCtrl_ = reader.Read8();
+  soundOn_ = reader.ReadBool();
+
+  ch1_.LoadState(reader);
+  ch2_.LoadState(reader);
+  ch3_.LoadState(reader);
+  ch4_.LoadState(reader);
+}
+
 void Apu::Update(unsigned int cycles) {
   if (!soundOn_) {
     return;
@@ -42,6 +76,15 @@ void Apu::Update(unsigned int cycles) {
   // APU speed does not scale with double speed mode
   cycles = util::RescaleCycles(cpu_, cycles);
 
+  if (IsInLazyMode()) {
+    // nothing is listening to our output, so don't bother generating waveforms
+    // or mixing. only the frame sequencer affects register-visible state
+    // (length counters, envelopes, sweep & NR52 status bits), so we only need
+    // to step that in bulk
+    UpdateFrameSequencer(cycles);
+    return;
+  }
+
   for (auto i = 0u; i < cycles; ++i) {
     UpdateFrameSequencerCycle();
 
@@ -50,25 +93,57 @@ void Apu::Update(unsigned int cycles) {
     ch3_.UpdateFrequencyTimer();
     ch4_.UpdateFrequencyTimer();
 
-    // check if it's time to buffer more samples before continuing the update
+    // check if it's time to buffer more samples before continuing the update.
+    // there may be nobody to buffer them for if lazy mode isn't allowed
     if (++outSampleCycles_ >= kCyclesPerBufferedSamples) {
       outSampleCycles_ -= kCyclesPerBufferedSamples;
 
-      if (audioOut_ && !audioOut_->AudioIsMuted()) {
-        const auto samples = MixChannels();
-        audioOut_->AudioBufferSamples(samples.first, samples.second);
+      if (!audioOut_ || audioOut_->AudioIsMuted()) {
+        continue;
+      }
+
+      const auto volumes = CalculateChannelVolumes();
+      if (audioOut_->AudioWantsChannelVolumes()) {
+        audioOut_->AudioBufferChannelVolumes(volumes);
       }
+
+      const auto samples = MixChannels(volumes);
+      audioOut_->AudioBufferSamples(samples.first, samples.second);
     }
   }
 }
 
+bool Apu::IsInLazyMode() const {
+  return lazyModeAllowed_ && (!audioOut_ || audioOut_->AudioIsMuted());
+}
+
+void Apu::SetLazyModeAllowed(bool val) {
+  lazyModeAllowed_ = val;
+}
+
+bool Apu::IsLazyModeAllowed() const {
+  return lazyModeAllowed_;
+}
+
+void Apu::UpdateFrameSequencer(unsigned int cycles) {
+  frameSeqCycles_ += cycles;
+
+  while (frameSeqCycles_ >= kFrameSeqUpdateTotalCycles) {
+    frameSeqCycles_ -= kFrameSeqUpdateTotalCycles;
+    StepFrameSequencer();
+  }
+}
+
 void Apu::UpdateFrameSequencerCycle() {
   if (++frameSeqCycles_ < kFrameSeqUpdateTotalCycles) {
     return; // not time to update the frame seq yet
   }
 
   frameSeqCycles_ -= kFrameSeqUpdateTotalCycles;
+  StepFrameSequencer();
+}
 
+void Apu::StepFrameSequencer() {
   if (frameSeqStep_ % 2 == 0) {
     // clock 256 Hz length control (ch1-4)
     ch1_.UpdateLengthCounter();
@@ -93,7 +168,12 @@ void Apu::UpdateFrameSequencerCycle() {
   }
 }
 
-std::pair<i16, i16> Apu::MixChannels() const {
+ApuChannelVolumes Apu::CalculateChannelVolumes() const {
+  return {{ch1_.CalculateDacOutputVolume(), ch2_.CalculateDacOutputVolume(),
+           ch3_.CalculateDacOutputVolume(), ch4_.CalculateDacOutputVolume()}};
+}
+
+std::pair<i16, i16> Apu::MixChannels(const ApuChannelVolumes& volumes) const {
   i16 left = 0, right = 0;
 
   // mix the output volumes of the APU sound channels
@@ -101,22 +181,22 @@ std::pair<i16, i16> Apu::MixChannels() const {
     u8 vol;
 
     // mix ch1
-    vol = muteCh1_ ? 0 : ch1_.CalculateDacOutputVolume();
+    vol = muteCh1_ ? 0 : volumes[0];
     left  += outCtrl_ & 0x10 ? vol : 0;
     right += outCtrl_ & 0x01 ? vol : 0;
 
     // mix ch2
-    vol = muteCh2_ ? 0 : ch2_.CalculateDacOutputVolume();
+    vol = muteCh2_ ? 0 : volumes[1];
     left  += outCtrl_ & 0x20 ? vol : 0;
     right += outCtrl_ & 0x02 ? vol : 0;
 
     // mix ch3
-    vol = muteCh3_ ? 0 : ch3_.CalculateDacOutputVolume();
+    vol = muteCh3_ ? 0 : volumes[2];
     left  += outCtrl_ & 0x40 ? vol : 0;
     right += outCtrl_ & 0x04 ? vol : 0;
 
     // mix ch4
-    vol = muteCh4_ ? 0 : ch4_.CalculateDacOutputVolume();
+    vol = muteCh4_ ? 0 : volumes[3];
     left  += outCtrl_ & 0x80 ? vol : 0;
     right += outCtrl_ & 0x08 ? vol : 0;
   }
@@ -421,3 +501,7 @@ bool Apu::IsCh4Muted() const {
 void Apu::SetApuOutput(IApuOutput* audioOut) {
   audioOut_ = audioOut;
 }
+
+IApuOutput* Apu::GetApuOutput() const {
+  return audioOut_;
+}
@@ -16,6 +16,20 @@ void ApuNoiseChannel::Restart() {
   linearShift_ = 0x7fff;
 }
 
+void ApuNoiseChannel::SaveState(StateWriter& writer) const {
+  ApuEnvelopeChannelBase::SaveState(writer);
+
+  writer.Write8(polyCtrl_);
+  writer.Write16(linearShift_);
+}
+
+void ApuNoiseChannel::LoadState(StateReader& reader) {
+  ApuEnvelopeChannelBase::LoadState(reader);
+
+  polyCtrl_ = reader.Read8();
+  linearShift_ = reader.Read16InRange(0, 0x7fff); // 15-bit LFSR
+}
+
 void ApuNoiseChannel::UpdateFrequency() {
   // generate a 15-bit pseudo-random bit sequence using the linear feedback
   // shift register (LSFR):
@@ -1,59 +1,7 @@
 #include "hw/apu/apu_chan_square.h"
-#include "util.h"
-
-constexpr std::array<u8, 4> kSquareDutyWaveforms {
-  0b00000001,
-  0b10000001,
-  0b10000111,
-  0b01111110
-};
-
-void ApuSquareChannel::Reset() {
-  ApuEnvelopeChannelBase::Reset();
-
-  freqLoad_ = 0x0000;
-  dutyNum_ = dutyBitIdxCounter_ = 0;
-}
-
-void ApuSquareChannel::ResetDutyCounter() {
-  dutyBitIdxCounter_ = 0;
-}
-
-void ApuSquareChannel::UpdateFrequency() {
-  // increment the duty bit pos
-  dutyBitIdxCounter_ = (dutyBitIdxCounter_ + 1) % 8;
-}
-
-u8 ApuSquareChannel::CalculateOutputVolume() const {
-  // output envelope volume if the selected bit of the duty waveform is set
-  const u8 duty = kSquareDutyWaveforms[dutyNum_];
-  return (1 << dutyBitIdxCounter_) & duty ? envVolume_ : 0;
-}
-
-u16 ApuSquareChannel::GetFrequencyTimerPeriod() const {
-  return ((kApuChannelMaxFreqLoad + 1) - freqLoad_) * 4;
-}
-
-void ApuSquareChannel::SetLengthLoadDutyCtrl(u8 val) {
-  dutyNum_ = (val >> 6) & 3; // duty number is bits 6-7
-  ResetLengthCounter(val & 0x3f); // load value is bits 0-5
-}
-
-u8 ApuSquareChannel::GetLengthLoadDutyCtrl() const {
-  return (dutyNum_ << 6) | 0x3f; // only duty number readable (bits 6-7)
-}
-
-void ApuSquareChannel::SetFreqLoadLo(u8 val) {
-  freqLoad_ = util::SetLo8(freqLoad_, val);
-}
-
-void ApuSquareChannel::SetLengthCtrlFreqLoadHi(u8 val) {
-  freqLoad_ = util::SetHi8(freqLoad_, val & 7); // bits 0-2 freq MSB
-  SetLengthCtrl(val);
-}
 
 void ApuSquareSweepChannel::Reset() {
-  ApuSquareChannel::Reset();
+  ApuSquareChannelBase::Reset();
 
   // sweep channel starts enabled (with DAC on), with duty number 2
   enabled_ = true;
@@ -66,7 +14,7 @@ void ApuSquareSweepChannel::Reset() {
 }
 
 void ApuSquareSweepChannel::Restart() {
-  ApuSquareChannel::Restart();
+  ApuSquareChannelBase::Restart();
 
   ResetSweepShadowFrequency();
   sweepEnabled_ = ResetSweepTimer() > 0 || GetSweepShift() > 0;
@@ -77,6 +25,24 @@ void ApuSquareSweepChannel::Restart() {
   }
 }
 
+void ApuSquareSweepChannel::SaveState(StateWriter& writer) const {
+  ApuSquareChannelBase::SaveState(writer);
+
+  writer.Write8(sweepTimer_);
+  writer.Write16(sweepShadow_);
+  writer.WriteBool(sweepEnabled_);
+  writer.Write8(sweepCtrl_);
+}
+
+void ApuSquareSweepChannel::LoadState(StateReader& reader) {
+  ApuSquareChannelBase::LoadState(reader);
+
+  sweepTimer_ = reader.Read8();
+  sweepShadow_ = reader.Read16();
+  sweepEnabled_ = reader.ReadBool();
+  sweepCtrl_ = reader.Read8();
+}
+
 void ApuSquareSweepChannel::UpdateSweep() {
   if (--sweepTimer_ <= 0 && ResetSweepTimer() > 0 && sweepEnabled_) {
     const u16 newFreq = CalculateNewSweepFreq();
@@ -21,6 +21,28 @@ void ApuWaveChannel::Restart() {
   sampleIdxCounter_ = 0;
 }
 
+void ApuWaveChannel::SaveState(StateWriter& writer) const {
+  ApuSoundChannelBase::SaveState(writer);
+
+  writer.Write16(freqLoad_);
+  writer.Write8(volumeCode_);
+
+  writer.WriteBytes(waveRam_);
+  writer.Write8(waveRamLastWrittenVal_);
+  writer.Write8(sampleIdxCounter_);
+}
+
+void ApuWaveChannel::LoadState(StateReader& reader) {
+  ApuSoundChannelBase::LoadState(reader);
+
+  freqLoad_ = reader.Read16();
+  volumeCode_ = reader.Read8InRange(0, 3);
+
+  reader.ReadBytes(waveRam_);
+  waveRamLastWrittenVal_ = reader.Read8();
+  sampleIdxCounter_ = reader.Read8InRange(0, waveRam_.size() * 2 - 1);
+}
+
 void ApuWaveChannel::UpdateFrequency() {
   // increment the sample index counter.
   // sample is 4 bits, so wave RAM has (2 * (size of wave RAM bytes)) samples
@@ -4,6 +4,7 @@
 #include "hw/cart/cart_ext_mbc2.h"
 #include "hw/cart/cart_ext_mbc3.h"
 #include "hw/cart/cart_ext_mbc5.h"
+#include "hw/state.h"
 #include "util.h"
 #include <cassert>
 #include <fstream>
@@ -47,6 +48,11 @@ bool Cartridge::SaveBatteryExtRam(const std::string& filePath) const {
     return true;
   }
 
+  // ROMs loaded from memory have no path to derive the save file path from
+  if (filePath.empty() && romFilePath_.empty()) {
+    return true;
+  }
+
   std::ofstream file(filePath.empty() ? romFilePath_ + ".sav" : filePath,
                      std::ios::binary);
   return extension_->ExtSaveRam(file);
@@ -57,6 +63,10 @@ bool Cartridge::LoadBatteryExtRam(const std::string& filePath) {
     return true;
   }
 
+  if (filePath.empty() && romFilePath_.empty()) {
+    return true;
+  }
+
   std::ifstream file(filePath.empty() ? romFilePath_ + ".sav" : filePath,
                      std::ios::binary);
   return extension_->ExtLoadRam(file);
@@ -66,6 +76,7 @@ void Cartridge::Clear() {
   Reset();
 
   romData_.clear();
+  romHash_ = 0;
   romFilePath_.clear();
   romFileName_.clear();
 
@@ -84,24 +95,53 @@ void Cartridge::Reset() {
   }
 }
 
+void Cartridge::SaveState(StateWriter& writer) const {
+  if (extension_) {
+    extension_->ExtSaveState(writer);
+  }
+}
+
+void Cartridge::LoadState(StateReader& reader) {
+  if (extension_) {
+    extension_->ExtLoadState(reader);
+  }
+}
+
 RomLoadResult Cartridge::LoadRomFile(const std::string& filePath,
                                      const std::string& fileName) {
+  std::vector<u8> romData;
+
+  std::ifstream file(filePath, std::ios::binary);
+  if (!util::ReadBinaryStream(file, romData)) {
+    return RomLoadResult::ReadError;
+  }
+
+  return LoadRom(std::move(romData), filePath,
+                 fileName.empty() ? filePath : fileName);
+}
+
+RomLoadResult Cartridge::LoadRomData(std::vector<u8> romData,
+                                     const std::string& romName) {
+  return LoadRom(std::move(romData), {}, romName);
+}
+
+RomLoadResult Cartridge::LoadRom(std::vector<u8>&& romData,
+                                 const std::string& filePath,
+                                 const std::string& fileName) {
   {
     // start creating the new cartridge from the ROM data
     Cartridge newCart;
-
-    std::ifstream file(filePath, std::ios::binary);
-    if (!util::ReadBinaryStream(file, newCart.romData_)) {
-      return RomLoadResult::ReadError;
-    }
+    newCart.romData_ = std::move(romData);
 
     const auto parseResult = ParseRomHeader(newCart);
     if (parseResult != RomLoadResult::Ok) {
       return parseResult;
     }
 
+    newCart.romHash_ = util::HashFnv1a64(newCart.romData_.data(),
+                                         newCart.romData_.size());
     newCart.romFilePath_ = filePath;
-    newCart.romFileName_ = fileName.empty() ? filePath : fileName;
+    newCart.romFileName_ = fileName;
     newCart.isRomLoaded_ = true;
 
     // loading successful, move to this new cartridge and re-assign cart ptr
@@ -258,6 +298,22 @@ u8 Cartridge::RamRead8(u16 loc) const {
   return extension_ ? extension_->ExtRamRead8(loc) : 0xff;
 }
 
+const u8* Cartridge::GetRomBank0Data() const {
+  assert(isRomLoaded_);
+  return extension_ ? extension_->ExtGetRomBank0Data() : romData_.data();
+}
+
+const u8* Cartridge::GetRomBankXData() const {
+  assert(isRomLoaded_);
+  return extension_ ? extension_->ExtGetRomBankXData()
+                    : romData_.data() + kRomBankSize;
+}
+
+const u8* Cartridge::GetRamData() const {
+  assert(isRomLoaded_);
+  return extension_ ? extension_->ExtGetRamData() : nullptr;
+}
+
 bool Cartridge::IsRomLoaded() const {
   return isRomLoaded_;
 }
@@ -274,6 +330,10 @@ const std::vector<u8>& Cartridge::GetRomData() const {
   return romData_;
 }
 
+u64 Cartridge::GetRomHash() const {
+  return romHash_;
+}
+
 u16 Cartridge::GetNumRomBanks() const {
   return numRomBanks_;
 }
@@ -1,7 +1,14 @@
 #include "hw/cart/cart.h"
 #include "hw/cart/cart_ext_base.h"
+#include "hw/state.h"
 #include "util.h"
 
+// the widest bank number registers of the supported MBCs (MBC5's). banks are
+// wrapped to the cartridge's size when mapped, so these only reject numbers
+// that no MBC could have been set to
+constexpr u16 kMaxRomBankNum = 0x1ff,
+              kMaxRamBankNum = 0xf;
+
 CartridgeExtensionBase::CartridgeExtensionBase() : cart_(nullptr) {}
 
 void CartridgeExtensionBase::ExtSetCartridge(const Cartridge* cart) {
@@ -21,6 +28,14 @@ u8 CartridgeExtensionBase::ExtRomBankXRead8(u16 loc) const {
   return cart_->GetRomData()[kRomBankSize + loc];
 }
 
+const u8* CartridgeExtensionBase::ExtGetRomBank0Data() const {
+  return cart_->GetRomData().data();
+}
+
+const u8* CartridgeExtensionBase::ExtGetRomBankXData() const {
+  return cart_->GetRomData().data() + kRomBankSize;
+}
+
 bool RamExtensionBase::ExtInit() {
   // clear and zero-out RAM to new size
   ramData_.clear();
@@ -56,6 +71,17 @@ u8 RamExtensionBase::RamBankXRead8(u16 loc, u16 bankNum) const {
   }
 }
 
+const u8* RamExtensionBase::GetRamBankXData(u16 bankNum) const {
+  // reads are only contiguous if the RAM size is a multiple of the bank size,
+  // as smaller RAM sizes are mirrored throughout the bank
+  if (!ramEnabled_ || ramData_.size() == 0 ||
+      ramData_.size() % kExtRamBankSize != 0) {
+    return nullptr;
+  }
+
+  return &ramData_[(kExtRamBankSize * bankNum) % ramData_.size()];
+}
+
 void RamExtensionBase::ExtRamWrite8(u16 loc, u8 val) {
   RamBankXWrite8(loc, val, ramBankNum_);
 }
@@ -64,6 +90,10 @@ u8 RamExtensionBase::ExtRamRead8(u16 loc) const {
   return RamBankXRead8(loc, ramBankNum_);
 }
 
+const u8* RamExtensionBase::ExtGetRamData() const {
+  return GetRamBankXData(ramBankNum_);
+}
+
 bool RamExtensionBase::ExtSaveRam(std::ostream& os) {
   return util::WriteBinaryStream(os, ramData_);
 }
@@ -72,11 +102,34 @@ bool RamExtensionBase::ExtLoadRam(std::istream& is) {
   return util::ReadBinaryStream(is, ramData_, false);
 }
 
+void RamExtensionBase::ExtSaveState(StateWriter& writer) const {
+  writer.WriteBool(ramEnabled_);
+  writer.Write16(ramBankNum_);
+  writer.WriteBytes(ramData_.data(), ramData_.size());
+}
+
+void RamExtensionBase::ExtLoadState(StateReader& reader) {
+  // the RAM size is decided by the ROM, which the save state must match
+  ramEnabled_ = reader.ReadBool();
+  ramBankNum_ = reader.Read16InRange(0, kMaxRamBankNum);
+  reader.ReadBytes(ramData_.data(), ramData_.size());
+}
+
 void MbcBase::ExtReset() {
   romBankNum_ = cart_->GetNumRomBanks() > 1 ? 1 : 0;
   RamExtensionBase::ExtReset();
 }
 
+void MbcBase::ExtSaveState(StateWriter& writer) const {
+  RamExtensionBase::ExtSaveState(writer);
+  writer.Write16(romBankNum_);
+}
+
+void MbcBase::ExtLoadState(StateReader& reader) {
+  RamExtensionBase::ExtLoadState(reader);
+  romBankNum_ = reader.Read16InRange(0, kMaxRomBankNum);
+}
+
 u8 MbcBase::RomBankXRead8(u16 loc, u16 bankNum) const {
   const std::size_t dataIndex = (kRomBankSize * bankNum + loc)
                                 % cart_->GetRomData().size();
@@ -90,3 +143,18 @@ u8 MbcBase::ExtRomBank0Read8(u16 loc) const {
 u8 MbcBase::ExtRomBankXRead8(u16 loc) const {
   return RomBankXRead8(loc, romBankNum_);
 }
+
+const u8* MbcBase::GetRomBankXData(u16 bankNum) const {
+  // ROM sizes are always a multiple of the bank size
+  const std::size_t dataIndex = (kRomBankSize * bankNum)
+                                % cart_->GetRomData().size();
+  return &cart_->GetRomData()[dataIndex];
+}
+
+const u8* MbcBase::ExtGetRomBank0Data() const {
+  return GetRomBankXData(0);
+}
+
+const u8* MbcBase::ExtGetRomBankXData() const {
+  return GetRomBankXData(romBankNum_);
+}
@@ -1,5 +1,6 @@
 #include "hw/cart/cart_ext_mbc1.h"
 #include "hw/cart/cart.h"
+#include "hw/state.h"
 
 bool Mbc1::ExtInit() {
   if (cart_->GetNumRomBanks() <= 1 || cart_->GetNumRomBanks() > 0x80 ||
@@ -15,6 +16,16 @@ void Mbc1::ExtReset() {
   MbcBase::ExtReset();
 }
 
+void Mbc1::ExtSaveState(StateWriter& writer) const {
+  MbcBase::ExtSaveState(writer);
+  writer.WriteBool(ramBankingMode_);
+}
+
+void Mbc1::ExtLoadState(StateReader& reader) {
+  MbcBase::ExtLoadState(reader);
+  ramBankingMode_ = reader.ReadBool();
+}
+
 void Mbc1::ExtRomBank0Write8(u16 loc, u8 val) {
   if (loc < 0x2000) {
     // ext RAM read/write enable switch
@@ -77,3 +88,21 @@ u8 Mbc1::ExtRamRead8(u16 loc) const {
     return RamBankXRead8(loc, 0);
   }
 }
+
+const u8* Mbc1::ExtGetRomBankXData() const {
+  if (ramBankingMode_) {
+    // can only access ROM banks 00-1F in RAM banking mode
+    return GetRomBankXData(romBankNum_ % 0x20);
+  } else {
+    return MbcBase::ExtGetRomBankXData();
+  }
+}
+
+const u8* Mbc1::ExtGetRamData() const {
+  if (ramBankingMode_) {
+    return RamExtensionBase::ExtGetRamData();
+  } else {
+    // can only access RAM bank 0 in ROM banking mode
+    return GetRamBankXData(0);
+  }
+}
@@ -1,7 +1,9 @@
 #include "hw/cart/cart_ext_mbc3.h"
 #include "hw/cart/cart.h"
+#include "hw/state.h"
 #include "util.h"
 #include <cassert>
+#include <initializer_list>
 
 Mbc3::Mbc3(bool timerEnabled) : timerEnabled_(timerEnabled) {}
 
@@ -25,6 +27,39 @@ void Mbc3::ExtReset() {
   MbcBase::ExtReset();
 }
 
+void Mbc3::ExtSaveState(StateWriter& writer) const {
+  MbcBase::ExtSaveState(writer);
+
+  writer.Write8(static_cast<u8>(selectedRtc_));
+
+  for (const auto rtc : {&rtc_, &latchedRtc_}) {
+    writer.Write8(rtc->s);
+    writer.Write8(rtc->m);
+    writer.Write8(rtc->h);
+    writer.Write16(rtc->d);
+  }
+
+  writer.Write8(prevLatchVal_);
+  writer.WriteBool(isRtcLatched_);
+}
+
+void Mbc3::ExtLoadState(StateReader& reader) {
+  MbcBase::ExtLoadState(reader);
+
+  selectedRtc_ = static_cast<RtcRegister>(reader.Read8InRange(
+      static_cast<u8>(RtcRegister::S), static_cast<u8>(RtcRegister::None)));
+
+  for (const auto rtc : {&rtc_, &latchedRtc_}) {
+    rtc->s = reader.Read8InRange(0, 59);
+    rtc->m = reader.Read8InRange(0, 59);
+    rtc->h = reader.Read8InRange(0, 23);
+    rtc->d = reader.Read16();
+  }
+
+  prevLatchVal_ = reader.Read8();
+  isRtcLatched_ = reader.ReadBool();
+}
+
 void Mbc3::ExtRomBank0Write8(u16 loc, u8 val) {
   if (loc < 0x2000) {
     // RAM & RTC enable
@@ -117,3 +152,12 @@ void Mbc3::ExtRamWrite8(u16 loc, u8 val) {
     WriteRtcRegister(selectedRtc_, val); // RTC write
   }
 }
+
+const u8* Mbc3::ExtGetRamData() const {
+  // RTC registers can't be read directly
+  if (selectedRtc_ == RtcRegister::None) {
+    return RamExtensionBase::ExtGetRamData();
+  } else {
+    return nullptr;
+  }
+}
@@ -2,10 +2,12 @@
 #include "hw/dma.h"
 #include "hw/joypad.h"
 #include "hw/mmu.h"
+#include "hw/state.h"
 #include <cassert>
 
 Cpu::Cpu(Mmu& mmu, const Dma& dma, const Joypad& joypad)
-    : status_(CpuStatus::Hung), mmu_(mmu), dma_(dma), joypad_(joypad) {}
+    : status_(CpuStatus::Hung), mmu_(mmu), dma_(dma), joypad_(joypad),
+      numInstructions_(0), numCycles_(0), numIdleCycles_(0) {}
 
 void Cpu::Reset(bool cgbMode) {
   cgbMode_ = cgbMode;
@@ -31,6 +33,47 @@ void Cpu::Reset(bool cgbMode) {
   speedSwitchCyclesLeft_ = 0;
 }
 
+void Cpu::SaveState(StateWriter& writer) const {
+  writer.Write8(static_cast<u8>(status_));
+  writer.WriteBool(cgbMode_);
+
+  writer.WriteBool(speedSwitchRequested_);
+  writer.WriteBool(doubleSpeedMode_);
+  writer.Write32(speedSwitchCyclesLeft_);
+
+  writer.Write16(reg_.pc.Get());
+  writer.Write16(reg_.sp.Get());
+  writer.Write16(reg_.af.Get());
+  writer.Write16(reg_.bc.Get());
+  writer.Write16(reg_.de.Get());
+  writer.Write16(reg_.hl.Get());
+
+  writer.WriteBool(intme_);
+  writer.Write8(intf_);
+  writer.Write8(inte_);
+}
+
+void Cpu::LoadState(StateReader& reader) {
+  status_ = static_cast<CpuStatus>(reader.Read8InRange(
+      0, static_cast<u8>(CpuStatus::Hung)));
+  cgbMode_ = reader.ReadBool();
+
+  speedSwitchRequested_ = reader.ReadBool();
+  doubleSpeedMode_ = reader.ReadBool();
+  speedSwitchCyclesLeft_ = reader.Read32();
+
+  reg_.pc.Set(reader.Read16());
+  reg_.sp.Set(reader.Read16());
+  reg_.af.Set(reader.Read16());
+  reg_.bc.Set(reader.Read16());
+  reg_.de.Set(reader.Read16());
+  reg_.hl.Set(reader.Read16());
+
+  intme_ = reader.ReadBool();
+  intf_ = reader.Read8();
+  inte_ = reader.Read8();
+}
+
 bool Cpu::Resume() {
   if (status_ != CpuStatus::Hung && speedSwitchCyclesLeft_ <= 0) {
     status_ = CpuStatus::Running;
@@ -47,14 +90,21 @@ unsigned int Cpu::Update() {
   if (status_ != CpuStatus::Hung && !dma_.IsNdmaInProgress()) {
     if (status_ == CpuStatus::Stopped) {
       HandleStoppedUpdate();
-    } else if (!HandleInterrupts() &&
-               status_ == CpuStatus::Running &&
-               !ExecuteOp(mmu_.Read8(reg_.pc++))) {
-      // unknown opcode executed - hang
-      status_ = CpuStatus::Hung;
+    } else if (!HandleInterrupts() && status_ == CpuStatus::Running) {
+      ++numInstructions_;
+
+      if (!ExecuteOp(mmu_.Read8(reg_.pc++))) {
+        // unknown opcode executed - hang
+        status_ = CpuStatus::Hung;
+      }
     }
   }
 
+  numCycles_ += updateCycles_;
+  if (status_ == CpuStatus::Halted || status_ == CpuStatus::Stopped) {
+    numIdleCycles_ += updateCycles_;
+  }
+
   return updateCycles_;
 }
 
@@ -147,6 +197,28 @@ CpuStatus Cpu::GetStatus() const {
   return status_;
 }
 
+u64 Cpu::GetNumInstructions() const {
+  return numInstructions_;
+}
+
+u64 Cpu::GetNumCycles() const {
+  return numCycles_;
+}
+
+u64 Cpu::GetNumIdleCycles() const {
+  return numIdleCycles_;
+}
+
+CpuTotals Cpu::GetTotals() const {
+  return {numInstructions_, numCycles_, numIdleCycles_};
+}
+
+void Cpu::RestoreTotals(const CpuTotals& totals) {
+  numInstructions_ = totals.numInstructions;
+  numCycles_ = totals.numCycles;
+  numIdleCycles_ = totals.numIdleCycles;
+}
+
 bool Cpu::GetIntme() const {
   return intme_;
 }
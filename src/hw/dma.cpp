@@ -2,7 +2,9 @@
 #include "hw/dma.h"
 #include "hw/mmu.h"
 #include "hw/ppu.h"
+#include "hw/state.h"
 #include "util.h"
+#include <algorithm>
 #include <tuple>
 
 constexpr u8 kNdmaBlockSize = 16;
@@ -24,6 +26,41 @@ void Dma::Reset(bool cgbMode) {
   ndmaNumBlocksLeft_ = 0;
 }
 
+void Dma::SaveState(StateWriter& writer) const {
+  writer.WriteBool(cgbMode_);
+
+  writer.Write8(static_cast<u8>(oamDmaStatus_));
+  writer.Write8(oamDmaSourceLocHi_);
+  writer.Write32(oamDmaCyclesLeft_);
+
+  writer.Write8(static_cast<u8>(ndmaStatus_));
+  writer.Write16(ndmaReadLoc_);
+  writer.Write16(ndmaVramWriteLoc_);
+  writer.Write8(ndmaNumBlocksLeft_);
+
+  writer.Write32(gdmaCyclesLeft_);
+  writer.Write32(hdmaBlockCyclesLeft_);
+}
+
+void Dma::LoadState(StateReader& reader) {
+  cgbMode_ = reader.ReadBool();
+
+  oamDmaStatus_ = static_cast<OamDmaStatus>(reader.Read8InRange(
+      0, static_cast<u8>(OamDmaStatus::InProgress)));
+  oamDmaSourceLocHi_ = reader.Read8();
+  oamDmaCyclesLeft_ = reader.Read32InRange(0, kOamDmaTotalCycles);
+
+  ndmaStatus_ = static_cast<NdmaStatus>(reader.Read8InRange(
+      0, static_cast<u8>(NdmaStatus::GdmaInProgress)));
+  ndmaReadLoc_ = reader.Read16();
+  ndmaVramWriteLoc_ = reader.Read16();
+  ndmaNumBlocksLeft_ = reader.Read8InRange(0, 0x80);
+
+  // a GDMA or HDMA block also takes 4 (or 8 in double speed) cycles to start
+  gdmaCyclesLeft_ = reader.Read32InRange(0, kNdmaCyclesPerBlock * 0x80 + 8);
+  hdmaBlockCyclesLeft_ = reader.Read32InRange(0, kNdmaCyclesPerBlock + 8);
+}
+
 void Dma::Update(unsigned int cycles) {
   // DMAs only happen while the CPU isn't suspended
   if (cpu_.GetStatus() != CpuStatus::Running) {
@@ -39,13 +76,24 @@ void Dma::DoNdmaTransfer(u8 maxNumBlocks) {
   const u8 numBlocks = std::min(maxNumBlocks, ndmaNumBlocksLeft_);
 
   for (u8 i = 0; i < numBlocks; ++i) {
-    for (u8 j = 0; j < kNdmaBlockSize; ++j) {
-      // don't copy past the bounds of the VRAM bank
-      if (ndmaVramWriteLoc_ + j >= std::tuple_size<VideoRamBank>::value) {
-        break;
+    // don't copy past the bounds of the VRAM bank
+    constexpr auto vramSize = std::tuple_size<VideoRamBank>::value;
+    const u16 blockSize = ndmaVramWriteLoc_ < vramSize
+                          ? std::min<u16>(kNdmaBlockSize,
+                                          vramSize - ndmaVramWriteLoc_)
+                          : 0;
+
+    // copy the whole block at once if the source can be read directly.
+    // otherwise, fall back to reading each byte through the MMU
+    const u8* sourceData = mmu_.GetDirectReadPtr(ndmaReadLoc_, blockSize);
+    if (blockSize <= 0) {
+      // nothing left to copy into this bank
+    } else if (sourceData) {
+      ppu_.VramWriteBlock(ndmaVramWriteLoc_, sourceData, blockSize);
+    } else {
+      for (u16 j = 0; j < blockSize; ++j) {
+        ppu_.VramWrite8(ndmaVramWriteLoc_ + j, mmu_.Read8(ndmaReadLoc_ + j));
       }
-
-      ppu_.VramWrite8(ndmaVramWriteLoc_ + j, mmu_.Read8(ndmaReadLoc_ + j));
     }
 
     ndmaVramWriteLoc_ += kNdmaBlockSize;
@@ -112,7 +160,17 @@ void Dma::UpdateHdmaHBlankState() {
 }
 
 void Dma::DoOamDmaTransfer() {
-  for (u8 i = 0; i < std::tuple_size<ObjectAttribMemory>::value; ++i) {
+  constexpr auto oamSize = std::tuple_size<ObjectAttribMemory>::value;
+
+  // the source is usually ROM or WRAM, which can be copied directly
+  const u8* sourceData = mmu_.GetDirectReadPtr(
+    util::To16(oamDmaSourceLocHi_, 0x00), oamSize);
+  if (sourceData) {
+    ppu_.OamDmaWriteAll(sourceData);
+    return;
+  }
+
+  for (u8 i = 0; i < oamSize; ++i) {
     ppu_.OamWrite8(i, mmu_.Read8(util::To16(oamDmaSourceLocHi_, i)), true);
   }
 }
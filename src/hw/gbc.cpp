@@ -1,13 +1,52 @@
 #include "hw/gbc.h"
+#include "debug/guest_profiler.h"
+#include "trace.h"
+#include "util.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+
+namespace {
+  // GbcUpdateTimes and GbcUpdateCounts lump the DMA and timer in with other,
+  // whose time is then measured by three reads per update
+  constexpr auto kOtherStepReads = 3u;
+
+  GbcUpdateStep GetSplitStep(GbcUpdateStep step) {
+    return step == kGbcUpdateDma || step == kGbcUpdateTimer ? kGbcUpdateOther
+                                                            : step;
+  }
+
+  // how long reading the clock takes, so that it can be taken away from the
+  // times measured between reads
+  double GetClockReadSeconds() {
+    using namespace std::chrono;
+
+    static const double clockReadSeconds = [] {
+      constexpr auto kNumReads = 1000;
+      const auto startTime = steady_clock::now();
+
+      for (auto i = 0; i < kNumReads; ++i) {
+        steady_clock::now();
+      }
+
+      return duration<double>(steady_clock::now() - startTime).count()
+             / kNumReads;
+    }();
+
+    return clockReadSeconds;
+  }
+}
 
 GbcHardware::GbcHardware()
     : cpu(mmu, dma, joypad), timer(cpu), apu(cpu), ppu(cpu, dma), joypad(cpu),
       serial(cpu), dma(mmu, cpu, ppu), mmu(*this) {}
 
-Gbc::Gbc() : cgbMode_(false) {}
+Gbc::Gbc()
+    : cgbMode_(false), normalSpeedFrameCycles_(0), profiler_(nullptr) {}
 
 void Gbc::Reset(bool forceDmgMode) {
   cgbMode_ = !forceDmgMode && hw_.cartridge.IsInCgbMode();
+  normalSpeedFrameCycles_ = 0;
 
   hw_.cpu.Reset(cgbMode_);
   hw_.ppu.Reset(cgbMode_);
@@ -25,10 +64,18 @@ void Gbc::Reset(bool forceDmgMode) {
   for (auto& b : hw_.wramBanks) {
     b.fill(0x00);
   }
+
+  if (profiler_) {
+    profiler_->ResetCallStack();
+  }
 }
 
 unsigned int Gbc::Update() {
-  const auto cycles = hw_.cpu.Update();
+  return UpdateHardware();
+}
+
+unsigned int Gbc::UpdateHardware() {
+  const auto cycles = UpdateCpu();
 
   hw_.dma.Update(cycles);
   hw_.apu.Update(cycles);
@@ -39,6 +86,106 @@ unsigned int Gbc::Update() {
   return cycles;
 }
 
+unsigned int Gbc::UpdateCpu() {
+  if (!profiler_) {
+    return hw_.cpu.Update();
+  }
+
+  // the rest of the hardware doesn't touch the guest's registers or stack, so
+  // the step can end before it is updated
+  const auto step = profiler_->BeginStep(hw_);
+  const auto cycles = hw_.cpu.Update();
+  profiler_->EndStep(hw_, step, cycles);
+  return cycles;
+}
+
+void Gbc::UpdateFrame() {
+  SDGBC_TRACE_ZONE("Gbc::UpdateFrame");
+  while (normalSpeedFrameCycles_ < kNormalSpeedCyclesPerFrame) {
+    // don't scale the amount of cycles left with CPU double speed mode
+    normalSpeedFrameCycles_ += util::RescaleCycles(hw_.cpu, Update());
+  }
+
+  normalSpeedFrameCycles_ -= kNormalSpeedCyclesPerFrame;
+}
+
+void Gbc::UpdateFrameTimed(GbcUpdateTimes& outTimes) {
+  using namespace std::chrono;
+  SDGBC_TRACE_ZONE("Gbc::UpdateFrameTimed");
+
+  std::array<steady_clock::duration, kGbcNumUpdateSteps> stepTimes{};
+  auto time = steady_clock::now();
+
+  const auto numUpdates = UpdateFrameInSteps([&](GbcUpdateStep step) {
+    const auto endTime = steady_clock::now();
+    stepTimes[GetSplitStep(step)] += endTime - time;
+    time = endTime;
+  });
+
+  const double clockReadSeconds = GetClockReadSeconds() * numUpdates;
+  const auto toSeconds = [clockReadSeconds](steady_clock::duration stepTime,
+                                            unsigned int numReads) {
+    return std::max(0.0, duration<double>(stepTime).count()
+                             - numReads * clockReadSeconds);
+  };
+
+  outTimes.cpuSeconds = toSeconds(stepTimes[kGbcUpdateCpu], 1);
+  outTimes.ppuSeconds = toSeconds(stepTimes[kGbcUpdatePpu], 1);
+  outTimes.apuSeconds = toSeconds(stepTimes[kGbcUpdateApu], 1);
+  outTimes.otherSeconds = toSeconds(stepTimes[kGbcUpdateOther],
+                                    kOtherStepReads);
+}
+
+void Gbc::UpdateFrameCounted(const PerfCounters& counters,
+                             GbcUpdateCounts& outCounts) {
+  SDGBC_TRACE_ZONE("Gbc::UpdateFrameCounted");
+
+  // what a read itself counts, measured like GetClockReadSeconds()
+  constexpr auto kNumCalibrationReads = 1000u;
+  const auto calibrationStart = counters.Read();
+  for (auto i = 0u; i < kNumCalibrationReads; ++i) {
+    counters.Read();
+  }
+
+  PerfCounts readCounts = counters.Read() - calibrationStart;
+  for (auto& count : readCounts) {
+    count /= kNumCalibrationReads + 1;
+  }
+
+  std::array<PerfCounts, kGbcNumUpdateSteps> stepCounts{};
+  auto counts = counters.Read();
+
+  const auto numUpdates = UpdateFrameInSteps([&](GbcUpdateStep step) {
+    const auto endCounts = counters.Read();
+    stepCounts[GetSplitStep(step)] += endCounts - counts;
+    counts = endCounts;
+  });
+
+  const auto toCounts = [&](const PerfCounts& stepCount,
+                            unsigned int numReads) {
+    PerfCounts result;
+    for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+      const u64 readCount = u64{numReads} * numUpdates * readCounts[i];
+      result[i] = stepCount[i] > readCount ? stepCount[i] - readCount : 0;
+    }
+
+    return result;
+  };
+
+  outCounts.cpu = toCounts(stepCounts[kGbcUpdateCpu], 1);
+  outCounts.ppu = toCounts(stepCounts[kGbcUpdatePpu], 1);
+  outCounts.apu = toCounts(stepCounts[kGbcUpdateApu], 1);
+  outCounts.other = toCounts(stepCounts[kGbcUpdateOther], kOtherStepReads);
+}
+
+void Gbc::SetGuestProfiler(GuestProfiler* profiler) {
+  profiler_ = profiler;
+}
+
+GuestProfiler* Gbc::GetGuestProfiler() const {
+  return profiler_;
+}
+
 RomLoadResult Gbc::LoadCartridgeRomFile(const std::string& filePath,
                                         const std::string& fileName) {
   const auto result = hw_.cartridge.LoadRomFile(filePath, fileName);
@@ -49,6 +196,166 @@ RomLoadResult Gbc::LoadCartridgeRomFile(const std::string& filePath,
   return result;
 }
 
+RomLoadResult Gbc::LoadCartridgeRomData(std::vector<u8> romData,
+                                        const std::string& romName) {
+  const auto result = hw_.cartridge.LoadRomData(std::move(romData), romName);
+  if (result == RomLoadResult::Ok) {
+    Reset();
+  }
+
+  return result;
+}
+
+void Gbc::SaveState(std::vector<u8>& outData) const {
+  outData.clear();
+  StateWriter writer(outData);
+
+  writer.Write32(kStateMagic);
+  writer.Write16(kStateVersion);
+  writer.Write64(hw_.cartridge.GetRomHash());
+
+  SaveHardwareState(writer);
+}
+
+StateLoadResult Gbc::LoadState(const u8* data, std::size_t size) {
+  if (!hw_.cartridge.IsRomLoaded()) {
+    return StateLoadResult::NoRom;
+  }
+
+  StateReader reader(data, size);
+
+  if (reader.Read32() != kStateMagic) {
+    return StateLoadResult::InvalidFormat;
+  }
+  if (reader.Read16() != kStateVersion) {
+    return StateLoadResult::UnsupportedVersion;
+  }
+  if (reader.Read64() != hw_.cartridge.GetRomHash()) {
+    return StateLoadResult::RomMismatch;
+  }
+
+  loadStateBackup_.clear();
+  StateWriter backupWriter(loadStateBackup_);
+  SaveHardwareState(backupWriter);
+
+  LoadHardwareState(reader);
+
+  if (reader.HasError() || reader.GetBytesLeft() > 0) {
+    StateReader backupReader(loadStateBackup_.data(),
+                             loadStateBackup_.size());
+    LoadHardwareState(backupReader);
+    return StateLoadResult::InvalidFormat;
+  }
+
+  if (profiler_) {
+    profiler_->ResetCallStack();
+  }
+
+  return StateLoadResult::Ok;
+}
+
+StateLoadResult Gbc::LoadState(const std::vector<u8>& data) {
+  return LoadState(data.data(), data.size());
+}
+
+void Gbc::RunAhead(unsigned int numFrames) {
+  if (numFrames == 0) {
+    return;
+  }
+
+  SaveSnapshot(runAheadState_);
+
+  // frames that are rolled back count towards neither the profile nor the
+  // CPU's totals
+  const auto profiler = profiler_;
+  profiler_ = nullptr;
+  const auto cpuTotals = hw_.cpu.GetTotals();
+
+  const auto audioOut = hw_.apu.GetApuOutput();
+  const auto serialOut = hw_.serial.GetSerialOutput();
+  const auto serialLink = hw_.serial.GetSerialLink();
+  const bool renderSuppressed = hw_.ppu.IsRenderSuppressed();
+
+  // the other end of a link cable mustn't see frames that are rolled back
+  hw_.apu.SetApuOutput(nullptr);
+  hw_.serial.SetSerialOutput(nullptr);
+  hw_.serial.SetSerialLink(nullptr);
+
+  hw_.ppu.SetRenderSuppressed(true);
+  for (auto i = 1u; i < numFrames; ++i) {
+    UpdateFrame();
+  }
+
+  hw_.ppu.SetRenderSuppressed(false);
+  UpdateFrame();
+
+  hw_.apu.SetApuOutput(audioOut);
+  hw_.serial.SetSerialOutput(serialOut);
+  hw_.serial.SetSerialLink(serialLink);
+  hw_.ppu.SetRenderSuppressed(renderSuppressed);
+
+  LoadSnapshot(runAheadState_);
+  profiler_ = profiler;
+  hw_.cpu.RestoreTotals(cpuTotals);
+}
+
+void Gbc::SaveSnapshot(std::vector<u8>& outData) const {
+  outData.clear();
+  StateWriter writer(outData);
+  SaveHardwareState(writer);
+}
+
+void Gbc::LoadSnapshot(const std::vector<u8>& data) {
+  StateReader reader(data.data(), data.size());
+  LoadHardwareState(reader);
+
+  if (profiler_) {
+    profiler_->ResetCallStack();
+  }
+}
+
+void Gbc::SaveHardwareState(StateWriter& writer) const {
+  writer.WriteBool(cgbMode_);
+  writer.Write32(normalSpeedFrameCycles_);
+
+  hw_.cpu.SaveState(writer);
+  hw_.dma.SaveState(writer);
+  hw_.ppu.SaveState(writer);
+  hw_.apu.SaveState(writer);
+  hw_.mmu.SaveState(writer);
+  hw_.timer.SaveState(writer);
+  hw_.serial.SaveState(writer);
+  hw_.joypad.SaveState(writer);
+
+  for (const auto& b : hw_.wramBanks) {
+    writer.WriteBytes(b);
+  }
+  writer.WriteBytes(hw_.hram);
+
+  hw_.cartridge.SaveState(writer);
+}
+
+void Gbc::LoadHardwareState(StateReader& reader) {
+  cgbMode_ = reader.ReadBool();
+  normalSpeedFrameCycles_ = reader.Read32();
+
+  hw_.cpu.LoadState(reader);
+  hw_.dma.LoadState(reader);
+  hw_.ppu.LoadState(reader);
+  hw_.apu.LoadState(reader);
+  hw_.mmu.LoadState(reader);
+  hw_.timer.LoadState(reader);
+  hw_.serial.LoadState(reader);
+  hw_.joypad.LoadState(reader);
+
+  for (auto& b : hw_.wramBanks) {
+    reader.ReadBytes(b);
+  }
+  reader.ReadBytes(hw_.hram);
+
+  hw_.cartridge.LoadState(reader);
+}
+
 GbcHardware& Gbc::GetHardware() {
   return hw_;
 }
@@ -1,5 +1,6 @@
 #include "hw/cpu/cpu.h"
 #include "hw/joypad.h"
+#include "hw/state.h"
 
 Joypad::Joypad(Cpu& cpu) : cpu_(cpu), leftRightOrUpDownAllowed_(false) {}
 
@@ -10,6 +11,22 @@ void Joypad::Reset() {
   wasSelectedKeyPressed_ = false;
 }
 
+void Joypad::SaveState(StateWriter& writer) const {
+  // NOTE: nextKeyStates_ holds input from the host that is yet to be
+  // committed, so it isn't part of the emulated state
+  writer.Write8(keyStates_);
+  writer.WriteBool(selectButtonKeys_);
+  writer.WriteBool(selectDirectionKeys_);
+  writer.WriteBool(wasSelectedKeyPressed_);
+}
+
+void Joypad::LoadState(StateReader& reader) {
+  keyStates_ = reader.Read8();
+  selectButtonKeys_ = reader.ReadBool();
+  selectDirectionKeys_ = reader.ReadBool();
+  wasSelectedKeyPressed_ = reader.ReadBool();
+}
+
 void Joypad::CommitKeyStates() {
   const u8 nowPressedKeys = nextKeyStates_ & ~keyStates_;
 
@@ -63,6 +80,18 @@ void Joypad::SetKeyState(JoypadKey key, bool pressed) {
   }
 }
 
+void Joypad::SetKeyStates(u8 keys) {
+  nextKeyStates_ = keys;
+}
+
+u8 Joypad::GetKeyStates() const {
+  return keyStates_;
+}
+
+u8 Joypad::GetNextKeyStates() const {
+  return nextKeyStates_;
+}
+
 void Joypad::SetJoyp(u8 val) {
   selectButtonKeys_ = (val & 0x20) == 0;
   selectDirectionKeys_ = (val & 0x10) == 0;
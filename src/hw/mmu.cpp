@@ -1,4 +1,5 @@
 #include "hw/gbc.h"
+#include "hw/state.h"
 #include <cassert>
 
 Mmu::Mmu(GbcHardware& hw) : hw_(hw) {}
@@ -8,6 +9,16 @@ void Mmu::Reset(bool cgbMode) {
   svbk_ = cgbMode_ ? 0xf8 : 0xff;
 }
 
+void Mmu::SaveState(StateWriter& writer) const {
+  writer.WriteBool(cgbMode_);
+  writer.Write8(svbk_);
+}
+
+void Mmu::LoadState(StateReader& reader) {
+  cgbMode_ = reader.ReadBool();
+  svbk_ = reader.Read8();
+}
+
 u8 Mmu::GetWramBankIndex() const {
   return cgbMode_ ? std::max(svbk_ & 7, 1) : 1;
 }
@@ -101,6 +112,54 @@ u8 Mmu::Read8(u16 loc) const {
   }
 }
 
+const u8* Mmu::GetDirectReadPtr(u16 loc, u16 size) const {
+  const u8* regionData;
+  unsigned int regionStart, regionEnd;
+
+  if (loc < 0x4000) {
+    // cartridge ROM bank 0
+    regionData = hw_.cartridge.GetRomBank0Data();
+    regionStart = 0x0000;
+    regionEnd = 0x4000;
+  } else if (loc < 0x8000) {
+    // cartridge switchable ROM bank 0-N
+    regionData = hw_.cartridge.GetRomBankXData();
+    regionStart = 0x4000;
+    regionEnd = 0x8000;
+  } else if (loc < 0xa000) {
+    // VRAM access depends on the PPU's current mode
+    return nullptr;
+  } else if (loc < 0xc000) {
+    // external cartridge RAM
+    regionData = hw_.cartridge.GetRamData();
+    regionStart = 0xa000;
+    regionEnd = 0xc000;
+  } else if (loc < 0xd000) {
+    // WRAM fixed bank 0
+    regionData = hw_.wramBanks[0].data();
+    regionStart = 0xc000;
+    regionEnd = 0xd000;
+  } else if (loc < 0xe000) {
+    // WRAM switchable bank 1-7
+    regionData = hw_.wramBanks[GetWramBankIndex()].data();
+    regionStart = 0xd000;
+    regionEnd = 0xe000;
+  } else if (loc < 0xfe00) {
+    // echo RAM (same as $C000 to $DDFF)
+    return loc + size <= 0xfe00u ? GetDirectReadPtr(loc - 0x2000, size)
+                                 : nullptr;
+  } else {
+    // OAM, IO registers etc.
+    return nullptr;
+  }
+
+  if (!regionData || loc + size > regionEnd) {
+    return nullptr;
+  }
+
+  return regionData + (loc - regionStart);
+}
+
 void Mmu::WriteIoRegister(u8 regId, u8 val) {
   switch (regId) {
     // serial data transfer registers
@@ -1,7 +1,9 @@
 #include "hw/cpu/cpu.h"
 #include "hw/dma.h"
 #include "hw/ppu.h"
+#include "hw/state.h"
 #include <algorithm>
+#include <cassert>
 #include <tuple>
 
 RgbColor RgbColor::FromLcdIntensities(u8 r, u8 g, u8 b) {
@@ -24,16 +26,13 @@ constexpr auto kTileMapWidth  = 32u,
 
 Ppu::Ppu(Cpu& cpu, const Dma& dma)
     : cpu_(cpu), dma_(dma), lcd_(nullptr), limitScanlineSprites_(true),
-      enableBg_(true), enableBgWindow_(true), enableSprites_(true) {}
+      renderSuppressed_(false), lcdPowerOutOfSync_(false), enableBg_(true),
+      enableBgWindow_(true), enableSprites_(true) {}
 
 void Ppu::Reset(bool cgbMode) {
   cgbMode_ = cgbMode;
   screenModeCycles_ = 0;
 
-  if (lcd_) {
-    lcd_->LcdPower(true);
-  }
-
   // initial register values
   lcdc_ = 0x91;
   stat_ = 0x80;
@@ -57,6 +56,79 @@ void Ppu::Reset(bool cgbMode) {
   // init contents of BCPD to white (all $FF)
   bcpData_.fill(0xff);
   ocpData_.fill(0xff);
+
+  UpdateLcdPower();
+}
+
+void Ppu::SaveState(StateWriter& writer) const {
+  writer.WriteBool(cgbMode_);
+  writer.Write32(screenModeCycles_);
+
+  writer.Write8(lcdc_);
+  writer.Write8(stat_);
+
+  writer.Write8(scy_);
+  writer.Write8(scx_);
+  writer.Write8(ly_);
+  writer.Write8(lyc_);
+  writer.Write8(wy_);
+  writer.Write8(wx_);
+
+  writer.Write8(bgp_);
+  writer.Write8(obp0_);
+  writer.Write8(obp1_);
+
+  writer.Write8(bcps_);
+  writer.Write8(ocps_);
+
+  writer.Write8(vbk_);
+
+  for (const auto& b : vramBanks_) {
+    writer.WriteBytes(b);
+  }
+  writer.WriteBytes(oam_);
+
+  writer.WriteBytes(bcpData_);
+  writer.WriteBytes(ocpData_);
+}
+
+void Ppu::LoadState(StateReader& reader) {
+  cgbMode_ = reader.ReadBool();
+  screenModeCycles_ = reader.Read32();
+
+  lcdc_ = reader.Read8();
+  stat_ = reader.Read8();
+
+  scy_ = reader.Read8();
+  scx_ = reader.Read8();
+  ly_ = reader.Read8InRange(0, 153);
+  lyc_ = reader.Read8();
+  wy_ = reader.Read8();
+  wx_ = reader.Read8();
+
+  bgp_ = reader.Read8();
+  obp0_ = reader.Read8();
+  obp1_ = reader.Read8();
+
+  bcps_ = reader.Read8();
+  ocps_ = reader.Read8();
+
+  vbk_ = reader.Read8();
+
+  // Update() always leaves less than a whole mode's worth of cycles behind
+  if (screenModeCycles_ >= GetScreenModeMaxCycles()) {
+    reader.SetError();
+  }
+
+  for (auto& b : vramBanks_) {
+    reader.ReadBytes(b);
+  }
+  reader.ReadBytes(oam_);
+
+  reader.ReadBytes(bcpData_);
+  reader.ReadBytes(ocpData_);
+
+  UpdateLcdPower();
 }
 
 void Ppu::Update(unsigned int cycles) {
@@ -87,7 +159,7 @@ void Ppu::UpdateScreenMode(unsigned int cycles) {
         } else {
           // finished rendering the last scanline for this frame. now refresh
           // the LCD with our finished frame
-          if (lcd_) {
+          if (lcd_ && !renderSuppressed_) {
             lcd_->LcdRefresh();
           }
 
@@ -148,7 +220,7 @@ PpuScreenMode Ppu::GetScreenMode() const {
 }
 
 void Ppu::RenderScanline() {
-  if (!lcd_) {
+  if (!lcd_ || renderSuppressed_) {
     return;
   }
 
@@ -522,6 +594,15 @@ u8 Ppu::VramRead8(u16 loc) const {
   }
 }
 
+void Ppu::VramWriteBlock(u16 loc, const u8* data, u16 size) {
+  assert(loc + size <= std::tuple_size<VideoRamBank>::value);
+
+  // VRAM inaccessible during use
+  if (GetScreenMode() != PpuScreenMode::DataTransfer) {
+    std::copy_n(data, size, vramBanks_[GetVramBankIndex()].begin() + loc);
+  }
+}
+
 bool Ppu::IsOamAccessible() const {
   return GetScreenMode() != PpuScreenMode::DataTransfer &&
          GetScreenMode() != PpuScreenMode::SearchingOam &&
@@ -537,6 +618,10 @@ void Ppu::OamWrite8(u16 loc, u8 val, bool oamDmaWrite) {
   }
 }
 
+void Ppu::OamDmaWriteAll(const u8* data) {
+  std::copy_n(data, oam_.size(), oam_.begin());
+}
+
 u8 Ppu::OamRead8(u16 loc) const {
   assert(loc < oam_.size());
   return IsOamAccessible() ? oam_[loc] : 0xff;
@@ -577,8 +662,19 @@ void Ppu::SetLcdc(u8 val) {
     SetLy(0);
   }
 
-  if (lcd_) {
-    lcd_->LcdPower(newLcdOn);
+  UpdateLcdPower();
+}
+
+void Ppu::UpdateLcdPower() {
+  if (!lcd_) {
+    return;
+  }
+
+  // powering off clears the LCD, so a suppressed frame must not do it; the LCD
+  // catches up with the latest power state once rendering resumes
+  lcdPowerOutOfSync_ = renderSuppressed_;
+  if (!renderSuppressed_) {
+    lcd_->LcdPower(IsLcdOn());
   }
 }
 
@@ -642,6 +738,18 @@ void Ppu::SetLcd(ILcd* lcd) {
   lcd_ = lcd;
 }
 
+void Ppu::SetRenderSuppressed(bool val) {
+  renderSuppressed_ = val;
+
+  if (lcdPowerOutOfSync_) {
+    UpdateLcdPower();
+  }
+}
+
+bool Ppu::IsRenderSuppressed() const {
+  return renderSuppressed_;
+}
+
 void Ppu::SetBgp(u8 val) {
   bgp_ = val;
 }
@@ -1,5 +1,6 @@
 #include "hw/cpu/cpu.h"
 #include "hw/serial.h"
+#include "hw/state.h"
 
 // the amount of clock cycles needed for a single bit transfer.
 // normal/fast transfer speed modes are controlled by SC bit 1 (CGB mode only)
@@ -8,7 +9,7 @@
 constexpr auto kBitTransferNormalCycles = 512u,
                kBitTransferFastCycles   = 16u;
 
-Serial::Serial(Cpu& cpu) : cpu_(cpu), dataOut_(nullptr) {}
+Serial::Serial(Cpu& cpu) : cpu_(cpu), dataOut_(nullptr), link_(nullptr) {}
 
 void Serial::Reset(bool cgbMode) {
   cgbMode_ = cgbMode;
@@ -23,11 +24,29 @@ void Serial::Reset(bool cgbMode) {
   }
 }
 
+void Serial::SaveState(StateWriter& writer) const {
+  writer.WriteBool(cgbMode_);
+
+  writer.Write8(sb_);
+  writer.Write8(sc_);
+  writer.Write32(nextBitTransferCycles_);
+  writer.Write8(transferNextBitIdx_);
+}
+
+void Serial::LoadState(StateReader& reader) {
+  cgbMode_ = reader.ReadBool();
+
+  sb_ = reader.Read8();
+  sc_ = reader.Read8();
+  nextBitTransferCycles_ = reader.Read32();
+  transferNextBitIdx_ = reader.Read8InRange(0, 7);
+}
+
 void Serial::Update(unsigned int cycles) {
-  // SC bit 7 is unset if there is no transfer in progress.
-  // NOTE: because we're not bothering to implement serial properly, we'll do
-  // nothing if we're set to listen for incoming data (SC bit 0 unset)
-  if (!(sc_ & 0x80) || !(sc_ & 1)) {
+  // SC bit 7 is unset if there is no transfer in progress. if we're set to
+  // listen for incoming data (SC bit 0 unset), the other end of the link
+  // clocks the transfer via ClockExternalBit()
+  if ((sc_ & 0x81) != 0x81) {
     return;
   }
 
@@ -40,32 +59,68 @@ void Serial::Update(unsigned int cycles) {
   while (nextBitTransferCycles_ > transferCycles) {
     nextBitTransferCycles_ -= transferCycles;
 
-    // send SB bit 7 and shift it out of the register by shifting left.
-    // replace the new bit 0 with the received bit.
-    // NOTE: because we're ignoring serial for the project, we'll receive a 1.
-    // this is usually what's received when there is no connection
-    if (dataOut_) {
-      dataOut_->SerialWriteBit(((sb_ >> 7) & 1) != 0);
+    // with nothing plugged in, a 1 is usually what's received
+    const bool outBit = ((sb_ >> 7) & 1) != 0;
+    ShiftBit(link_ ? link_->SerialExchangeBit(outBit) : true);
+
+    if (!IsTransferPending()) {
+      break; // finished the byte
     }
-    sb_ = ((sb_ << 1) | 1) & 0xff;
+  }
+}
 
-    transferNextBitIdx_ = (transferNextBitIdx_ + 1) % 8;
-    if (transferNextBitIdx_ == 0) {
-      // finished sending a full byte. request int $58 and clear SC bit 7
-      cpu_.IntfRequest(kCpuInterrupt0x58);
-      sc_ &= 0x7f;
+bool Serial::ClockExternalBit(bool inBit, bool& outBit) {
+  if ((sc_ & 0x81) != 0x80) {
+    return false;
+  }
 
-      if (dataOut_) {
-        dataOut_->SerialOnByteWritten();
-      }
+  outBit = ShiftBit(inBit);
+  return true;
+}
+
+bool Serial::ShiftBit(bool inBit) {
+  // send SB bit 7 and shift it out of the register by shifting left.
+  // replace the new bit 0 with the received bit
+  const bool outBit = ((sb_ >> 7) & 1) != 0;
+  if (dataOut_) {
+    dataOut_->SerialWriteBit(outBit);
+  }
+  sb_ = ((sb_ << 1) | (inBit ? 1 : 0)) & 0xff;
+
+  transferNextBitIdx_ = (transferNextBitIdx_ + 1) % 8;
+  if (transferNextBitIdx_ == 0) {
+    // finished sending a full byte. request int $58 and clear SC bit 7
+    cpu_.IntfRequest(kCpuInterrupt0x58);
+    sc_ &= 0x7f;
+
+    if (dataOut_) {
+      dataOut_->SerialOnByteWritten();
     }
   }
+
+  return outBit;
 }
 
 void Serial::SetSerialOutput(ISerialOutput* dataOut) {
   dataOut_ = dataOut;
 }
 
+ISerialOutput* Serial::GetSerialOutput() const {
+  return dataOut_;
+}
+
+void Serial::SetSerialLink(ISerialLink* link) {
+  link_ = link;
+}
+
+ISerialLink* Serial::GetSerialLink() const {
+  return link_;
+}
+
+bool Serial::IsTransferPending() const {
+  return (sc_ & 0x80) != 0;
+}
+
 void Serial::SetSb(u8 val) {
   sb_ = val;
 }
@@ -0,0 +1,137 @@
+#include "hw/state.h"
+#include <cassert>
+#include <cstring>
+
+StateWriter::StateWriter(std::vector<u8>& data) : data_(data) {}
+
+void StateWriter::Write8(u8 val) {
+  data_.push_back(val);
+}
+
+void StateWriter::Write16(u16 val) {
+  Write8(val & 0xff);
+  Write8(val >> 8);
+}
+
+void StateWriter::Write32(u32 val) {
+  Write16(val & 0xffff);
+  Write16(val >> 16);
+}
+
+void StateWriter::Write64(u64 val) {
+  Write32(val & 0xffffffff);
+  Write32(val >> 32);
+}
+
+void StateWriter::WriteBool(bool val) {
+  Write8(val ? 1 : 0);
+}
+
+void StateWriter::WriteBytes(const u8* data, std::size_t size) {
+  data_.insert(data_.end(), data, data + size);
+}
+
+StateReader::StateReader(const u8* data, std::size_t size)
+    : data_(data), size_(size), pos_(0), hasError_(false) {}
+
+u8 StateReader::Read8() {
+  if (pos_ >= size_) {
+    hasError_ = true;
+    return 0;
+  }
+
+  return data_[pos_++];
+}
+
+u16 StateReader::Read16() {
+  const u16 lo = Read8();
+  return lo | (Read8() << 8);
+}
+
+u32 StateReader::Read32() {
+  const u32 lo = Read16();
+  return lo | (static_cast<u32>(Read16()) << 16);
+}
+
+u64 StateReader::Read64() {
+  const u64 lo = Read32();
+  return lo | (static_cast<u64>(Read32()) << 32);
+}
+
+bool StateReader::ReadBool() {
+  return Read8() != 0;
+}
+
+u8 StateReader::Read8InRange(u8 min, u8 max) {
+  return static_cast<u8>(CheckRange(Read8(), min, max));
+}
+
+u16 StateReader::Read16InRange(u16 min, u16 max) {
+  return static_cast<u16>(CheckRange(Read16(), min, max));
+}
+
+u32 StateReader::Read32InRange(u32 min, u32 max) {
+  return static_cast<u32>(CheckRange(Read32(), min, max));
+}
+
+u64 StateReader::Read64InRange(u64 min, u64 max) {
+  return CheckRange(Read64(), min, max);
+}
+
+void StateReader::ReadBytes(u8* outData, std::size_t size) {
+  if (size > size_ - pos_) {
+    hasError_ = true;
+    pos_ = size_;
+    std::memset(outData, 0, size);
+    return;
+  }
+
+  std::memcpy(outData, data_ + pos_, size);
+  pos_ += size;
+}
+
+u64 StateReader::CheckRange(u64 val, u64 min, u64 max) {
+  if (val < min || val > max) {
+    hasError_ = true;
+    return min;
+  }
+
+  return val;
+}
+
+void StateReader::SetError() {
+  hasError_ = true;
+}
+
+bool StateReader::HasError() const {
+  return hasError_;
+}
+
+std::size_t StateReader::GetBytesLeft() const {
+  return size_ - pos_;
+}
+
+std::string GetStateLoadResultAsMessage(StateLoadResult result) {
+  switch (result) {
+    case StateLoadResult::Ok:
+      return "Save state loaded successfully!";
+
+    case StateLoadResult::ReadError:
+      return "The save state could not be properly read.";
+
+    case StateLoadResult::InvalidFormat:
+      return "The save state is corrupted or is not a save state.";
+
+    case StateLoadResult::UnsupportedVersion:
+      return "The save state was made by an incompatible version of sdgbc.";
+
+    case StateLoadResult::RomMismatch:
+      return "The save state was made using a different ROM.";
+
+    case StateLoadResult::NoRom:
+      return "A ROM must be loaded before loading a save state.";
+
+    default: assert(!"unimplemented StateLoadResult message!");
+      return "Unknown error!";
+  }
+}
@@ -1,6 +1,8 @@
 #include "hw/cpu/cpu.h"
+#include "hw/state.h"
 #include "hw/timer.h"
 #include <cassert>
+#include <limits>
 
 // calculated as (non-double speed frequency in Hz) / (timer frequency in Hz)
 enum TimerFreqInCycles : unsigned int {
@@ -10,43 +12,103 @@ enum TimerFreqInCycles : unsigned int {
   kTimerFreq4096HzCycles   = 1024
 };
 
+// used as the overflow cycle when TIMA is stopped; never reached
+constexpr auto kTimerNoEvent = std::numeric_limits<u64>::max();
+
+// initial value of the internal divider counter (DIV is its upper 8 bits)
+constexpr u16 kInitialDivCounter = 0xd3ff;
+
 Timer::Timer(Cpu& cpu) : cpu_(cpu) {}
 
 void Timer::Reset() {
-  // initial register & clock counter values
-  divCycles_ = timaCycles_ = 0xff;
+  cycles_ = 0;
+
+  // initial register & clock counter values.
+  // NOTE: unsigned wrap-around is intended here
+  divBaseCycle_ = cycles_ - kInitialDivCounter;
 
-  div_ = 0xd3;
-  tima_ = tma_ = 0x00;
+  timaBase_ = tma_ = 0x00;
+  timaBaseCycle_ = cycles_;
   tac_ = 0xf8;
+
+  ScheduleTimaOverflow();
+}
+
+void Timer::SaveState(StateWriter& writer) const {
+  writer.Write64(cycles_);
+  writer.Write64(divBaseCycle_);
+
+  writer.Write8(timaBase_);
+  writer.Write64(timaBaseCycle_);
+  writer.Write64(timaOverflowCycle_);
+
+  writer.Write8(tma_);
+  writer.Write8(tac_);
+}
+
+void Timer::LoadState(StateReader& reader) {
+  cycles_ = reader.Read64();
+  divBaseCycle_ = reader.Read64(); // may be ahead of cycles_ after a reset
+
+  timaBase_ = reader.Read8();
+  timaBaseCycle_ = reader.Read64InRange(0, cycles_);
+  const auto timaOverflowCycle = reader.Read64();
+
+  tma_ = reader.Read8();
+  tac_ = reader.Read8();
+
+  // the next overflow follows from the rest, and can't have been missed
+  ScheduleTimaOverflow();
+  if (timaOverflowCycle != timaOverflowCycle_
+      || cycles_ >= timaOverflowCycle_) {
+    reader.SetError();
+  }
 }
 
 void Timer::Update(unsigned int cycles) {
-  divCycles_ += cycles;
+  cycles_ += cycles;
 
-  // DIV increments at 16384 Hz, which takes 256 clock cycles
-  div_ += (divCycles_ / kTimerFreq16384HzCycles) & 0xff;
-  divCycles_ %= kTimerFreq16384HzCycles;
-
-  // increment the timer register (TIMA) if it is running (bit 2 set of TAC)
-  if (tac_ & 4) {
-    timaCycles_ += cycles;
-
-    // TIMA increments using the frequency value set in TAC
-    const auto timaFreq = GetTimaFreqInCycles();
-    const auto newTima = tima_ + (timaCycles_ / timaFreq);
-
-    if (newTima > 0xff) {
-      // TIMA is going to overflow. set it to TMA while accounting for the
-      // additional cycles after the change, and request int $50
-      cpu_.IntfRequest(kCpuInterrupt0x50);
-      tima_ = (newTima % (0x100 - tma_)) & 0xff;
-    } else {
-      tima_ = newTima & 0xff;
-    }
-
-    timaCycles_ %= timaFreq;
+  if (cycles_ >= timaOverflowCycle_) {
+    HandleTimaOverflow();
+  }
+}
+
+void Timer::HandleTimaOverflow() {
+  // TIMA is reloaded with TMA when it overflows, and int $50 is requested.
+  // the update may have been long enough for this to happen more than once
+  do {
+    timaBase_ = tma_;
+    timaBaseCycle_ = timaOverflowCycle_;
+    ScheduleTimaOverflow();
+  } while (cycles_ >= timaOverflowCycle_);
+
+  cpu_.IntfRequest(kCpuInterrupt0x50);
+}
+
+void Timer::RebaseTima() {
+  if (!IsTimaRunning()) {
+    return;
   }
+
+  const auto timaFreq = GetTimaFreqInCycles();
+  const auto elapsed = cycles_ - timaBaseCycle_;
+
+  timaBase_ = GetTima();
+  timaBaseCycle_ = cycles_ - (elapsed % timaFreq);
+}
+
+void Timer::ScheduleTimaOverflow() {
+  if (!IsTimaRunning()) {
+    timaOverflowCycle_ = kTimerNoEvent;
+    return;
+  }
+
+  timaOverflowCycle_ = timaBaseCycle_
+                       + (0x100u - timaBase_) * GetTimaFreqInCycles();
+}
+
+bool Timer::IsTimaRunning() const {
+  return (tac_ & 4) != 0; // running if bit 2 set of TAC
 }
 
 unsigned int Timer::GetTimaFreqInCycles() const {
@@ -65,19 +127,30 @@ unsigned int Timer::GetTimaFreqInCycles() const {
 }
 
 void Timer::ResetDiv() {
-  divCycles_ = div_ = 0;
+  divBaseCycle_ = cycles_;
 }
 
 u8 Timer::GetDiv() const {
-  return div_;
+  // DIV increments at 16384 Hz, which takes 256 clock cycles
+  return ((cycles_ - divBaseCycle_) / kTimerFreq16384HzCycles) & 0xff;
 }
 
 void Timer::SetTima(u8 val) {
-  tima_ = val;
+  RebaseTima();
+  timaBase_ = val;
+  ScheduleTimaOverflow();
 }
 
 u8 Timer::GetTima() const {
-  return tima_;
+  if (!IsTimaRunning()) {
+    return timaBase_;
+  }
+
+  // overflows are always handled by Update(), so this can't exceed $ff
+  const auto increments = (cycles_ - timaBaseCycle_) / GetTimaFreqInCycles();
+  assert(timaBase_ + increments <= 0xff);
+
+  return static_cast<u8>(timaBase_ + increments);
 }
 
 void Timer::SetTma(u8 val) {
@@ -89,8 +162,12 @@ u8 Timer::GetTma() const {
 }
 
 void Timer::SetTac(u8 val) {
+  // writing TAC restarts the count towards the next TIMA increment
+  timaBase_ = GetTima();
   tac_ = val | 0xf8;
-  timaCycles_ = 0;
+  timaBaseCycle_ = cycles_;
+
+  ScheduleTimaOverflow();
 }
 
 u8 Timer::GetTac() const {
@@ -0,0 +1,114 @@
+#include "link_cable.h"
+#include "util.h"
+#include <algorithm>
+
+LinkCable::End::End()
+    : cable(nullptr), gbc(nullptr), other(nullptr), frameCycles(0) {}
+
+bool LinkCable::End::SerialExchangeBit(bool bitSet) {
+  // a bit can be clocked by the same instruction that starts the transfer,
+  // before the other side has had a chance to catch up with us
+  if (other->frameCycles < frameCycles) {
+    cable->RunEnd(*other, frameCycles, true);
+  }
+
+  bool receivedBit;
+  if (!other->gbc->GetHardware().serial.ClockExternalBit(bitSet,
+                                                         receivedBit)) {
+    return true;
+  }
+
+  ++cable->stats_.numBitsExchanged;
+  return receivedBit;
+}
+
+LinkCable::LinkCable() : stats_() {
+  ends_[0].other = &ends_[1];
+  ends_[1].other = &ends_[0];
+
+  for (auto& end : ends_) {
+    end.cable = this;
+  }
+}
+
+LinkCable::~LinkCable() {
+  Disconnect();
+}
+
+void LinkCable::Connect(Gbc& a, Gbc& b) {
+  Disconnect();
+
+  ends_[0].gbc = &a;
+  ends_[1].gbc = &b;
+  stats_ = LinkCableStats();
+
+  for (auto& end : ends_) {
+    end.frameCycles = 0;
+    end.gbc->GetHardware().serial.SetSerialLink(&end);
+  }
+}
+
+void LinkCable::Disconnect() {
+  for (auto& end : ends_) {
+    if (end.gbc) {
+      end.gbc->GetHardware().serial.SetSerialLink(nullptr);
+      end.gbc = nullptr;
+    }
+  }
+}
+
+bool LinkCable::IsConnected() const {
+  return ends_[0].gbc != nullptr;
+}
+
+void LinkCable::UpdateFrame() {
+  if (!IsConnected()) {
+    return;
+  }
+
+  while (std::min(ends_[0].frameCycles, ends_[1].frameCycles)
+         < kNormalSpeedCyclesPerFrame) {
+    // the side that is behind always runs next
+    auto& end = ends_[0].frameCycles <= ends_[1].frameCycles ? ends_[0]
+                                                             : ends_[1];
+    const bool isSynced = ends_[0].gbc->GetHardware().serial
+                              .IsTransferPending()
+                          || ends_[1].gbc->GetHardware().serial
+                                 .IsTransferPending();
+
+    if (isSynced) {
+      RunEnd(end, end.other->frameCycles + kLinkCableSyncCycles, true);
+    } else {
+      RunEnd(end, std::min(end.frameCycles + kLinkCableBatchCycles,
+                           kNormalSpeedCyclesPerFrame),
+             false);
+    }
+  }
+
+  for (auto& end : ends_) {
+    end.frameCycles -= kNormalSpeedCyclesPerFrame;
+  }
+}
+
+void LinkCable::RunEnd(End& end, unsigned int untilCycles, bool isSynced) {
+  auto& gbc = *end.gbc;
+  const auto& hw = gbc.GetHardware();
+  const auto startCycles = end.frameCycles;
+
+  while (end.frameCycles < untilCycles) {
+    // don't scale the amount of cycles with CPU double speed mode
+    end.frameCycles += util::RescaleCycles(hw.cpu, gbc.Update());
+
+    // the other side needs to catch up as soon as a transfer is pending
+    if (!isSynced && hw.serial.IsTransferPending()) {
+      break;
+    }
+  }
+
+  (isSynced ? stats_.syncedCycles : stats_.batchedCycles)
+      += end.frameCycles - startCycles;
+}
+
+const LinkCableStats& LinkCable::GetStats() const {
+  return stats_;
+}
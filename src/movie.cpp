@@ -0,0 +1,259 @@
+#include "movie.h"
+#include "hw/state.h"
+#include "util.h"
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+
+// input runs longer than this are split up
+constexpr u32 kMaxKeyRunLength = 0xffff;
+
+Movie::Movie() : romHash_(0), hashInterval_(kMovieDefaultHashInterval) {}
+
+void Movie::Start(const Gbc& gbc, unsigned int hashInterval) {
+  assert(gbc.GetHardware().cartridge.IsRomLoaded());
+
+  romHash_ = gbc.GetHardware().cartridge.GetRomHash();
+  gbc.SaveState(startState_);
+
+  frameKeys_.clear();
+  hashInterval_ = std::max(1u, hashInterval);
+  frameHashes_.clear();
+}
+
+void Movie::RecordFrame(const Gbc& gbc) {
+  frameKeys_.push_back(gbc.GetHardware().joypad.GetKeyStates());
+
+  if (frameKeys_.size() % hashInterval_ == 0) {
+    frameHashes_.push_back(CalculateStateHash(gbc, hashStateBuffer_));
+  }
+}
+
+void Movie::Save(std::vector<u8>& outData) const {
+  outData.clear();
+  StateWriter writer(outData);
+
+  writer.Write32(kMovieMagic);
+  writer.Write16(kMovieVersion);
+  writer.Write64(romHash_);
+
+  writer.Write32(static_cast<u32>(startState_.size()));
+  writer.WriteBytes(startState_.data(), startState_.size());
+
+  // input is stored as a count of runs, followed by the key states and length
+  // of each run
+  writer.Write32(GetNumFrames());
+
+  std::vector<std::pair<u8, u16>> keyRuns;
+  for (const auto keys : frameKeys_) {
+    if (keyRuns.empty() || keyRuns.back().first != keys
+        || keyRuns.back().second == kMaxKeyRunLength) {
+      keyRuns.emplace_back(keys, 0);
+    }
+
+    ++keyRuns.back().second;
+  }
+
+  writer.Write32(static_cast<u32>(keyRuns.size()));
+  for (const auto& run : keyRuns) {
+    writer.Write8(run.first);
+    writer.Write16(run.second);
+  }
+
+  writer.Write32(hashInterval_);
+  writer.Write32(static_cast<u32>(frameHashes_.size()));
+  for (const auto hash : frameHashes_) {
+    writer.Write64(hash);
+  }
+}
+
+MovieLoadResult Movie::Load(const u8* data, std::size_t size) {
+  StateReader reader(data, size);
+
+  if (reader.Read32() != kMovieMagic) {
+    return MovieLoadResult::InvalidFormat;
+  }
+  if (reader.Read16() != kMovieVersion) {
+    return MovieLoadResult::UnsupportedVersion;
+  }
+
+  Movie movie;
+  movie.romHash_ = reader.Read64();
+
+  const auto startStateSize = reader.Read32();
+  if (startStateSize > reader.GetBytesLeft()) {
+    return MovieLoadResult::InvalidFormat;
+  }
+
+  movie.startState_.resize(startStateSize);
+  reader.ReadBytes(movie.startState_.data(), startStateSize);
+
+  const auto numFrames = reader.Read32();
+  const auto numKeyRuns = reader.Read32();
+
+  // each run takes 3 bytes, so check the count before trusting it
+  if (numKeyRuns > reader.GetBytesLeft() / 3) {
+    return MovieLoadResult::InvalidFormat;
+  }
+
+  for (u32 i = 0; i < numKeyRuns; ++i) {
+    const auto keys = reader.Read8();
+    const auto runLength = reader.Read16();
+
+    if (runLength == 0 || movie.frameKeys_.size() + runLength > numFrames) {
+      return MovieLoadResult::InvalidFormat;
+    }
+
+    movie.frameKeys_.insert(movie.frameKeys_.end(), runLength, keys);
+  }
+
+  movie.hashInterval_ = reader.Read32();
+  const auto numHashes = reader.Read32();
+
+  if (movie.frameKeys_.size() != numFrames || movie.hashInterval_ == 0
+      || numHashes != numFrames / movie.hashInterval_
+      || numHashes > reader.GetBytesLeft() / 8) {
+    return MovieLoadResult::InvalidFormat;
+  }
+
+  movie.frameHashes_.resize(numHashes);
+  for (auto& hash : movie.frameHashes_) {
+    hash = reader.Read64();
+  }
+
+  if (reader.HasError() || reader.GetBytesLeft() > 0) {
+    return MovieLoadResult::InvalidFormat;
+  }
+
+  romHash_ = movie.romHash_;
+  startState_ = std::move(movie.startState_);
+  frameKeys_ = std::move(movie.frameKeys_);
+  hashInterval_ = movie.hashInterval_;
+  frameHashes_ = std::move(movie.frameHashes_);
+  return MovieLoadResult::Ok;
+}
+
+bool Movie::SaveFile(const std::string& filePath) const {
+  std::vector<u8> data;
+  Save(data);
+
+  std::ofstream file(filePath, std::ios::binary);
+  return util::WriteBinaryStream(file, data);
+}
+
+MovieLoadResult Movie::LoadFile(const std::string& filePath) {
+  std::vector<u8> data;
+
+  std::ifstream file(filePath, std::ios::binary);
+  if (!util::ReadBinaryStream(file, data)) {
+    return MovieLoadResult::ReadError;
+  }
+
+  return Load(data.data(), data.size());
+}
+
+u64 Movie::GetRomHash() const {
+  return romHash_;
+}
+
+const std::vector<u8>& Movie::GetStartState() const {
+  return startState_;
+}
+
+u32 Movie::GetNumFrames() const {
+  return static_cast<u32>(frameKeys_.size());
+}
+
+u8 Movie::GetFrameKeys(u32 frame) const {
+  return frameKeys_[frame];
+}
+
+unsigned int Movie::GetHashInterval() const {
+  return hashInterval_;
+}
+
+bool Movie::HasFrameHash(u32 frame) const {
+  return frame > 0 && frame % hashInterval_ == 0
+         && frame / hashInterval_ <= frameHashes_.size();
+}
+
+u64 Movie::GetFrameHash(u32 frame) const {
+  assert(HasFrameHash(frame));
+  return frameHashes_[frame / hashInterval_ - 1];
+}
+
+u64 Movie::CalculateStateHash(const Gbc& gbc, std::vector<u8>& stateBuffer) {
+  gbc.SaveState(stateBuffer);
+  return util::HashFnv1a64(stateBuffer.data(), stateBuffer.size());
+}
+
+std::string Movie::GetMovieLoadResultAsMessage(MovieLoadResult result) {
+  switch (result) {
+    case MovieLoadResult::Ok: return "Success.";
+    case MovieLoadResult::ReadError: return "Failed to read the movie file.";
+    case MovieLoadResult::InvalidFormat:
+      return "The movie file is corrupt or is not a movie file.";
+    case MovieLoadResult::UnsupportedVersion:
+      return "The movie file was made by an unsupported version.";
+    default: return "Unknown error.";
+  }
+}
+
+MoviePlayer::MoviePlayer(const Movie& movie)
+    : movie_(movie), frame_(0), desyncFrame_(0), hasDesynced_(false) {}
+
+StateLoadResult MoviePlayer::Start(Gbc& gbc) {
+  frame_ = desyncFrame_ = 0;
+  hasDesynced_ = false;
+
+  const auto result = gbc.LoadState(movie_.GetStartState());
+  if (result == StateLoadResult::Ok) {
+    gbc.GetHardware().apu.SetLazyModeAllowed(false);
+    CommitFrameKeys(gbc);
+  }
+
+  return result;
+}
+
+bool MoviePlayer::OnFrameEnd(Gbc& gbc) {
+  ++frame_;
+
+  if (movie_.HasFrameHash(frame_)
+      && Movie::CalculateStateHash(gbc, stateBuffer_)
+         != movie_.GetFrameHash(frame_)) {
+    hasDesynced_ = true;
+    desyncFrame_ = frame_;
+    return false;
+  }
+
+  if (IsFinished()) {
+    return false;
+  }
+
+  CommitFrameKeys(gbc);
+  return true;
+}
+
+bool MoviePlayer::IsFinished() const {
+  return frame_ >= movie_.GetNumFrames();
+}
+
+bool MoviePlayer::HasDesynced() const {
+  return hasDesynced_;
+}
+
+u32 MoviePlayer::GetFrame() const {
+  return frame_;
+}
+
+u32 MoviePlayer::GetDesyncFrame() const {
+  return desyncFrame_;
+}
+
+void MoviePlayer::CommitFrameKeys(Gbc& gbc) const {
+  if (frame_ < movie_.GetNumFrames()) {
+    auto& joypad = gbc.GetHardware().joypad;
+    joypad.SetKeyStates(movie_.GetFrameKeys(frame_));
+    joypad.CommitKeyStates();
+  }
+}
@@ -0,0 +1,407 @@
+#include "netplay.h"
+#include "hw/state.h"
+#include "util.h"
+#include <algorithm>
+#include <cstring>
+
+#ifndef _WIN32
+# include <sys/socket.h>
+# include <sys/un.h>
+# include <unistd.h>
+#endif
+
+constexpr auto kNetplayHistoryMask = kNetplayHistoryFrames - 1;
+
+// large enough for a packet holding a whole history's worth of input, or a
+// remote link cable packet full of events
+constexpr std::size_t kNetplayMaxPacketSize = 1024;
+
+// marks history slots that hold no input from the peer yet
+constexpr auto kNoFrame = 0xffffffffu;
+
+namespace {
+#ifndef _WIN32
+  bool MakeSocketAddress(const std::string& path, sockaddr_un& outAddr) {
+    if (path.empty() || path.size() >= sizeof(outAddr.sun_path)) {
+      return false;
+    }
+
+    std::memset(&outAddr, 0, sizeof(outAddr));
+    outAddr.sun_family = AF_UNIX;
+    std::memcpy(outAddr.sun_path, path.c_str(), path.size() + 1);
+    return true;
+  }
+#endif
+}
+
+SocketNetplayTransport::SocketNetplayTransport() : fd_(-1) {}
+
+SocketNetplayTransport::~SocketNetplayTransport() {
+  Close();
+}
+
+bool SocketNetplayTransport::OpenPair(SocketNetplayTransport& a,
+                                      SocketNetplayTransport& b) {
+  a.Close();
+  b.Close();
+
+#ifndef _WIN32
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) != 0) {
+    return false;
+  }
+
+  a.fd_ = fds[0];
+  b.fd_ = fds[1];
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool SocketNetplayTransport::Open(const std::string& localPath,
+                                  const std::string& remotePath) {
+  Close();
+
+#ifndef _WIN32
+  sockaddr_un localAddr, remoteAddr;
+  if (!MakeSocketAddress(localPath, localAddr)
+      || !MakeSocketAddress(remotePath, remoteAddr)) {
+    return false;
+  }
+
+  fd_ = socket(AF_UNIX, SOCK_DGRAM, 0);
+  if (fd_ < 0) {
+    return false;
+  }
+
+  unlink(localPath.c_str());
+  if (bind(fd_, reinterpret_cast<const sockaddr*>(&localAddr),
+           sizeof(localAddr)) != 0) {
+    Close();
+    return false;
+  }
+
+  localPath_ = localPath;
+  remotePath_ = remotePath;
+  return true;
+#else
+  return false;
+#endif
+}
+
+void SocketNetplayTransport::Close() {
+#ifndef _WIN32
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+
+  if (!localPath_.empty()) {
+    unlink(localPath_.c_str());
+  }
+#endif
+
+  fd_ = -1;
+  localPath_.clear();
+  remotePath_.clear();
+}
+
+bool SocketNetplayTransport::IsOpen() const {
+  return fd_ >= 0;
+}
+
+bool SocketNetplayTransport::NetplaySend(const std::vector<u8>& packet) {
+#ifndef _WIN32
+  if (fd_ < 0) {
+    return false;
+  }
+
+  if (remotePath_.empty()) {
+    return send(fd_, packet.data(), packet.size(), MSG_DONTWAIT)
+           == static_cast<ssize_t>(packet.size());
+  }
+
+  sockaddr_un remoteAddr;
+  MakeSocketAddress(remotePath_, remoteAddr);
+
+  return sendto(fd_, packet.data(), packet.size(), MSG_DONTWAIT,
+                reinterpret_cast<const sockaddr*>(&remoteAddr),
+                sizeof(remoteAddr))
+         == static_cast<ssize_t>(packet.size());
+#else
+  return false;
+#endif
+}
+
+bool SocketNetplayTransport::NetplayReceive(std::vector<u8>& outPacket) {
+#ifndef _WIN32
+  if (fd_ < 0) {
+    return false;
+  }
+
+  outPacket.resize(kNetplayMaxPacketSize);
+  const auto size = recv(fd_, outPacket.data(), outPacket.size(),
+                         MSG_DONTWAIT);
+  if (size < 0) {
+    return false;
+  }
+
+  outPacket.resize(static_cast<std::size_t>(size));
+  return true;
+#else
+  return false;
+#endif
+}
+
+LatencyNetplayTransport::LatencyNetplayTransport(
+    INetplayTransport& transport, std::chrono::microseconds latency)
+    : transport_(transport), latency_(latency) {}
+
+bool LatencyNetplayTransport::NetplaySend(const std::vector<u8>& packet) {
+  return transport_.NetplaySend(packet);
+}
+
+bool LatencyNetplayTransport::NetplayReceive(std::vector<u8>& outPacket) {
+  using namespace std::chrono;
+  const auto nowTime = steady_clock::now();
+
+  while (transport_.NetplayReceive(outPacket)) {
+    pending_.emplace_back(nowTime, std::move(outPacket));
+  }
+
+  if (pending_.empty() || nowTime - pending_.front().first < latency_) {
+    return false;
+  }
+
+  outPacket = std::move(pending_.front().second);
+  pending_.pop_front();
+  return true;
+}
+
+RollbackSession::RollbackSession()
+    : transport_(nullptr), localPlayer_(0), frame_(0), remoteFrame_(0),
+      remoteAckFrame_(0), rollbackFrame_(0), stats_() {}
+
+void RollbackSession::Start(Gbc& gbc, INetplayTransport& transport,
+                            unsigned int localPlayer) {
+  transport_ = &transport;
+  localPlayer_ = localPlayer;
+
+  frame_ = remoteFrame_ = remoteAckFrame_ = rollbackFrame_ = 0;
+  localKeys_.fill(0);
+  remoteKeys_.fill(0);
+  usedRemoteKeys_.fill(0);
+  remoteKeysFrame_.fill(kNoFrame);
+  stats_ = NetplayStats();
+
+  gbc.GetHardware().apu.SetLazyModeAllowed(false);
+}
+
+void RollbackSession::Stop() {
+  transport_ = nullptr;
+}
+
+bool RollbackSession::IsStarted() const {
+  return transport_ != nullptr;
+}
+
+bool RollbackSession::AdvanceFrame(Gbc& gbc, u8 localKeys) {
+  ReceivePackets();
+
+  if (frame_ >= remoteFrame_ + kNetplayMaxRollbackFrames) {
+    ++stats_.numStalls;
+    SendInput(); // our input may have been lost; keep offering it
+    return false;
+  }
+
+  Rollback(gbc);
+
+  localKeys_[frame_ & kNetplayHistoryMask] = localKeys;
+  EmulateFrame(gbc, frame_, true);
+  rollbackFrame_ = ++frame_;
+  stats_.numFrames = frame_;
+
+  SendInput();
+  return true;
+}
+
+void RollbackSession::Poll(Gbc& gbc) {
+  ReceivePackets();
+  Rollback(gbc);
+  SendInput();
+}
+
+bool RollbackSession::IsSynchronized() const {
+  return remoteFrame_ >= frame_ && rollbackFrame_ == frame_;
+}
+
+const NetplayStats& RollbackSession::GetStats() const {
+  return stats_;
+}
+
+void RollbackSession::ReceivePackets() {
+  while (transport_->NetplayReceive(packet_)) {
+    HandlePacket(packet_);
+  }
+
+  stats_.remoteFrame = remoteFrame_;
+}
+
+void RollbackSession::HandlePacket(const std::vector<u8>& packet) {
+  StateReader reader(packet.data(), packet.size());
+
+  if (reader.Read32() != kNetplayPacketMagic
+      || reader.Read8() == localPlayer_) {
+    return;
+  }
+
+  const auto ackFrame = reader.Read32();
+  const auto firstFrame = reader.Read32();
+  const auto numFrames = reader.Read8();
+
+  std::array<u8, kNetplayHistoryFrames> keys;
+  if (numFrames > keys.size()) {
+    return;
+  }
+
+  for (auto i = 0u; i < numFrames; ++i) {
+    keys[i] = reader.Read8();
+  }
+
+  if (reader.HasError() || reader.GetBytesLeft() > 0) {
+    return;
+  }
+
+  remoteAckFrame_ = std::max(remoteAckFrame_, std::min(ackFrame, frame_));
+
+  for (auto i = 0u; i < numFrames; ++i) {
+    const auto frame = firstFrame + i;
+
+    // skip input that we already have, or that is too far ahead to hold
+    if (frame < remoteFrame_
+        || frame >= remoteFrame_ + kNetplayHistoryFrames) {
+      continue;
+    }
+
+    const auto slot = frame & kNetplayHistoryMask;
+    remoteKeys_[slot] = keys[i];
+    remoteKeysFrame_[slot] = frame;
+
+    if (frame < frame_ && usedRemoteKeys_[slot] != keys[i]) {
+      rollbackFrame_ = std::min(rollbackFrame_, frame);
+    }
+  }
+
+  while (remoteKeysFrame_[remoteFrame_ & kNetplayHistoryMask]
+         == remoteFrame_) {
+    ++remoteFrame_;
+  }
+}
+
+void RollbackSession::SendInput() {
+  // resend everything that the peer hasn't confirmed, so that lost packets
+  // don't need to be detected
+  const auto firstFrame = remoteAckFrame_;
+  const auto numFrames = std::min(frame_ - firstFrame, kNetplayHistoryFrames);
+
+  packet_.clear();
+  StateWriter writer(packet_);
+
+  writer.Write32(kNetplayPacketMagic);
+  writer.Write8(static_cast<u8>(localPlayer_));
+  writer.Write32(remoteFrame_);
+  writer.Write32(firstFrame);
+  writer.Write8(static_cast<u8>(numFrames));
+
+  for (auto i = 0u; i < numFrames; ++i) {
+    writer.Write8(localKeys_[(firstFrame + i) & kNetplayHistoryMask]);
+  }
+
+  transport_->NetplaySend(packet_);
+}
+
+void RollbackSession::Rollback(Gbc& gbc) {
+  if (rollbackFrame_ >= frame_) {
+    return;
+  }
+
+  using namespace std::chrono;
+  const auto startTime = steady_clock::now();
+
+  // the frames being re-emulated were already seen, heard and counted with
+  // the mispredicted input, so only their state matters now
+  auto& hw = gbc.GetHardware();
+  const auto cpuTotals = hw.cpu.GetTotals();
+  gbc.LoadSnapshot(snapshots_[rollbackFrame_ & kNetplayHistoryMask]);
+
+  const auto audioOut = hw.apu.GetApuOutput();
+  const auto serialOut = hw.serial.GetSerialOutput();
+  const auto serialLink = hw.serial.GetSerialLink();
+  const bool renderSuppressed = hw.ppu.IsRenderSuppressed();
+
+  hw.apu.SetApuOutput(nullptr);
+  hw.serial.SetSerialOutput(nullptr);
+  hw.serial.SetSerialLink(nullptr);
+  hw.ppu.SetRenderSuppressed(true);
+
+  // the snapshot of the first frame is the one that was just restored
+  for (auto frame = rollbackFrame_; frame < frame_; ++frame) {
+    EmulateFrame(gbc, frame, frame != rollbackFrame_);
+  }
+
+  hw.apu.SetApuOutput(audioOut);
+  hw.serial.SetSerialOutput(serialOut);
+  hw.serial.SetSerialLink(serialLink);
+  hw.ppu.SetRenderSuppressed(renderSuppressed);
+  hw.cpu.RestoreTotals(cpuTotals);
+
+  const auto depth = frame_ - rollbackFrame_;
+  rollbackFrame_ = frame_;
+
+  ++stats_.numRollbacks;
+  stats_.lastRollbackFrames = depth;
+  stats_.maxRollbackFrames = std::max(stats_.maxRollbackFrames, depth);
+  stats_.rollbackCostMicros = util::SmoothCost(
+      stats_.rollbackCostMicros,
+      duration<double, std::micro>(steady_clock::now() - startTime).count());
+}
+
+void RollbackSession::EmulateFrame(Gbc& gbc, u32 frame, bool takeSnapshot) {
+  const auto slot = frame & kNetplayHistoryMask;
+
+  if (takeSnapshot) {
+    using namespace std::chrono;
+    const auto startTime = steady_clock::now();
+
+    gbc.SaveSnapshot(snapshots_[slot]);
+
+    stats_.snapshotCostMicros = util::SmoothCost(
+        stats_.snapshotCostMicros,
+        duration<double, std::micro>(steady_clock::now() - startTime).count());
+  }
+
+  usedRemoteKeys_[slot] = GetRemoteKeys(frame);
+
+  // leave the keys that the caller has pending alone, as they may be where the
+  // local player's keys are coming from
+  auto& joypad = gbc.GetHardware().joypad;
+  const auto pendingKeys = joypad.GetNextKeyStates();
+
+  joypad.SetKeyStates(localKeys_[slot] | usedRemoteKeys_[slot]);
+  joypad.CommitKeyStates();
+  joypad.SetKeyStates(pendingKeys);
+
+  gbc.UpdateFrame();
+}
+
+u8 RollbackSession::GetRemoteKeys(u32 frame) const {
+  const auto slot = frame & kNetplayHistoryMask;
+  if (remoteKeysFrame_[slot] == frame) {
+    return remoteKeys_[slot];
+  }
+
+  // predict that the peer is still holding whatever it held last
+  return remoteFrame_ > 0
+         ? remoteKeys_[(remoteFrame_ - 1) & kNetplayHistoryMask]
+         : 0;
+}
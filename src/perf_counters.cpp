@@ -0,0 +1,274 @@
+#include "perf_counters.h"
+#include <atomic>
+#include <cassert>
+
+#ifdef __linux__
+# include <linux/perf_event.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+# include <cerrno>
+# if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#  define SDGBC_PERF_HAS_RDPMC
+# endif
+#endif
+
+namespace {
+#ifdef __linux__
+  struct PerfCounterEvent {
+    u32 type;
+    u64 config;
+  };
+
+  const std::array<PerfCounterEvent, kNumPerfCounters> kPerfCounterEvents{{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D
+                         | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                         | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)}
+  }};
+
+  int OpenPerfEvent(const PerfCounterEvent& event, int groupFd) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = event.type;
+    attr.config = event.config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    // the calling thread, on whichever CPU it runs
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1,
+                                    groupFd, 0));
+  }
+#endif
+
+#ifdef SDGBC_PERF_HAS_RDPMC
+  u64 Rdpmc(u32 counter) {
+    u32 lo, hi;
+    asm volatile("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+    return (static_cast<u64>(hi) << 32) | lo;
+  }
+
+  // as described in linux/perf_event.h. the kernel bumps lock while it
+  // updates the page (e.g when the thread is moved to another CPU)
+  u64 ReadMmapPage(const volatile perf_event_mmap_page& page) {
+    u32 seq;
+    u64 count;
+
+    do {
+      seq = page.lock;
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+
+      const u32 idx = page.index;
+      count = page.offset;
+      if (page.cap_user_rdpmc && idx != 0) {
+        // sign-extend the counter from its width
+        const auto shift = 64u - page.pmc_width;
+        count += static_cast<u64>(static_cast<i64>(Rdpmc(idx - 1) << shift)
+                                  >> shift);
+      }
+
+      std::atomic_signal_fence(std::memory_order_seq_cst);
+    } while (page.lock != seq);
+
+    return count;
+  }
+#endif
+}
+
+std::string GetPerfCountersOpenResultAsMessage(PerfCountersOpenResult result) {
+  switch (result) {
+    case PerfCountersOpenResult::Ok:
+      return "Hardware counters opened successfully!";
+
+    case PerfCountersOpenResult::Unsupported:
+      return "Hardware counters are only supported on Linux.";
+
+    case PerfCountersOpenResult::NotPermitted:
+      return "Not permitted to open hardware counters (try lowering "
+             "/proc/sys/kernel/perf_event_paranoid).";
+
+    case PerfCountersOpenResult::NoCounters:
+      return "No hardware counters are available on this host.";
+
+    default: assert(!"unimplemented PerfCountersOpenResult message!");
+      return {};
+  }
+}
+
+const char* GetPerfCounterName(PerfCounter counter) {
+  switch (counter) {
+    case kPerfCounterCycles: return "cycles";
+    case kPerfCounterInstructions: return "instructions";
+    case kPerfCounterBranchMisses: return "branch_misses";
+    case kPerfCounterL1dMisses: return "l1d_misses";
+
+    default: assert(!"unimplemented PerfCounter name!");
+      return "";
+  }
+}
+
+PerfCounts operator-(const PerfCounts& lhs, const PerfCounts& rhs) {
+  PerfCounts result;
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    result[i] = lhs[i] - rhs[i];
+  }
+
+  return result;
+}
+
+PerfCounts& operator+=(PerfCounts& lhs, const PerfCounts& rhs) {
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    lhs[i] += rhs[i];
+  }
+
+  return lhs;
+}
+
+PerfCounters::PerfCounters()
+    : groupFd_(-1), numOpen_(0), hasFastReads_(false) {
+  fds_.fill(-1);
+  mmapPages_.fill(nullptr);
+  groupIdxs_.fill(0);
+}
+
+PerfCounters::~PerfCounters() {
+  Close();
+}
+
+PerfCountersOpenResult PerfCounters::Open() {
+  Close();
+
+#ifdef __linux__
+  auto result = PerfCountersOpenResult::NoCounters;
+
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    const auto fd = OpenPerfEvent(kPerfCounterEvents[i], groupFd_);
+    if (fd < 0) {
+      if (errno == EACCES || errno == EPERM) {
+        result = PerfCountersOpenResult::NotPermitted;
+      }
+
+      continue; // otherwise, the host doesn't have this counter
+    }
+
+    fds_[i] = fd;
+    groupIdxs_[i] = numOpen_++;
+    if (groupFd_ < 0) {
+      groupFd_ = fd;
+    }
+  }
+
+  if (numOpen_ == 0) {
+    return result;
+  }
+
+# ifdef SDGBC_PERF_HAS_RDPMC
+  // user-space reads need every counter's page, and the kernel to allow rdpmc
+  const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+  hasFastReads_ = true;
+
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    if (fds_[i] < 0) {
+      continue;
+    }
+
+    const auto page = mmap(nullptr, pageSize, PROT_READ, MAP_SHARED, fds_[i],
+                           0);
+    if (page == MAP_FAILED) {
+      hasFastReads_ = false;
+      continue;
+    }
+
+    mmapPages_[i] = page;
+    if (!static_cast<const perf_event_mmap_page*>(page)->cap_user_rdpmc) {
+      hasFastReads_ = false;
+    }
+  }
+# endif
+
+  return PerfCountersOpenResult::Ok;
+#else
+  return PerfCountersOpenResult::Unsupported;
+#endif
+}
+
+void PerfCounters::Close() {
+#ifdef __linux__
+  const auto pageSize = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    if (mmapPages_[i]) {
+      munmap(mmapPages_[i], pageSize);
+    }
+    if (fds_[i] >= 0) {
+      close(fds_[i]);
+    }
+  }
+#endif
+
+  fds_.fill(-1);
+  mmapPages_.fill(nullptr);
+  groupFd_ = -1;
+  numOpen_ = 0;
+  hasFastReads_ = false;
+}
+
+bool PerfCounters::IsOpen() const {
+  return numOpen_ > 0;
+}
+
+bool PerfCounters::IsCounting(PerfCounter counter) const {
+  return fds_[counter] >= 0;
+}
+
+bool PerfCounters::HasFastReads() const {
+  return hasFastReads_;
+}
+
+PerfCounts PerfCounters::Read() const {
+  if (!IsOpen()) {
+    return {};
+  }
+
+  return hasFastReads_ ? ReadMmapPages() : ReadGroup();
+}
+
+PerfCounts PerfCounters::ReadGroup() const {
+  PerfCounts counts{};
+
+#ifdef __linux__
+  // read as {nr, values[nr]}, in the order that the counters were opened
+  std::array<u64, 1 + kNumPerfCounters> values{};
+  const auto expectedSize = static_cast<ssize_t>((1 + numOpen_) * sizeof(u64));
+
+  if (read(groupFd_, values.data(), sizeof(values)) != expectedSize) {
+    return counts;
+  }
+
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    if (fds_[i] >= 0) {
+      counts[i] = values[1 + groupIdxs_[i]];
+    }
+  }
+#endif
+
+  return counts;
+}
+
+PerfCounts PerfCounters::ReadMmapPages() const {
+  PerfCounts counts{};
+
+#ifdef SDGBC_PERF_HAS_RDPMC
+  for (std::size_t i = 0; i < kNumPerfCounters; ++i) {
+    if (mmapPages_[i]) {
+      counts[i] = ReadMmapPage(
+          *static_cast<const volatile perf_event_mmap_page*>(mmapPages_[i]));
+    }
+  }
+#endif
+
+  return counts;
+}
@@ -0,0 +1,491 @@
+#include "remote_link_cable.h"
+#include "util.h"
+#include <algorithm>
+#include <chrono>
+
+// events sent in each packet at most, which keeps packets well within what
+// SocketNetplayTransport can receive
+constexpr std::size_t kRemoteLinkMaxPacketEvents = 64;
+
+constexpr u16 kPortListening = 0x100;
+
+namespace {
+  u64 NextMultiple(u64 time, u64 interval) {
+    return (time / interval + 1) * interval;
+  }
+}
+
+RemoteLinkCable::RemoteLinkCable()
+    : gbc_(nullptr), transport_(nullptr), isReplaying_(false),
+      replayApuOut_(nullptr), replaySerialOut_(nullptr),
+      replayRenderSuppressed_(false), replayCpuTotals_(), stats_() {}
+
+RemoteLinkCable::~RemoteLinkCable() {
+  Disconnect();
+}
+
+void RemoteLinkCable::Connect(Gbc& gbc, INetplayTransport& transport) {
+  Disconnect();
+
+  gbc_ = &gbc;
+  transport_ = &transport;
+
+  state_ = LinkState();
+  state_.portState = GetPortState();
+  frameEndTime_ = kNormalSpeedCyclesPerFrame;
+  nextServiceTime_ = nextSnapshotTime_ = 0;
+  replayEndTime_ = 0;
+
+  events_.clear();
+  resendTime_ = 0;
+  epoch_ = 0;
+
+  remoteEvents_.clear();
+  remoteTime_ = remotePrunedTime_ = 0;
+  remoteEpoch_ = 0;
+  remoteBasePortState_ = 0; // not listening after a reset
+
+  for (auto& snapshot : snapshots_) {
+    snapshot.isValid = false;
+  }
+  nextSnapshotIdx_ = 0;
+  stats_ = RemoteLinkCableStats();
+
+  gbc.GetHardware().serial.SetSerialLink(this);
+  gbc.GetHardware().apu.SetLazyModeAllowed(false);
+}
+
+void RemoteLinkCable::Disconnect() {
+  if (!gbc_) {
+    return;
+  }
+
+  SetReplaying(false);
+
+  auto& hw = gbc_->GetHardware();
+  hw.serial.SetSerialLink(nullptr);
+  hw.apu.SetLazyModeAllowed(true);
+
+  gbc_ = nullptr;
+  transport_ = nullptr;
+}
+
+bool RemoteLinkCable::IsConnected() const {
+  return gbc_ != nullptr;
+}
+
+bool RemoteLinkCable::UpdateFrame() {
+  if (!IsConnected()) {
+    return true;
+  }
+
+  if (!RunUntil(frameEndTime_)) {
+    return false;
+  }
+
+  frameEndTime_ += kNormalSpeedCyclesPerFrame;
+  return true;
+}
+
+void RemoteLinkCable::Poll() {
+  if (!IsConnected()) {
+    return;
+  }
+
+  Service();
+
+  // catch back up if that rolled us back
+  RunUntil(replayEndTime_);
+}
+
+bool RemoteLinkCable::IsSynchronized() const {
+  // the last instruction of a frame usually overshoots its end by a few
+  // cycles, and by a different amount for each side
+  const auto time = frameEndTime_ - kNormalSpeedCyclesPerFrame;
+  return remoteTime_ >= time && resendTime_ >= time
+         && replayEndTime_ <= state_.time;
+}
+
+const RemoteLinkCableStats& RemoteLinkCable::GetStats() const {
+  return stats_;
+}
+
+bool RemoteLinkCable::RunUntil(u64 endTime) {
+  const auto& cpu = gbc_->GetHardware().cpu;
+
+  while (state_.time < endTime) {
+    if (state_.time >= nextServiceTime_
+        || state_.time >= remoteTime_ + kRemoteLinkMaxSpeculationCycles) {
+      nextServiceTime_ = NextMultiple(state_.time, kRemoteLinkServiceCycles);
+      Service();
+
+      if (state_.time >= remoteTime_ + kRemoteLinkMaxSpeculationCycles) {
+        ++stats_.numStalls;
+        SetReplaying(false);
+        return false;
+      }
+    }
+
+    if (state_.time >= nextSnapshotTime_) {
+      nextSnapshotTime_ = NextMultiple(state_.time,
+                                       kRemoteLinkSnapshotCycles);
+      TakeSnapshot();
+    }
+
+    SetReplaying(state_.time < replayEndTime_);
+    ApplyRemoteTransfers();
+
+    // events caused by this instruction are timed from when it started
+    const auto instructionTime = state_.time;
+    // don't scale the amount of cycles with CPU double speed mode
+    state_.time += util::RescaleCycles(cpu, gbc_->Update());
+
+    const auto portState = GetPortState();
+    if (portState != state_.portState) {
+      state_.portState = portState;
+      events_.push_back({instructionTime, EventType::PortState, portState});
+    }
+  }
+
+  SetReplaying(false);
+  return true;
+}
+
+void RemoteLinkCable::SetReplaying(bool isReplaying) {
+  if (isReplaying == isReplaying_) {
+    return;
+  }
+
+  // the time being ran again was already seen, heard and counted with the
+  // peer's mispredicted input, so only its state matters now
+  auto& hw = gbc_->GetHardware();
+  if (isReplaying) {
+    replayCpuTotals_ = hw.cpu.GetTotals();
+    replayApuOut_ = hw.apu.GetApuOutput();
+    replaySerialOut_ = hw.serial.GetSerialOutput();
+    replayRenderSuppressed_ = hw.ppu.IsRenderSuppressed();
+
+    hw.apu.SetApuOutput(nullptr);
+    hw.serial.SetSerialOutput(nullptr);
+    hw.ppu.SetRenderSuppressed(true);
+  } else {
+    hw.apu.SetApuOutput(replayApuOut_);
+    hw.serial.SetSerialOutput(replaySerialOut_);
+    hw.ppu.SetRenderSuppressed(replayRenderSuppressed_);
+    hw.cpu.RestoreTotals(replayCpuTotals_);
+  }
+
+  isReplaying_ = isReplaying;
+}
+
+bool RemoteLinkCable::SerialExchangeBit(bool bitSet) {
+  // the whole byte received is whatever the peer was listening with when the
+  // first bit was clocked
+  if (state_.exchangeBitIdx == 0) {
+    const auto remotePortState = GetRemotePortState(state_.time);
+    state_.lastLookupTime = state_.time;
+    state_.exchangeInByte = remotePortState & kPortListening
+                                ? remotePortState & 0xff
+                                : 0xff;
+    state_.exchangeOutByte = 0;
+  }
+
+  const bool receivedBit = ((state_.exchangeInByte
+                             >> (7 - state_.exchangeBitIdx)) & 1) != 0;
+  state_.exchangeOutByte = static_cast<u8>((state_.exchangeOutByte << 1)
+                                           | (bitSet ? 1 : 0));
+
+  if (++state_.exchangeBitIdx == 8) {
+    state_.exchangeBitIdx = 0;
+    events_.push_back({state_.time, EventType::Transfer,
+                       state_.exchangeOutByte});
+
+    if (!isReplaying_) {
+      ++stats_.numTransfers;
+    }
+  }
+
+  return receivedBit;
+}
+
+void RemoteLinkCable::Service() {
+  ReceivePackets();
+  SendEvents();
+}
+
+void RemoteLinkCable::ReceivePackets() {
+  while (transport_->NetplayReceive(packet_)) {
+    HandlePacket(packet_);
+  }
+}
+
+void RemoteLinkCable::HandlePacket(const std::vector<u8>& packet) {
+  StateReader reader(packet.data(), packet.size());
+
+  if (reader.Read32() != kRemoteLinkPacketMagic) {
+    return;
+  }
+
+  const auto epoch = reader.Read32();
+  const auto ackEpoch = reader.Read32();
+  const auto ackTime = reader.Read64();
+  auto fromTime = reader.Read64();
+  const auto remoteTime = reader.Read64();
+  const auto numEvents = reader.Read8();
+
+  packetEvents_.clear();
+  for (auto i = 0u; i < numEvents; ++i) {
+    Event event;
+    event.time = reader.Read64();
+    event.type = static_cast<EventType>(reader.Read8());
+    event.value = reader.Read16();
+
+    // anything older than we keep has already been taken into account
+    if (event.time >= remotePrunedTime_) {
+      packetEvents_.push_back(event);
+    }
+  }
+
+  if (reader.HasError() || reader.GetBytesLeft() > 0) {
+    return;
+  }
+
+  // the peer only skips events that we've acknowledged, so this shouldn't
+  // happen, but a gap in the peer's timeline would go unnoticed otherwise
+  if (fromTime > remoteTime_) {
+    return;
+  }
+
+  if (ackEpoch == epoch_) {
+    resendTime_ = std::max(resendTime_, ackTime);
+  }
+
+  remoteEpoch_ = epoch;
+  remoteTime_ = remoteTime;
+  fromTime = std::max(fromTime, remotePrunedTime_);
+
+  // the packet replaces what we had of the peer's timeline between fromTime
+  // and remoteTime. anything after that is left as our prediction of what
+  // the peer will do, even if the peer rolled back since sending it, as it
+  // will most likely happen again the same way
+  const auto oldIt = std::lower_bound(remoteEvents_.begin(),
+                                      remoteEvents_.end(), fromTime,
+                                      IsEventBefore);
+  const auto oldEndIt = std::lower_bound(oldIt, remoteEvents_.end(),
+                                         remoteTime, IsEventBefore);
+
+  // find the earliest time that the peer's timeline changed from what we had
+  auto oldMismatchIt = oldIt;
+  auto newMismatchIt = packetEvents_.begin();
+
+  while (oldMismatchIt != oldEndIt && newMismatchIt != packetEvents_.end()
+         && oldMismatchIt->time == newMismatchIt->time
+         && oldMismatchIt->type == newMismatchIt->type
+         && oldMismatchIt->value == newMismatchIt->value) {
+    ++oldMismatchIt;
+    ++newMismatchIt;
+  }
+
+  u64 changeTime = ~u64(0);
+  if (oldMismatchIt != oldEndIt) {
+    changeTime = oldMismatchIt->time;
+  }
+  if (newMismatchIt != packetEvents_.end()) {
+    changeTime = std::min(changeTime, newMismatchIt->time);
+  }
+
+  // only roll back if what changed was used: the peer's port state when we
+  // clocked a transfer, or a transfer that the peer clocked
+  const auto isUsedTransfer = [this, changeTime](const Event& event) {
+    return event.type == EventType::Transfer && event.time >= changeTime
+           && event.time < state_.appliedTime;
+  };
+
+  const bool needsRollback =
+      changeTime <= state_.lastLookupTime
+      || std::any_of(oldMismatchIt, oldEndIt, isUsedTransfer)
+      || std::any_of(newMismatchIt, packetEvents_.end(), isUsedTransfer);
+
+  const auto insertIt = remoteEvents_.erase(oldIt, oldEndIt);
+  remoteEvents_.insert(insertIt, packetEvents_.begin(), packetEvents_.end());
+
+  if (needsRollback) {
+    Rollback(changeTime);
+  }
+}
+
+void RemoteLinkCable::SendEvents() {
+  const auto firstIt = std::lower_bound(
+      events_.begin(), events_.end(), resendTime_, IsEventBefore);
+  const auto numEvents = std::min<std::size_t>(events_.end() - firstIt,
+                                               kRemoteLinkMaxPacketEvents);
+  const auto endIt = firstIt + numEvents;
+
+  // if not everything fits, the peer only hears about the time before the
+  // events left out
+  const auto time = endIt != events_.end() ? endIt->time : state_.time;
+
+  packet_.clear();
+  StateWriter writer(packet_);
+
+  writer.Write32(kRemoteLinkPacketMagic);
+  writer.Write32(epoch_);
+  writer.Write32(remoteEpoch_);
+  writer.Write64(remoteTime_);
+  writer.Write64(resendTime_);
+  writer.Write64(time);
+  writer.Write8(static_cast<u8>(numEvents));
+
+  for (auto it = firstIt; it != endIt; ++it) {
+    writer.Write64(it->time);
+    writer.Write8(static_cast<u8>(it->type));
+    writer.Write16(it->value);
+  }
+
+  transport_->NetplaySend(packet_);
+}
+
+void RemoteLinkCable::TakeSnapshot() {
+  using namespace std::chrono;
+  const auto startTime = steady_clock::now();
+
+  auto& snapshot = snapshots_[nextSnapshotIdx_];
+  nextSnapshotIdx_ = (nextSnapshotIdx_ + 1) % snapshots_.size();
+
+  gbc_->SaveSnapshot(snapshot.data);
+  snapshot.state = state_;
+  snapshot.isValid = true;
+
+  stats_.snapshotCostMicros = util::SmoothCost(
+      stats_.snapshotCostMicros,
+      duration<double, std::micro>(steady_clock::now() - startTime).count());
+
+  PruneEvents();
+}
+
+void RemoteLinkCable::Rollback(u64 changeTime) {
+  // find the latest snapshot taken no later than the change
+  std::size_t idx = nextSnapshotIdx_;
+  bool found = false;
+
+  for (std::size_t i = 0; i < snapshots_.size(); ++i) {
+    idx = (idx + snapshots_.size() - 1) % snapshots_.size();
+
+    const auto& snapshot = snapshots_[idx];
+    if (snapshot.isValid && snapshot.state.time <= changeTime) {
+      found = true;
+      break;
+    }
+  }
+
+  if (!found) {
+    ++stats_.numFailedRollbacks;
+    return;
+  }
+
+  using namespace std::chrono;
+  const auto startTime = steady_clock::now();
+
+  const auto& snapshot = snapshots_[idx];
+  const auto rollbackTime = state_.time;
+
+  SetReplaying(false);
+  gbc_->LoadSnapshot(snapshot.data);
+  state_ = snapshot.state;
+
+  // later snapshots belong to the timeline being abandoned
+  for (auto i = (idx + 1) % snapshots_.size(); i != nextSnapshotIdx_;
+       i = (i + 1) % snapshots_.size()) {
+    snapshots_[i].isValid = false;
+  }
+  nextSnapshotIdx_ = idx;
+  nextSnapshotTime_ = state_.time;
+  nextServiceTime_ = NextMultiple(state_.time, kRemoteLinkServiceCycles);
+  replayEndTime_ = std::max(replayEndTime_, rollbackTime);
+
+  // our events from then on will happen again (perhaps differently), so the
+  // peer needs to hear about them again
+  events_.erase(std::lower_bound(events_.begin(), events_.end(), state_.time,
+                                 IsEventBefore),
+                events_.end());
+  resendTime_ = std::min(resendTime_, state_.time);
+  ++epoch_;
+
+  const auto depth = rollbackTime - state_.time;
+  ++stats_.numRollbacks;
+  stats_.lastRollbackCycles = depth;
+  stats_.maxRollbackCycles = std::max(stats_.maxRollbackCycles, depth);
+  stats_.rollbackCostMicros = util::SmoothCost(
+      stats_.rollbackCostMicros,
+      duration<double, std::micro>(steady_clock::now() - startTime).count());
+}
+
+void RemoteLinkCable::ApplyRemoteTransfers() {
+  auto it = std::lower_bound(
+      remoteEvents_.begin(), remoteEvents_.end(), state_.appliedTime,
+      IsEventBefore);
+
+  auto& serial = gbc_->GetHardware().serial;
+  for (; it != remoteEvents_.end() && it->time <= state_.time; ++it) {
+    if (it->type != EventType::Transfer) {
+      continue;
+    }
+
+    // does nothing if we aren't listening, in which case the peer received
+    // 1s (as far as it knew)
+    bool sentBit;
+    for (int i = 7; i >= 0; --i) {
+      serial.ClockExternalBit(((it->value >> i) & 1) != 0, sentBit);
+    }
+  }
+
+  state_.appliedTime = state_.time + 1;
+}
+
+void RemoteLinkCable::PruneEvents() {
+  // the peer has everything of ours before the time it acknowledged
+  events_.erase(events_.begin(),
+                std::lower_bound(events_.begin(), events_.end(), resendTime_,
+                                 IsEventBefore));
+
+  // the peer's events are only needed from the oldest snapshot on
+  auto pruneTime = remoteTime_;
+  for (const auto& snapshot : snapshots_) {
+    if (snapshot.isValid) {
+      pruneTime = std::min(pruneTime, snapshot.state.time);
+    }
+  }
+  const auto pruneIt = std::lower_bound(
+      remoteEvents_.begin(), remoteEvents_.end(), pruneTime, IsEventBefore);
+
+  for (auto it = remoteEvents_.begin(); it != pruneIt; ++it) {
+    if (it->type == EventType::PortState) {
+      remoteBasePortState_ = it->value;
+    }
+  }
+
+  remoteEvents_.erase(remoteEvents_.begin(), pruneIt);
+  remotePrunedTime_ = std::max(remotePrunedTime_, pruneTime);
+}
+
+bool RemoteLinkCable::IsEventBefore(const Event& event, u64 time) {
+  return event.time < time;
+}
+
+u16 RemoteLinkCable::GetPortState() const {
+  const auto& serial = gbc_->GetHardware().serial;
+  return (serial.GetSc() & 0x81) == 0x80 ? kPortListening | serial.GetSb()
+                                         : 0;
+}
+
+u16 RemoteLinkCable::GetRemotePortState(u64 time) const {
+  // the latest change no later than time, predicting no changes after the
+  // last that we know of
+  for (auto it = remoteEvents_.rbegin(); it != remoteEvents_.rend(); ++it) {
+    if (it->type == EventType::PortState && it->time <= time) {
+      return it->value;
+    }
+  }
+
+  return remoteBasePortState_;
+}
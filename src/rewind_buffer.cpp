@@ -0,0 +1,291 @@
+#include "rewind_buffer.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+// encoded data is a sequence of runs, each starting with a header byte:
+//   0x00-0x7f: a literal run of (header + 1) bytes follows
+//   0x80-0xff: a repeat run; the next byte holds the low 8 bits of the count
+//              (with the header's low 7 bits as the high bits) minus
+//              kMinRepeatRunLength, followed by the byte to repeat
+constexpr std::size_t kMaxLiteralRunLength = 0x80;
+constexpr std::size_t kMinRepeatRunLength = 4;
+constexpr std::size_t kMaxRepeatRunLength = 0x7fff + kMinRepeatRunLength;
+
+namespace {
+  // encodes (data XOR base), or just data if base is nullptr
+  void EncodeXorRle(const u8* data, const u8* base, std::size_t size,
+                    std::vector<u8>& out) {
+    out.clear();
+
+    const auto byteAt = [&](std::size_t i) -> u8 {
+      return base ? data[i] ^ base[i] : data[i];
+    };
+
+    std::size_t literalStart = 0, i = 0;
+
+    const auto flushLiterals = [&](std::size_t end) {
+      while (literalStart < end) {
+        const auto len = std::min(end - literalStart, kMaxLiteralRunLength);
+        out.push_back(static_cast<u8>(len - 1));
+        for (std::size_t j = 0; j < len; ++j) {
+          out.push_back(byteAt(literalStart + j));
+        }
+        literalStart += len;
+      }
+    };
+
+    while (i < size) {
+      const u8 val = byteAt(i);
+
+      std::size_t runEnd = i + 1;
+      while (runEnd < size && runEnd - i < kMaxRepeatRunLength &&
+             byteAt(runEnd) == val) {
+        ++runEnd;
+      }
+
+      if (runEnd - i >= kMinRepeatRunLength) {
+        flushLiterals(i);
+
+        const auto count = runEnd - i - kMinRepeatRunLength;
+        out.push_back(static_cast<u8>(0x80 | (count >> 8)));
+        out.push_back(static_cast<u8>(count & 0xff));
+        out.push_back(val);
+
+        i = literalStart = runEnd;
+      } else {
+        i = runEnd;
+      }
+    }
+
+    flushLiterals(size);
+  }
+
+  // decodes into out (of the given size), XORing against base if not nullptr.
+  // returns false if the encoded data doesn't decode to exactly size bytes
+  bool DecodeXorRle(const std::vector<u8>& in, const u8* base, u8* out,
+                    std::size_t size) {
+    std::size_t inPos = 0, outPos = 0;
+
+    while (inPos < in.size()) {
+      const u8 header = in[inPos++];
+
+      if (header < 0x80) {
+        const std::size_t len = header + 1u;
+        if (inPos + len > in.size() || outPos + len > size) {
+          return false;
+        }
+
+        std::memcpy(out + outPos, &in[inPos], len);
+        inPos += len;
+        outPos += len;
+      } else {
+        if (inPos + 2 > in.size()) {
+          return false;
+        }
+
+        const std::size_t len = (((header & 0x7fu) << 8) | in[inPos])
+                                + kMinRepeatRunLength;
+        const u8 val = in[inPos + 1];
+        inPos += 2;
+
+        if (outPos + len > size) {
+          return false;
+        }
+
+        std::memset(out + outPos, val, len);
+        outPos += len;
+      }
+    }
+
+    if (base) {
+      for (std::size_t j = 0; j < size; ++j) {
+        out[j] ^= base[j];
+      }
+    }
+
+    return outPos == size;
+  }
+}
+
+RewindBuffer::RewindBuffer()
+    : maxEntries_(std::numeric_limits<std::size_t>::max()),
+      maxMemoryBytes_(0), keyframeInterval_(kRewindDefaultKeyframeInterval),
+      stateSize_(0), entriesMemoryUsage_(0), freeMemoryUsage_(0),
+      numKeyframes_(0), isKeyframeValid_(false), entriesSinceKeyframe_(0) {}
+
+void RewindBuffer::SetLimits(std::size_t maxEntries,
+                             std::size_t maxMemoryBytes) {
+  maxEntries_ = maxEntries;
+  maxMemoryBytes_ = maxMemoryBytes;
+
+  while (numKeyframes_ > 0 &&
+         (entries_.size() > maxEntries_ ||
+          (maxMemoryBytes_ > 0 && GetMemoryUsage() > maxMemoryBytes_))) {
+    EvictOldest();
+  }
+}
+
+void RewindBuffer::SetKeyframeInterval(unsigned int interval) {
+  keyframeInterval_ = std::max(1u, interval);
+}
+
+void RewindBuffer::Clear() {
+  while (!entries_.empty()) {
+    RecycleEntry(std::move(entries_.back()));
+    entries_.pop_back();
+  }
+
+  numKeyframes_ = 0;
+  isKeyframeValid_ = false;
+  entriesSinceKeyframe_ = 0;
+}
+
+void RewindBuffer::Push(const std::vector<u8>& state) {
+  if (maxEntries_ == 0 || state.empty()) {
+    return;
+  }
+
+  if (state.size() != stateSize_) {
+    Clear();
+    stateSize_ = state.size();
+  }
+
+  const bool isKeyframe = !SyncKeyframe() ||
+                          entriesSinceKeyframe_ >= keyframeInterval_;
+
+  Entry entry;
+  entry.isKeyframe = isKeyframe;
+  entry.data = TakeFreeBuffer();
+
+  if (isKeyframe) {
+    EncodeXorRle(state.data(), nullptr, state.size(), entry.data);
+    keyframe_ = state;
+    isKeyframeValid_ = true;
+    entriesSinceKeyframe_ = 0;
+    ++numKeyframes_;
+  } else {
+    EncodeXorRle(state.data(), keyframe_.data(), state.size(), entry.data);
+    ++entriesSinceKeyframe_;
+  }
+
+  entriesMemoryUsage_ += entry.data.capacity();
+  entries_.push_back(std::move(entry));
+
+  // never evict the group that the entry we've just pushed belongs to
+  while (numKeyframes_ > 1 &&
+         (entries_.size() > maxEntries_ ||
+          (maxMemoryBytes_ > 0 && GetMemoryUsage() > maxMemoryBytes_))) {
+    EvictOldest();
+  }
+}
+
+bool RewindBuffer::Pop(std::vector<u8>& outState) {
+  if (entries_.empty()) {
+    return false;
+  }
+
+  auto& entry = entries_.back();
+  bool decoded;
+
+  if (entry.isKeyframe) {
+    if (isKeyframeValid_) {
+      outState = keyframe_;
+      decoded = true;
+    } else {
+      outState.resize(stateSize_);
+      decoded = DecodeXorRle(entry.data, nullptr, outState.data(), stateSize_);
+    }
+
+    isKeyframeValid_ = false;
+    --numKeyframes_;
+  } else {
+    if (!SyncKeyframe()) {
+      return false;
+    }
+
+    outState.resize(stateSize_);
+    decoded = DecodeXorRle(entry.data, keyframe_.data(), outState.data(),
+                           stateSize_);
+    --entriesSinceKeyframe_;
+  }
+
+  assert(decoded);
+
+  RecycleEntry(std::move(entry));
+  entries_.pop_back();
+
+  return decoded;
+}
+
+std::size_t RewindBuffer::GetNumEntries() const {
+  return entries_.size();
+}
+
+std::size_t RewindBuffer::GetMemoryUsage() const {
+  return entriesMemoryUsage_ + freeMemoryUsage_ + keyframe_.capacity();
+}
+
+bool RewindBuffer::SyncKeyframe() {
+  if (isKeyframeValid_) {
+    return true;
+  }
+
+  // the keyframe of the newest group was popped (or evicted); find and decode
+  // the keyframe of what is now the newest group
+  for (auto it = entries_.rbegin(); it != entries_.rend(); ++it) {
+    if (it->isKeyframe) {
+      keyframe_.resize(stateSize_);
+      if (!DecodeXorRle(it->data, nullptr, keyframe_.data(), stateSize_)) {
+        return false;
+      }
+
+      isKeyframeValid_ = true;
+      entriesSinceKeyframe_ = static_cast<unsigned int>(
+          std::distance(entries_.rbegin(), it));
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void RewindBuffer::EvictOldest() {
+  // deltas are useless without their keyframe, so drop the whole group
+  do {
+    if (entries_.front().isKeyframe) {
+      --numKeyframes_;
+    }
+
+    RecycleEntry(std::move(entries_.front()));
+    entries_.pop_front();
+  } while (!entries_.empty() && !entries_.front().isKeyframe);
+
+  if (numKeyframes_ == 0) {
+    isKeyframeValid_ = false;
+    entriesSinceKeyframe_ = 0;
+  }
+}
+
+std::vector<u8> RewindBuffer::TakeFreeBuffer() {
+  if (freeBuffers_.empty()) {
+    return {};
+  }
+
+  auto buffer = std::move(freeBuffers_.back());
+  freeBuffers_.pop_back();
+  freeMemoryUsage_ -= buffer.capacity();
+  return buffer;
+}
+
+void RewindBuffer::RecycleEntry(Entry&& entry) {
+  entriesMemoryUsage_ -= entry.data.capacity();
+
+  // keyframe buffers are much larger than what deltas need, so let them go.
+  // only keep enough spare buffers to cover a full group of entries
+  if (!entry.isKeyframe && freeBuffers_.size() < keyframeInterval_) {
+    freeMemoryUsage_ += entry.data.capacity();
+    freeBuffers_.push_back(std::move(entry.data));
+  }
+}
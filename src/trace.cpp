@@ -0,0 +1,230 @@
+#include "trace.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> trace::detail::isRecording(false);
+
+namespace {
+  struct TraceEvent {
+    const char* name;
+    u64 startNanos, endNanos;
+  };
+
+  // only the owning thread writes events. a buffer is emptied by its owner
+  // the first time that it records into a new recording, which it notices by
+  // its recording number being out of date
+  struct ThreadBuffer {
+    std::vector<TraceEvent> events;
+    std::atomic<std::size_t> numEvents;
+    std::atomic<u64> numDropped;
+    std::atomic<u32> recordingNum;
+
+    // guarded by bufferListMutex
+    unsigned int threadId;
+    const char* threadName;
+    bool isOwned;
+  };
+
+  const auto kStartTime = std::chrono::steady_clock::now();
+
+  std::atomic<u32> recordingNum(0);
+
+  // buffers are kept after their thread exits so that its zones can still be
+  // written out, but a new thread takes one over if it has nothing recorded
+  // in the current recording
+  std::mutex bufferListMutex;
+  std::vector<std::unique_ptr<ThreadBuffer>> bufferList;
+
+  ThreadBuffer* AcquireBuffer(const char* threadName) {
+    std::lock_guard<std::mutex> lock(bufferListMutex);
+
+    const auto currentNum = recordingNum.load(std::memory_order_relaxed);
+    for (const auto& buffer : bufferList) {
+      if (!buffer->isOwned
+          && buffer->recordingNum.load(std::memory_order_relaxed)
+             != currentNum) {
+        buffer->isOwned = true;
+        buffer->threadName = threadName;
+        return buffer.get();
+      }
+    }
+
+    std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+    buffer->events.resize(kTraceMaxEventsPerThread);
+    buffer->numEvents = 0;
+    buffer->numDropped = 0;
+    buffer->recordingNum = currentNum - 1; // emptied by its first zone
+    buffer->threadId = static_cast<unsigned int>(bufferList.size()) + 1;
+    buffer->threadName = threadName;
+    buffer->isOwned = true;
+
+    bufferList.push_back(std::move(buffer));
+    return bufferList.back().get();
+  }
+
+  // takes a buffer for this thread when it first records a zone, and gives
+  // it up when the thread exits
+  class ThreadBufferOwner {
+  public:
+    ThreadBufferOwner() : buffer_(nullptr), threadName_(nullptr) {}
+
+    ~ThreadBufferOwner() {
+      if (buffer_) {
+        std::lock_guard<std::mutex> lock(bufferListMutex);
+        buffer_->isOwned = false;
+      }
+    }
+
+    ThreadBuffer& Get() {
+      if (!buffer_) {
+        buffer_ = AcquireBuffer(threadName_);
+      }
+
+      return *buffer_;
+    }
+
+    void SetThreadName(const char* name) {
+      if (name == threadName_) {
+        return;
+      }
+
+      threadName_ = name;
+
+      if (buffer_) {
+        std::lock_guard<std::mutex> lock(bufferListMutex);
+        buffer_->threadName = name;
+      }
+    }
+
+  private:
+    ThreadBuffer* buffer_;
+    const char* threadName_;
+  };
+
+  thread_local ThreadBufferOwner threadBuffer;
+
+  void WriteJsonString(std::ostream& os, const char* str) {
+    os << '"';
+    for (; *str; ++str) {
+      if (*str == '"' || *str == '\\') {
+        os << '\\';
+      }
+
+      os << *str;
+    }
+    os << '"';
+  }
+}
+
+void trace::StartRecording() {
+  recordingNum.fetch_add(1, std::memory_order_acq_rel);
+  detail::isRecording.store(true, std::memory_order_release);
+}
+
+void trace::StopRecording() {
+  detail::isRecording.store(false, std::memory_order_release);
+}
+
+void trace::SetThreadName(const char* name) {
+  threadBuffer.SetThreadName(name);
+}
+
+u64 trace::GetNanos() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now() - kStartTime).count();
+}
+
+void trace::RecordZone(const char* name, u64 startNanos, u64 endNanos) {
+  auto& buffer = threadBuffer.Get();
+
+  const auto currentNum = recordingNum.load(std::memory_order_acquire);
+  if (buffer.recordingNum.load(std::memory_order_relaxed) != currentNum) {
+    // empty the buffer before marking it as part of the new recording, so
+    // that a reader who sees the new number also sees it empty
+    buffer.numEvents.store(0, std::memory_order_relaxed);
+    buffer.numDropped.store(0, std::memory_order_relaxed);
+    buffer.recordingNum.store(currentNum, std::memory_order_release);
+  }
+
+  const auto idx = buffer.numEvents.load(std::memory_order_relaxed);
+  if (idx >= buffer.events.size()) {
+    buffer.numDropped.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  buffer.events[idx] = {name, startNanos, endNanos};
+  buffer.numEvents.store(idx + 1, std::memory_order_release);
+}
+
+u64 trace::GetNumDroppedEvents() {
+  std::lock_guard<std::mutex> lock(bufferListMutex);
+
+  const auto currentNum = recordingNum.load(std::memory_order_acquire);
+  u64 numDropped = 0;
+  for (const auto& buffer : bufferList) {
+    if (buffer->recordingNum.load(std::memory_order_acquire) == currentNum) {
+      numDropped += buffer->numDropped.load(std::memory_order_relaxed);
+    }
+  }
+
+  return numDropped;
+}
+
+bool trace::WriteChromeJson(std::ostream& os) {
+  std::lock_guard<std::mutex> lock(bufferListMutex);
+
+  const auto currentNum = recordingNum.load(std::memory_order_acquire);
+  const auto oldFlags = os.flags();
+  const auto oldPrecision = os.precision();
+  os.setf(std::ios::fixed, std::ios::floatfield);
+  os.precision(3);
+
+  // Chrome's trace event format: complete ("X") events with their times in
+  // microseconds, plus metadata ("M") events naming the threads
+  os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+
+  auto isFirstEvent = true;
+  const auto writeEventStart = [&](const char* name, char phase,
+                                   unsigned int threadId) {
+    os << (isFirstEvent ? "\n" : ",\n") << "{\"name\": ";
+    WriteJsonString(os, name);
+    os << ", \"ph\": \"" << phase << "\", \"pid\": 1, \"tid\": " << threadId;
+    isFirstEvent = false;
+  };
+
+  for (const auto& buffer : bufferList) {
+    if (buffer->recordingNum.load(std::memory_order_acquire) != currentNum) {
+      continue; // nothing recorded by this thread
+    }
+
+    const auto numEvents = buffer->numEvents.load(std::memory_order_acquire);
+    if (buffer->threadName) {
+      writeEventStart("thread_name", 'M', buffer->threadId);
+      os << ", \"args\": {\"name\": ";
+      WriteJsonString(os, buffer->threadName);
+      os << "}}";
+    }
+
+    for (std::size_t i = 0; i < numEvents; ++i) {
+      const auto& event = buffer->events[i];
+
+      writeEventStart(event.name, 'X', buffer->threadId);
+      os << ", \"ts\": " << event.startNanos / 1000.0
+         << ", \"dur\": " << (event.endNanos - event.startNanos) / 1000.0
+         << '}';
+    }
+  }
+
+  os << "\n]}\n";
+  os.flags(oldFlags);
+  os.precision(oldPrecision);
+  return static_cast<bool>(os);
+}
+
+bool trace::WriteChromeJsonFile(const std::string& filePath) {
+  std::ofstream file(filePath);
+  return file && WriteChromeJson(file);
+}
@@ -81,3 +81,15 @@ bool util::WriteBinaryStream(std::ostream& os, const std::vector<u8>& data) {
   os.write(reinterpret_cast<const char*>(&data[0]), data.size());
   return !os.fail();
 }
+
+u64 util::HashFnv1a64(const u8* data, std::size_t size, u64 hash) {
+  for (std::size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 0x100000001b3;
+  }
+
+  return hash;
+}
+
+double util::SmoothCost(double avgMicros, double sampleMicros) {
+  return avgMicros + (sampleMicros - avgMicros) / 16.0;
+}
@@ -0,0 +1,57 @@
+#include "video/buffer_lcd.h"
+
+constexpr u32 kWhitePixel = 0x00ffffff;
+
+BufferLcd::BufferLcd() : numRefreshes_(0), isLcdOn_(false) {
+  ClearToWhite();
+}
+
+void BufferLcd::LcdPower(bool powerOn) {
+  isLcdOn_ = powerOn;
+
+  if (!isLcdOn_) {
+    ClearToWhite();
+  }
+}
+
+void BufferLcd::LcdRefresh() {
+  frontBuffer_ = backBuffer_;
+  ++numRefreshes_;
+}
+
+void BufferLcd::LcdPutPixel(unsigned int x, unsigned int y,
+                            const RgbColor& color) {
+  if (x < kLcdWidthPixels && y < kLcdHeightPixels) {
+    backBuffer_[y * kLcdWidthPixels + x] = (color.r << 16) | (color.g << 8)
+                                           | color.b;
+  }
+}
+
+const LcdFrameBuffer& BufferLcd::GetFrameBuffer() const {
+  return frontBuffer_;
+}
+
+u64 BufferLcd::CalculateFrameHash() const {
+  u64 hash = 0xcbf29ce484222325;
+
+  for (const auto pixel : frontBuffer_) {
+    for (auto i = 0u; i < 3; ++i) {
+      hash = (hash ^ ((pixel >> (i * 8)) & 0xff)) * 0x100000001b3;
+    }
+  }
+
+  return hash;
+}
+
+u64 BufferLcd::GetNumRefreshes() const {
+  return numRefreshes_;
+}
+
+bool BufferLcd::IsLcdOn() const {
+  return isLcdOn_;
+}
+
+void BufferLcd::ClearToWhite() {
+  frontBuffer_.fill(kWhitePixel);
+  backBuffer_.fill(kWhitePixel);
+}
@@ -49,7 +49,7 @@ bool App::OnInit() {
 
 int App::OnRun() {
   if (cpuCmdMode_) {
-    return CpuCmdMode().Run(startupRomFilePath_);
+    return CpuCmdMode().Run(startupRomFilePath_, startupSymFilePath_);
   } else {
     return wxApp::OnRun();
   }
@@ -106,6 +106,8 @@ void App::OnInitCmdLine(wxCmdLineParser& parser) {
   parser.AddParam("path of the program ROM file to be loaded at startup",
                   wxCMD_LINE_VAL_STRING, wxCMD_LINE_PARAM_OPTIONAL);
   parser.AddLongSwitch("cpu-cmd", "start using the command-line CPU debugger");
+  parser.AddLongOption("sym", "RGBDS .sym file to name profiled code with in "
+                              "the CPU debugger");
 }
 
 bool App::OnCmdLineParsed(wxCmdLineParser& parser) {
@@ -114,6 +116,11 @@ bool App::OnCmdLineParsed(wxCmdLineParser& parser) {
     startupRomFilePath_ = parser.GetParam(0);
   }
 
+  wxString symFilePath;
+  if (parser.Found("sym", &symFilePath)) {
+    startupSymFilePath_ = symFilePath.ToStdString();
+  }
+
   cpuCmdMode_ = parser.Found("cpu-cmd");
   return true;
 }
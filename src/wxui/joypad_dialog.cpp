@@ -20,6 +20,14 @@ JoypadDialog::JoypadDialog(wxWindow* parent)
   infoSizer->Add(new wxStaticText(this, wxID_ANY,
                                   "Arrow Keys = Direction Buttons."),
                  0, wxCENTER);
+  infoSizer->AddSpacer(15);
+
+  infoSizer->Add(new wxStaticText(this, wxID_ANY,
+                                  "Hold Backspace = Rewind."),
+                 0, wxCENTER);
+  infoSizer->Add(new wxStaticText(this, wxID_ANY,
+                                  "Ctrl+F = Toggle Fast-Forward."),
+                 0, wxCENTER);
   infoSizer->AddSpacer(10);
 
   auto mainSizer = new wxBoxSizer(wxVERTICAL);
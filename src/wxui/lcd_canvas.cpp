@@ -1,12 +1,13 @@
+#include "trace.h"
 #include "wxui/lcd_canvas.h"
 
+constexpr auto kLcdFreshFrameBit = 0x4u;
+
 LcdCanvas::LcdCanvas(wxWindow* parent, wxWindowID id, const wxPoint& pos,
                      const wxSize& size, long style)
     : SfmlCanvas(parent, id, pos, size, style),
-      lcdFrontBuffer_(&lcdFrameBuffers_[0]),
-      lcdBackBuffer_(&lcdFrameBuffers_[1]),
-      lcdTextureNeedsRefresh_(false), maintainAspectRatio_(true),
-      isLcdOn_(false) {
+      lcdBackIndex_(0), lcdFrontIndex_(1), lcdReadyIndex_(2),
+      maintainAspectRatio_(true), isLcdOn_(false) {
   setFramerateLimit(60);
   lcdTexture_.setSmooth(true);
 
@@ -16,6 +17,7 @@ LcdCanvas::LcdCanvas(wxWindow* parent, wxWindowID id, const wxPoint& pos,
 }
 
 void LcdCanvas::CanvasRender() {
+  SDGBC_TRACE_ZONE("LcdCanvas::CanvasRender");
   clear();
 
   // save current view & create a view scaling the LCD to fit the canvas
@@ -40,11 +42,12 @@ void LcdCanvas::CanvasRender() {
 
   setView(newView);
 
-  // refresh the texture if a new frame was just finished
-  if (lcdTextureNeedsRefresh_) {
-    std::unique_lock<std::mutex> lock(lcdFrontBufferMutex_);
-    lcdTexture_.loadFromImage(*lcdFrontBuffer_);
-    lcdTextureNeedsRefresh_ = false;
+  // if a new frame was finished, take it and hand back our old front buffer
+  if (lcdReadyIndex_.load(std::memory_order_relaxed) & kLcdFreshFrameBit) {
+    lcdFrontIndex_ = lcdReadyIndex_.exchange(lcdFrontIndex_,
+                                             std::memory_order_acq_rel)
+                     & ~kLcdFreshFrameBit;
+    lcdTexture_.loadFromImage(lcdFrameBuffers_[lcdFrontIndex_]);
   }
 
   draw(sf::Sprite(lcdTexture_));
@@ -54,30 +57,28 @@ void LcdCanvas::CanvasRender() {
 }
 
 void LcdCanvas::LcdRefresh() {
-  {
-    std::unique_lock<std::mutex> lockFront(lcdFrontBufferMutex_);
-    std::swap(lcdFrontBuffer_, lcdBackBuffer_);
-  }
-  lcdTextureNeedsRefresh_ = true;
+  SDGBC_TRACE_ZONE("LcdCanvas::LcdRefresh");
+  // publish the finished frame and carry on drawing into whichever buffer was
+  // ready before. if the main thread never took that frame, it is just dropped
+  lcdBackIndex_ = lcdReadyIndex_.exchange(lcdBackIndex_ | kLcdFreshFrameBit,
+                                          std::memory_order_acq_rel)
+                  & ~kLcdFreshFrameBit;
+
+  // only wakes the main thread up; the drawing happens there
   SfmlCanvas::CanvasRender();
 }
 
 void LcdCanvas::ClearToWhite() {
-  lcdBackBuffer_->create(kLcdWidthPixels, kLcdHeightPixels,
-                         sf::Color(0xff, 0xff, 0xff));
-  {
-    std::unique_lock<std::mutex> lockFront(lcdFrontBufferMutex_);
-    lcdFrontBuffer_->create(kLcdWidthPixels, kLcdHeightPixels,
-                            sf::Color(0xff, 0xff, 0xff));
-  }
-
+  lcdFrameBuffers_[lcdBackIndex_].create(kLcdWidthPixels, kLcdHeightPixels,
+                                         sf::Color(0xff, 0xff, 0xff));
   LcdRefresh();
 }
 
 void LcdCanvas::LcdPutPixel(unsigned int x, unsigned int y,
                             const RgbColor& color) {
   if (x < kLcdWidthPixels && y < kLcdHeightPixels) {
-    lcdBackBuffer_->setPixel(x, y, sf::Color(color.r, color.g, color.b));
+    lcdFrameBuffers_[lcdBackIndex_].setPixel(x, y, sf::Color(color.r, color.g,
+                                                             color.b));
   }
 }
 
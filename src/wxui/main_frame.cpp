@@ -1,18 +1,44 @@
+#include "trace.h"
 #include "wxui/about_dialog.h"
 #include "wxui/joypad_dialog.h"
 #include "wxui/main_frame.h"
 #include "wxui/xpm/xpm.h"
 #include <wx/filename.h>
 
+// rewind history is limited to whichever of these is reached first
+constexpr auto kRewindHistorySeconds = 120u;
+constexpr std::size_t kRewindMaxMemoryBytes = 64 * 1024 * 1024;
+
+constexpr auto kMaxRunAheadFrames = 4u;
+
+// speed multipliers offered for fast-forwarding, 0 being unlimited
+constexpr unsigned int kFastForwardSpeeds[] = {2, 4, 8, 0};
+constexpr auto kNumFastForwardSpeeds = static_cast<int>(
+    sizeof(kFastForwardSpeeds) / sizeof(kFastForwardSpeeds[0]));
+constexpr auto kTitleTimerIntervalMillis = 1000;
+constexpr auto kStatsTimerIntervalMillis = 500;
+
 enum MenuItemId {
   kMenuIdOpenRomFile = wxID_HIGHEST + 1,
   kMenuIdImportBattery,
   kMenuIdExportBattery,
+  kMenuIdStartMovie,
+  kMenuIdStopMovie,
 
   kMenuIdReset,
   kMenuIdResetInDmgMode,
   kMenuIdPause,
   kMenuIdLimitFramerate,
+  kMenuIdFastForward,
+  kMenuIdFastForwardSpeedFirst,
+  kMenuIdFastForwardSpeedLast = kMenuIdFastForwardSpeedFirst
+                                + kNumFastForwardSpeeds - 1,
+  kMenuIdEnableRewind,
+  kMenuIdRunAheadOff,
+  kMenuIdRunAheadLast = kMenuIdRunAheadOff + kMaxRunAheadFrames,
+  kMenuIdShowStats,
+  kMenuIdCountHwEvents,
+  kMenuIdRecordTrace,
 
   kMenuIdEnableBg,
   kMenuIdEnableBgWindow,
@@ -31,6 +57,12 @@ enum MenuItemId {
   kMenuIdJoypadControls
 };
 
+// after the menu items, so that timer and menu events don't share ids
+enum TimerId {
+  kTimerIdTitle = kMenuIdJoypadControls + 1,
+  kTimerIdStats
+};
+
 wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
   EVT_CLOSE(MainFrame::OnClose)
   EVT_SIZE(MainFrame::OnSize)
@@ -42,11 +74,24 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
   EVT_MENU(kMenuIdOpenRomFile, MainFrame::OnOpenRomFile)
   EVT_MENU(kMenuIdImportBattery, MainFrame::OnImportBattery)
   EVT_MENU(kMenuIdExportBattery, MainFrame::OnExportBattery)
+  EVT_MENU(kMenuIdStartMovie, MainFrame::OnStartMovie)
+  EVT_MENU(kMenuIdStopMovie, MainFrame::OnStopMovie)
 
   EVT_MENU(kMenuIdReset, MainFrame::OnReset)
   EVT_MENU(kMenuIdResetInDmgMode, MainFrame::OnResetInDmgMode)
   EVT_MENU(kMenuIdPause, MainFrame::OnPause)
   EVT_MENU(kMenuIdLimitFramerate, MainFrame::OnLimitFramerate)
+  EVT_MENU(kMenuIdFastForward, MainFrame::OnFastForward)
+  EVT_MENU_RANGE(kMenuIdFastForwardSpeedFirst, kMenuIdFastForwardSpeedLast,
+                 MainFrame::OnFastForwardSpeed)
+  EVT_MENU(kMenuIdEnableRewind, MainFrame::OnEnableRewind)
+  EVT_MENU_RANGE(kMenuIdRunAheadOff, kMenuIdRunAheadLast,
+                 MainFrame::OnRunAhead)
+  EVT_MENU(kMenuIdShowStats, MainFrame::OnShowStats)
+  EVT_MENU(kMenuIdCountHwEvents, MainFrame::OnCountHwEvents)
+  EVT_MENU(kMenuIdRecordTrace, MainFrame::OnRecordTrace)
+  EVT_TIMER(kTimerIdTitle, MainFrame::OnTitleTimer)
+  EVT_TIMER(kTimerIdStats, MainFrame::OnStatsTimer)
 
   EVT_MENU(kMenuIdEnableBg, MainFrame::OnEnableBg)
   EVT_MENU(kMenuIdEnableBgWindow, MainFrame::OnEnableBgWindow)
@@ -68,7 +113,8 @@ wxBEGIN_EVENT_TABLE(MainFrame, wxFrame)
 wxEND_EVENT_TABLE()
 
 MainFrame::MainFrame()
-    : wxFrame(nullptr, wxID_ANY, "sdgbc"), lcdCanvas_(nullptr) {
+    : wxFrame(nullptr, wxID_ANY, "sdgbc"), lcdCanvas_(nullptr),
+      titleTimer_(this, kTimerIdTitle), statsTimer_(this, kTimerIdStats) {
   // create a bundle of all our different sized icons to use as the window icon
   wxIconBundle iconBundle;
   iconBundle.AddIcon(wxIcon(xpmSdgbc16));
@@ -80,6 +126,8 @@ MainFrame::MainFrame()
   iconBundle.AddIcon(wxIcon(xpmSdgbc256));
   SetIcons(iconBundle);
 
+  trace::SetThreadName("ui");
+
   // create menu items
   auto menuFile = new wxMenu;
   menuFile->Append(kMenuIdOpenRomFile, "&Open ROM File...\tCtrl+O");
@@ -89,6 +137,9 @@ MainFrame::MainFrame()
   menuFile->Append(kMenuIdExportBattery,
                    "&Export Battery-Packed RAM Snapshot...");
   menuFile->AppendSeparator();
+  menuFile->Append(kMenuIdStartMovie, "Start Recording &Movie");
+  menuFile->Append(kMenuIdStopMovie, "Stop Recording Movie...");
+  menuFile->AppendSeparator();
   menuFile->Append(wxID_EXIT);
 
   auto menuEmulator = new wxMenu;
@@ -104,6 +155,37 @@ MainFrame::MainFrame()
   menuEmulator->AppendSeparator();
   menuEmulator->AppendCheckItem(kMenuIdLimitFramerate,
                                 "&Limit Emulation Speed\tCtrl+L");
+  menuEmulator->AppendCheckItem(kMenuIdFastForward, "&Fast-Forward\tCtrl+F");
+
+  auto menuFastForwardSpeed = new wxMenu;
+  for (auto i = 0; i < kNumFastForwardSpeeds; ++i) {
+    const auto speed = kFastForwardSpeeds[i];
+    menuFastForwardSpeed->AppendRadioItem(
+        kMenuIdFastForwardSpeedFirst + i,
+        speed > 0 ? wxString::Format("&%ux", speed) : wxString("&Unlimited"));
+  }
+  menuEmulator->AppendSubMenu(menuFastForwardSpeed, "Fast-Forward &Speed");
+
+  menuEmulator->AppendCheckItem(kMenuIdEnableRewind,
+                                "Enable Re&wind (Hold Backspace)");
+
+  auto menuRunAhead = new wxMenu;
+  menuRunAhead->AppendRadioItem(kMenuIdRunAheadOff, "&Off");
+  for (auto i = 1u; i <= kMaxRunAheadFrames; ++i) {
+    menuRunAhead->AppendRadioItem(kMenuIdRunAheadOff + i,
+                                  wxString::Format("&%u Frame%s", i,
+                                                   i > 1 ? "s" : ""));
+  }
+  menuEmulator->AppendSubMenu(menuRunAhead, "Run-&Ahead");
+
+  menuEmulator->AppendSeparator();
+  menuEmulator->AppendCheckItem(kMenuIdShowStats,
+                                "Show Performance S&tats\tCtrl+T");
+  menuEmulator->AppendCheckItem(kMenuIdCountHwEvents,
+                                "Count Host &Hardware Events");
+  if (kTraceZonesEnabled) {
+    menuEmulator->AppendCheckItem(kMenuIdRecordTrace, "Record Tr&ace");
+  }
 
   auto menuVideo = new wxMenu;
   menuVideo->AppendCheckItem(kMenuIdEnableBg, "Render Background Layer");
@@ -190,7 +272,29 @@ void MainFrame::UpdateTitle() {
           << (emulator_.IsPaused() ? " (Paused)" : "")
           << (emulator_.GetCartridgeExtMeta().hasBattery ? " [Battery]" : "")
           << (emulator_.IsInCgbMode() ? "" : " [Game Boy compatibility mode]")
-          << " - ";
+          << (emulator_.IsRecordingMovie() ? " [Recording Movie]" : "");
+
+    if (emulator_.IsFastForwarding()) {
+      const auto speed = emulator_.GetFastForwardSpeed();
+      title << (speed > 0 ? wxString::Format(" (Fast-Forward: %ux)", speed)
+                          : wxString(" (Fast-Forward: Unlimited)"));
+    }
+
+    const auto runAheadFrames = emulator_.GetRunAheadFrames();
+    if (runAheadFrames > 0) {
+      title << wxString::Format(" [Run-Ahead: %u, %.0f us/frame]",
+                                runAheadFrames,
+                                emulator_.GetRunAheadCostMicros());
+    }
+
+    if (emulator_.IsRewinding()) {
+      title << wxString::Format(" (Rewinding: %.1fs left, %.1f MiB used)",
+                                emulator_.GetRewindHistorySeconds(),
+                                emulator_.GetRewindMemoryUsage()
+                                / (1024.0 * 1024.0));
+    }
+
+    title << " - ";
   }
 
   title << "sdgbc";
@@ -207,11 +311,22 @@ void MainFrame::UpdateMenu() {
   // file menu
   menu->Enable(kMenuIdImportBattery, romBattery);
   menu->Enable(kMenuIdExportBattery, romBattery);
+  menu->Enable(kMenuIdStartMovie, romLoaded && !emulator_.IsRecordingMovie());
+  menu->Enable(kMenuIdStopMovie, emulator_.IsRecordingMovie());
 
   // emulation menu
   menu->Enable(kMenuIdReset, romLoaded);
   menu->Enable(kMenuIdResetInDmgMode, romLoaded);
   menu->Check(kMenuIdLimitFramerate, emulator_.IsLimitingFramerate());
+  menu->Check(kMenuIdFastForward, emulator_.IsFastForwarding());
+  for (auto i = 0; i < kNumFastForwardSpeeds; ++i) {
+    if (kFastForwardSpeeds[i] == emulator_.GetFastForwardSpeed()) {
+      menu->Check(kMenuIdFastForwardSpeedFirst + i, true);
+    }
+  }
+  menu->Check(kMenuIdEnableRewind, emulator_.IsRewindEnabled());
+  menu->Check(kMenuIdRunAheadOff + emulator_.GetRunAheadFrames(), true);
+  menu->Check(kMenuIdShowStats, GetStatusBar() != nullptr);
 
   // video menu
   menu->Check(kMenuIdEnableBg, emulator_.IsVideoBgRenderEnabled());
@@ -235,6 +350,53 @@ void MainFrame::UpdateMenu() {
               emulator_.AreJoypadImpossibleInputsAllowed());
 }
 
+void MainFrame::UpdateStatsBar() {
+  const auto stats = emulator_.GetStats();
+
+  SetStatusText(wxString::Format("%.1f fps (%.0f%%), %.2f MIPS, %.0f%% idle",
+                                 stats.framesPerSecond, stats.speedPercent,
+                                 stats.instructionsPerSecond / 1e6,
+                                 stats.idlePercent), 0);
+  if (stats.hasUpdateTimes) {
+    SetStatusText(wxString::Format("%.0f us/frame: CPU %.0f, PPU %.0f, "
+                                   "APU %.0f, other %.0f",
+                                   stats.emulateMicros, stats.cpuMicros,
+                                   stats.ppuMicros, stats.apuMicros,
+                                   stats.otherMicros), 1);
+  } else {
+    SetStatusText(wxString::Format("%.0f us/frame", stats.emulateMicros), 1);
+  }
+  SetStatusText(wxString::Format("%llu skipped, audio %llu/%llu under/overruns"
+                                 ", %.1f us/frame lock wait",
+                                 static_cast<unsigned long long>(
+                                     stats.numFramesSkipped),
+                                 static_cast<unsigned long long>(
+                                     stats.numAudioUnderruns),
+                                 static_cast<unsigned long long>(
+                                     stats.numAudioOverruns),
+                                 stats.lockWaitMicros), 2);
+
+  const auto openResult = emulator_.GetPerfCountersOpenResult();
+  wxString perfText;
+  if (!emulator_.IsPerfCountersEnabled()) {
+    perfText = "Hardware events not counted";
+  } else if (openResult != PerfCountersOpenResult::Ok) {
+    perfText = GetPerfCountersOpenResultAsMessage(openResult);
+  } else if (stats.hasPerfCounts) {
+    const auto& counts = stats.perfCountsPerFrame;
+    perfText = wxString::Format(
+        "%.2f IPC, %llu branch/%llu L1d misses per frame",
+        counts[kPerfCounterCycles] > 0
+            ? static_cast<double>(counts[kPerfCounterInstructions])
+                  / counts[kPerfCounterCycles]
+            : 0.0,
+        static_cast<unsigned long long>(counts[kPerfCounterBranchMisses]),
+        static_cast<unsigned long long>(counts[kPerfCounterL1dMisses]));
+  }
+
+  SetStatusText(perfText, 3);
+}
+
 bool MainFrame::LoadCartridgeRomFile(std::string filePath) {
   // prompt the user for a file if empty filePath given
   if (filePath.empty()) {
@@ -366,6 +528,34 @@ void MainFrame::OnExportBattery(wxCommandEvent&) {
   ExportCartridgeBatteryExtRam();
 }
 
+void MainFrame::OnStartMovie(wxCommandEvent&) {
+  emulator_.StartMovieRecording();
+  UpdateUIState();
+}
+
+void MainFrame::OnStopMovie(wxCommandEvent&) {
+  emulator_.StopMovieRecording();
+  UpdateUIState();
+
+  wxFileDialog saveFileDialog(this, "Save Movie", wxEmptyString,
+                              wxEmptyString,
+                              "sdgbc Movie (*.sdgm)|*.sdgm|"
+                              "All Files (*.*)|*.*",
+                              wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+
+  if (saveFileDialog.ShowModal() == wxID_CANCEL) {
+    return;
+  }
+
+  if (!emulator_.SaveMovieFile(saveFileDialog.GetPath().ToStdString())) {
+    wxMessageDialog(this,
+                    "Failed to save movie file! Ensure that the file is "
+                    "writable and try again.",
+                    "Movie save failed", wxICON_ERROR | wxOK | wxCENTER)
+        .ShowModal();
+  }
+}
+
 void MainFrame::OnPause(wxCommandEvent& event) {
   emulator_.SetPaused(event.IsChecked());
   UpdateUIState();
@@ -385,6 +575,96 @@ void MainFrame::OnLimitFramerate(wxCommandEvent& event) {
   emulator_.SetLimitFramerate(event.IsChecked());
 }
 
+void MainFrame::OnFastForward(wxCommandEvent& event) {
+  emulator_.SetFastForwarding(event.IsChecked());
+  UpdateTitle();
+}
+
+void MainFrame::OnFastForwardSpeed(wxCommandEvent& event) {
+  emulator_.SetFastForwardSpeed(
+      kFastForwardSpeeds[event.GetId() - kMenuIdFastForwardSpeedFirst]);
+  UpdateTitle();
+}
+
+void MainFrame::OnEnableRewind(wxCommandEvent& event) {
+  if (event.IsChecked()) {
+    emulator_.SetRewindConfig(kRewindHistorySeconds, kRewindMaxMemoryBytes);
+  } else {
+    emulator_.SetRewindConfig(0, 0, 0);
+  }
+}
+
+void MainFrame::OnRunAhead(wxCommandEvent& event) {
+  const auto numFrames = static_cast<unsigned int>(event.GetId()
+                                                   - kMenuIdRunAheadOff);
+  emulator_.SetRunAheadFrames(numFrames);
+
+  // keep the cost shown in the title up to date while running ahead
+  if (numFrames > 0) {
+    titleTimer_.Start(kTitleTimerIntervalMillis);
+  } else {
+    titleTimer_.Stop();
+  }
+
+  UpdateTitle();
+}
+
+void MainFrame::OnShowStats(wxCommandEvent& event) {
+  if (event.IsChecked()) {
+    CreateStatusBar(4);
+    UpdateStatsBar();
+    statsTimer_.Start(kStatsTimerIntervalMillis);
+  } else {
+    statsTimer_.Stop();
+
+    const auto statusBar = GetStatusBar();
+    SetStatusBar(nullptr);
+    statusBar->Destroy();
+  }
+
+  // make room for (or reclaim the room taken by) the status bar
+  Layout();
+}
+
+void MainFrame::OnCountHwEvents(wxCommandEvent& event) {
+  emulator_.SetPerfCountersEnabled(event.IsChecked());
+}
+
+void MainFrame::OnRecordTrace(wxCommandEvent& event) {
+  if (event.IsChecked()) {
+    trace::StartRecording();
+    return;
+  }
+
+  trace::StopRecording();
+
+  wxFileDialog saveFileDialog(this, "Save Trace", wxEmptyString,
+                              wxEmptyString,
+                              "Chrome Trace (*.json)|*.json|"
+                              "All Files (*.*)|*.*",
+                              wxFD_SAVE | wxFD_OVERWRITE_PROMPT);
+
+  if (saveFileDialog.ShowModal() == wxID_CANCEL) {
+    return;
+  }
+
+  if (!trace::WriteChromeJsonFile(saveFileDialog.GetPath().ToStdString())) {
+    wxMessageDialog(this,
+                    "Failed to save trace file! Ensure that the file is "
+                    "writable and try again.",
+                    "Trace save failed", wxICON_ERROR | wxOK | wxCENTER)
+        .ShowModal();
+  }
+}
+
+void MainFrame::OnTitleTimer(wxTimerEvent&) {
+  UpdateTitle();
+}
+
+void MainFrame::OnStatsTimer(wxTimerEvent&) {
+  UpdateStatsBar();
+}
+
 void MainFrame::OnEnableBg(wxCommandEvent& event) {
   emulator_.SetVideoBgRenderEnabled(event.IsChecked());
 }
@@ -496,12 +776,32 @@ bool MainFrame::HandleJoypadKeyEvent(wxKeyEvent& event) {
   }
 }
 
+bool MainFrame::HandleRewindKeyEvent(wxKeyEvent& event) {
+  if (event.GetKeyCode() != WXK_BACK) {
+    return false;
+  }
+  if (!emulator_.IsRewindEnabled()) {
+    // rewind may have been disabled while the key was held down
+    emulator_.SetRewinding(false);
+    return false;
+  }
+
+  // key repeats while held down keep refreshing the history left in the title
+  emulator_.SetRewinding(event.GetEventType() == wxEVT_KEY_DOWN);
+  UpdateTitle();
+  return true;
+}
+
 void MainFrame::OnKeyDown(wxKeyEvent& event) {
-  HandleJoypadKeyEvent(event);
+  if (!HandleRewindKeyEvent(event)) {
+    HandleJoypadKeyEvent(event);
+  }
 }
 
 void MainFrame::OnKeyUp(wxKeyEvent& event) {
-  HandleJoypadKeyEvent(event);
+  if (!HandleRewindKeyEvent(event)) {
+    HandleJoypadKeyEvent(event);
+  }
 }
 
 void MainFrame::RecursivelyConnectKeyEvents(wxWindow* childComponent) {
@@ -1,3 +1,4 @@
+#include "trace.h"
 #include "wxui/sfml_canvas.h"
 
 #ifdef __WXGTK__
@@ -49,6 +50,8 @@ void SfmlCanvas::OnIdle(wxIdleEvent&) {
 }
 
 void SfmlCanvas::OnPaint(wxPaintEvent&) {
+  // includes the time that display() spends waiting for vsync
+  SDGBC_TRACE_ZONE("SfmlCanvas::OnPaint");
   wxPaintDC dc(this); // prepare control to be re-painted
 
   // adjust size of the sfml view to work with wxWidgets properly